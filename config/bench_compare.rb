@@ -0,0 +1,178 @@
+#!/usr/bin/env ruby
+#
+# Runs the client microbenchmarks and a fixed load against a local C
+# simulator, stores the results as JSON, and compares them with a stored
+# baseline, failing if throughput dropped or p99 latency rose by more than
+# the tolerances. Run with 'make bench-compare' or 'rake bench:compare'.
+#
+# The first run (or any run with --update) records the baseline. Baselines
+# are specific to the machine they were recorded on.
+
+require 'json'
+require 'optparse'
+require 'fileutils'
+
+options = {
+  microbench: './bin/kinetic-c-microbench',
+  simulator: './bin/kinetic-c-simulator',
+  load_generator: './bin/kinetic-bench',
+  baseline_dir: './build/bench',
+  tolerance: 10.0,
+  latency_tolerance: 25.0,
+  min_time: 0.5,
+  repeat: 3,
+  duration: 5,
+  update: false,
+}
+
+OptionParser.new do |opts|
+  opts.banner = "Usage: #{$0} [options]"
+  opts.on('--microbench PATH', 'Microbenchmark executable') { |v| options[:microbench] = v }
+  opts.on('--simulator PATH', 'Simulator executable') { |v| options[:simulator] = v }
+  opts.on('--load-generator PATH', 'kinetic-bench executable') { |v| options[:load_generator] = v }
+  opts.on('--baseline-dir DIR', "Directory of results (default: #{options[:baseline_dir]})") do |v|
+    options[:baseline_dir] = v
+  end
+  opts.on('--tolerance PCT', Float, "Allowed throughput drop (default: #{options[:tolerance]}%)") do |v|
+    options[:tolerance] = v
+  end
+  # p99 latencies are reported at the resolution of the latency histogram
+  # buckets, which are ~19% apart, so a smaller tolerance would fail on noise
+  opts.on('--latency-tolerance PCT', Float,
+          "Allowed p99 latency rise (default: #{options[:latency_tolerance]}%)") do |v|
+    options[:latency_tolerance] = v
+  end
+  opts.on('--min-time SECS', Float, 'Minimum time of each microbenchmark') { |v| options[:min_time] = v }
+  opts.on('--repeat N', Integer, "Microbenchmark runs, keeping the fastest (default: #{options[:repeat]})") do |v|
+    options[:repeat] = v
+  end
+  opts.on('--duration SECS', Integer, 'Duration of the load run') { |v| options[:duration] = v }
+  opts.on('--update', 'Record the results as the new baseline') { options[:update] = true }
+end.parse!
+
+# The load run is fixed, so that results are comparable between runs
+LOAD_ARGS = %w[--threads 2 --keys 1000 --value-size 4096 --mix put=50,get=50
+               --prefill --seed 1 --interval 0 --json]
+
+# Keeps the fastest of several runs of each benchmark, since interference
+# from the rest of the machine only ever slows a run down
+def run_microbenchmarks(options)
+  best = {}
+  options[:repeat].times do |run|
+    puts "Running microbenchmarks (#{run + 1}/#{options[:repeat]})..."
+    output = IO.popen([options[:microbench], '-t', options[:min_time].to_s], &:read)
+    raise "Microbenchmarks failed!" unless $?.success?
+    output.lines.map { |line| JSON.parse(line) }.each do |result|
+      name = result['name']
+      best[name] = result if best[name].nil? || result['ns_per_op'] < best[name]['ns_per_op']
+    end
+  end
+  best
+end
+
+def with_simulator(options)
+  simulator = IO.popen([options[:simulator], '--host', '127.0.0.1', '--port', '0'])
+  line = simulator.gets
+  port = line && line[/:(\d+)/, 1]
+  raise "Failed starting simulator!" if port.nil?
+  yield port.to_i
+ensure
+  if simulator
+    Process.kill('TERM', simulator.pid) rescue nil
+    simulator.close
+  end
+end
+
+def run_load(options)
+  puts "Running #{options[:duration]}s load against the simulator..."
+  with_simulator(options) do |port|
+    args = [options[:load_generator], '--host', '127.0.0.1', '--port', port.to_s,
+            '--duration', options[:duration].to_s] + LOAD_ARGS
+    output = IO.popen(args, &:read)
+    raise "Load run failed!" unless $?.success?
+    result = JSON.parse(output.lines.last)
+    errors = result['ops'].values.map { |op| op['errors'] }.sum
+    raise "Load run had #{errors} failed operations!" if errors > 0
+    result
+  end
+end
+
+# Flattens results to metric => [value, higher_is_better]
+def metrics(results)
+  flat = {}
+  results['microbenchmarks'].each do |name, result|
+    flat["micro/#{name} ns/op"] = [result['ns_per_op'], false]
+  end
+  load = results['load']
+  flat['load ops/s'] = [load['ops_per_s'], true]
+  load['ops'].each do |op, result|
+    flat["load/#{op} ops/s"] = [result['ops_per_s'], true]
+    flat["load/#{op} p99 us"] = [result['p99_us'], false]
+  end
+  flat
+end
+
+def compare(baseline, current, options)
+  base = metrics(baseline)
+  rows = []
+  regressions = 0
+  metrics(current).each do |name, (value, higher_is_better)|
+    if base[name].nil?
+      rows << [name, '-', format('%.1f', value), '-', 'new']
+      next
+    end
+    before = base[name][0]
+    change = before.zero? ? 0.0 : (value - before) * 100.0 / before
+    worse = higher_is_better ? -change : change
+    tolerance = name.end_with?('p99 us') ? options[:latency_tolerance] : options[:tolerance]
+    status = if worse > tolerance
+               regressions += 1
+               'REGRESSED'
+             elsif worse < -tolerance
+               'improved'
+             else
+               'ok'
+             end
+    rows << [name, format('%.1f', before), format('%.1f', value),
+             format('%+.1f%%', change), status]
+  end
+
+  header = ['Metric', 'Baseline', 'Current', 'Change', 'Status']
+  widths = header.each_index.map { |i| ([header] + rows).map { |row| row[i].length }.max }
+  line = lambda do |row|
+    row.each_with_index.map { |cell, i| i == 0 ? cell.ljust(widths[i]) : cell.rjust(widths[i]) }.join('  ')
+  end
+  puts
+  puts line.call(header)
+  puts widths.map { |w| '-' * w }.join('  ')
+  rows.each { |row| puts line.call(row) }
+  puts
+  regressions
+end
+
+current = {
+  'recorded' => Time.now.utc.strftime('%Y-%m-%dT%H:%M:%SZ'),
+  'microbenchmarks' => run_microbenchmarks(options),
+  'load' => run_load(options),
+}
+
+FileUtils.mkdir_p(options[:baseline_dir])
+latest_path = File.join(options[:baseline_dir], 'latest.json')
+baseline_path = File.join(options[:baseline_dir], 'baseline.json')
+File.write(latest_path, JSON.pretty_generate(current) + "\n")
+
+if options[:update] || !File.exist?(baseline_path)
+  FileUtils.cp(latest_path, baseline_path)
+  puts "Recorded baseline: #{baseline_path}"
+  exit 0
+end
+
+baseline = JSON.parse(File.read(baseline_path))
+puts "Comparing with baseline recorded #{baseline['recorded']} (#{baseline_path})"
+regressions = compare(baseline, current, options)
+if regressions > 0
+  puts "FAILED: #{regressions} metric(s) regressed beyond tolerance " \
+       "(throughput: #{options[:tolerance]}%, p99 latency: #{options[:latency_tolerance]}%)"
+  exit 1
+end
+puts "No regressions beyond tolerance"
@@ -30,6 +30,201 @@
  */
 void KineticClient_Init(const char* logFile);
 
+/**
+ * @brief Configures log filtering. Messages below the specified level, or from
+ * subsystems not in the specified mask, are discarded without being formatted.
+ * Must be called after KineticClient_Init(), which resets these to defaults.
+ *
+ * @param level         Minimum severity level to log
+ * @param subsystems    Mask of KINETIC_LOG_SUBSYSTEM_* flags to log
+ * @param protobufSampleRate  Log only 1 in N full protobuf dumps (0 or 1 logs all)
+ *
+ * @return              Returns the resulting KineticStatus
+ */
+KineticStatus KineticClient_ConfigureLogging(KineticLogLevel level,
+        uint32_t subsystems, uint32_t protobufSampleRate);
+
+/**
+ * @brief Enables binary tracing. A fixed-format record of every PDU sent and
+ * received is written into a ring of records in a memory-mapped file, which
+ * can be rendered to the text log format offline with `kinetic-c-trace`.
+ * A trace already enabled is closed first. May be called while operations
+ * are in progress, including those of write-back buffers, key filters and
+ * cluster rebuilds on threads of their own.
+ *
+ * @param traceFile     Path of the trace file to create
+ * @param records       Number of records retained in the ring (0 for default)
+ * @param captureBytes  Max packed protobuf size to capture per record
+ *                      (0 records only the fixed-format fields)
+ *
+ * @return              Returns the resulting KineticStatus
+ */
+KineticStatus KineticClient_StartTrace(const char* traceFile,
+                                       uint32_t records, uint32_t captureBytes);
+
+/**
+ * @brief Disables binary tracing and closes the trace file, once the PDUs
+ * being recorded by other threads are. May be called while operations are
+ * in progress.
+ */
+void KineticClient_StopTrace(void);
+
+/**
+ * @brief Collects operation statistics: latency histograms for each message
+ * type, byte, operation, syscall and per-KineticStatus result counters.
+ * Process-wide counters are kept per thread and summed when collected, so
+ * collection may be slightly out of date w.r.t. operations in progress.
+ * Only requests executed with the device are counted, so operations the
+ * session serves itself (from its write-back buffer, key filter or read
+ * cache) are not, though the GETVERSION checking a cached entry is.
+ *
+ * @param handle    Session to collect statistics for, or KINETIC_HANDLE_INVALID
+ *                  to collect process-wide statistics
+ * @param stats     Structure to populate with the statistics
+ *
+ * @return          Returns the resulting KineticStatus
+ */
+KineticStatus KineticClient_GetStats(KineticSessionHandle handle, KineticStats* stats);
+
+/**
+ * @brief Resets operation statistics.
+ *
+ * @param handle    Session to reset statistics for, or KINETIC_HANDLE_INVALID
+ *                  to reset process-wide statistics
+ *
+ * @return          Returns the resulting KineticStatus
+ */
+KineticStatus KineticClient_ResetStats(KineticSessionHandle handle);
+
+/**
+ * @brief Computes a latency percentile from a histogram collected with
+ * KineticClient_GetStats().
+ *
+ * @param histogram     Latency histogram
+ * @param percentile    Percentile to compute (0.0 to 100.0)
+ *
+ * @return              Returns the upper bound of the bucket holding the
+ *                      percentile, in nanoseconds (0 if the histogram is empty)
+ */
+uint64_t KineticClient_GetLatencyPercentile(const KineticLatencyHistogram* histogram,
+                                            double percentile);
+
+/**
+ * @brief Enables/disables operation timing. When enabled, the time spent in
+ * each stage of an operation (build, HMAC, pack, send, wait, receive, decode)
+ * is measured, and recorded in the `stages` histograms of the statistics
+ * collected with KineticClient_GetStats(). When disabled, no timestamps are
+ * taken for stages.
+ *
+ * @param enabled   Whether operation timing should be enabled
+ */
+void KineticClient_SetOperationTiming(bool enabled);
+
+/**
+ * @brief Retrieves the stage timing of the last operation completed by the
+ * calling thread while operation timing was enabled.
+ *
+ * @param timing    Structure to populate with the operation timing
+ *
+ * @return          Returns KINETIC_STATUS_SUCCESS, or KINETIC_STATUS_NOT_ATTEMPTED
+ *                  if no operation has been timed on the calling thread
+ */
+KineticStatus KineticClient_GetLastOperationTiming(KineticOperationTiming* timing);
+
+/**
+ * @brief Registers tracing hooks, which are called when each operation starts,
+ * once its request has been fully written, when the first bytes of its
+ * response are received, and when it completes. Callbacks are invoked on the
+ * thread executing the operation, without any library locks held, so they
+ * may block but should be brief, since the operation waits on them.
+ *
+ * @param hooks     Hooks to register, or NULL to unregister. The hooks are not
+ *                  copied, so must remain valid until replaced and any
+ *                  operations in progress have completed.
+ */
+void KineticClient_SetHooks(const KineticHooks* hooks);
+
+/**
+ * @brief Configures the response decode stage. When enabled, protobuf unpacking,
+ * HMAC validation and status mapping of responses are performed by a pool of
+ * worker threads, so the thread reading from the socket only frames PDUs and
+ * can receive the value payload while the response is being decoded. Where
+ * requests are pipelined (write-back flushes and cluster replicas), the
+ * responses which follow are also read while earlier ones decode. Responses
+ * are still completed in order on each connection.
+ *
+ * @param workers   Number of decode worker threads (0 disables the decode
+ *                  stage, and responses are decoded by the reading thread)
+ *
+ * @return          Returns the resulting KineticStatus
+ */
+KineticStatus KineticClient_SetDecodeWorkers(int workers);
+
+/**
+ * @brief Collects statistics of the read cache of a session, enabled by setting
+ * `readCacheBytes` in its configuration (all zero if not enabled).
+ *
+ * @param handle    KineticSessionHandle for a connected session
+ * @param stats     Structure to populate with the statistics
+ *
+ * @return          Returns the resulting KineticStatus
+ */
+KineticStatus KineticClient_GetCacheStats(KineticSessionHandle handle,
+                                          KineticCacheStats* stats);
+
+/**
+ * @brief Collects statistics of the cache file of a session, enabled by setting
+ * `readCacheFile` in its configuration (all zero if not enabled). `entries`
+ * includes entries recovered from the file when the session connected.
+ *
+ * @param handle    KineticSessionHandle for a connected session
+ * @param stats     Structure to populate with the statistics
+ *
+ * @return          Returns the resulting KineticStatus
+ */
+KineticStatus KineticClient_GetCacheFileStats(KineticSessionHandle handle,
+                                              KineticCacheStats* stats);
+
+/**
+ * @brief Collects statistics of the write-back buffer of a session, enabled by
+ * setting `writeBackBytes` in its configuration (all zero if not enabled).
+ *
+ * @param handle    KineticSessionHandle for a connected session
+ * @param stats     Structure to populate with the statistics
+ *
+ * @return          Returns the resulting KineticStatus
+ */
+KineticStatus KineticClient_GetWriteBackStats(KineticSessionHandle handle,
+                                              KineticWriteBackStats* stats);
+
+/**
+ * @brief Collects statistics of the key filter of a session, enabled by
+ * setting `keyFilterBytes` in its configuration (all zero if not enabled),
+ * including its expected and measured false positive rates.
+ *
+ * @param handle    KineticSessionHandle for a connected session
+ * @param stats     Structure to populate with the statistics
+ *
+ * @return          Returns the resulting KineticStatus
+ */
+KineticStatus KineticClient_GetKeyFilterStats(KineticSessionHandle handle,
+                                              KineticKeyFilterStats* stats);
+
+/**
+ * @brief Rebuilds the key filter of a session from the keys on the device,
+ * waiting for the build to complete. GETs of keys PUT through other sessions
+ * since the last build fail with KINETIC_STATUS_DATA_ERROR, as if the keys
+ * did not exist, until the filter is rebuilt, so the filter is only correct
+ * if the session is the only writer of the device.
+ *
+ * @param handle    KineticSessionHandle for a connected session
+ *
+ * @return          Returns the resulting KineticStatus, which is
+ *                  KINETIC_STATUS_NOT_ATTEMPTED if the key filter is not
+ *                  enabled for the session
+ */
+KineticStatus KineticClient_RebuildKeyFilter(KineticSessionHandle handle);
+
 /**
  * @brief Initializes the Kinetic API, configures logging destination, establishes a
  * connection to the specified Kinetic Device, and establishes a session.
@@ -41,6 +236,10 @@ void KineticClient_Init(const char* logFile);
  *  .clusterVersion     Cluster version to use for the session
  *  .identity           Identity to use for the session
  *  .hmacKey            Key to use for HMAC calculations (NULL-terminated string)
+ *  .readCacheBytes     Memory for a cache of entries read/written by the
+ *                      session, revalidated with GETVERSION (0 to disable)
+ *  .writeBackBytes     Memory for buffering forced PUTs of the session,
+ *                      written in the background (0 to disable)
  * @handle          Pointer to KineticSessionHandle (populated upon successful connection)
  *
  * @return          Returns the resulting KineticStatus
@@ -81,6 +280,12 @@ KineticStatus KineticClient_Put(KineticSessionHandle handle,
 /**
  * @brief Executes a GET command to retrieve and entry from the Kinetic Device.
  *
+ * If the session has a key filter (see `keyFilterBytes`), GETs of keys it
+ * excludes fail with KINETIC_STATUS_DATA_ERROR without a request. Keys PUT
+ * through other sessions since the filter was last built are excluded too,
+ * so only enable the filter for a session which is the only writer of the
+ * device.
+ *
  * @param handle        KineticSessionHandle for a connected session.
  * @param metadata      Key/value metadata for object to retrieve. 'value' will
  *                      be populated unless 'metadataOnly' is set to 'true'
@@ -90,6 +295,39 @@ KineticStatus KineticClient_Put(KineticSessionHandle handle,
 KineticStatus KineticClient_Get(KineticSessionHandle handle,
                                 KineticEntry* const metadata);
 
+/**
+ * @brief Waits for any PUTs buffered by the write-back buffer of the session
+ * to be written, then executes a FLUSHALLDATA command to persist all entries
+ * written with KINETIC_SYNCHRONIZATION_WRITEBACK
+ *
+ * @param handle        KineticSessionHandle for a connected session.
+ *
+ * @return              Returns the resulting KineticStatus
+ */
+KineticStatus KineticClient_Flush(KineticSessionHandle handle);
+
+/**
+ * @brief Updates an entry with a compare-and-swap PUT, retrying if the entry
+ * changes concurrently. The last entry read or written by the session is used
+ * if known, so only a PUT is needed unless the entry has since changed.
+ *
+ * @param handle        KineticSessionHandle for a connected session.
+ * @param entry         Key of the entry to update, with buffers for its value,
+ *                      dbVersion and tag. Populated with the updated entry,
+ *                      including its new dbVersion, upon success.
+ * @param update        Function updating the entry (see KineticUpdateFunction).
+ *                      A random newVersion is used if it does not set one.
+ * @param context       Passed to the update function
+ *
+ * @return              Returns the resulting KineticStatus, which is
+ *                      KINETIC_STATUS_NOT_ATTEMPTED if the update is abandoned,
+ *                      or KINETIC_STATUS_VERSION_FAILURE if the entry kept
+ *                      changing concurrently
+ */
+KineticStatus KineticClient_Update(KineticSessionHandle handle,
+                                   KineticEntry* const entry,
+                                   KineticUpdateFunction update, void* context);
+
 /**
  * @brief Executes a DELETE command to delete an entry from the Kinetic Device
  *
@@ -121,4 +359,26 @@ KineticStatus KineticClient_Delete(KineticSessionHandle handle,
 KineticStatus KineticClient_GetKeyRange(KineticSessionHandle handle,
                                         KineticKeyRange* range, ByteBuffer* keys[], int max_keys);
 
+/**
+ * @brief Executes PEER2PEERPUSH commands, which copy entries from the Kinetic
+ * Device directly to a peer device, without their values passing through the
+ * client. The operations are pushed in batches sized to the limits the
+ * device reports with GETLOG (writes outstanding and message size),
+ * which are read with the first push of each connection.
+ * The status of each operation is set once its batch completes; operations
+ * of batches which were not pushed are KINETIC_STATUS_NOT_ATTEMPTED.
+ *
+ * @param handle        KineticSessionHandle for a connected session.
+ * @param peer          Host, port and whether to use TLS, for the device to
+ *                      connect to the peer
+ * @param operations    Entries to copy (see KineticP2POperation)
+ * @param count         Number of operations
+ *
+ * @return              Returns KINETIC_STATUS_SUCCESS if all operations
+ *                      succeeded, or the status of the first which failed
+ */
+KineticStatus KineticClient_P2PPush(KineticSessionHandle handle,
+                                    const KineticP2PPeer* const peer,
+                                    KineticP2POperation* const operations, int count);
+
 #endif // _KINETIC_CLIENT_H
@@ -0,0 +1,306 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+
+#ifndef _KINETIC_CLUSTER_H
+#define _KINETIC_CLUSTER_H
+
+#include "kinetic_types.h"
+
+/**
+ * @brief Connects a session to each of a set of devices, between which keys
+ * are placed by weighted rendezvous hashing: each key is placed on the device
+ * with the highest score, from a hash of the key and the device name scaled
+ * by the weight of the device. Each device receives a share of the keys in
+ * proportion to its weight, and adding a device only moves the keys which
+ * are placed on the new device.
+ *
+ * Clusters, like sessions, must not be used by multiple threads at once.
+ *
+ * @param devices   Devices of the cluster
+ * @param count     Number of devices
+ * @param cluster   Populated with the connected cluster
+ *
+ * @return          Returns the resulting KineticStatus
+ */
+KineticStatus KineticCluster_Connect(const KineticClusterDevice* devices, int count,
+                                     KineticCluster** cluster);
+
+/**
+ * @brief Disconnects the sessions of a cluster, and frees it.
+ *
+ * @param cluster   Cluster to disconnect, set to NULL once disconnected
+ *
+ * @return          Returns the status of the first session which failed to
+ *                  disconnect cleanly, if any
+ */
+KineticStatus KineticCluster_Disconnect(KineticCluster** const cluster);
+
+/**
+ * @brief Connects a session to an additional device of a cluster. Keys placed
+ * on the new device must then be copied to it from the devices on which they
+ * were previously placed (see KineticCluster_GetDeviceFor()).
+ *
+ * @param cluster   Cluster to add the device to
+ * @param device    Device to add, whose name must differ from the others
+ *
+ * @return          Returns the resulting KineticStatus
+ */
+KineticStatus KineticCluster_AddDevice(KineticCluster* const cluster,
+                                       const KineticClusterDevice* device);
+
+/**
+ * @brief Connects a session to a device replacing one of a cluster, e.g.
+ * after a failure. The replacement takes over the name and weight of the
+ * device, so the same keys are placed on it, and the replicas or chunks of
+ * them can be restored with KineticCluster_Rebuild().
+ *
+ * @param cluster       Cluster of the device
+ * @param device        Index of the device to replace
+ * @param replacement   Device replacing it, whose name and weight are unused
+ *
+ * @return              Returns the resulting KineticStatus
+ */
+KineticStatus KineticCluster_ReplaceDevice(KineticCluster* const cluster, int device,
+                                           const KineticClusterDevice* replacement);
+
+/**
+ * @brief Returns the number of devices of a cluster.
+ */
+int KineticCluster_GetDeviceCount(const KineticCluster* const cluster);
+
+/**
+ * @brief Returns the index of the device on which a key is placed, in the
+ * order the devices were added. With replication, this is the first replica.
+ */
+int KineticCluster_GetDeviceFor(const KineticCluster* const cluster,
+                                const ByteBuffer* const key);
+
+/**
+ * @brief Reports the devices on which a key is placed with replication, the
+ * devices with the highest scores for the key, highest first.
+ *
+ * @param cluster   Cluster of the devices
+ * @param key       Key to report the devices of
+ * @param devices   Populated with the indices of the devices
+ * @param count     Number of devices to report, at most
+ *                  KINETIC_CLUSTER_REPLICAS_MAX
+ *
+ * @return          Returns the number of devices reported, which is less than
+ *                  the count if the cluster has fewer devices
+ */
+int KineticCluster_GetReplicas(const KineticCluster* const cluster,
+                               const ByteBuffer* const key,
+                               int* devices, int count);
+
+/**
+ * @brief Returns the session to the device with the specified index, e.g. for
+ * operations of the device not otherwise available through the cluster.
+ * Responses to replicated operations still outstanding on the session are
+ * received first.
+ */
+KineticSessionHandle KineticCluster_GetSession(KineticCluster* const cluster,
+                                               int device);
+
+/**
+ * @brief Replicates each key of a cluster on multiple devices. Each PUT and
+ * DELETE is then sent to all replicas of the key at once, and returns once
+ * the write quorum of them succeed, while the responses of the others are
+ * received with later operations. Each GET reads the entry from the first
+ * replica, and the versions of the entry from as many others as needed for
+ * the read quorum, and returns the version reported by most of them, so
+ * that with a write quorum and read quorum of more than the replicas
+ * together, GETs return the latest successful PUT.
+ *
+ * Replicated operations are pipelined on the sessions of the devices, and
+ * are counted in the statistics of the sessions (KineticClient_GetStats()),
+ * without stage timings. Any PUT of the key buffered by the write-back
+ * buffer of a session is written first, and writes invalidate the key in
+ * the caches of the session and add it to its key filter. GETs are neither
+ * served from nor added to the caches, as the versions of the replicas must
+ * be compared, and hooks are not called for replicated operations, as they
+ * follow one operation at a time per thread. Devices which fail are
+ * reconnected to when next needed.
+ *
+ * @param cluster       Cluster to replicate the keys of
+ * @param replicas      Number of devices to place each key on (1 for none)
+ * @param writeQuorum   Number of replicas which must succeed for a write
+ * @param readQuorum    Number of replicas whose versions a GET compares
+ *
+ * @return              Returns KINETIC_STATUS_INVALID unless the quorums are
+ *                      between 1 and the replicas, and the replicas are at
+ *                      most the devices of the cluster
+ */
+KineticStatus KineticCluster_SetReplication(KineticCluster* const cluster,
+                                            int replicas, int writeQuorum, int readQuorum);
+
+/**
+ * @brief Erasure codes the values of a cluster instead of replicating them.
+ * Each value is split into data chunks, from which Reed-Solomon parity
+ * chunks are computed, and each chunk is stored under the key on one of the
+ * devices with the highest scores for the key (see
+ * KineticCluster_GetReplicas()), so that the value can be recovered from
+ * any of its data chunks' worth of them. Values may be up to the data
+ * chunks times the largest value of a device (less a 16 byte header of
+ * each chunk).
+ *
+ * Each PUT returns once the write quorum of its chunks are stored, and each
+ * DELETE once all chunks are deleted. Each GET reads the data chunks, and
+ * also the parity chunks (a degraded read) if any data chunk fails, or is
+ * not read within the degraded read time, decoding any data chunks missing.
+ * As with replication, operations bypass the caches of the sessions.
+ *
+ * @param cluster           Cluster to erasure code the values of
+ * @param dataChunks        Number of data chunks of each value
+ * @param parityChunks      Number of parity chunks of each value
+ * @param writeQuorum       Number of chunks which must be stored for a PUT,
+ *                          between the data chunks and all chunks
+ * @param degradedReadMs    Milliseconds a GET waits for the data chunks
+ *                          before also reading the parity chunks
+ *
+ * @return                  Returns KINETIC_STATUS_INVALID unless the chunks
+ *                          are at most the devices of the cluster
+ */
+KineticStatus KineticCluster_SetErasureCoding(KineticCluster* const cluster,
+                                              int dataChunks, int parityChunks,
+                                              int writeQuorum, int degradedReadMs);
+
+/**
+ * @brief Reports statistics of the replicated and erasure coded operations
+ * of a cluster.
+ */
+void KineticCluster_GetStats(const KineticCluster* const cluster,
+                             KineticClusterStats* const stats);
+
+/**
+ * @brief Restores the replicas or chunks of the keys placed on a device of a
+ * replicated or erasure coded cluster, e.g. a replacement of a failed device
+ * (see KineticCluster_ReplaceDevice()). The keys are listed with GETKEYRANGE
+ * on the other devices which respond, and each key placed on the device is
+ * read from its others and its replica or chunk reconstructed and written to
+ * the device, a batch of keys in parallel. Entries already on the device,
+ * e.g. written since it was replaced, are not replaced.
+ *
+ * Requests are paced to the limits of the configuration, to bound the load
+ * on the devices. With a checkpoint file, the progress is saved after each
+ * GETKEYRANGE, and a rebuild of the same device restarted later resumes from
+ * it rather than starting over, also once stopped after the maximum keys.
+ * Rebuilds run on the calling thread, or in the background with
+ * KineticCluster_StartRebuild().
+ *
+ * @param cluster   Cluster of the device
+ * @param device    Index of the device to rebuild
+ * @param config    Configuration of the rebuild
+ * @param stats     Populated with the progress of the rebuild (or NULL)
+ *
+ * @return          Returns KINETIC_STATUS_SUCCESS if no keys failed, once
+ *                  all are listed or the maximum keys are, otherwise the
+ *                  status of the first key which failed, or of the device
+ *                  whose keys could not be listed
+ */
+KineticStatus KineticCluster_Rebuild(KineticCluster* const cluster, int device,
+                                     const KineticClusterRebuildConfig* config,
+                                     KineticClusterRebuildStats* const stats);
+
+/**
+ * @brief Starts a rebuild of a device of a cluster (see
+ * KineticCluster_Rebuild()) on a thread of its own, with sessions of its own
+ * to the devices, so that the cluster can be used while it runs. The
+ * rebuild places keys as the cluster does when started, so the devices,
+ * replication and erasure coding of the cluster must not be changed until
+ * it is stopped. Devices which cannot be connected to are not read from.
+ *
+ * @param cluster   Cluster of the device
+ * @param device    Index of the device to rebuild
+ * @param config    Configuration of the rebuild, which is copied
+ * @param rebuilder Populated with the rebuild running
+ *
+ * @return          Returns the resulting KineticStatus
+ */
+KineticStatus KineticCluster_StartRebuild(KineticCluster* const cluster, int device,
+                                          const KineticClusterRebuildConfig* config,
+                                          KineticClusterRebuilder** const rebuilder);
+
+/**
+ * @brief Reports the progress of a rebuild running in the background, as of
+ * the last batch of keys rebuilt.
+ *
+ * @param rebuilder Rebuild to report the progress of
+ * @param stats     Populated with the progress of the rebuild (or NULL)
+ * @param status    Populated once finished with the status
+ *                  KineticCluster_Rebuild() would return (or NULL)
+ *
+ * @return          Returns whether the rebuild has finished
+ */
+bool KineticCluster_PollRebuild(KineticClusterRebuilder* const rebuilder,
+                                KineticClusterRebuildStats* const stats,
+                                KineticStatus* const status);
+
+/**
+ * @brief Stops a rebuild running in the background, once the batch of keys
+ * in progress is rebuilt, and frees it. With a checkpoint file, a later
+ * rebuild of the device resumes from the last keys listed whose keys were
+ * all rebuilt.
+ *
+ * @param rebuilder Rebuild to stop, set to NULL once stopped
+ * @param stats     Populated with the progress of the rebuild (or NULL)
+ *
+ * @return          Returns the status KineticCluster_Rebuild() would return
+ */
+KineticStatus KineticCluster_StopRebuild(KineticClusterRebuilder** const rebuilder,
+                                         KineticClusterRebuildStats* const stats);
+
+/**
+ * @brief Executes a PUT, GET or DELETE with the session to the device on
+ * which the key of the entry is placed (see KineticClient_Put(),
+ * KineticClient_Get() and KineticClient_Delete()), or on its replicas or
+ * chunks (see KineticCluster_SetReplication() and
+ * KineticCluster_SetErasureCoding()).
+ *
+ * @param cluster   Cluster to execute the operation on
+ * @param entry     Key/value entry of the operation
+ *
+ * @return          Returns the resulting KineticStatus
+ */
+KineticStatus KineticCluster_Put(KineticCluster* const cluster, KineticEntry* const entry);
+KineticStatus KineticCluster_Get(KineticCluster* const cluster, KineticEntry* const entry);
+KineticStatus KineticCluster_Delete(KineticCluster* const cluster, KineticEntry* const entry);
+
+/**
+ * @brief Executes a batch of operations, concurrently on each device. The
+ * operations of each device are executed in order, with its session, while
+ * those of different devices are executed in parallel. With replication or
+ * erasure coding, each run of consecutive PUTs and DELETEs is pipelined: all
+ * of their requests are sent to their replicas or chunks before the write
+ * quorum of each is awaited. GETs, and PUTs of erasure coded values, are
+ * executed one at a time, in order with the runs of writes around them.
+ * The status of each operation is set once the batch completes.
+ *
+ * @param cluster       Cluster to execute the operations on
+ * @param operations    Operations to execute
+ * @param count         Number of operations
+ *
+ * @return              Returns KINETIC_STATUS_SUCCESS if all operations
+ *                      succeeded, or the status of the first which failed
+ */
+KineticStatus KineticCluster_Execute(KineticCluster* const cluster,
+                                     KineticClusterOperation* operations, int count);
+
+#endif // _KINETIC_CLUSTER_H
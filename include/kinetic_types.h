@@ -58,6 +58,29 @@
 #ifndef LOG_FILE_NAME_MAX
 #define LOG_FILE_NAME_MAX (HOST_NAME_MAX)
 #endif
+
+/**
+ * @brief Enumeration of log message severity levels. Messages below the
+ * configured level are filtered out. KINETIC_LOG_LEVEL_NONE disables logging.
+ */
+typedef enum _KineticLogLevel {
+    KINETIC_LOG_LEVEL_NONE = -1,
+    KINETIC_LOG_LEVEL_DEBUG = 0,
+    KINETIC_LOG_LEVEL_INFO,
+    KINETIC_LOG_LEVEL_WARN,
+    KINETIC_LOG_LEVEL_ERROR,
+} KineticLogLevel;
+
+/**
+ * @brief Log subsystem flags, which may be OR'ed together into a mask of
+ * subsystems to be logged.
+ */
+#define KINETIC_LOG_SUBSYSTEM_SOCKET    (1u << 0)
+#define KINETIC_LOG_SUBSYSTEM_PDU       (1u << 1)
+#define KINETIC_LOG_SUBSYSTEM_HMAC      (1u << 2)
+#define KINETIC_LOG_SUBSYSTEM_ALLOCATOR (1u << 3)
+#define KINETIC_LOG_SUBSYSTEM_CLIENT    (1u << 4)
+#define KINETIC_LOG_SUBSYSTEM_ALL       (0xFFFFFFFFu)
 /**
  * @brief Enumeration of encryption/checksum key algorithms
  */
@@ -88,6 +111,9 @@ typedef enum _KineticSynchronization {
 typedef int KineticSessionHandle;
 
 
+// Byte stream carrying the PDUs of a session (see kinetic_transport.h)
+typedef struct _KineticTransport KineticTransport;
+
 /**
  * @brief Structure used to specify the configuration of a session.
  */
@@ -98,6 +124,18 @@ typedef struct _KineticSession {
     // Port for Kinetic Device session
     int     port;
 
+    // Set to true to secure the session with TLS (see KINETIC_TLS_PORT)
+    bool    useTls;
+
+    // PEM file of the CA certificates with which to verify the device when
+    // useTls is set, or of the device's own certificate to pin it, which must
+    // remain readable while the session is connected. The certificate must
+    // also name the host. If NULL, the device is not verified, as devices are
+    // provisioned with self-signed certificates, and an active
+    // man-in-the-middle could read the session (HMACs only prevent it from
+    // altering requests and responses).
+    const char* tlsCAFile;
+
     // Set to true to enable non-blocking/asynchronous I/O
     bool    nonBlocking;
 
@@ -115,6 +153,48 @@ typedef struct _KineticSession {
     // client and the device, used to sign requests.
     uint8_t keyData[KINETIC_MAX_KEY_LEN];
     ByteArray hmacKey;
+
+    // Transport to connect with instead of TCP, such as the in-process
+    // transport of the simulator (NULL for TCP, or TLS if useTls is set)
+    const KineticTransport* transport;
+
+    // Memory to use for a cache of the entries read and written by the
+    // session (0 to disable). GETs of cached entries check the version of the
+    // entry on the device with a GETVERSION, so that the value is only
+    // transferred again if it has changed.
+    size_t  readCacheBytes;
+
+    // File in which to keep a second tier of the read cache, of up to
+    // readCacheFileBytes (NULL to disable), such as on a local SSD. Entries
+    // are checked with a GETVERSION as for the memory tier, and the file is
+    // kept when the session ends, so that later sessions with the same file
+    // start with its entries cached. A file can only be used by one session
+    // at a time. Its storage is allocated on connecting; if there is not
+    // the space for it, the session runs without the file.
+    const char* readCacheFile;
+    size_t  readCacheFileBytes;
+
+    // Memory to use for buffering forced PUTs of the session (0 to disable).
+    // Buffered PUTs succeed immediately, and repeated PUTs of a key replace
+    // the buffered entry, until a background thread writes them to the device
+    // with KINETIC_SYNCHRONIZATION_WRITEBACK followed by a FLUSHALLDATA. This
+    // happens every writeBackIntervalMs (default 100ms), or sooner once this
+    // much memory is used, when further PUTs wait for the buffer to drain.
+    // Buffered PUTs are lost if the client exits before they are written.
+    size_t  writeBackBytes;
+    int     writeBackIntervalMs;
+
+    // Memory to use for a Bloom filter of the keys on the device (0 to
+    // disable), so that GETs of keys which do not exist fail without a
+    // request. A background thread builds the filter with GETKEYRANGE once
+    // connected, and again every keyFilterRebuildSeconds (if set), to drop
+    // deleted keys. Keys PUT through the session are added as they are
+    // written, but those PUT through other sessions are only found once
+    // the filter is rebuilt, and until then GETs of them fail as if they
+    // did not exist. Only enable the filter if this session is the only
+    // writer of the device.
+    size_t  keyFilterBytes;
+    int     keyFilterRebuildSeconds;
 } KineticSession;
 
 #define KINETIC_SESSION_INIT(_session, _host, _clusterVersion, _identity, _hmacKey) { \
@@ -154,6 +234,110 @@ typedef enum {
 
 const char* Kinetic_GetStatusDescription(KineticStatus status);
 
+// Latency histograms are kept for each Kinetic protocol message type code of
+// the request (e.g. GET=2, PUT=4, DELETE=6, NOOP=30), in nanoseconds
+#define KINETIC_STATS_MESSAGE_TYPES    (33)
+#define KINETIC_STATS_LATENCY_BUCKETS  (280)
+
+// Log-linear latency histogram. Values below 8ns have their own buckets, and
+// each power of 2 above that is split into 8 linear buckets, so any value is
+// recorded with at most 12.5% error. The last bucket collects all values
+// beyond ~68 seconds.
+typedef struct _KineticLatencyHistogram {
+    uint64_t count;
+    uint64_t totalNanoseconds;
+    uint64_t buckets[KINETIC_STATS_LATENCY_BUCKETS];
+} KineticLatencyHistogram;
+
+// Stages of an operation, for which time spent is measured if operation
+// timing is enabled
+typedef enum _KineticOperationStage {
+    KINETIC_OPERATION_STAGE_BUILD = 0,  // Building the request message
+    KINETIC_OPERATION_STAGE_HMAC,       // Calculating/validating HMACs
+    KINETIC_OPERATION_STAGE_PACK,       // Packing the request protobuf
+    KINETIC_OPERATION_STAGE_SEND,       // Writing the request to the socket
+    KINETIC_OPERATION_STAGE_WAIT,       // Waiting for the response to arrive
+    KINETIC_OPERATION_STAGE_RECEIVE,    // Reading the response from the socket
+    KINETIC_OPERATION_STAGE_DECODE,     // Unpacking the response protobuf
+    KINETIC_OPERATION_STAGE_COUNT
+} KineticOperationStage;
+
+// Time spent in each stage of an operation, in nanoseconds
+typedef struct _KineticOperationTiming {
+    uint64_t totalNanoseconds;
+    uint64_t stageNanoseconds[KINETIC_OPERATION_STAGE_COUNT];
+} KineticOperationTiming;
+
+// Operation statistics, for a session or the whole process
+typedef struct _KineticStats {
+    uint64_t operations;                         // Operations executed
+    uint64_t bytesSent;                          // Bytes written to the socket
+    uint64_t bytesReceived;                      // Bytes read from the socket
+    uint64_t syscalls;                           // Socket read/write/select calls
+    uint64_t statusCounts[KINETIC_STATUS_COUNT]; // Operation results by KineticStatus
+    uint64_t invalidStatusCount;                 // Operations resulting in KINETIC_STATUS_INVALID
+    KineticLatencyHistogram latency[KINETIC_STATS_MESSAGE_TYPES];
+    KineticLatencyHistogram stages[KINETIC_OPERATION_STAGE_COUNT]; // If timing enabled
+} KineticStats;
+
+// Statistics of the read cache of a session (see KineticSession.readCacheBytes),
+// or of its cache file (see KineticSession.readCacheFile)
+typedef struct _KineticCacheStats {
+    uint64_t hits;      // GETs served from the cache, after a GETVERSION
+    uint64_t misses;    // GETs of entries which were not cached
+    uint64_t stale;     // GETs of cached entries which had since changed
+    uint64_t evictions; // Entries evicted to stay within the capacity
+    uint64_t entries;   // Entries currently cached
+    uint64_t bytes;     // Memory used by the cached entries
+} KineticCacheStats;
+
+// Statistics of the write-back buffer of a session (see KineticSession.writeBackBytes)
+typedef struct _KineticWriteBackStats {
+    uint64_t absorbed;     // PUTs buffered
+    uint64_t written;      // PUTs written to the device
+    uint64_t flushes;      // Batches of PUTs written and flushed
+    uint64_t failures;     // Batches which failed to be written
+    uint64_t dirtyEntries; // Entries currently buffered
+    uint64_t dirtyBytes;   // Memory used by the buffered entries
+} KineticWriteBackStats;
+
+// Statistics of the key filter of a session (see KineticSession.keyFilterBytes)
+typedef struct _KineticKeyFilterStats {
+    uint64_t lookups;        // GETs checked against the filter
+    uint64_t negatives;      // GETs failed without a request, as the key was absent
+    uint64_t falsePositives; // GETs of absent keys which the filter did not exclude
+    uint64_t rebuilds;       // Builds of the filter completed
+    uint64_t failures;       // Builds which failed
+    uint64_t keys;           // Keys added to the filter since it was built
+    uint64_t bits;           // Size of the filter (0 until first built)
+    uint32_t hashes;         // Bits set for each key
+    double expectedFalsePositiveRate; // From the fraction of bits set
+    double falsePositiveRate;         // Of the GETs of absent keys so far
+} KineticKeyFilterStats;
+
+// Details of an operation passed to tracing hooks
+typedef struct _KineticHookInfo {
+    int64_t connectionID;
+    int64_t sequence;
+    int32_t messageType;        // Kinetic protocol message type code of the request
+    size_t keyLength;           // Bytes in the key of the request, if any
+    size_t valueLength;         // Bytes in the value sent with the request, if any
+    size_t responseValueLength; // Bytes in the value of the response, once started
+    KineticStatus status;       // Result of the operation so far
+} KineticHookInfo;
+
+typedef void (*KineticHookCallback)(const KineticHookInfo* info, void* context);
+
+// Tracing hooks, invoked on the thread executing an operation with no library
+// locks held. Any of the callbacks may be NULL.
+typedef struct _KineticHooks {
+    KineticHookCallback operationStarted;   // Request built, about to be sent
+    KineticHookCallback requestWritten;     // Request fully written to the socket
+    KineticHookCallback responseStarted;    // First bytes of the response received
+    KineticHookCallback operationCompleted; // Operation completed or failed
+    void* context;                          // Passed to each callback
+} KineticHooks;
+
 // KineticEntry - byte arrays need to be preallocated by the client
 typedef struct _KineticEntry {
     ByteBuffer key;
@@ -167,6 +351,12 @@ typedef struct _KineticEntry {
     ByteBuffer value;
 } KineticEntry;
 
+// Function updating an entry for KineticClient_Update, passed the entry with
+// its current value, dbVersion and tag (all empty if it does not exist yet).
+// Sets the new value, and optionally a newVersion and tag, returning false to
+// abandon the update. May be called again if the entry changes concurrently.
+typedef bool (*KineticUpdateFunction)(KineticEntry* entry, void* context);
+
 // Kinetic Key Range request structure
 typedef struct _KineticKeyRange {
     ByteBuffer startKey;
@@ -177,4 +367,92 @@ typedef struct _KineticKeyRange {
     bool reverse;
 } KineticKeyRange;
 
+// Device to which KineticClient_P2PPush copies entries
+typedef struct _KineticP2PPeer {
+    const char* host;
+    int port;
+    bool tls;
+} KineticP2PPeer;
+
+// Entry copied by KineticClient_P2PPush from the device to its peer
+typedef struct _KineticP2POperation {
+    ByteBuffer key;         // Of the entry on the device
+    ByteBuffer version;     // Expected version of the entry on the peer (empty
+                            // if it must not exist there yet), unless forced
+    ByteBuffer newKey;      // Of the entry on the peer (empty for the same key)
+    bool force;             // Replace the entry on the peer whatever its version
+    KineticStatus status;   // Result of the copy, once pushed
+} KineticP2POperation;
+
+// Device of a cluster (see KineticCluster_Connect)
+typedef struct _KineticClusterDevice {
+    KineticSession session; // Configuration of the session to the device
+
+    // Name identifying the device in key placement (NULL for "host:port").
+    // Keys are placed on a device by its name, so a device replacing another
+    // with the same name is assigned the same keys.
+    const char* name;
+
+    // Relative share of the keys placed on the device, or 0 to weight the
+    // device by the nominal capacity in bytes that it reports with GETLOG
+    double weight;
+} KineticClusterDevice;
+
+// Sessions to a set of devices, between which keys are placed by hashing
+typedef struct _KineticCluster KineticCluster;
+
+typedef enum {
+    KINETIC_CLUSTER_OPERATION_PUT,
+    KINETIC_CLUSTER_OPERATION_GET,
+    KINETIC_CLUSTER_OPERATION_DELETE,
+} KineticClusterOperationType;
+
+// Operation of a batch executed by KineticCluster_Execute
+typedef struct _KineticClusterOperation {
+    KineticClusterOperationType type;
+    KineticEntry* entry;
+    KineticStatus status; // Result of the operation, once executed
+} KineticClusterOperation;
+
+// Most devices each key of a cluster can be replicated on
+#define KINETIC_CLUSTER_REPLICAS_MAX (16)
+
+// Statistics of the replicated and erasure coded operations of a cluster
+// (see KineticCluster_GetStats)
+typedef struct _KineticClusterStats {
+    uint64_t replicaWrites;     // PUTs and DELETEs sent to replicas or chunks
+    uint64_t replicaFailures;   // Replica requests which failed, other than
+                                // as the key does not exist
+    uint64_t lateAcks;          // Replica writes which succeeded after their
+                                // operation had returned
+    uint64_t divergentReads;    // GETs whose replicas reported different versions
+    uint64_t degradedReads;     // Erasure coded GETs which read parity chunks
+} KineticClusterStats;
+
+// Configuration of a rebuild of a cluster device (see KineticCluster_Rebuild)
+typedef struct _KineticClusterRebuildConfig {
+    int parallelism;            // Keys rebuilt at once (0 for 8)
+    int64_t maxBytesPerSecond;  // Of values read and written (0 for no limit)
+    int maxOpsPerSecond;        // Requests sent to devices (0 for no limit)
+    int64_t maxKeys;            // Keys listed before returning (0 for all)
+    const char* checkpointPath; // File the progress is saved to, and resumed
+                                // from (NULL to not save it)
+} KineticClusterRebuildConfig;
+
+// Progress of a rebuild of a cluster device, including earlier runs resumed
+// from its checkpoint (see KineticCluster_Rebuild)
+typedef struct _KineticClusterRebuildStats {
+    uint64_t keysScanned;   // Keys listed by the other devices
+    uint64_t keysRebuilt;   // Replicas or chunks written to the device
+    uint64_t keysSkipped;   // Already on the device, or deleted since listed
+    uint64_t keysFailed;    // Which could not be read or written
+    uint64_t bytesRead;
+    uint64_t bytesWritten;
+    bool complete;          // Whether the keys of all devices have been listed
+} KineticClusterRebuildStats;
+
+// Rebuild of a cluster device running in the background
+// (see KineticCluster_StartRebuild)
+typedef struct _KineticClusterRebuilder KineticClusterRebuilder;
+
 #endif // _KINETIC_TYPES_H
@@ -18,8 +18,11 @@
 *
 */
 
+#define KINETIC_LOG_SUBSYSTEM KINETIC_LOG_SUBSYSTEM_ALLOCATOR
+
 #include "kinetic_allocator.h"
 #include "kinetic_logger.h"
+#include "kinetic_probes.h"
 #include <stdlib.h>
 #include <pthread.h>
 
@@ -35,8 +38,8 @@ static inline void KineticAllocator_Lock(void)
 
 static inline void KineticAllocator_Unlock(void)
 {
-    pthread_mutex_unlock(&_global_pdu_lists_mutex);
     listsLocked = false;
+    pthread_mutex_unlock(&_global_pdu_lists_mutex);
 }
 
 void* KineticAllocator_NewItem(KineticList* const list, size_t size)
@@ -64,12 +67,14 @@ void* KineticAllocator_NewItem(KineticList* const list, size_t size)
 
     // LOGF("Allocated new list item @ 0x%0llX w/data @ 0x%0llX",
     //      (long long)newItem, (long long)&newItem->data);
+    KINETIC_PROBE2(alloc_new, newItem->data, size);
 
     return newItem->data;
 }
 
 void KineticAllocator_FreeItem(KineticList* const list, void* item)
 {
+    KINETIC_PROBE1(alloc_free, item);
     KineticAllocator_Lock();
     KineticListItem* cur = list->start;
     while (cur->data != item) {
@@ -109,6 +114,7 @@ void KineticAllocator_FreeItem(KineticList* const list, void* item)
                 if (cur->next != NULL) {
                     // LOG("    next being reset!");
                     cur->previous->next = cur->next;
+                    cur->next->previous = cur->previous;
                 }
                 else {
                     list->last = cur->previous;
@@ -198,6 +204,10 @@ void KineticAllocator_FreePDU(KineticList* const list, KineticPDU* pdu)
         // LOG("Freeing dynamically allocated protobuf");
         KineticProto__free_unpacked(pdu->proto, NULL);
     };
+    if (pdu->packedProtobuf != NULL) {
+        free(pdu->packedProtobuf);
+        pdu->packedProtobuf = NULL;
+    }
     KineticAllocator_Unlock();
     KineticAllocator_FreeItem(list, (void*)pdu);
 }
@@ -214,6 +224,9 @@ void KineticAllocator_FreeAllPDUs(KineticList* const list)
                 && pdu->protobufDynamicallyExtracted) {
                 KineticProto__free_unpacked(pdu->proto, NULL);
             }
+            if (pdu != NULL && pdu->packedProtobuf != NULL) {
+                free(pdu->packedProtobuf);
+            }
             current = current->next;
         }
         KineticAllocator_Unlock();
@@ -0,0 +1,389 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+
+#include "kinetic_cache.h"
+#include "kinetic_logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define KINETIC_CACHE_INITIAL_BUCKETS (64)
+
+typedef struct _KineticCacheItem {
+    struct _KineticCacheItem* hashNext;
+    struct _KineticCacheItem* newer;   // Towards the most recently used
+    struct _KineticCacheItem* older;   // Towards the least recently used
+    uint64_t hash;
+    size_t keyLen;
+    size_t versionLen;
+    size_t tagLen;
+    size_t valueLen;
+    KineticAlgorithm algorithm;
+    uint8_t data[];                    // Key, version, tag and value
+} KineticCacheItem;
+
+typedef struct _KineticCacheShard {
+    pthread_mutex_t mutex;
+    KineticCacheItem** buckets;
+    size_t bucketCount;                // Power of 2
+    size_t count;
+    size_t bytes;
+    size_t capacity;
+    KineticCacheItem* newest;
+    KineticCacheItem* oldest;
+    KineticCacheStats stats;
+} KineticCacheShard;
+
+struct _KineticCache {
+    KineticCacheShard shards[KINETIC_CACHE_SHARDS];
+};
+
+static inline size_t KineticCache_ItemSize(const KineticCacheItem* const item)
+{
+    return sizeof(KineticCacheItem) +
+           item->keyLen + item->versionLen + item->tagLen + item->valueLen;
+}
+
+static inline uint8_t* KineticCache_ItemVersion(KineticCacheItem* const item)
+{
+    return &item->data[item->keyLen];
+}
+
+static inline uint8_t* KineticCache_ItemTag(KineticCacheItem* const item)
+{
+    return &item->data[item->keyLen + item->versionLen];
+}
+
+static inline uint8_t* KineticCache_ItemValue(KineticCacheItem* const item)
+{
+    return &item->data[item->keyLen + item->versionLen + item->tagLen];
+}
+
+static inline KineticCacheShard* KineticCache_Shard(KineticCache* const cache, uint64_t hash)
+{
+    // The low bits of the hash select the bucket within the shard
+    return &cache->shards[hash >> 61];
+}
+
+KineticCache* KineticCache_Create(size_t capacityBytes)
+{
+    KineticCache* cache = calloc(1, sizeof(KineticCache));
+    if (cache == NULL) {
+        LOG_ERROR("Failed allocating read cache!");
+        return NULL;
+    }
+    for (int i = 0; i < KINETIC_CACHE_SHARDS; i++) {
+        KineticCacheShard* shard = &cache->shards[i];
+        pthread_mutex_init(&shard->mutex, NULL);
+        shard->capacity = capacityBytes / KINETIC_CACHE_SHARDS;
+        shard->bucketCount = KINETIC_CACHE_INITIAL_BUCKETS;
+        shard->buckets = calloc(shard->bucketCount, sizeof(KineticCacheItem*));
+        if (shard->buckets == NULL) {
+            LOG_ERROR("Failed allocating read cache!");
+            KineticCache_Destroy(cache);
+            return NULL;
+        }
+    }
+    return cache;
+}
+
+void KineticCache_Destroy(KineticCache* const cache)
+{
+    if (cache == NULL) {
+        return;
+    }
+    for (int i = 0; i < KINETIC_CACHE_SHARDS; i++) {
+        KineticCacheShard* shard = &cache->shards[i];
+        KineticCacheItem* item = shard->newest;
+        while (item != NULL) {
+            KineticCacheItem* older = item->older;
+            free(item);
+            item = older;
+        }
+        free(shard->buckets);
+        pthread_mutex_destroy(&shard->mutex);
+    }
+    free(cache);
+}
+
+static KineticCacheItem* KineticCache_Find(KineticCacheShard* const shard,
+                                           const ByteBuffer* const key, uint64_t hash)
+{
+    KineticCacheItem* item = shard->buckets[hash & (shard->bucketCount - 1)];
+    while (item != NULL) {
+        if (item->hash == hash && item->keyLen == key->bytesUsed &&
+            memcmp(item->data, key->array.data, item->keyLen) == 0) {
+            break;
+        }
+        item = item->hashNext;
+    }
+    return item;
+}
+
+static void KineticCache_Unlink(KineticCacheShard* const shard, KineticCacheItem* const item)
+{
+    if (item->newer != NULL) {
+        item->newer->older = item->older;
+    }
+    else {
+        shard->newest = item->older;
+    }
+    if (item->older != NULL) {
+        item->older->newer = item->newer;
+    }
+    else {
+        shard->oldest = item->newer;
+    }
+    item->newer = item->older = NULL;
+}
+
+static void KineticCache_MakeNewest(KineticCacheShard* const shard, KineticCacheItem* const item)
+{
+    item->older = shard->newest;
+    item->newer = NULL;
+    if (shard->newest != NULL) {
+        shard->newest->newer = item;
+    }
+    shard->newest = item;
+    if (shard->oldest == NULL) {
+        shard->oldest = item;
+    }
+}
+
+static void KineticCache_Remove(KineticCacheShard* const shard, KineticCacheItem* const item)
+{
+    KineticCacheItem** link = &shard->buckets[item->hash & (shard->bucketCount - 1)];
+    while (*link != item) {
+        link = &(*link)->hashNext;
+    }
+    *link = item->hashNext;
+    KineticCache_Unlink(shard, item);
+    shard->count--;
+    shard->bytes -= KineticCache_ItemSize(item);
+    free(item);
+}
+
+static void KineticCache_Grow(KineticCacheShard* const shard)
+{
+    size_t bucketCount = shard->bucketCount * 2;
+    KineticCacheItem** buckets = calloc(bucketCount, sizeof(KineticCacheItem*));
+    if (buckets == NULL) {
+        return; // Chains just get longer
+    }
+    for (size_t i = 0; i < shard->bucketCount; i++) {
+        KineticCacheItem* item = shard->buckets[i];
+        while (item != NULL) {
+            KineticCacheItem* next = item->hashNext;
+            KineticCacheItem** bucket = &buckets[item->hash & (bucketCount - 1)];
+            item->hashNext = *bucket;
+            *bucket = item;
+            item = next;
+        }
+    }
+    free(shard->buckets);
+    shard->buckets = buckets;
+    shard->bucketCount = bucketCount;
+}
+
+bool KineticCache_Contains(KineticCache* const cache, const ByteBuffer* const key)
+{
+    assert(cache != NULL);
+    assert(key != NULL);
+    uint64_t hash = Kinetic_HashKey(key->array.data, key->bytesUsed);
+    KineticCacheShard* shard = KineticCache_Shard(cache, hash);
+    pthread_mutex_lock(&shard->mutex);
+    bool found = (KineticCache_Find(shard, key, hash) != NULL);
+    if (!found) {
+        shard->stats.misses++;
+    }
+    pthread_mutex_unlock(&shard->mutex);
+    return found;
+}
+
+// Copies cached data into an entry buffer, as a GET would from the response
+static bool KineticCache_CopyOut(ByteBuffer* const dest, const uint8_t* data, size_t len)
+{
+    dest->bytesUsed = len;
+    if (len == 0) {
+        return true;
+    }
+    if (dest->array.data == NULL || dest->array.len < len) {
+        return false;
+    }
+    memcpy(dest->array.data, data, len);
+    return true;
+}
+
+// Copies a cached entry into an entry as a hit, and releases the shard
+static KineticStatus KineticCache_CopyEntry(KineticCacheShard* const shard,
+                                            KineticCacheItem* const item,
+                                            KineticEntry* const entry)
+{
+    bool copied = KineticCache_CopyOut(&entry->dbVersion, KineticCache_ItemVersion(item), item->versionLen);
+    copied = KineticCache_CopyOut(&entry->tag, KineticCache_ItemTag(item), item->tagLen) && copied;
+    copied = KineticCache_CopyOut(&entry->value, KineticCache_ItemValue(item), item->valueLen) && copied;
+    entry->algorithm = item->algorithm;
+    KineticCache_Unlink(shard, item);
+    KineticCache_MakeNewest(shard, item);
+    shard->stats.hits++;
+    pthread_mutex_unlock(&shard->mutex);
+
+    if (!copied) {
+        LOG("Cached entry does not fit in the buffers of the entry!");
+        return KINETIC_STATUS_BUFFER_OVERRUN;
+    }
+    return KINETIC_STATUS_SUCCESS;
+}
+
+KineticStatus KineticCache_Get(KineticCache* const cache,
+                               KineticEntry* const entry, ByteArray dbVersion)
+{
+    assert(cache != NULL);
+    assert(entry != NULL);
+    uint64_t hash = Kinetic_HashKey(entry->key.array.data, entry->key.bytesUsed);
+    KineticCacheShard* shard = KineticCache_Shard(cache, hash);
+    pthread_mutex_lock(&shard->mutex);
+
+    KineticCacheItem* item = KineticCache_Find(shard, &entry->key, hash);
+    if (item == NULL) {
+        // Evicted since looked up
+        shard->stats.misses++;
+        pthread_mutex_unlock(&shard->mutex);
+        return KINETIC_STATUS_NOT_ATTEMPTED;
+    }
+    if (item->versionLen != dbVersion.len ||
+        memcmp(KineticCache_ItemVersion(item), dbVersion.data, dbVersion.len) != 0) {
+        shard->stats.stale++;
+        KineticCache_Remove(shard, item);
+        pthread_mutex_unlock(&shard->mutex);
+        return KINETIC_STATUS_NOT_ATTEMPTED;
+    }
+
+    return KineticCache_CopyEntry(shard, item, entry);
+}
+
+KineticStatus KineticCache_GetLatest(KineticCache* const cache, KineticEntry* const entry)
+{
+    assert(cache != NULL);
+    assert(entry != NULL);
+    uint64_t hash = Kinetic_HashKey(entry->key.array.data, entry->key.bytesUsed);
+    KineticCacheShard* shard = KineticCache_Shard(cache, hash);
+    pthread_mutex_lock(&shard->mutex);
+
+    KineticCacheItem* item = KineticCache_Find(shard, &entry->key, hash);
+    if (item == NULL) {
+        shard->stats.misses++;
+        pthread_mutex_unlock(&shard->mutex);
+        return KINETIC_STATUS_NOT_ATTEMPTED;
+    }
+    return KineticCache_CopyEntry(shard, item, entry);
+}
+
+void KineticCache_Put(KineticCache* const cache, const KineticEntry* const entry)
+{
+    assert(cache != NULL);
+    assert(entry != NULL);
+    uint64_t hash = Kinetic_HashKey(entry->key.array.data, entry->key.bytesUsed);
+    KineticCacheShard* shard = KineticCache_Shard(cache, hash);
+
+    // Without a version, a GETVERSION cannot tell whether the entry changed
+    KineticCacheItem* item = NULL;
+    size_t tagLen = (entry->tag.array.data != NULL) ? entry->tag.bytesUsed : 0;
+    size_t valueLen = (entry->value.array.data != NULL) ? entry->value.bytesUsed : 0;
+    size_t size = sizeof(KineticCacheItem) + entry->key.bytesUsed +
+                  entry->dbVersion.bytesUsed + tagLen + valueLen;
+    if (entry->dbVersion.array.data != NULL && entry->dbVersion.bytesUsed > 0 &&
+        size <= shard->capacity) {
+        item = malloc(size);
+    }
+    if (item != NULL) {
+        *item = (KineticCacheItem) {
+            .hash = hash,
+            .keyLen = entry->key.bytesUsed,
+            .versionLen = entry->dbVersion.bytesUsed,
+            .tagLen = tagLen,
+            .valueLen = valueLen,
+            .algorithm = entry->algorithm,
+        };
+        memcpy(item->data, entry->key.array.data, item->keyLen);
+        memcpy(KineticCache_ItemVersion(item), entry->dbVersion.array.data, item->versionLen);
+        if (tagLen > 0) {
+            memcpy(KineticCache_ItemTag(item), entry->tag.array.data, tagLen);
+        }
+        if (valueLen > 0) {
+            memcpy(KineticCache_ItemValue(item), entry->value.array.data, valueLen);
+        }
+    }
+
+    pthread_mutex_lock(&shard->mutex);
+    KineticCacheItem* cached = KineticCache_Find(shard, &entry->key, hash);
+    if (cached != NULL) {
+        KineticCache_Remove(shard, cached);
+    }
+    if (item != NULL) {
+        while (shard->bytes + size > shard->capacity) {
+            KineticCache_Remove(shard, shard->oldest);
+            shard->stats.evictions++;
+        }
+        if (shard->count >= shard->bucketCount) {
+            KineticCache_Grow(shard);
+        }
+        KineticCacheItem** bucket = &shard->buckets[hash & (shard->bucketCount - 1)];
+        item->hashNext = *bucket;
+        *bucket = item;
+        KineticCache_MakeNewest(shard, item);
+        shard->count++;
+        shard->bytes += size;
+    }
+    pthread_mutex_unlock(&shard->mutex);
+}
+
+void KineticCache_Invalidate(KineticCache* const cache, const ByteBuffer* const key)
+{
+    assert(cache != NULL);
+    assert(key != NULL);
+    uint64_t hash = Kinetic_HashKey(key->array.data, key->bytesUsed);
+    KineticCacheShard* shard = KineticCache_Shard(cache, hash);
+    pthread_mutex_lock(&shard->mutex);
+    KineticCacheItem* item = KineticCache_Find(shard, key, hash);
+    if (item != NULL) {
+        KineticCache_Remove(shard, item);
+    }
+    pthread_mutex_unlock(&shard->mutex);
+}
+
+void KineticCache_GetStats(KineticCache* const cache, KineticCacheStats* const stats)
+{
+    assert(cache != NULL);
+    assert(stats != NULL);
+    *stats = (KineticCacheStats) {.hits = 0};
+    for (int i = 0; i < KINETIC_CACHE_SHARDS; i++) {
+        KineticCacheShard* shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->mutex);
+        stats->hits += shard->stats.hits;
+        stats->misses += shard->stats.misses;
+        stats->stale += shard->stats.stale;
+        stats->evictions += shard->stats.evictions;
+        stats->entries += shard->count;
+        stats->bytes += shard->bytes;
+        pthread_mutex_unlock(&shard->mutex);
+    }
+}
@@ -0,0 +1,58 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+
+#ifndef _KINETIC_CACHE_H
+#define _KINETIC_CACHE_H
+
+#include "kinetic_types_internal.h"
+
+#define KINETIC_CACHE_SHARDS (8)
+
+// Client-side read cache of the entries of a session, bounded by the memory
+// used for their keys, versions, tags and values. Entries are sharded by the
+// hash of their key, and each shard evicts its least recently used entries
+// once over its share of the capacity. Only entries with a version are
+// cached, so that a GETVERSION can tell whether a cached copy is current.
+KineticCache* KineticCache_Create(size_t capacityBytes);
+void KineticCache_Destroy(KineticCache* const cache);
+
+// Returns whether the entry with the key is cached, counting a miss if not
+bool KineticCache_Contains(KineticCache* const cache, const ByteBuffer* const key);
+
+// Copies the cached entry with the key of the specified entry into it, if its
+// version matches the version on the device. Returns KINETIC_STATUS_NOT_ATTEMPTED
+// (removing the cached entry) if the version does not match, or the entry
+// is no longer cached.
+KineticStatus KineticCache_Get(KineticCache* const cache,
+                               KineticEntry* const entry, ByteArray dbVersion);
+
+// Copies the cached entry with the key of the specified entry into it, without
+// checking it is current. Returns KINETIC_STATUS_NOT_ATTEMPTED if not cached.
+KineticStatus KineticCache_GetLatest(KineticCache* const cache, KineticEntry* const entry);
+
+// Caches the key, dbVersion, tag, algorithm and value of the entry, replacing
+// any cached copy, or removes the cached copy if the entry has no version
+void KineticCache_Put(KineticCache* const cache, const KineticEntry* const entry);
+void KineticCache_Invalidate(KineticCache* const cache, const ByteBuffer* const key);
+
+void KineticCache_GetStats(KineticCache* const cache, KineticCacheStats* const stats);
+
+#endif // _KINETIC_CACHE_H
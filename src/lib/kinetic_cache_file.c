@@ -0,0 +1,620 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+
+// For flock() and O_CLOEXEC, which are not in POSIX.1-2001
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+#ifndef _BSD_SOURCE
+#define _BSD_SOURCE
+#endif
+
+#include "kinetic_cache_file.h"
+#include "kinetic_logger.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#define KINETIC_CACHE_FILE_MAGIC (0x313048434143434bull) // "KCCACH01"
+#define KINETIC_CACHE_FILE_INITIAL_BUCKETS (1024)
+#define KINETIC_CACHE_FILE_ALIGN (8)
+#define KINETIC_CACHE_FILE_CAPACITY_MIN (64 * 1024)
+
+typedef enum {
+    KINETIC_CACHE_FILE_RECORD_ENTRY = 1,
+    KINETIC_CACHE_FILE_RECORD_TOMBSTONE, // Key no longer cached
+    KINETIC_CACHE_FILE_RECORD_WRAP,      // Rest of the log unused
+} KineticCacheFileRecordType;
+
+// Stored in the header page of the file
+typedef struct _KineticCacheFileHeader {
+    uint64_t magic;
+    uint64_t capacity; // Bytes of log following the header page
+    uint64_t head;     // Offset in the log of the next record
+    uint64_t tail;     // Offset in the log of the oldest record
+    uint64_t used;     // Bytes from the tail to the head, including any skipped
+} KineticCacheFileHeader;
+
+typedef struct _KineticCacheFileRecord {
+    uint64_t checksum;     // Of the rest of the record header, and the key
+    uint64_t dataChecksum; // Of the version, tag and value
+    uint32_t type;
+    uint32_t keyLen;
+    uint32_t versionLen;
+    uint32_t tagLen;
+    uint32_t valueLen;
+    int32_t algorithm;
+    uint8_t data[];        // Key, version, tag and value
+} KineticCacheFileRecord;
+
+typedef struct _KineticCacheFileItem {
+    struct _KineticCacheFileItem* hashNext;
+    uint64_t hash;
+    uint64_t offset; // Of the record in the log
+    bool verified;   // Data checksum checked, or written by this session
+} KineticCacheFileItem;
+
+struct _KineticCacheFile {
+    pthread_mutex_t mutex;
+    int fd;
+    uint8_t* map;
+    size_t mapLen;
+    KineticCacheFileHeader* header;
+    uint8_t* log;
+    KineticCacheFileItem** buckets;
+    size_t bucketCount; // Power of 2
+    size_t count;
+    KineticCacheStats stats;
+};
+
+// FNV-1a over 64 bit words, so that checking large values is not too slow
+static uint64_t KineticCacheFile_Checksum(uint64_t hash, const uint8_t* data, size_t len)
+{
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, &data[i], sizeof(word));
+        hash = (hash ^ word) * KINETIC_FNV_PRIME;
+    }
+    for (; i < len; i++) {
+        hash = (hash ^ data[i]) * KINETIC_FNV_PRIME;
+    }
+    return hash;
+}
+
+static inline uint64_t KineticCacheFile_RecordLen(uint64_t dataLen)
+{
+    uint64_t len = sizeof(KineticCacheFileRecord) + dataLen;
+    return (len + KINETIC_CACHE_FILE_ALIGN - 1) & ~(uint64_t)(KINETIC_CACHE_FILE_ALIGN - 1);
+}
+
+static inline uint64_t KineticCacheFile_RecordSize(const KineticCacheFileRecord* const record)
+{
+    return KineticCacheFile_RecordLen((uint64_t)record->keyLen + record->versionLen +
+                                      record->tagLen + record->valueLen);
+}
+
+static inline KineticCacheFileRecord* KineticCacheFile_RecordAt(KineticCacheFile* const file,
+                                                                uint64_t offset)
+{
+    return (KineticCacheFileRecord*)&file->log[offset];
+}
+
+static uint64_t KineticCacheFile_HeaderChecksum(const KineticCacheFileRecord* const record)
+{
+    uint64_t checksum = KineticCacheFile_Checksum(KINETIC_FNV_OFFSET,
+        (const uint8_t*)&record->type,
+        sizeof(KineticCacheFileRecord) - offsetof(KineticCacheFileRecord, type));
+    return KineticCacheFile_Checksum(checksum, record->data, record->keyLen);
+}
+
+static uint64_t KineticCacheFile_DataChecksum(const KineticCacheFileRecord* const record)
+{
+    return KineticCacheFile_Checksum(KINETIC_FNV_OFFSET,
+        &record->data[record->keyLen],
+        (uint64_t)record->versionLen + record->tagLen + record->valueLen);
+}
+
+//------------------------------------------------------------------------------
+// Index
+
+static KineticCacheFileItem** KineticCacheFile_Link(KineticCacheFile* const file,
+                                                    const uint8_t* key, size_t keyLen,
+                                                    uint64_t hash)
+{
+    KineticCacheFileItem** link = &file->buckets[hash & (file->bucketCount - 1)];
+    while (*link != NULL) {
+        KineticCacheFileItem* item = *link;
+        if (item->hash == hash) {
+            KineticCacheFileRecord* record = KineticCacheFile_RecordAt(file, item->offset);
+            if (record->keyLen == keyLen && memcmp(record->data, key, keyLen) == 0) {
+                break;
+            }
+        }
+        link = &item->hashNext;
+    }
+    return link;
+}
+
+static void KineticCacheFile_Grow(KineticCacheFile* const file)
+{
+    size_t bucketCount = file->bucketCount * 2;
+    KineticCacheFileItem** buckets = calloc(bucketCount, sizeof(KineticCacheFileItem*));
+    if (buckets == NULL) {
+        return; // Chains just get longer
+    }
+    for (size_t i = 0; i < file->bucketCount; i++) {
+        KineticCacheFileItem* item = file->buckets[i];
+        while (item != NULL) {
+            KineticCacheFileItem* next = item->hashNext;
+            KineticCacheFileItem** bucket = &buckets[item->hash & (bucketCount - 1)];
+            item->hashNext = *bucket;
+            *bucket = item;
+            item = next;
+        }
+    }
+    free(file->buckets);
+    file->buckets = buckets;
+    file->bucketCount = bucketCount;
+}
+
+// Indexes the record at the offset, replacing any older record of its key
+static void KineticCacheFile_Index(KineticCacheFile* const file, uint64_t offset, bool verified)
+{
+    KineticCacheFileRecord* record = KineticCacheFile_RecordAt(file, offset);
+    uint64_t hash = Kinetic_HashKey(record->data, record->keyLen);
+    KineticCacheFileItem** link = KineticCacheFile_Link(file, record->data, record->keyLen, hash);
+    if (*link != NULL) {
+        (*link)->offset = offset;
+        (*link)->verified = verified;
+        return;
+    }
+
+    KineticCacheFileItem* item = malloc(sizeof(KineticCacheFileItem));
+    if (item == NULL) {
+        return;
+    }
+    *item = (KineticCacheFileItem) {
+        .hash = hash,
+        .offset = offset,
+        .verified = verified,
+    };
+    *link = item;
+    file->count++;
+    if (file->count > file->bucketCount) {
+        KineticCacheFile_Grow(file);
+    }
+}
+
+static void KineticCacheFile_Unindex(KineticCacheFile* const file,
+                                     KineticCacheFileItem** const link)
+{
+    KineticCacheFileItem* item = *link;
+    *link = item->hashNext;
+    file->count--;
+    free(item);
+}
+
+//------------------------------------------------------------------------------
+// Log
+
+// Discards the oldest record in the log, or the unused end of the log
+static void KineticCacheFile_EvictTail(KineticCacheFile* const file)
+{
+    KineticCacheFileHeader* header = file->header;
+    uint64_t remaining = header->capacity - header->tail;
+    KineticCacheFileRecord* record = KineticCacheFile_RecordAt(file, header->tail);
+    if (remaining < sizeof(KineticCacheFileRecord) ||
+        record->type == KINETIC_CACHE_FILE_RECORD_WRAP) {
+        header->used -= remaining;
+        header->tail = 0;
+        return;
+    }
+
+    if (record->type == KINETIC_CACHE_FILE_RECORD_ENTRY) {
+        uint64_t hash = Kinetic_HashKey(record->data, record->keyLen);
+        KineticCacheFileItem** link = KineticCacheFile_Link(file, record->data, record->keyLen, hash);
+        if (*link != NULL && (*link)->offset == header->tail) {
+            KineticCacheFile_Unindex(file, link);
+            file->stats.evictions++;
+        }
+    }
+    uint64_t size = KineticCacheFile_RecordSize(record);
+    header->used -= size;
+    header->tail += size;
+}
+
+// Reserves space for a record at the head of the log, evicting the oldest
+// records as needed, and returns its offset
+static uint64_t KineticCacheFile_Reserve(KineticCacheFile* const file, uint64_t size)
+{
+    KineticCacheFileHeader* header = file->header;
+    for (;;) {
+        if (header->used == 0) {
+            header->head = header->tail = 0;
+        }
+        bool wrapped = (header->head < header->tail) ||
+                       (header->head == header->tail && header->used > 0);
+        uint64_t limit = wrapped ? header->tail : header->capacity;
+        if (header->head + size <= limit) {
+            break;
+        }
+        if (wrapped) {
+            KineticCacheFile_EvictTail(file);
+            continue;
+        }
+
+        // Skip the rest of the log, marking where it starts if a record fits
+        uint64_t remaining = header->capacity - header->head;
+        if (remaining >= sizeof(KineticCacheFileRecord)) {
+            KineticCacheFileRecord* record = KineticCacheFile_RecordAt(file, header->head);
+            *record = (KineticCacheFileRecord) {.type = KINETIC_CACHE_FILE_RECORD_WRAP};
+            record->checksum = KineticCacheFile_HeaderChecksum(record);
+        }
+        header->used += remaining;
+        header->head = 0;
+    }
+
+    uint64_t offset = header->head;
+    header->head += size;
+    header->used += size;
+    return offset;
+}
+
+// Appends a record of the entry, or a tombstone of its key, to the log
+static uint64_t KineticCacheFile_Append(KineticCacheFile* const file,
+                                        KineticCacheFileRecordType type,
+                                        const KineticEntry* const entry)
+{
+    size_t keyLen = entry->key.bytesUsed;
+    size_t versionLen = 0, tagLen = 0, valueLen = 0;
+    if (type == KINETIC_CACHE_FILE_RECORD_ENTRY) {
+        versionLen = entry->dbVersion.bytesUsed;
+        tagLen = (entry->tag.array.data != NULL) ? entry->tag.bytesUsed : 0;
+        valueLen = (entry->value.array.data != NULL) ? entry->value.bytesUsed : 0;
+    }
+    uint64_t offset = KineticCacheFile_Reserve(file,
+        KineticCacheFile_RecordLen(keyLen + versionLen + tagLen + valueLen));
+
+    KineticCacheFileRecord* record = KineticCacheFile_RecordAt(file, offset);
+    *record = (KineticCacheFileRecord) {
+        .type = type,
+        .keyLen = keyLen,
+        .versionLen = versionLen,
+        .tagLen = tagLen,
+        .valueLen = valueLen,
+        .algorithm = entry->algorithm,
+    };
+    uint8_t* data = record->data;
+    memcpy(data, entry->key.array.data, keyLen);
+    data += keyLen;
+    if (versionLen > 0) {
+        memcpy(data, entry->dbVersion.array.data, versionLen);
+        data += versionLen;
+    }
+    if (tagLen > 0) {
+        memcpy(data, entry->tag.array.data, tagLen);
+        data += tagLen;
+    }
+    if (valueLen > 0) {
+        memcpy(data, entry->value.array.data, valueLen);
+    }
+    record->dataChecksum = KineticCacheFile_DataChecksum(record);
+    record->checksum = KineticCacheFile_HeaderChecksum(record);
+    return offset;
+}
+
+// Rebuilds the index from the log, discarding the log from the first record
+// which is torn. Returns false if the file does not hold a valid log.
+static bool KineticCacheFile_Load(KineticCacheFile* const file, uint64_t capacity)
+{
+    KineticCacheFileHeader* header = file->header;
+    if (header->magic != KINETIC_CACHE_FILE_MAGIC || header->capacity != capacity ||
+        header->head > capacity || header->tail > capacity || header->used > capacity) {
+        return false;
+    }
+
+    uint64_t offset = header->tail;
+    uint64_t remaining = header->used;
+    while (remaining > 0) {
+        uint64_t left = capacity - offset;
+        KineticCacheFileRecord* record = KineticCacheFile_RecordAt(file, offset);
+        if (left < sizeof(KineticCacheFileRecord) ||
+            (record->type == KINETIC_CACHE_FILE_RECORD_WRAP &&
+             record->checksum == KineticCacheFile_HeaderChecksum(record))) {
+            if (left > remaining) {
+                break;
+            }
+            remaining -= left;
+            offset = 0;
+            continue;
+        }
+
+        uint64_t size = KineticCacheFile_RecordSize(record);
+        if (size > left || size > remaining ||
+            record->checksum != KineticCacheFile_HeaderChecksum(record)) {
+            break;
+        }
+        if (record->type == KINETIC_CACHE_FILE_RECORD_ENTRY) {
+            KineticCacheFile_Index(file, offset, false);
+        }
+        else if (record->type == KINETIC_CACHE_FILE_RECORD_TOMBSTONE) {
+            uint64_t hash = Kinetic_HashKey(record->data, record->keyLen);
+            KineticCacheFileItem** link = KineticCacheFile_Link(file,
+                record->data, record->keyLen, hash);
+            if (*link != NULL) {
+                KineticCacheFile_Unindex(file, link);
+            }
+        }
+        else {
+            break;
+        }
+        offset += size;
+        remaining -= size;
+    }
+
+    if (remaining > 0) {
+        LOGF("Discarding %llu bytes of the cache file after a torn record",
+             (unsigned long long)remaining);
+    }
+    header->head = offset;
+    header->used -= remaining;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Session interface
+
+KineticStatus KineticCacheFile_Open(const char* path, size_t capacityBytes,
+                                    KineticCacheFile** const cacheFile)
+{
+    assert(path != NULL);
+    assert(cacheFile != NULL);
+    *cacheFile = NULL;
+    uint64_t capacity = capacityBytes & ~(uint64_t)(KINETIC_CACHE_FILE_ALIGN - 1);
+    if (capacity < KINETIC_CACHE_FILE_CAPACITY_MIN) {
+        LOGF_ERROR("Cache file must be at least %d bytes!", KINETIC_CACHE_FILE_CAPACITY_MIN);
+        return KINETIC_STATUS_SESSION_INVALID;
+    }
+
+    KineticStatus status = KINETIC_STATUS_SESSION_INVALID;
+    KineticCacheFile* file = calloc(1, sizeof(KineticCacheFile));
+    if (file == NULL) {
+        LOG_ERROR("Failed allocating cache file!");
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    file->bucketCount = KINETIC_CACHE_FILE_INITIAL_BUCKETS;
+    file->buckets = calloc(file->bucketCount, sizeof(KineticCacheFileItem*));
+    file->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (file->buckets == NULL || file->fd < 0) {
+        LOGF_ERROR("Failed opening cache file %s: %s", path, strerror(errno));
+        goto fail;
+    }
+
+    // Sessions would corrupt the log of a file they shared
+    if (flock(file->fd, LOCK_EX | LOCK_NB) != 0) {
+        LOGF_ERROR("Cache file %s is in use by another session!", path);
+        goto fail;
+    }
+
+    file->mapLen = KINETIC_CACHE_FILE_DATA_OFFSET + capacity;
+    struct stat st;
+    if (fstat(file->fd, &st) != 0 ||
+        ((uint64_t)st.st_size > file->mapLen && ftruncate(file->fd, file->mapLen) != 0)) {
+        LOGF_ERROR("Failed sizing cache file %s: %s", path, strerror(errno));
+        goto fail;
+    }
+
+    // Allocate the storage of the whole file up front, as storing to a page
+    // of a sparse mapping with the file system full would raise SIGBUS
+    int error = posix_fallocate(file->fd, 0, (off_t)file->mapLen);
+    if (error != 0) {
+        LOGF_ERROR("Failed allocating %llu bytes for cache file %s: %s",
+                   (unsigned long long)file->mapLen, path, strerror(error));
+        status = KINETIC_STATUS_MEMORY_ERROR;
+        goto fail;
+    }
+    file->map = mmap(NULL, file->mapLen, PROT_READ | PROT_WRITE, MAP_SHARED, file->fd, 0);
+    if (file->map == MAP_FAILED) {
+        file->map = NULL;
+        LOGF_ERROR("Failed mapping cache file %s: %s", path, strerror(errno));
+        goto fail;
+    }
+    file->header = (KineticCacheFileHeader*)file->map;
+    file->log = &file->map[KINETIC_CACHE_FILE_DATA_OFFSET];
+
+    if (!KineticCacheFile_Load(file, capacity)) {
+        LOGF("Initializing cache file %s", path);
+        *file->header = (KineticCacheFileHeader) {
+            .magic = KINETIC_CACHE_FILE_MAGIC,
+            .capacity = capacity,
+        };
+    }
+    pthread_mutex_init(&file->mutex, NULL);
+    *cacheFile = file;
+    return KINETIC_STATUS_SUCCESS;
+
+fail:
+    if (file->fd >= 0) {
+        close(file->fd);
+    }
+    free(file->buckets);
+    free(file);
+    return status;
+}
+
+void KineticCacheFile_Close(KineticCacheFile* const file)
+{
+    if (file == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < file->bucketCount; i++) {
+        KineticCacheFileItem* item = file->buckets[i];
+        while (item != NULL) {
+            KineticCacheFileItem* next = item->hashNext;
+            free(item);
+            item = next;
+        }
+    }
+    munmap(file->map, file->mapLen);
+    close(file->fd);
+    pthread_mutex_destroy(&file->mutex);
+    free(file->buckets);
+    free(file);
+}
+
+bool KineticCacheFile_Contains(KineticCacheFile* const file, const ByteBuffer* const key)
+{
+    assert(file != NULL);
+    assert(key != NULL);
+    uint64_t hash = Kinetic_HashKey(key->array.data, key->bytesUsed);
+    pthread_mutex_lock(&file->mutex);
+    bool found = (*KineticCacheFile_Link(file, key->array.data, key->bytesUsed, hash) != NULL);
+    if (!found) {
+        file->stats.misses++;
+    }
+    pthread_mutex_unlock(&file->mutex);
+    return found;
+}
+
+static bool KineticCacheFile_CopyOut(ByteBuffer* const dest, const uint8_t* data, size_t len)
+{
+    dest->bytesUsed = len;
+    if (len == 0) {
+        return true;
+    }
+    if (dest->array.data == NULL || dest->array.len < len) {
+        return false;
+    }
+    memcpy(dest->array.data, data, len);
+    return true;
+}
+
+KineticStatus KineticCacheFile_Get(KineticCacheFile* const file,
+                                   KineticEntry* const entry, ByteArray dbVersion)
+{
+    assert(file != NULL);
+    assert(entry != NULL);
+    uint64_t hash = Kinetic_HashKey(entry->key.array.data, entry->key.bytesUsed);
+    pthread_mutex_lock(&file->mutex);
+
+    KineticCacheFileItem** link = KineticCacheFile_Link(file,
+        entry->key.array.data, entry->key.bytesUsed, hash);
+    KineticCacheFileItem* item = *link;
+    if (item == NULL) {
+        // Evicted since looked up
+        file->stats.misses++;
+        pthread_mutex_unlock(&file->mutex);
+        return KINETIC_STATUS_NOT_ATTEMPTED;
+    }
+    KineticCacheFileRecord* record = KineticCacheFile_RecordAt(file, item->offset);
+    const uint8_t* version = &record->data[record->keyLen];
+    if (record->versionLen != dbVersion.len ||
+        memcmp(version, dbVersion.data, dbVersion.len) != 0) {
+        file->stats.stale++;
+        KineticCacheFile_Unindex(file, link);
+        pthread_mutex_unlock(&file->mutex);
+        return KINETIC_STATUS_NOT_ATTEMPTED;
+    }
+
+    // Records read back from a previous session may have been torn by a crash
+    if (!item->verified) {
+        if (record->dataChecksum != KineticCacheFile_DataChecksum(record)) {
+            LOG_ERROR("Discarding corrupt entry from the cache file!");
+            file->stats.misses++;
+            KineticCacheFile_Unindex(file, link);
+            pthread_mutex_unlock(&file->mutex);
+            return KINETIC_STATUS_NOT_ATTEMPTED;
+        }
+        item->verified = true;
+    }
+
+    const uint8_t* tag = version + record->versionLen;
+    const uint8_t* value = tag + record->tagLen;
+    bool copied = KineticCacheFile_CopyOut(&entry->dbVersion, version, record->versionLen);
+    copied = KineticCacheFile_CopyOut(&entry->tag, tag, record->tagLen) && copied;
+    copied = KineticCacheFile_CopyOut(&entry->value, value, record->valueLen) && copied;
+    entry->algorithm = (KineticAlgorithm)record->algorithm;
+    file->stats.hits++;
+    pthread_mutex_unlock(&file->mutex);
+
+    if (!copied) {
+        LOG("Cached entry does not fit in the buffers of the entry!");
+        return KINETIC_STATUS_BUFFER_OVERRUN;
+    }
+    return KINETIC_STATUS_SUCCESS;
+}
+
+void KineticCacheFile_Put(KineticCacheFile* const file, const KineticEntry* const entry)
+{
+    assert(file != NULL);
+    assert(entry != NULL);
+
+    // Entries of more than a quarter of the log would evict too many others
+    uint64_t len = KineticCacheFile_RecordLen((uint64_t)entry->key.bytesUsed +
+        entry->dbVersion.bytesUsed +
+        ((entry->tag.array.data != NULL) ? entry->tag.bytesUsed : 0) +
+        ((entry->value.array.data != NULL) ? entry->value.bytesUsed : 0));
+    if (entry->dbVersion.array.data == NULL || entry->dbVersion.bytesUsed == 0 ||
+        len > file->header->capacity / 4) {
+        KineticCacheFile_Invalidate(file, &entry->key);
+        return;
+    }
+
+    pthread_mutex_lock(&file->mutex);
+    uint64_t offset = KineticCacheFile_Append(file, KINETIC_CACHE_FILE_RECORD_ENTRY, entry);
+    KineticCacheFile_Index(file, offset, true);
+    pthread_mutex_unlock(&file->mutex);
+}
+
+void KineticCacheFile_Invalidate(KineticCacheFile* const file, const ByteBuffer* const key)
+{
+    assert(file != NULL);
+    assert(key != NULL);
+    uint64_t hash = Kinetic_HashKey(key->array.data, key->bytesUsed);
+    pthread_mutex_lock(&file->mutex);
+    KineticCacheFileItem** link = KineticCacheFile_Link(file, key->array.data, key->bytesUsed, hash);
+    if (*link != NULL) {
+        // The tombstone keeps the entry from being indexed again once reopened
+        KineticCacheFile_Unindex(file, link);
+        KineticEntry tombstone = {.key = *key};
+        KineticCacheFile_Append(file, KINETIC_CACHE_FILE_RECORD_TOMBSTONE, &tombstone);
+    }
+    pthread_mutex_unlock(&file->mutex);
+}
+
+void KineticCacheFile_GetStats(KineticCacheFile* const file, KineticCacheStats* const stats)
+{
+    assert(file != NULL);
+    assert(stats != NULL);
+    pthread_mutex_lock(&file->mutex);
+    *stats = file->stats;
+    stats->entries = file->count;
+    stats->bytes = file->header->used;
+    pthread_mutex_unlock(&file->mutex);
+}
@@ -0,0 +1,65 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+
+#ifndef _KINETIC_CACHE_FILE_H
+#define _KINETIC_CACHE_FILE_H
+
+#include "kinetic_types_internal.h"
+
+#define KINETIC_CACHE_FILE_DATA_OFFSET (4096) // Header page, then the log
+
+// Second tier of the read cache of a session, kept in a memory-mapped file so
+// that it survives the client restarting. Entries are appended to a circular
+// log, which overwrites the oldest once full, and indexed in memory by key.
+// The index is rebuilt from the log when the file is opened, and records are
+// checksummed, so that any torn by a crash are discarded. As for the memory
+// tier, only entries with a version are cached, and entries are only served
+// once a GETVERSION shows the cached version is current.
+//
+// The storage of the whole file is allocated when opened. Returns
+// KINETIC_STATUS_MEMORY_ERROR if it cannot be, e.g. as the file system is
+// full, or KINETIC_STATUS_SESSION_INVALID if the file cannot be created or
+// mapped, or is in use by another session.
+KineticStatus KineticCacheFile_Open(const char* path, size_t capacityBytes,
+                                    KineticCacheFile** const cacheFile);
+
+// Unmaps the file, leaving the kernel to write it back to storage
+void KineticCacheFile_Close(KineticCacheFile* const file);
+
+// Returns whether the entry with the key is cached, counting a miss if not
+bool KineticCacheFile_Contains(KineticCacheFile* const file, const ByteBuffer* const key);
+
+// Copies the cached entry with the key of the specified entry into it, if its
+// version matches the version on the device. Returns KINETIC_STATUS_NOT_ATTEMPTED
+// (removing the cached entry) if the version does not match, or the entry
+// is no longer cached or is corrupt.
+KineticStatus KineticCacheFile_Get(KineticCacheFile* const file,
+                                   KineticEntry* const entry, ByteArray dbVersion);
+
+// Appends the key, dbVersion, tag, algorithm and value of the entry to the
+// log, replacing any cached copy, or removes the cached copy if the entry has
+// no version or is too large to cache
+void KineticCacheFile_Put(KineticCacheFile* const file, const KineticEntry* const entry);
+void KineticCacheFile_Invalidate(KineticCacheFile* const file, const ByteBuffer* const key);
+
+void KineticCacheFile_GetStats(KineticCacheFile* const file, KineticCacheStats* const stats);
+
+#endif // _KINETIC_CACHE_FILE_H
@@ -19,14 +19,25 @@
 */
 
 #include "kinetic_client.h"
+#include "kinetic_client_internal.h"
 #include "kinetic_types_internal.h"
 #include "kinetic_pdu.h"
 #include "kinetic_operation.h"
 #include "kinetic_connection.h"
 #include "kinetic_message.h"
+#include "kinetic_decoder.h"
+#include "kinetic_trace.h"
+#include "kinetic_stats.h"
+#include "kinetic_hooks.h"
+#include "kinetic_cache.h"
+#include "kinetic_cache_file.h"
+#include "kinetic_writeback.h"
+#include "kinetic_keyfilter.h"
 #include "kinetic_pdu.h"
 #include "kinetic_logger.h"
+#include <openssl/rand.h>
 #include <stdlib.h>
+#include <string.h>
 
 static KineticStatus KineticClient_CreateOperation(
     KineticOperation* const operation,
@@ -48,9 +59,21 @@ static KineticStatus KineticClient_CreateOperation(
         return KINETIC_STATUS_NO_PDUS_AVAVILABLE;
     }
 
+    // Operation statistics/timing cover building the request onwards
+    KineticStats_BeginOperation();
+
     return KINETIC_STATUS_SUCCESS;
 }
 
+// Frees an operation which completes without executing its request, e.g. as
+// the session served it, ending its statistics unrecorded. Hooks are only
+// invoked for requests executed, so none were for the operation.
+static void KineticClient_AbandonOperation(KineticOperation* const operation)
+{
+    KineticStats_AbandonOperation();
+    KineticOperation_Free(operation);
+}
+
 static KineticStatus KineticClient_ExecuteOperation(KineticOperation* operation)
 {
     KineticStatus status = KINETIC_STATUS_INVALID;
@@ -65,6 +88,13 @@ static KineticStatus KineticClient_ExecuteOperation(KineticOperation* operation)
         LOG("  Sending PDU w/o value");
     }
 
+    if (KineticStatsTimingEnabled) {
+        KineticStats_EndBuildStage();
+    }
+    if (KINETIC_HOOKS_ENABLED()) {
+        KineticHooks_BeginOperation(operation->request);
+    }
+
     // Send the request
     status = KineticPDU_Send(operation->request);
     if (status == KINETIC_STATUS_SUCCESS) {
@@ -78,6 +108,10 @@ static KineticStatus KineticClient_ExecuteOperation(KineticOperation* operation)
         }
     }
 
+    KineticStats_EndOperation(operation->request->connection,
+        operation->request->protoData.message.header.messageType, status);
+    KINETIC_HOOK(KINETIC_HOOK_EVENT_OPERATION_COMPLETED, status);
+
     return status;
 }
 
@@ -86,6 +120,250 @@ void KineticClient_Init(const char* logFile)
     KineticLogger_Init(logFile);
 }
 
+KineticStatus KineticClient_ConfigureLogging(KineticLogLevel level,
+        uint32_t subsystems, uint32_t protobufSampleRate)
+{
+    if (level < KINETIC_LOG_LEVEL_NONE || level > KINETIC_LOG_LEVEL_ERROR) {
+        LOGF_ERROR("Invalid log level specified: %d", level);
+        return KINETIC_STATUS_INVALID;
+    }
+    KineticLogger_SetLevel(level);
+    KineticLogger_SetSubsystems(subsystems);
+    KineticLogger_SetProtobufSampleRate(protobufSampleRate);
+    return KINETIC_STATUS_SUCCESS;
+}
+
+KineticStatus KineticClient_StartTrace(const char* traceFile,
+                                       uint32_t records, uint32_t captureBytes)
+{
+    if (traceFile == NULL || traceFile[0] == '\0') {
+        LOG_ERROR("Trace file path is NULL or empty!");
+        return KINETIC_STATUS_INVALID;
+    }
+    return KineticTrace_Open(traceFile, records, captureBytes);
+}
+
+void KineticClient_StopTrace(void)
+{
+    KineticTrace_Close();
+}
+
+KineticStatus KineticClient_GetStats(KineticSessionHandle handle, KineticStats* stats)
+{
+    if (stats == NULL) {
+        LOG_ERROR("Specified stats structure is NULL!");
+        return KINETIC_STATUS_INVALID;
+    }
+    if (handle == KINETIC_HANDLE_INVALID) {
+        KineticStats_Get(NULL, stats);
+        return KINETIC_STATUS_SUCCESS;
+    }
+    KineticConnection* connection = KineticConnection_FromHandle(handle);
+    if (connection == NULL) {
+        LOG_ERROR("Failed getting valid connection from handle!");
+        return KINETIC_STATUS_SESSION_INVALID;
+    }
+    KineticStats_Get(connection, stats);
+    return KINETIC_STATUS_SUCCESS;
+}
+
+KineticStatus KineticClient_ResetStats(KineticSessionHandle handle)
+{
+    if (handle == KINETIC_HANDLE_INVALID) {
+        KineticStats_Reset(NULL);
+        return KINETIC_STATUS_SUCCESS;
+    }
+    KineticConnection* connection = KineticConnection_FromHandle(handle);
+    if (connection == NULL) {
+        LOG_ERROR("Failed getting valid connection from handle!");
+        return KINETIC_STATUS_SESSION_INVALID;
+    }
+    KineticStats_Reset(connection);
+    return KINETIC_STATUS_SUCCESS;
+}
+
+uint64_t KineticClient_GetLatencyPercentile(const KineticLatencyHistogram* histogram,
+                                            double percentile)
+{
+    if (histogram == NULL) {
+        return 0;
+    }
+    return KineticStats_Percentile(histogram, percentile);
+}
+
+void KineticClient_SetOperationTiming(bool enabled)
+{
+    KineticStats_SetTimingEnabled(enabled);
+}
+
+KineticStatus KineticClient_GetLastOperationTiming(KineticOperationTiming* timing)
+{
+    if (timing == NULL) {
+        LOG_ERROR("Specified timing structure is NULL!");
+        return KINETIC_STATUS_INVALID;
+    }
+    if (!KineticStats_GetLastOperationTiming(timing)) {
+        return KINETIC_STATUS_NOT_ATTEMPTED;
+    }
+    return KINETIC_STATUS_SUCCESS;
+}
+
+void KineticClient_SetHooks(const KineticHooks* hooks)
+{
+    KineticHooks_Set(hooks);
+}
+
+KineticStatus KineticClient_Flush(KineticSessionHandle handle)
+{
+    KineticStatus status;
+    KineticOperation operation;
+
+    status = KineticClient_CreateOperation(&operation, handle);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        return status;
+    }
+
+    if (operation.connection->writeBack != NULL) {
+        status = KineticWriteBack_Flush(operation.connection->writeBack);
+        if (status != KINETIC_STATUS_SUCCESS) {
+            KineticClient_AbandonOperation(&operation);
+            return status;
+        }
+    }
+
+    // Initialize request
+    KineticOperation_BuildFlush(&operation);
+
+    // Execute the operation
+    status = KineticClient_ExecuteOperation(&operation);
+
+    KineticOperation_Free(&operation);
+
+    return status;
+}
+
+KineticStatus KineticClient_GetWriteBackStats(KineticSessionHandle handle,
+                                              KineticWriteBackStats* stats)
+{
+    if (stats == NULL) {
+        LOG_ERROR("Specified write-back stats structure is NULL!");
+        return KINETIC_STATUS_INVALID;
+    }
+    if (handle == KINETIC_HANDLE_INVALID) {
+        LOG("Specified session has invalid handle value");
+        return KINETIC_STATUS_SESSION_EMPTY;
+    }
+    KineticConnection* connection = KineticConnection_FromHandle(handle);
+    if (connection == NULL) {
+        LOG_ERROR("Failed getting valid connection from handle!");
+        return KINETIC_STATUS_SESSION_INVALID;
+    }
+    if (connection->writeBack == NULL) {
+        *stats = (KineticWriteBackStats) {.absorbed = 0};
+        return KINETIC_STATUS_SUCCESS;
+    }
+    KineticWriteBack_GetStats(connection->writeBack, stats);
+    return KINETIC_STATUS_SUCCESS;
+}
+
+KineticStatus KineticClient_GetKeyFilterStats(KineticSessionHandle handle,
+                                              KineticKeyFilterStats* stats)
+{
+    if (stats == NULL) {
+        LOG_ERROR("Specified key filter stats structure is NULL!");
+        return KINETIC_STATUS_INVALID;
+    }
+    if (handle == KINETIC_HANDLE_INVALID) {
+        LOG("Specified session has invalid handle value");
+        return KINETIC_STATUS_SESSION_EMPTY;
+    }
+    KineticConnection* connection = KineticConnection_FromHandle(handle);
+    if (connection == NULL) {
+        LOG_ERROR("Failed getting valid connection from handle!");
+        return KINETIC_STATUS_SESSION_INVALID;
+    }
+    if (connection->keyFilter == NULL) {
+        *stats = (KineticKeyFilterStats) {.lookups = 0};
+        return KINETIC_STATUS_SUCCESS;
+    }
+    KineticKeyFilter_GetStats(connection->keyFilter, stats);
+    return KINETIC_STATUS_SUCCESS;
+}
+
+KineticStatus KineticClient_RebuildKeyFilter(KineticSessionHandle handle)
+{
+    if (handle == KINETIC_HANDLE_INVALID) {
+        LOG("Specified session has invalid handle value");
+        return KINETIC_STATUS_SESSION_EMPTY;
+    }
+    KineticConnection* connection = KineticConnection_FromHandle(handle);
+    if (connection == NULL) {
+        LOG_ERROR("Failed getting valid connection from handle!");
+        return KINETIC_STATUS_SESSION_INVALID;
+    }
+    if (connection->keyFilter == NULL) {
+        return KINETIC_STATUS_NOT_ATTEMPTED;
+    }
+    return KineticKeyFilter_Rebuild(connection->keyFilter);
+}
+
+KineticStatus KineticClient_GetCacheStats(KineticSessionHandle handle,
+                                          KineticCacheStats* stats)
+{
+    if (stats == NULL) {
+        LOG_ERROR("Specified cache stats structure is NULL!");
+        return KINETIC_STATUS_INVALID;
+    }
+    if (handle == KINETIC_HANDLE_INVALID) {
+        LOG("Specified session has invalid handle value");
+        return KINETIC_STATUS_SESSION_EMPTY;
+    }
+    KineticConnection* connection = KineticConnection_FromHandle(handle);
+    if (connection == NULL) {
+        LOG_ERROR("Failed getting valid connection from handle!");
+        return KINETIC_STATUS_SESSION_INVALID;
+    }
+    if (connection->cache == NULL) {
+        *stats = (KineticCacheStats) {.hits = 0};
+        return KINETIC_STATUS_SUCCESS;
+    }
+    KineticCache_GetStats(connection->cache, stats);
+    return KINETIC_STATUS_SUCCESS;
+}
+
+KineticStatus KineticClient_GetCacheFileStats(KineticSessionHandle handle,
+                                              KineticCacheStats* stats)
+{
+    if (stats == NULL) {
+        LOG_ERROR("Specified cache stats structure is NULL!");
+        return KINETIC_STATUS_INVALID;
+    }
+    if (handle == KINETIC_HANDLE_INVALID) {
+        LOG("Specified session has invalid handle value");
+        return KINETIC_STATUS_SESSION_EMPTY;
+    }
+    KineticConnection* connection = KineticConnection_FromHandle(handle);
+    if (connection == NULL) {
+        LOG_ERROR("Failed getting valid connection from handle!");
+        return KINETIC_STATUS_SESSION_INVALID;
+    }
+    if (connection->cacheFile == NULL) {
+        *stats = (KineticCacheStats) {.hits = 0};
+        return KINETIC_STATUS_SUCCESS;
+    }
+    KineticCacheFile_GetStats(connection->cacheFile, stats);
+    return KINETIC_STATUS_SUCCESS;
+}
+
+KineticStatus KineticClient_SetDecodeWorkers(int workers)
+{
+    if (workers < 0 || workers > KINETIC_DECODER_WORKERS_MAX) {
+        LOGF("Invalid number of decode workers specified: %d", workers);
+        return KINETIC_STATUS_INVALID;
+    }
+    return KineticDecoder_Start(workers);
+}
+
 KineticStatus KineticClient_Connect(const KineticSession* config,
                                     KineticSessionHandle* handle)
 {
@@ -100,7 +378,8 @@ KineticStatus KineticClient_Connect(const KineticSession* config,
         return KINETIC_STATUS_SESSION_EMPTY;
     }
 
-    if (strlen(config->host) == 0) {
+    // The host is only required by the default transports
+    if (config->transport == NULL && strlen(config->host) == 0) {
         LOG("Host is empty!");
         return KINETIC_STATUS_HOST_EMPTY;
     }
@@ -112,24 +391,75 @@ KineticStatus KineticClient_Connect(const KineticSession* config,
 
     *handle = KineticConnection_NewConnection(config);
     if (handle == KINETIC_HANDLE_INVALID) {
-        LOG("Failed connecting to device!");
+        LOG_ERROR("Failed connecting to device!");
         return KINETIC_STATUS_SESSION_INVALID;
     }
 
     KineticConnection* connection = KineticConnection_FromHandle(*handle);
     if (connection == NULL) {
-        LOG("Failed getting valid connection from handle!");
+        LOG_ERROR("Failed getting valid connection from handle!");
         return KINETIC_STATUS_CONNECTION_ERROR;
     }
 
     KineticStatus status = KineticConnection_Connect(connection);
     if (status != KINETIC_STATUS_SUCCESS) {
-        LOGF("Failed creating connection to %s:%d", config->host, config->port);
+        LOGF_ERROR("Failed creating connection to %s:%d", config->host, config->port);
         KineticConnection_FreeConnection(handle);
         *handle = KINETIC_HANDLE_INVALID;
         return status;
     }
 
+    if (config->readCacheBytes > 0) {
+        connection->cache = KineticCache_Create(config->readCacheBytes);
+        if (connection->cache == NULL) {
+            KineticConnection_Disconnect(connection);
+            KineticConnection_FreeConnection(handle);
+            *handle = KINETIC_HANDLE_INVALID;
+            return KINETIC_STATUS_MEMORY_ERROR;
+        }
+    }
+
+    // Without the space for the cache file, the session runs without it
+    if (config->readCacheFile != NULL) {
+        status = KineticCacheFile_Open(config->readCacheFile,
+                                       config->readCacheFileBytes, &connection->cacheFile);
+        if (status == KINETIC_STATUS_MEMORY_ERROR) {
+            LOGF_ERROR("Running without cache file %s", config->readCacheFile);
+        }
+        else if (status != KINETIC_STATUS_SUCCESS) {
+            KineticCache_Destroy(connection->cache);
+            KineticConnection_Disconnect(connection);
+            KineticConnection_FreeConnection(handle);
+            *handle = KINETIC_HANDLE_INVALID;
+            return KINETIC_STATUS_SESSION_INVALID;
+        }
+    }
+
+    if (config->writeBackBytes > 0) {
+        status = KineticWriteBack_Create(config, &connection->writeBack);
+        if (status != KINETIC_STATUS_SUCCESS) {
+            KineticCacheFile_Close(connection->cacheFile);
+            KineticCache_Destroy(connection->cache);
+            KineticConnection_Disconnect(connection);
+            KineticConnection_FreeConnection(handle);
+            *handle = KINETIC_HANDLE_INVALID;
+            return status;
+        }
+    }
+
+    if (config->keyFilterBytes > 0) {
+        status = KineticKeyFilter_Create(config, &connection->keyFilter);
+        if (status != KINETIC_STATUS_SUCCESS) {
+            KineticWriteBack_Destroy(connection->writeBack);
+            KineticCacheFile_Close(connection->cacheFile);
+            KineticCache_Destroy(connection->cache);
+            KineticConnection_Disconnect(connection);
+            KineticConnection_FreeConnection(handle);
+            *handle = KINETIC_HANDLE_INVALID;
+            return status;
+        }
+    }
+
     return KINETIC_STATUS_SUCCESS;
 }
 
@@ -142,15 +472,38 @@ KineticStatus KineticClient_Disconnect(KineticSessionHandle* const handle)
 
     KineticConnection* connection = KineticConnection_FromHandle(*handle);
     if (connection == NULL) {
-        LOG("Failed getting valid connection from handle!");
+        LOG_ERROR("Failed getting valid connection from handle!");
         return KINETIC_STATUS_CONNECTION_ERROR;
     }
 
+    // Buffered entries are written before the session is closed
+    if (connection->writeBack != NULL) {
+        KineticWriteBack_Destroy(connection->writeBack);
+        connection->writeBack = NULL;
+    }
+    if (connection->keyFilter != NULL) {
+        KineticKeyFilter_Destroy(connection->keyFilter);
+        connection->keyFilter = NULL;
+    }
+
     KineticStatus status = KineticConnection_Disconnect(connection);
     if (status != KINETIC_STATUS_SUCCESS) {
         LOG("Disconnection failed!");
     }
 
+    if (connection->cache != NULL) {
+        KineticCache_Destroy(connection->cache);
+        connection->cache = NULL;
+    }
+    if (connection->cacheFile != NULL) {
+        KineticCacheFile_Close(connection->cacheFile);
+        connection->cacheFile = NULL;
+    }
+    if (connection->versions != NULL) {
+        KineticCache_Destroy(connection->versions);
+        connection->versions = NULL;
+    }
+
     KineticConnection_FreeConnection(handle);
     *handle = KINETIC_HANDLE_INVALID;
 
@@ -178,6 +531,82 @@ KineticStatus KineticClient_NoOp(KineticSessionHandle handle)
     return status;
 }
 
+// Records an entry read from or written to the device in the caches of the session
+static void KineticClient_CacheEntry(KineticConnection* const connection,
+                                     const KineticEntry* const entry)
+{
+    if (connection->cache != NULL) {
+        KineticCache_Put(connection->cache, entry);
+    }
+    if (connection->cacheFile != NULL) {
+        KineticCacheFile_Put(connection->cacheFile, entry);
+    }
+    if (connection->versions != NULL) {
+        KineticCache_Put(connection->versions, entry);
+    }
+}
+
+void KineticClient_UncacheEntry(KineticConnection* const connection,
+                                const KineticEntry* const entry)
+{
+    if (connection->cache != NULL) {
+        KineticCache_Invalidate(connection->cache, &entry->key);
+    }
+    if (connection->cacheFile != NULL) {
+        KineticCacheFile_Invalidate(connection->cacheFile, &entry->key);
+    }
+    if (connection->versions != NULL) {
+        KineticCache_Invalidate(connection->versions, &entry->key);
+    }
+}
+
+// Waits for any PUT of a key buffered by the session to be written
+KineticStatus KineticClient_FlushKey(KineticConnection* const connection,
+                                     const ByteBuffer* const key)
+{
+    KineticWriteBack* writeBack = connection->writeBack;
+    if (writeBack != NULL && KineticWriteBack_Contains(writeBack, key)) {
+        return KineticWriteBack_Flush(writeBack);
+    }
+    return KINETIC_STATUS_SUCCESS;
+}
+
+// Records a key written to the device in the key filter of the session
+void KineticClient_AddKey(KineticConnection* const connection,
+                          const ByteBuffer* const key)
+{
+    if (connection->keyFilter != NULL) {
+        KineticKeyFilter_Add(connection->keyFilter, key);
+    }
+}
+
+// Buffers a PUT in the write-back buffer of the session, if it can be. A PUT
+// which cannot be buffered waits for any buffered entry of the key to be
+// written first, and returns KINETIC_STATUS_NOT_ATTEMPTED if successful.
+static KineticStatus KineticClient_PutWriteBack(KineticConnection* const connection,
+                                                KineticEntry* const entry)
+{
+    KineticWriteBack* writeBack = connection->writeBack;
+    KineticStatus status = KineticWriteBack_Put(writeBack, entry);
+    if (status == KINETIC_STATUS_NOT_ATTEMPTED) {
+        if (KineticWriteBack_Contains(writeBack, &entry->key)) {
+            status = KineticWriteBack_Flush(writeBack);
+            if (status == KINETIC_STATUS_SUCCESS) {
+                status = KINETIC_STATUS_NOT_ATTEMPTED;
+            }
+        }
+        return status;
+    }
+
+    KineticClient_UncacheEntry(connection, entry);
+    if (status == KINETIC_STATUS_SUCCESS &&
+        entry->newVersion.array.data != NULL && entry->newVersion.array.len > 0) {
+        entry->dbVersion = entry->newVersion;
+        entry->newVersion = BYTE_BUFFER_NONE;
+    }
+    return status;
+}
+
 KineticStatus KineticClient_Put(KineticSessionHandle handle,
                                 KineticEntry* const entry)
 {
@@ -189,19 +618,151 @@ KineticStatus KineticClient_Put(KineticSessionHandle handle,
         return status;
     }
 
+    KineticKeyFilter* keyFilter = operation.connection->keyFilter;
+    if (operation.connection->writeBack != NULL) {
+        status = KineticClient_PutWriteBack(operation.connection, entry);
+        if (status != KINETIC_STATUS_NOT_ATTEMPTED) {
+            if (status == KINETIC_STATUS_SUCCESS && keyFilter != NULL) {
+                KineticKeyFilter_Add(keyFilter, &entry->key);
+            }
+            KineticClient_AbandonOperation(&operation);
+            return status;
+        }
+    }
+
     // Initialize request
     KineticOperation_BuildPut(&operation, entry);
 
     // Execute the operation
     status = KineticClient_ExecuteOperation(&operation);
 
+    if (status == KINETIC_STATUS_SUCCESS && keyFilter != NULL) {
+        KineticKeyFilter_Add(keyFilter, &entry->key);
+    }
     if (status == KINETIC_STATUS_SUCCESS) {
         // Propagate newVersion to dbVersion in metadata, if newVersion specified
         if (entry->newVersion.array.data != NULL && entry->newVersion.array.len > 0) {
             entry->dbVersion = entry->newVersion;
             entry->newVersion = BYTE_BUFFER_NONE;
+            KineticClient_CacheEntry(operation.connection, entry);
+        }
+        else {
+            KineticClient_UncacheEntry(operation.connection, entry);
+        }
+    }
+    else {
+        KineticClient_UncacheEntry(operation.connection, entry);
+    }
+
+    KineticOperation_Free(&operation);
+
+    return status;
+}
+
+static bool KineticClient_IsNotFound(const KineticOperation* const operation)
+{
+    const KineticProto* proto = operation->response->proto;
+    return proto != NULL && proto->command != NULL && proto->command->status != NULL &&
+           proto->command->status->has_code &&
+           proto->command->status->code == KINETIC_PROTO_STATUS_STATUS_CODE_NOT_FOUND;
+}
+
+// Executes a GET of the entry, and frees the operation. Sets notFound, if
+// specified, to whether the GET failed as the entry does not exist.
+static KineticStatus KineticClient_GetFromDevice(KineticOperation* const operation,
+                                                 KineticEntry* const entry,
+                                                 bool* const notFound)
+{
+    // Initialize request
+    KineticOperation_BuildGet(operation, entry);
+
+    // Execute the operation
+    KineticStatus status = KineticClient_ExecuteOperation(operation);
+
+
+    // Update the entry upon success
+    // entry->value.array.len = 0;
+    if (status == KINETIC_STATUS_SUCCESS) {
+        KineticProto_KeyValue* keyValue = KineticPDU_GetKeyValue(operation->response);
+        if (keyValue != NULL) {
+            if (!Copy_KineticProto_KeyValue_to_KineticEntry(keyValue, entry)) {
+                status = KINETIC_STATUS_BUFFER_OVERRUN;
+            }
+        }
+        if (!entry->metadataOnly) {
+            entry->value.bytesUsed = (operation->response->header.valueLength > 0) ?
+                                     operation->response->entry.value.bytesUsed : 0;
+        }
+    }
+    if (notFound != NULL) {
+        *notFound = (status != KINETIC_STATUS_SUCCESS) && KineticClient_IsNotFound(operation);
+    }
+
+    if (!entry->metadataOnly) {
+        // Values truncated to fit the buffer of the caller are not cached
+        if (status == KINETIC_STATUS_SUCCESS &&
+            entry->value.bytesUsed == operation->response->header.valueLength) {
+            KineticClient_CacheEntry(operation->connection, entry);
+        }
+        else {
+            KineticClient_UncacheEntry(operation->connection, entry);
+        }
+    }
+
+    KineticOperation_Free(operation);
+
+    return status;
+}
+
+// Serves a GET from the read cache of the session, if a GETVERSION shows the
+// cached copy of the entry is still current. Entries found only in the cache
+// file are promoted to the memory tier. Returns KINETIC_STATUS_NOT_ATTEMPTED
+// if the entry must be read from the device instead.
+static KineticStatus KineticClient_GetCached(KineticSessionHandle handle,
+                                             KineticConnection* const connection,
+                                             KineticEntry* const entry)
+{
+    KineticCache* cache = connection->cache;
+    KineticCacheFile* cacheFile = connection->cacheFile;
+    bool inMemory = (cache != NULL && KineticCache_Contains(cache, &entry->key));
+    if (!inMemory && (cacheFile == NULL || !KineticCacheFile_Contains(cacheFile, &entry->key))) {
+        return KINETIC_STATUS_NOT_ATTEMPTED;
+    }
+
+    KineticStatus status;
+    KineticOperation operation;
+
+    status = KineticClient_CreateOperation(&operation, handle);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        return status;
+    }
+
+    KineticOperation_BuildGetVersion(&operation, entry);
+    status = KineticClient_ExecuteOperation(&operation);
+
+    if (status == KINETIC_STATUS_SUCCESS) {
+        KineticProto_KeyValue* keyValue = KineticPDU_GetKeyValue(operation.response);
+        if (keyValue != NULL && keyValue->has_dbVersion) {
+            ByteArray version = {.data = keyValue->dbVersion.data, .len = keyValue->dbVersion.len};
+            if (inMemory) {
+                status = KineticCache_Get(cache, entry, version);
+            }
+            else {
+                status = KineticCacheFile_Get(cacheFile, entry, version);
+                if (status == KINETIC_STATUS_SUCCESS && cache != NULL) {
+                    KineticCache_Put(cache, entry);
+                }
+            }
+        }
+        else {
+            KineticClient_UncacheEntry(connection, entry);
+            status = KINETIC_STATUS_NOT_ATTEMPTED;
         }
     }
+    else {
+        // e.g. the entry was deleted through another session
+        KineticClient_UncacheEntry(connection, entry);
+    }
 
     KineticOperation_Free(&operation);
 
@@ -224,26 +785,157 @@ KineticStatus KineticClient_Get(KineticSessionHandle handle,
         return status;
     }
 
-    // Initialize request
-    KineticOperation_BuildGet(&operation, entry);
+    // Buffered entries are newer than those on the device
+    KineticWriteBack* writeBack = operation.connection->writeBack;
+    if (writeBack != NULL) {
+        status = KineticWriteBack_Get(writeBack, entry);
+        if (status != KINETIC_STATUS_NOT_ATTEMPTED) {
+            KineticClient_AbandonOperation(&operation);
+            return status;
+        }
+    }
 
-    // Execute the operation
-    status = KineticClient_ExecuteOperation(&operation);
+    // Keys which are certainly not on the device fail as the GET would
+    KineticKeyFilter* keyFilter = operation.connection->keyFilter;
+    if (keyFilter != NULL && !KineticKeyFilter_MayContain(keyFilter, &entry->key)) {
+        KineticClient_AbandonOperation(&operation);
+        return KINETIC_STATUS_DATA_ERROR;
+    }
 
+    KineticConnection* connection = operation.connection;
+    // The GETVERSION checking a cached entry is executed as an operation of
+    // its own, and the GET only if the entry must be read from the device
+    if ((connection->cache != NULL || connection->cacheFile != NULL) && !entry->metadataOnly) {
+        KineticClient_AbandonOperation(&operation);
+        status = KineticClient_GetCached(handle, connection, entry);
+        if (status != KINETIC_STATUS_NOT_ATTEMPTED) {
+            return status;
+        }
+        status = KineticClient_CreateOperation(&operation, handle);
+        if (status != KINETIC_STATUS_SUCCESS) {
+            return status;
+        }
+    }
 
-    // Update the entry upon success
-    // entry->value.array.len = 0;
-    if (status == KINETIC_STATUS_SUCCESS) {
-        KineticProto_KeyValue* keyValue = KineticPDU_GetKeyValue(operation.response);
-        if (keyValue != NULL) {
-            if (!Copy_KineticProto_KeyValue_to_KineticEntry(keyValue, entry)) {
-                status = KINETIC_STATUS_BUFFER_OVERRUN;
-            }
+    bool notFound = false;
+    status = KineticClient_GetFromDevice(&operation, entry, &notFound);
+    if (notFound && keyFilter != NULL) {
+        KineticKeyFilter_AddFalsePositive(keyFilter);
+    }
+    return status;
+}
+
+#define KINETIC_UPDATE_ATTEMPTS_MAX (8)
+#define KINETIC_UPDATE_VERSION_LEN (16)
+#define KINETIC_VERSION_CACHE_BYTES (1024 * 1024)
+
+// Reads the current entry for an update, which is empty if it does not exist
+static KineticStatus KineticClient_ReadForUpdate(KineticSessionHandle handle,
+                                                 KineticEntry* const entry)
+{
+    KineticStatus status;
+    KineticOperation operation;
+
+    status = KineticClient_CreateOperation(&operation, handle);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        return status;
+    }
+
+    // A buffered entry is written before a versioned PUT of its key
+    KineticWriteBack* writeBack = operation.connection->writeBack;
+    if (writeBack != NULL) {
+        status = KineticWriteBack_Get(writeBack, entry);
+        if (status != KINETIC_STATUS_NOT_ATTEMPTED) {
+            KineticClient_AbandonOperation(&operation);
+            return status;
         }
     }
 
-    KineticOperation_Free(&operation);
+    // Entries stored without a version have none in the response
+    entry->dbVersion.bytesUsed = 0;
+    entry->tag.bytesUsed = 0;
+    bool notFound = false;
+    status = KineticClient_GetFromDevice(&operation, entry, &notFound);
+    if (notFound) {
+        entry->dbVersion.bytesUsed = 0;
+        entry->tag.bytesUsed = 0;
+        entry->value.bytesUsed = 0;
+        status = KINETIC_STATUS_SUCCESS;
+    }
+    return status;
+}
 
+KineticStatus KineticClient_Update(KineticSessionHandle handle,
+                                   KineticEntry* const entry,
+                                   KineticUpdateFunction update, void* context)
+{
+    assert(entry != NULL);
+    assert(entry->value.array.data != NULL);
+    assert(entry->dbVersion.array.data != NULL);
+    assert(update != NULL);
+
+    if (handle == KINETIC_HANDLE_INVALID) {
+        LOG("Specified session has invalid handle value");
+        return KINETIC_STATUS_SESSION_EMPTY;
+    }
+    KineticConnection* connection = KineticConnection_FromHandle(handle);
+    if (connection == NULL) {
+        LOG_ERROR("Failed getting valid connection from handle!");
+        return KINETIC_STATUS_SESSION_INVALID;
+    }
+
+    // Entries are only cached for sessions which update entries, from then on
+    if (connection->versions == NULL) {
+        connection->versions = KineticCache_Create(KINETIC_VERSION_CACHE_BYTES);
+        if (connection->versions == NULL) {
+            return KINETIC_STATUS_MEMORY_ERROR;
+        }
+    }
+
+    // Start from the last known entry, only reading it from the device if not
+    // known or if the PUT shows it has since changed
+    ByteBuffer dbVersion = entry->dbVersion;
+    uint8_t newVersion[KINETIC_UPDATE_VERSION_LEN];
+    entry->metadataOnly = false;
+    bool known = (KineticCache_GetLatest(connection->versions, entry) == KINETIC_STATUS_SUCCESS);
+    KineticStatus status = KINETIC_STATUS_VERSION_FAILURE;
+    for (int attempt = 0; attempt < KINETIC_UPDATE_ATTEMPTS_MAX &&
+         status == KINETIC_STATUS_VERSION_FAILURE; attempt++) {
+        if (!known) {
+            status = KineticClient_ReadForUpdate(handle, entry);
+            if (status != KINETIC_STATUS_SUCCESS) {
+                return status;
+            }
+        }
+        known = false;
+
+        entry->newVersion = BYTE_BUFFER_NONE;
+        if (!update(entry, context)) {
+            return KINETIC_STATUS_NOT_ATTEMPTED;
+        }
+        if (entry->newVersion.array.data == NULL || entry->newVersion.bytesUsed == 0) {
+            if (RAND_bytes(newVersion, sizeof(newVersion)) != 1) {
+                LOG_ERROR("Failed generating a new version for the entry!");
+                return KINETIC_STATUS_OPERATION_FAILED;
+            }
+            entry->newVersion = ByteBuffer_Create(newVersion, sizeof(newVersion));
+            entry->newVersion.bytesUsed = sizeof(newVersion);
+        }
+        entry->force = false;
+        status = KineticClient_Put(handle, entry);
+    }
+
+    // Return the new version in the dbVersion buffer of the caller
+    if (status == KINETIC_STATUS_SUCCESS && entry->dbVersion.array.data != dbVersion.array.data) {
+        size_t len = entry->dbVersion.bytesUsed;
+        if (len > dbVersion.array.len) {
+            status = KINETIC_STATUS_BUFFER_OVERRUN;
+            len = 0;
+        }
+        memcpy(dbVersion.array.data, entry->dbVersion.array.data, len);
+        entry->dbVersion = dbVersion;
+        entry->dbVersion.bytesUsed = len;
+    }
     return status;
 }
 
@@ -258,12 +950,21 @@ KineticStatus KineticClient_Delete(KineticSessionHandle handle,
         return status;
     }
 
+    // Any buffered PUT of the key must reach the device first
+    status = KineticClient_FlushKey(operation.connection, &entry->key);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        KineticClient_AbandonOperation(&operation);
+        return status;
+    }
+
     // Initialize request
     KineticOperation_BuildDelete(&operation, entry);
 
     // Execute the operation
     status = KineticClient_ExecuteOperation(&operation);
 
+    KineticClient_UncacheEntry(operation.connection, entry);
+
     KineticOperation_Free(&operation);
 
     return status;
@@ -319,3 +1020,183 @@ KineticStatus KineticClient_GetKeyRange(KineticSessionHandle handle,
     KineticStatus status = KINETIC_STATUS_SUCCESS;
     return status;
 }
+
+// Size of each operation of a PEER2PEERPUSH message besides its keys and
+// version (field tags, lengths and force), and of the rest of the message
+#define KINETIC_P2P_OPERATION_OVERHEAD (32)
+#define KINETIC_P2P_MESSAGE_OVERHEAD (512)
+// Operations pushed at once if the device does not report a limit
+#define KINETIC_P2P_BATCH_DEFAULT (100)
+
+// Reads the limits of a device on PEER2PEERPUSH batches with GETLOG: the
+// writes it may have outstanding to the peer, and the size of a message.
+// They are kept by the connection once read, until it is reconnected.
+static void KineticClient_GetP2PLimits(KineticSessionHandle handle,
+                                       size_t* maxOperations, size_t* maxBytes)
+{
+    KineticConnection* connection = KineticConnection_FromHandle(handle);
+    if (connection->p2pMaxOperations > 0) {
+        *maxOperations = connection->p2pMaxOperations;
+        *maxBytes = connection->p2pMaxBytes;
+        return;
+    }
+    *maxOperations = KINETIC_P2P_BATCH_DEFAULT;
+    *maxBytes = PDU_PROTO_MAX_LEN;
+
+    KineticOperation operation;
+    if (KineticClient_CreateOperation(&operation, handle) != KINETIC_STATUS_SUCCESS) {
+        return;
+    }
+    KineticOperation_BuildGetLog(&operation, KINETIC_PROTO_GET_LOG_TYPE_LIMITS);
+    KineticStatus status = KineticClient_ExecuteOperation(&operation);
+
+    KineticProto_GetLog* log = KineticPDU_GetLog(operation.response);
+    if (status == KINETIC_STATUS_SUCCESS && log != NULL && log->limits != NULL) {
+        KineticProto_GetLog_Limits* limits = log->limits;
+        if (limits->has_maxOutstandingWriteRequests && limits->maxOutstandingWriteRequests > 0) {
+            *maxOperations = limits->maxOutstandingWriteRequests;
+        }
+        if (limits->has_maxMessageSize && limits->maxMessageSize > 0 &&
+            limits->maxMessageSize < PDU_PROTO_MAX_LEN) {
+            *maxBytes = limits->maxMessageSize;
+        }
+    }
+    else {
+        LOG("Device did not report its limits, so pushing default batches");
+    }
+    if (status == KINETIC_STATUS_SUCCESS) {
+        connection->p2pMaxOperations = *maxOperations;
+        connection->p2pMaxBytes = *maxBytes;
+    }
+    KineticOperation_Free(&operation);
+}
+
+// Pushes a batch of operations in a single PEER2PEERPUSH, setting the status
+// of each. Returns KINETIC_STATUS_SUCCESS if the device reported the result
+// of every operation, whether or not they succeeded.
+static KineticStatus KineticClient_P2PPushBatch(KineticSessionHandle handle,
+                                                const KineticP2PPeer* const peer,
+                                                KineticP2POperation* const operations,
+                                                KineticProto_P2POperation_Operation** protoOperations,
+                                                size_t count)
+{
+    KineticStatus status;
+    KineticOperation operation;
+
+    status = KineticClient_CreateOperation(&operation, handle);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        return status;
+    }
+
+    // Initialize request
+    KineticOperation_BuildP2POperation(&operation, peer, operations, protoOperations, count);
+
+    // Execute the operation
+    status = KineticClient_ExecuteOperation(&operation);
+
+    // The response may report the result of each operation even if some failed
+    KineticProto_P2POperation* results = KineticPDU_GetP2POperation(operation.response);
+    bool reported = (results != NULL && results->n_operation == count);
+    for (size_t i = 0; i < count; i++) {
+        KineticProto_Status* result = reported ? results->operation[i]->status : NULL;
+        if (result != NULL && result->has_code) {
+            operations[i].status = KineticProtoStatusCode_to_KineticStatus(result->code);
+        }
+        else {
+            reported = false;
+            operations[i].status = (status == KINETIC_STATUS_SUCCESS) ?
+                                   KINETIC_STATUS_DATA_ERROR : status;
+        }
+    }
+    if (!reported && status == KINETIC_STATUS_SUCCESS) {
+        LOG_ERROR("PEER2PEERPUSH response did not report the result of each operation!");
+        status = KINETIC_STATUS_DATA_ERROR;
+    }
+
+    KineticOperation_Free(&operation);
+
+    return reported ? KINETIC_STATUS_SUCCESS : status;
+}
+
+KineticStatus KineticClient_P2PPush(KineticSessionHandle handle,
+                                    const KineticP2PPeer* const peer,
+                                    KineticP2POperation* const operations, int count)
+{
+    if (peer == NULL || peer->host == NULL || (operations == NULL && count > 0) || count < 0) {
+        LOG_ERROR("Invalid PEER2PEERPUSH peer or operations!");
+        return KINETIC_STATUS_INVALID;
+    }
+    if (handle == KINETIC_HANDLE_INVALID) {
+        LOG("Specified session has invalid handle value");
+        return KINETIC_STATUS_SESSION_EMPTY;
+    }
+    KineticConnection* connection = KineticConnection_FromHandle(handle);
+    if (connection == NULL) {
+        LOG("Specified session is not associated with a connection");
+        return KINETIC_STATUS_SESSION_INVALID;
+    }
+    for (int i = 0; i < count; i++) {
+        operations[i].status = KINETIC_STATUS_NOT_ATTEMPTED;
+    }
+    if (count == 0) {
+        return KINETIC_STATUS_SUCCESS;
+    }
+
+    // Entries buffered by the session must reach the device to be pushed
+    if (connection->writeBack != NULL) {
+        KineticStatus status = KineticWriteBack_Flush(connection->writeBack);
+        if (status != KINETIC_STATUS_SUCCESS) {
+            return status;
+        }
+    }
+
+    size_t maxOperations, maxBytes;
+    KineticClient_GetP2PLimits(handle, &maxOperations, &maxBytes);
+    if (maxOperations > (size_t)count) {
+        maxOperations = count;
+    }
+    KineticProto_P2POperation_Operation** protoOperations =
+        malloc(maxOperations * (sizeof(KineticProto_P2POperation_Operation*) +
+                                sizeof(KineticProto_P2POperation_Operation)));
+    if (protoOperations == NULL) {
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    KineticProto_P2POperation_Operation* elements =
+        (KineticProto_P2POperation_Operation*)&protoOperations[maxOperations];
+    for (size_t i = 0; i < maxOperations; i++) {
+        protoOperations[i] = &elements[i];
+    }
+
+    // Fill each batch up to the limits of the device, with at least one operation
+    KineticStatus status = KINETIC_STATUS_SUCCESS;
+    size_t first = 0;
+    while (first < (size_t)count) {
+        size_t bytes = KINETIC_P2P_MESSAGE_OVERHEAD + strlen(peer->host);
+        size_t batch = 0;
+        while (first + batch < (size_t)count && batch < maxOperations) {
+            const KineticP2POperation* operation = &operations[first + batch];
+            size_t operationBytes = KINETIC_P2P_OPERATION_OVERHEAD + operation->key.bytesUsed +
+                                    operation->version.bytesUsed + operation->newKey.bytesUsed;
+            if (batch > 0 && bytes + operationBytes > maxBytes) {
+                break;
+            }
+            bytes += operationBytes;
+            batch++;
+        }
+
+        KineticStatus batchStatus = KineticClient_P2PPushBatch(handle, peer, &operations[first],
+                                                               protoOperations, batch);
+        if (batchStatus != KINETIC_STATUS_SUCCESS) {
+            // The rest are left not attempted
+            status = batchStatus;
+            break;
+        }
+        for (size_t i = first; i < first + batch && status == KINETIC_STATUS_SUCCESS; i++) {
+            status = operations[i].status;
+        }
+        first += batch;
+    }
+
+    free(protoOperations);
+    return status;
+}
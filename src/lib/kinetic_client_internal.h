@@ -0,0 +1,35 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#ifndef _KINETIC_CLIENT_INTERNAL_H
+#define _KINETIC_CLIENT_INTERNAL_H
+
+#include "kinetic_types_internal.h"
+
+// Keeps the features of a session consistent with requests of its connection
+// sent without KineticClient (e.g. the replica requests of a cluster)
+KineticStatus KineticClient_FlushKey(KineticConnection* const connection,
+                                     const ByteBuffer* const key);
+void KineticClient_UncacheEntry(KineticConnection* const connection,
+                                const KineticEntry* const entry);
+void KineticClient_AddKey(KineticConnection* const connection,
+                          const ByteBuffer* const key);
+
+#endif // _KINETIC_CLIENT_INTERNAL_H
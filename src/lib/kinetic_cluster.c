@@ -0,0 +1,2584 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+
+#include "kinetic_cluster.h"
+#include "kinetic_client.h"
+#include "kinetic_client_internal.h"
+#include "kinetic_types_internal.h"
+#include "kinetic_connection.h"
+#include "kinetic_operation.h"
+#include "kinetic_pdu.h"
+#include "kinetic_decoder.h"
+#include "kinetic_transport.h"
+#include "kinetic_erasure.h"
+#include "kinetic_stats.h"
+#include "kinetic_nbo.h"
+#include "kinetic_logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#define KINETIC_CLUSTER_NAME_MAX (HOST_NAME_MAX + 16)
+#define KINETIC_CLUSTER_PENDING_MAX (16)        // Replica requests in flight per device
+#define KINETIC_CLUSTER_REPLY_TIMEOUT_MS (5000) // As the socket read timeout
+#define KINETIC_CLUSTER_CHUNK_HEADER_LEN (16)
+#define KINETIC_CLUSTER_CHUNK_FORMAT (1)
+
+// Replica request sent, whose response has not been received yet
+typedef struct _KineticClusterPending {
+    KineticOperation operation;
+    uint64_t request;   // Replicated operation the request is part of
+    int replica;        // Rank of the device among the replicas of the key
+    uint8_t* buffer;    // Value is read into, owned by the request (or NULL)
+    uint64_t sent;      // When the request was sent (ns)
+    bool framed;        // Response read, but not yet completed
+    KineticStatus frameStatus;
+} KineticClusterPending;
+
+typedef struct _KineticClusterMember {
+    KineticSessionHandle handle;
+    char name[KINETIC_CLUSTER_NAME_MAX];
+    uint64_t seed;  // Hash of the name
+    double weight;
+
+    // Ring of the replica requests in flight, oldest first, whose responses
+    // arrive in the order they were sent
+    KineticClusterPending pending[KINETIC_CLUSTER_PENDING_MAX];
+    int pendingStart;
+    int pendingCount;
+} KineticClusterMember;
+
+// Result from a replica of the replicated operation in progress
+typedef struct _KineticClusterReply {
+    KineticEntry* entry;    // Updated from the response of a read (else NULL)
+    uint8_t* buffer;        // Owned value buffer of the request, to be freed
+    KineticStatus status;
+    bool notFound;          // Whether the key does not exist on the replica
+    bool done;
+} KineticClusterReply;
+
+struct _KineticCluster {
+    KineticClusterMember* members;
+    int count;
+
+    int replicas;
+    int writeQuorum;
+    int readQuorum;
+    int dataChunks;         // Of erasure coded values (0 if not coded)
+    int parityChunks;
+    int degradedReadMs;
+    KineticErasureCode code;
+    uint64_t stripes;       // Erasure coded values written
+    uint64_t request;               // Replicated operation in progress, or last
+    KineticClusterReply* replies;   // Of the operation in progress, by replica
+    KineticClusterStats stats;
+};
+
+// Operations of a batch to execute on one device
+typedef struct _KineticClusterWork {
+    KineticClusterMember* member;
+    KineticClusterOperation* operations;
+    int* indices;   // Of the operations for the device, in order
+    int count;
+    pthread_t thread;
+    bool started;
+} KineticClusterWork;
+
+// Combines the hashes of a key and a device name (the splitmix64 finalizer)
+static inline uint64_t KineticCluster_Combine(uint64_t keyHash, uint64_t seed)
+{
+    uint64_t hash = keyHash ^ seed;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+    return hash ^ (hash >> 31);
+}
+
+// Score of a device for a key. With the hash taken as uniform in (0, 1),
+// weight / -ln(hash) is exponentially distributed with rate 1 / weight, so
+// the device with the highest score is chosen in proportion to its weight.
+static double KineticCluster_Score(const KineticClusterMember* const member, uint64_t keyHash)
+{
+    uint64_t hash = KineticCluster_Combine(keyHash, member->seed);
+    double uniform = ((hash >> 11) + 0.5) / 9007199254740992.0; // 2^53
+    return member->weight / -log(uniform);
+}
+
+//------------------------------------------------------------------------------
+// Replica requests
+
+static bool KineticCluster_IsNotFound(const KineticOperation* const operation)
+{
+    const KineticProto* proto = operation->response->proto;
+    return proto != NULL && proto->command != NULL && proto->command->status != NULL &&
+           proto->command->status->has_code &&
+           proto->command->status->code == KINETIC_PROTO_STATUS_STATUS_CODE_NOT_FOUND;
+}
+
+// Records the result of a replica request, and frees its operation
+static void KineticCluster_Complete(KineticCluster* const cluster,
+                                    KineticClusterPending* const pending,
+                                    KineticStatus status)
+{
+    KineticOperation* operation = &pending->operation;
+    bool notFound = (status != KINETIC_STATUS_SUCCESS) && KineticCluster_IsNotFound(operation);
+    if (status != KINETIC_STATUS_SUCCESS && !notFound) {
+        cluster->stats.replicaFailures++;
+    }
+
+    // Counted in the statistics of the session of the device, as the
+    // requests it executes itself are
+    KineticProto_MessageType type = operation->request->protoData.message.header.messageType;
+    KineticPDUHeader* sent = &operation->request->header;
+    KineticPDUHeader* received = &operation->response->header;
+    KineticStats_RecordOperation(operation->connection, type, status,
+                                 KineticStats_Now() - pending->sent,
+                                 PDU_HEADER_LEN + sent->protobufLength + sent->valueLength,
+                                 PDU_HEADER_LEN + received->protobufLength + received->valueLength);
+
+    if (cluster->replies == NULL || pending->request != cluster->request) {
+        // The replicated operation returned once enough other replicas succeeded
+        if (status == KINETIC_STATUS_SUCCESS &&
+            (type == KINETIC_PROTO_MESSAGE_TYPE_PUT || type == KINETIC_PROTO_MESSAGE_TYPE_DELETE)) {
+            cluster->stats.lateAcks++;
+        }
+        else if (!notFound) {
+            LOGF_ERROR("Late cluster replica request failed with status: %s",
+                       Kinetic_GetStatusDescription(status));
+        }
+        free(pending->buffer);
+        KineticOperation_Free(operation);
+        return;
+    }
+
+    KineticClusterReply* reply = &cluster->replies[pending->replica];
+    reply->buffer = pending->buffer;
+    if (status == KINETIC_STATUS_SUCCESS && reply->entry != NULL) {
+        KineticProto_KeyValue* keyValue = KineticPDU_GetKeyValue(operation->response);
+        if (keyValue != NULL && !Copy_KineticProto_KeyValue_to_KineticEntry(keyValue, reply->entry)) {
+            status = KINETIC_STATUS_BUFFER_OVERRUN;
+        }
+        if (!reply->entry->metadataOnly) {
+            reply->entry->value.bytesUsed = (operation->response->header.valueLength > 0) ?
+                                            operation->response->entry.value.bytesUsed : 0;
+        }
+    }
+    reply->status = status;
+    reply->notFound = notFound;
+    reply->done = true;
+    KineticOperation_Free(operation);
+}
+
+// Fails the requests in flight to a device whose connection failed, which
+// is reconnected to when next needed
+static void KineticCluster_Abort(KineticCluster* const cluster,
+                                 KineticClusterMember* const member,
+                                 KineticStatus status)
+{
+    LOGF_ERROR("Cluster device %s failed with status: %s",
+               member->name, Kinetic_GetStatusDescription(status));
+    while (member->pendingCount > 0) {
+        KineticClusterPending* pending = &member->pending[member->pendingStart];
+        if (pending->framed) {
+            KineticPDU_Complete(pending->operation.response, pending->frameStatus);
+            pending->framed = false;
+        }
+        KineticCluster_Complete(cluster, pending, status);
+        member->pendingStart = (member->pendingStart + 1) % KINETIC_CLUSTER_PENDING_MAX;
+        member->pendingCount--;
+    }
+    KineticConnection* connection = KineticConnection_FromHandle(member->handle);
+    if (connection->connected) {
+        KineticConnection_Disconnect(connection);
+    }
+}
+
+// Receives the response to the oldest request in flight to a device
+static void KineticCluster_ReceiveOldest(KineticCluster* const cluster,
+                                         KineticClusterMember* const member)
+{
+    assert(member->pendingCount > 0);
+    KineticClusterPending* pending = &member->pending[member->pendingStart];
+    KineticOperation* operation = &pending->operation;
+    KineticStatus status;
+    if (pending->framed) {
+        status = KineticPDU_Complete(operation->response, pending->frameStatus);
+        pending->framed = false;
+    }
+    else {
+        operation->response->connection = operation->request->connection;
+        status = KineticPDU_Receive(operation->response);
+    }
+    if (status == KINETIC_STATUS_SUCCESS) {
+        status = KineticOperation_GetStatus(operation);
+    }
+    KineticCluster_Complete(cluster, pending, status);
+    member->pendingStart = (member->pendingStart + 1) % KINETIC_CLUSTER_PENDING_MAX;
+    member->pendingCount--;
+
+    if (Kinetic_IsConnectionFailure(status)) {
+        KineticCluster_Abort(cluster, member, status);
+    }
+}
+
+// Receives the responses to all requests in flight to a device. With the
+// decode stage enabled, they are all read before any is completed, so that
+// each is decoded while those after it are read.
+static void KineticCluster_Drain(KineticCluster* const cluster,
+                                 KineticClusterMember* const member)
+{
+    if (KineticDecoder_IsEnabled()) {
+        // Once a read fails, the rest in flight can no longer be read
+        KineticStatus status = KINETIC_STATUS_SUCCESS;
+        for (int i = 0; i < member->pendingCount; i++) {
+            KineticClusterPending* pending =
+                &member->pending[(member->pendingStart + i) % KINETIC_CLUSTER_PENDING_MAX];
+            if (pending->framed) {
+                status = pending->frameStatus;
+                continue;
+            }
+            if (status == KINETIC_STATUS_SUCCESS) {
+                KineticOperation* operation = &pending->operation;
+                operation->response->connection = operation->request->connection;
+                status = KineticPDU_ReceiveFrame(operation->response);
+            }
+            pending->frameStatus = status;
+            pending->framed = true;
+        }
+    }
+    while (member->pendingCount > 0) {
+        KineticCluster_ReceiveOldest(cluster, member);
+    }
+}
+
+// Whether a device has a request of the replicated operation in progress in flight
+static bool KineticCluster_IsAwaited(const KineticCluster* const cluster,
+                                     const KineticClusterMember* const member)
+{
+    for (int i = 0; i < member->pendingCount; i++) {
+        int slot = (member->pendingStart + i) % KINETIC_CLUSTER_PENDING_MAX;
+        if (member->pending[slot].request == cluster->request) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void KineticCluster_BeginRequest(KineticCluster* const cluster,
+                                        KineticClusterReply* replies)
+{
+    cluster->request++;
+    cluster->replies = replies;
+}
+
+static void KineticCluster_EndRequest(KineticCluster* const cluster)
+{
+    cluster->replies = NULL;
+}
+
+// Sends a request of the replicated operation in progress to a replica,
+// without waiting for the response. The value of a GET may be read into a
+// buffer owned by the request, which passes to the reply if the response is
+// received before the operation returns, or is otherwise freed.
+static void KineticCluster_Send(KineticCluster* const cluster, int replica, int device,
+                                KineticProto_MessageType type, KineticEntry* const entry,
+                                uint8_t* buffer)
+{
+    KineticClusterMember* member = &cluster->members[device];
+    KineticConnection* connection = KineticConnection_FromHandle(member->handle);
+    if (member->pendingCount == KINETIC_CLUSTER_PENDING_MAX) {
+        KineticCluster_ReceiveOldest(cluster, member);
+    }
+
+    KineticStatus status = KINETIC_STATUS_SUCCESS;
+    if (!connection->connected) {
+        status = KineticConnection_Connect(connection);
+    }
+    if (status == KINETIC_STATUS_SUCCESS) {
+        // Any PUT of the key buffered by the session must reach the device first
+        status = KineticClient_FlushKey(connection, &entry->key);
+    }
+    KineticClusterPending* pending = &member->pending[
+        (member->pendingStart + member->pendingCount) % KINETIC_CLUSTER_PENDING_MAX];
+    if (status == KINETIC_STATUS_SUCCESS) {
+        pending->operation = KineticOperation_Create(connection);
+        if (pending->operation.request == NULL || pending->operation.response == NULL) {
+            KineticOperation_Free(&pending->operation);
+            status = KINETIC_STATUS_NO_PDUS_AVAVILABLE;
+        }
+    }
+    if (status == KINETIC_STATUS_SUCCESS) {
+        switch (type) {
+        case KINETIC_PROTO_MESSAGE_TYPE_PUT:
+            KineticOperation_BuildPut(&pending->operation, entry);
+            break;
+        case KINETIC_PROTO_MESSAGE_TYPE_DELETE:
+            KineticOperation_BuildDelete(&pending->operation, entry);
+            break;
+        case KINETIC_PROTO_MESSAGE_TYPE_GET:
+            KineticOperation_BuildGet(&pending->operation, entry);
+            break;
+        default:
+            KineticOperation_BuildGetVersion(&pending->operation, entry);
+            break;
+        }
+        if (type == KINETIC_PROTO_MESSAGE_TYPE_PUT || type == KINETIC_PROTO_MESSAGE_TYPE_DELETE) {
+            // Writes may complete after the operation returns, so their
+            // responses must not refer to the entry of the caller
+            pending->operation.response->entry = (KineticEntry) {.value = BYTE_BUFFER_NONE};
+            cluster->stats.replicaWrites++;
+
+            // Keep the caches and key filter of the session consistent with
+            // the write, as KineticClient_Put() and KineticClient_Delete() do
+            KineticClient_UncacheEntry(connection, entry);
+            if (type == KINETIC_PROTO_MESSAGE_TYPE_PUT) {
+                KineticClient_AddKey(connection, &entry->key);
+            }
+        }
+        pending->sent = KineticStats_Now();
+        status = KineticPDU_Send(pending->operation.request);
+        if (status != KINETIC_STATUS_SUCCESS) {
+            KineticOperation_Free(&pending->operation);
+        }
+    }
+
+    if (status != KINETIC_STATUS_SUCCESS) {
+        cluster->stats.replicaFailures++;
+        cluster->replies[replica] = (KineticClusterReply) {
+            .buffer = buffer,
+            .status = status,
+            .done = true,
+        };
+        if (Kinetic_IsConnectionFailure(status)) {
+            KineticCluster_Abort(cluster, member, status);
+        }
+        return;
+    }
+    pending->request = cluster->request;
+    pending->replica = replica;
+    pending->buffer = buffer;
+    pending->framed = false;
+    member->pendingCount++;
+}
+
+// Receives the next response to the replicated operation in progress from
+// any of its replicas. Returns KINETIC_STATUS_NOT_ATTEMPTED if none are
+// outstanding, or KINETIC_STATUS_SOCKET_TIMEOUT if none arrive within a
+// timeout shorter than the reply timeout, after which replicas fail.
+static KineticStatus KineticCluster_ReceiveNext(KineticCluster* const cluster,
+                                                const int* devices, int count,
+                                                int timeoutMs)
+{
+    assert(count > 0);
+    struct pollfd fds[count];
+    int polled[count];
+    int polledCount = 0;
+    for (int i = 0; i < count; i++) {
+        KineticClusterMember* member = &cluster->members[devices[i]];
+        if (!KineticCluster_IsAwaited(cluster, member)) {
+            continue;
+        }
+        // Responses may already be buffered (e.g. by TLS), and transports
+        // without a socket can only be read from blocking
+        KineticConnection* connection = KineticConnection_FromHandle(member->handle);
+        if (connection->socket < 0 ||
+            KineticTransport_Poll(connection, 0) == KINETIC_STATUS_SUCCESS) {
+            KineticCluster_ReceiveOldest(cluster, member);
+            return KINETIC_STATUS_SUCCESS;
+        }
+        fds[polledCount] = (struct pollfd) {.fd = connection->socket, .events = POLLIN};
+        polled[polledCount++] = devices[i];
+    }
+    if (polledCount == 0) {
+        return KINETIC_STATUS_NOT_ATTEMPTED;
+    }
+
+    if (timeoutMs > KINETIC_CLUSTER_REPLY_TIMEOUT_MS) {
+        timeoutMs = KINETIC_CLUSTER_REPLY_TIMEOUT_MS;
+    }
+    int ready;
+    do {
+        ready = poll(fds, polledCount, timeoutMs);
+    } while (ready < 0 && errno == EINTR);
+    if (ready == 0 && timeoutMs < KINETIC_CLUSTER_REPLY_TIMEOUT_MS) {
+        return KINETIC_STATUS_SOCKET_TIMEOUT;
+    }
+    for (int i = 0; i < polledCount; i++) {
+        KineticClusterMember* member = &cluster->members[polled[i]];
+        if (ready <= 0) {
+            KineticCluster_Abort(cluster, member, KINETIC_STATUS_SOCKET_TIMEOUT);
+        }
+        else if (fds[i].revents != 0) {
+            KineticCluster_ReceiveOldest(cluster, member);
+            break;
+        }
+    }
+    return KINETIC_STATUS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+// Devices
+
+// Reads the nominal capacity of a device with GETLOG
+static KineticStatus KineticCluster_GetCapacity(KineticSessionHandle handle, double* capacity)
+{
+    KineticConnection* connection = KineticConnection_FromHandle(handle);
+    if (connection == NULL) {
+        return KINETIC_STATUS_SESSION_INVALID;
+    }
+    KineticOperation operation = KineticOperation_Create(connection);
+    if (operation.request == NULL || operation.response == NULL) {
+        return KINETIC_STATUS_NO_PDUS_AVAVILABLE;
+    }
+    KineticOperation_BuildGetLog(&operation, KINETIC_PROTO_GET_LOG_TYPE_CAPACITIES);
+    KineticStatus status = KineticPDU_Send(operation.request);
+    if (status == KINETIC_STATUS_SUCCESS) {
+        operation.response->connection = connection;
+        status = KineticPDU_Receive(operation.response);
+    }
+    if (status == KINETIC_STATUS_SUCCESS) {
+        status = KineticOperation_GetStatus(&operation);
+    }
+
+    *capacity = 0.0;
+    KineticProto_GetLog* log = KineticPDU_GetLog(operation.response);
+    if (status == KINETIC_STATUS_SUCCESS && log != NULL && log->capacity != NULL &&
+        log->capacity->has_nominalCapacityInBytes) {
+        *capacity = (double)log->capacity->nominalCapacityInBytes;
+    }
+    KineticOperation_Free(&operation);
+    return status;
+}
+
+KineticStatus KineticCluster_AddDevice(KineticCluster* const cluster,
+                                       const KineticClusterDevice* device)
+{
+    assert(cluster != NULL);
+    assert(device != NULL);
+    if (device->weight < 0.0) {
+        LOG_ERROR("Cluster device weight must not be negative!");
+        return KINETIC_STATUS_INVALID;
+    }
+
+    KineticClusterMember member = {.weight = device->weight};
+    if (device->name != NULL) {
+        snprintf(member.name, sizeof(member.name), "%s", device->name);
+    }
+    else {
+        snprintf(member.name, sizeof(member.name), "%s:%d",
+                 device->session.host, device->session.port);
+    }
+    for (int i = 0; i < cluster->count; i++) {
+        if (strcmp(cluster->members[i].name, member.name) == 0) {
+            LOGF_ERROR("Cluster already has a device named %s!", member.name);
+            return KINETIC_STATUS_INVALID;
+        }
+    }
+    member.seed = Kinetic_HashKey((const uint8_t*)member.name, strlen(member.name));
+
+    KineticClusterMember* members = realloc(cluster->members,
+                                            (cluster->count + 1) * sizeof(KineticClusterMember));
+    if (members == NULL) {
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    cluster->members = members;
+
+    KineticStatus status = KineticClient_Connect(&device->session, &member.handle);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        LOGF_ERROR("Failed connecting to cluster device %s", member.name);
+        return status;
+    }
+    if (member.weight == 0.0) {
+        status = KineticCluster_GetCapacity(member.handle, &member.weight);
+        if (status == KINETIC_STATUS_SUCCESS && member.weight == 0.0) {
+            LOGF_ERROR("Cluster device %s reported no capacity, so needs a weight!", member.name);
+            status = KINETIC_STATUS_INVALID;
+        }
+        if (status != KINETIC_STATUS_SUCCESS) {
+            KineticClient_Disconnect(&member.handle);
+            return status;
+        }
+    }
+    LOGF("Added cluster device %s with weight %g", member.name, member.weight);
+
+    cluster->members[cluster->count++] = member;
+    return KINETIC_STATUS_SUCCESS;
+}
+
+KineticStatus KineticCluster_Connect(const KineticClusterDevice* devices, int count,
+                                     KineticCluster** cluster)
+{
+    if (cluster == NULL) {
+        LOG("Cluster is NULL!");
+        return KINETIC_STATUS_SESSION_EMPTY;
+    }
+    *cluster = NULL;
+    if (devices == NULL || count < 1) {
+        LOG("Cluster has no devices!");
+        return KINETIC_STATUS_INVALID;
+    }
+
+    KineticCluster* newCluster = calloc(1, sizeof(KineticCluster));
+    if (newCluster == NULL) {
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    newCluster->replicas = 1;
+    newCluster->writeQuorum = 1;
+    newCluster->readQuorum = 1;
+    for (int i = 0; i < count; i++) {
+        KineticStatus status = KineticCluster_AddDevice(newCluster, &devices[i]);
+        if (status != KINETIC_STATUS_SUCCESS) {
+            KineticCluster_Disconnect(&newCluster);
+            return status;
+        }
+    }
+    *cluster = newCluster;
+    return KINETIC_STATUS_SUCCESS;
+}
+
+KineticStatus KineticCluster_Disconnect(KineticCluster** const cluster)
+{
+    if (cluster == NULL || *cluster == NULL) {
+        LOG("Invalid cluster specified!");
+        return KINETIC_STATUS_SESSION_INVALID;
+    }
+    KineticStatus status = KINETIC_STATUS_SUCCESS;
+    for (int i = 0; i < (*cluster)->count; i++) {
+        KineticClusterMember* member = &(*cluster)->members[i];
+        KineticCluster_Drain(*cluster, member);
+
+        // Devices which failed are already disconnected
+        bool connected = KineticConnection_FromHandle(member->handle)->connected;
+        KineticStatus disconnectStatus = KineticClient_Disconnect(&member->handle);
+        if (status == KINETIC_STATUS_SUCCESS && connected) {
+            status = disconnectStatus;
+        }
+    }
+    free((*cluster)->members);
+    free(*cluster);
+    *cluster = NULL;
+    return status;
+}
+
+int KineticCluster_GetDeviceCount(const KineticCluster* const cluster)
+{
+    assert(cluster != NULL);
+    return cluster->count;
+}
+
+int KineticCluster_GetDeviceFor(const KineticCluster* const cluster,
+                                const ByteBuffer* const key)
+{
+    int device = 0;
+    KineticCluster_GetReplicas(cluster, key, &device, 1);
+    return device;
+}
+
+int KineticCluster_GetReplicas(const KineticCluster* const cluster,
+                               const ByteBuffer* const key,
+                               int* devices, int count)
+{
+    assert(cluster != NULL);
+    assert(key != NULL);
+    assert(devices != NULL);
+    if (count > KINETIC_CLUSTER_REPLICAS_MAX) {
+        count = KINETIC_CLUSTER_REPLICAS_MAX;
+    }
+    if (count > cluster->count) {
+        count = cluster->count;
+    }
+
+    // Insert each device into the ranking by score, keeping the first of
+    // devices with equal scores ahead
+    uint64_t keyHash = Kinetic_HashKey(key->array.data, key->bytesUsed);
+    double scores[KINETIC_CLUSTER_REPLICAS_MAX];
+    int ranked = 0;
+    for (int i = 0; i < cluster->count; i++) {
+        double score = KineticCluster_Score(&cluster->members[i], keyHash);
+        int rank = (ranked < count) ? ranked++ : count;
+        while (rank > 0 && scores[rank - 1] < score) {
+            if (rank < count) {
+                scores[rank] = scores[rank - 1];
+                devices[rank] = devices[rank - 1];
+            }
+            rank--;
+        }
+        if (rank < count) {
+            scores[rank] = score;
+            devices[rank] = i;
+        }
+    }
+    return ranked;
+}
+
+KineticSessionHandle KineticCluster_GetSession(KineticCluster* const cluster,
+                                               int device)
+{
+    assert(cluster != NULL);
+    if (device < 0 || device >= cluster->count) {
+        return KINETIC_HANDLE_INVALID;
+    }
+    KineticCluster_Drain(cluster, &cluster->members[device]);
+    return cluster->members[device].handle;
+}
+
+KineticStatus KineticCluster_SetReplication(KineticCluster* const cluster,
+                                            int replicas, int writeQuorum, int readQuorum)
+{
+    assert(cluster != NULL);
+    if (replicas < 1 || replicas > cluster->count || replicas > KINETIC_CLUSTER_REPLICAS_MAX ||
+        writeQuorum < 1 || writeQuorum > replicas ||
+        readQuorum < 1 || readQuorum > replicas) {
+        LOGF_ERROR("Invalid cluster replication: %d replicas (of %d devices), "
+                   "write quorum %d, read quorum %d",
+                   replicas, cluster->count, writeQuorum, readQuorum);
+        return KINETIC_STATUS_INVALID;
+    }
+    for (int i = 0; i < cluster->count; i++) {
+        KineticCluster_Drain(cluster, &cluster->members[i]);
+    }
+    cluster->replicas = replicas;
+    cluster->writeQuorum = writeQuorum;
+    cluster->readQuorum = readQuorum;
+    cluster->dataChunks = 0;
+    cluster->parityChunks = 0;
+    return KINETIC_STATUS_SUCCESS;
+}
+
+KineticStatus KineticCluster_SetErasureCoding(KineticCluster* const cluster,
+                                              int dataChunks, int parityChunks,
+                                              int writeQuorum, int degradedReadMs)
+{
+    assert(cluster != NULL);
+    int count = dataChunks + parityChunks;
+    if (dataChunks < 1 || parityChunks < 0 || count > cluster->count ||
+        count > KINETIC_CLUSTER_REPLICAS_MAX ||
+        writeQuorum < dataChunks || writeQuorum > count || degradedReadMs < 0) {
+        LOGF_ERROR("Invalid cluster erasure coding: %d data and %d parity chunks "
+                   "(of %d devices), write quorum %d",
+                   dataChunks, parityChunks, cluster->count, writeQuorum);
+        return KINETIC_STATUS_INVALID;
+    }
+    KineticStatus status = KineticErasure_Init(&cluster->code, dataChunks, parityChunks);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        return status;
+    }
+    for (int i = 0; i < cluster->count; i++) {
+        KineticCluster_Drain(cluster, &cluster->members[i]);
+    }
+    cluster->replicas = 1;
+    cluster->writeQuorum = writeQuorum;
+    cluster->readQuorum = 1;
+    cluster->dataChunks = dataChunks;
+    cluster->parityChunks = parityChunks;
+    cluster->degradedReadMs = degradedReadMs;
+    return KINETIC_STATUS_SUCCESS;
+}
+
+void KineticCluster_GetStats(const KineticCluster* const cluster,
+                             KineticClusterStats* const stats)
+{
+    assert(cluster != NULL);
+    assert(stats != NULL);
+    *stats = cluster->stats;
+}
+
+//------------------------------------------------------------------------------
+// Operations
+
+static KineticStatus KineticCluster_ExecuteOn(KineticClusterMember* const member,
+                                              KineticClusterOperation* const operation)
+{
+    switch (operation->type) {
+    case KINETIC_CLUSTER_OPERATION_PUT:
+        return KineticClient_Put(member->handle, operation->entry);
+    case KINETIC_CLUSTER_OPERATION_GET:
+        return KineticClient_Get(member->handle, operation->entry);
+    case KINETIC_CLUSTER_OPERATION_DELETE:
+        return KineticClient_Delete(member->handle, operation->entry);
+    default:
+        return KINETIC_STATUS_INVALID;
+    }
+}
+
+// Whether the replies of a write have reached its quorum, or too many have
+// failed for them to. Sets the status of the write from the replies so far:
+// success once the quorum is reached, or else that of the first failure.
+static bool KineticCluster_Decided(const KineticClusterReply* replies, int count, int quorum,
+                                   KineticStatus* const status)
+{
+    int acks = 0;
+    int failures = 0;
+    *status = KINETIC_STATUS_INVALID;
+    for (int i = 0; i < count; i++) {
+        if (replies[i].done && replies[i].status == KINETIC_STATUS_SUCCESS) {
+            acks++;
+        }
+        else if (replies[i].done) {
+            if (failures++ == 0) {
+                *status = replies[i].status;
+            }
+        }
+    }
+    if (acks >= quorum) {
+        *status = KINETIC_STATUS_SUCCESS;
+        return true;
+    }
+    return failures > count - quorum;
+}
+
+// Sends a PUT or DELETE to each of the devices, returning once the quorum
+// of them succeed, or too many fail for it to
+static KineticStatus KineticCluster_Write(KineticCluster* const cluster,
+                                          KineticProto_MessageType type,
+                                          KineticEntry* const* entries,
+                                          const int* devices, int count, int quorum)
+{
+    KineticClusterReply replies[KINETIC_CLUSTER_REPLICAS_MAX];
+    memset(replies, 0, sizeof(replies));
+
+    KineticCluster_BeginRequest(cluster, replies);
+    for (int i = 0; i < count; i++) {
+        KineticCluster_Send(cluster, i, devices[i], type, entries[i], NULL);
+    }
+    KineticStatus status;
+    while (!KineticCluster_Decided(replies, count, quorum, &status) &&
+           KineticCluster_ReceiveNext(cluster, devices, count,
+                                      KINETIC_CLUSTER_REPLY_TIMEOUT_MS) != KINETIC_STATUS_NOT_ATTEMPTED) {
+    }
+    KineticCluster_EndRequest(cluster);
+    return status;
+}
+
+// Sends a PUT or DELETE of the entry to the first devices of the key
+static KineticStatus KineticCluster_WriteAll(KineticCluster* const cluster,
+                                             KineticProto_MessageType type,
+                                             KineticEntry* const entry, int count)
+{
+    int devices[KINETIC_CLUSTER_REPLICAS_MAX];
+    KineticEntry* entries[KINETIC_CLUSTER_REPLICAS_MAX];
+    count = KineticCluster_GetReplicas(cluster, &entry->key, devices, count);
+    for (int i = 0; i < count; i++) {
+        entries[i] = entry;
+    }
+    return KineticCluster_Write(cluster, type, entries, devices, count, cluster->writeQuorum);
+}
+
+// Propagates the newVersion of a PUT to its dbVersion
+static void KineticCluster_UpdateVersion(KineticEntry* const entry)
+{
+    if (entry->newVersion.array.data != NULL && entry->newVersion.array.len > 0) {
+        entry->dbVersion = entry->newVersion;
+        entry->newVersion = BYTE_BUFFER_NONE;
+    }
+}
+
+// Receives the responses of all replicas sent to
+static void KineticCluster_AwaitAll(KineticCluster* const cluster,
+                                    const int* devices, int count)
+{
+    while (KineticCluster_ReceiveNext(cluster, devices, count, KINETIC_CLUSTER_REPLY_TIMEOUT_MS) !=
+           KINETIC_STATUS_NOT_ATTEMPTED) {
+    }
+}
+
+// Whether a replica reported the entry, or that it does not exist
+static inline bool KineticCluster_Responded(const KineticClusterReply* const reply)
+{
+    return reply->done && (reply->status == KINETIC_STATUS_SUCCESS || reply->notFound);
+}
+
+static bool KineticCluster_SameVersion(const KineticClusterReply* const a,
+                                       const KineticClusterReply* const b)
+{
+    if (a->notFound || b->notFound) {
+        return a->notFound == b->notFound;
+    }
+    const ByteBuffer* versionA = &a->entry->dbVersion;
+    const ByteBuffer* versionB = &b->entry->dbVersion;
+    return versionA->bytesUsed == versionB->bytesUsed &&
+           (versionA->bytesUsed == 0 ||
+            memcmp(versionA->array.data, versionB->array.data, versionA->bytesUsed) == 0);
+}
+
+// Reads the entry from the first replica, concurrently with the versions of
+// the entry from the next replicas up to the read quorum, and returns the
+// version which most of them report
+static KineticStatus KineticCluster_ReplicateGet(KineticCluster* const cluster,
+                                                 KineticEntry* const entry)
+{
+    int devices[KINETIC_CLUSTER_REPLICAS_MAX];
+    int count = KineticCluster_GetReplicas(cluster, &entry->key, devices, cluster->replicas);
+    KineticClusterReply replies[KINETIC_CLUSTER_REPLICAS_MAX];
+    memset(replies, 0, sizeof(replies));
+    KineticEntry versions[KINETIC_CLUSTER_REPLICAS_MAX];
+    uint8_t versionData[KINETIC_CLUSTER_REPLICAS_MAX][KINETIC_MAX_VERSION_LEN];
+
+    // Entries stored without a version have none in the response
+    entry->dbVersion.bytesUsed = 0;
+    KineticCluster_BeginRequest(cluster, replies);
+    replies[0].entry = entry;
+    KineticCluster_Send(cluster, 0, devices[0], KINETIC_PROTO_MESSAGE_TYPE_GET, entry, NULL);
+    int sent = 1;
+    int failed = 0;
+    int responded = 0;
+    for (;;) {
+        // Replicas which fail are replaced by the next, while any remain
+        while (sent < count && sent - failed < cluster->readQuorum) {
+            versions[sent] = (KineticEntry) {
+                .key = entry->key,
+                .dbVersion = ByteBuffer_Create(versionData[sent], sizeof(versionData[sent])),
+                .metadataOnly = true,
+            };
+            replies[sent].entry = &versions[sent];
+            KineticCluster_Send(cluster, sent, devices[sent],
+                                KINETIC_PROTO_MESSAGE_TYPE_GETVERSION, &versions[sent], NULL);
+            sent++;
+        }
+        KineticCluster_AwaitAll(cluster, devices, sent);
+        responded = 0;
+        for (int i = 0; i < sent; i++) {
+            responded += KineticCluster_Responded(&replies[i]) ? 1 : 0;
+        }
+        failed = sent - responded;
+        if (responded >= cluster->readQuorum || sent == count) {
+            break;
+        }
+    }
+
+    // The version reported by the most replicas wins, or of versions
+    // reported by as many, that of the replica ranked first
+    KineticStatus status = KINETIC_STATUS_INVALID;
+    int winner = -1;
+    int votes = 0;
+    for (int i = 0; i < sent; i++) {
+        if (!KineticCluster_Responded(&replies[i])) {
+            if (status == KINETIC_STATUS_INVALID) {
+                status = replies[i].status;
+            }
+            continue;
+        }
+        int matching = 0;
+        for (int j = 0; j < sent; j++) {
+            if (KineticCluster_Responded(&replies[j]) &&
+                KineticCluster_SameVersion(&replies[i], &replies[j])) {
+                matching++;
+            }
+        }
+        if (matching > votes) {
+            winner = i;
+            votes = matching;
+        }
+    }
+
+    // Without enough replicas, fails as the first replica which failed
+    if (responded >= cluster->readQuorum) {
+        if (votes < responded) {
+            cluster->stats.divergentReads++;
+            LOGF("Cluster replicas diverged, with %d of %d reporting the version read",
+                 votes, responded);
+        }
+        if (replies[winner].notFound) {
+            status = KINETIC_STATUS_DATA_ERROR;
+        }
+        else if (winner == 0) {
+            status = KINETIC_STATUS_SUCCESS;
+        }
+        else {
+            // The first replica did not have the winning version, so the
+            // entry is read again from one which does
+            entry->dbVersion.bytesUsed = 0;
+            replies[winner] = (KineticClusterReply) {.entry = entry};
+            KineticCluster_Send(cluster, winner, devices[winner],
+                                KINETIC_PROTO_MESSAGE_TYPE_GET, entry, NULL);
+            KineticCluster_AwaitAll(cluster, &devices[winner], 1);
+            status = replies[winner].status;
+        }
+    }
+    KineticCluster_EndRequest(cluster);
+    return status;
+}
+
+//------------------------------------------------------------------------------
+// Erasure coding
+
+// Header stored ahead of each chunk of an erasure coded value. Chunks are
+// only decoded together with those of the same stripe (PUT of the value), so
+// never with chunks left from an earlier PUT.
+typedef struct _KineticClusterChunkHeader {
+    uint32_t valueLength;
+    uint8_t dataChunks;
+    uint8_t parityChunks;
+    uint8_t index;
+    uint64_t stripe;
+} KineticClusterChunkHeader;
+
+static void KineticCluster_WriteChunkHeader(uint8_t* const data,
+                                            const KineticClusterChunkHeader* const header)
+{
+    uint32_t valueLength = KineticNBO_FromHostU32(header->valueLength);
+    uint64_t stripe = KineticNBO_FromHostU64(header->stripe);
+    memcpy(&data[0], &valueLength, sizeof(valueLength));
+    data[4] = header->dataChunks;
+    data[5] = header->parityChunks;
+    data[6] = header->index;
+    data[7] = KINETIC_CLUSTER_CHUNK_FORMAT;
+    memcpy(&data[8], &stripe, sizeof(stripe));
+}
+
+static bool KineticCluster_ReadChunkHeader(const ByteBuffer* const chunk,
+                                           KineticClusterChunkHeader* const header)
+{
+    const uint8_t* data = chunk->array.data;
+    if (chunk->bytesUsed < KINETIC_CLUSTER_CHUNK_HEADER_LEN ||
+        data[7] != KINETIC_CLUSTER_CHUNK_FORMAT) {
+        return false;
+    }
+    uint32_t valueLength;
+    uint64_t stripe;
+    memcpy(&valueLength, &data[0], sizeof(valueLength));
+    memcpy(&stripe, &data[8], sizeof(stripe));
+    *header = (KineticClusterChunkHeader) {
+        .valueLength = KineticNBO_ToHostU32(valueLength),
+        .dataChunks = data[4],
+        .parityChunks = data[5],
+        .index = data[6],
+        .stripe = KineticNBO_ToHostU64(stripe),
+    };
+    return true;
+}
+
+// Whether a chunk was read, and is the chunk of its index in a stripe of the
+// erasure code of the cluster
+static bool KineticCluster_IsChunk(const KineticCluster* const cluster,
+                                   const KineticClusterReply* const reply, int index,
+                                   KineticClusterChunkHeader* const header)
+{
+    return reply->done && reply->status == KINETIC_STATUS_SUCCESS &&
+           KineticCluster_ReadChunkHeader(&reply->entry->value, header) &&
+           header->index == index && header->dataChunks == cluster->dataChunks &&
+           header->parityChunks == cluster->parityChunks;
+}
+
+// Finds the stripe with the most valid chunks, returning the number of them
+// and setting the first
+static int KineticCluster_FindStripe(const KineticClusterChunkHeader* headers,
+                                     const bool* valid, int count, int* first)
+{
+    int best = 0;
+    for (int i = 0; i < count; i++) {
+        int matching = 0;
+        for (int j = 0; j < count && valid[i]; j++) {
+            if (valid[j] && headers[j].stripe == headers[i].stripe) {
+                matching++;
+            }
+        }
+        if (matching > best) {
+            best = matching;
+            *first = i;
+        }
+    }
+    return best;
+}
+
+// Splits the value into the data chunks, encodes the parity chunks, and
+// writes each chunk to its device
+static KineticStatus KineticCluster_PutChunks(KineticCluster* const cluster,
+                                              KineticEntry* const entry)
+{
+    const int dataChunks = cluster->dataChunks;
+    const int count = dataChunks + cluster->parityChunks;
+    const size_t valueLength = entry->value.bytesUsed;
+    const size_t chunkLength = (valueLength + dataChunks - 1) / dataChunks;
+    const size_t stride = KINETIC_CLUSTER_CHUNK_HEADER_LEN + chunkLength;
+    if (stride > PDU_VALUE_MAX_LEN) {
+        LOGF_ERROR("Value of %zu bytes is too long for %d data chunks", valueLength, dataChunks);
+        return KINETIC_STATUS_BUFFER_OVERRUN;
+    }
+    uint8_t* stripe = malloc(count * stride);
+    if (stripe == NULL) {
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+
+    KineticClusterChunkHeader header = {
+        .valueLength = (uint32_t)valueLength,
+        .dataChunks = (uint8_t)dataChunks,
+        .parityChunks = (uint8_t)cluster->parityChunks,
+        .stripe = KineticCluster_Combine(KineticStats_Now(), ++cluster->stripes),
+    };
+    uint8_t* chunks[KINETIC_CLUSTER_REPLICAS_MAX];
+    KineticEntry chunkEntries[KINETIC_CLUSTER_REPLICAS_MAX];
+    KineticEntry* entries[KINETIC_CLUSTER_REPLICAS_MAX];
+    for (int i = 0; i < count; i++) {
+        uint8_t* data = &stripe[i * stride];
+        chunks[i] = data + KINETIC_CLUSTER_CHUNK_HEADER_LEN;
+        header.index = (uint8_t)i;
+        KineticCluster_WriteChunkHeader(data, &header);
+        if (i < dataChunks) {
+            size_t offset = i * chunkLength;
+            size_t len = (offset >= valueLength) ? 0 :
+                         (valueLength - offset < chunkLength) ? valueLength - offset : chunkLength;
+            if (len > 0) {
+                memcpy(chunks[i], (uint8_t*)entry->value.array.data + offset, len);
+            }
+            memset(chunks[i] + len, 0, chunkLength - len);
+        }
+        chunkEntries[i] = *entry;
+        chunkEntries[i].value = ByteBuffer_Create(data, stride);
+        chunkEntries[i].value.bytesUsed = stride;
+        entries[i] = &chunkEntries[i];
+    }
+    KineticErasure_Encode(&cluster->code, chunks, &chunks[dataChunks], chunkLength);
+
+    int devices[KINETIC_CLUSTER_REPLICAS_MAX];
+    KineticCluster_GetReplicas(cluster, &entry->key, devices, count);
+    KineticStatus status = KineticCluster_Write(cluster, KINETIC_PROTO_MESSAGE_TYPE_PUT,
+                                                entries, devices, count, cluster->writeQuorum);
+    free(stripe);
+    return status;
+}
+
+// Chunk reads of the erasure coded GET in progress
+typedef struct _KineticClusterChunkReads {
+    const int* devices;
+    KineticEntry* entry;
+    size_t chunkCapacity;   // Bytes of each chunk read, with its header
+    KineticEntry chunkEntries[KINETIC_CLUSTER_REPLICAS_MAX];
+    KineticClusterReply replies[KINETIC_CLUSTER_REPLICAS_MAX];
+    KineticClusterChunkHeader headers[KINETIC_CLUSTER_REPLICAS_MAX];
+    bool valid[KINETIC_CLUSTER_REPLICAS_MAX];
+} KineticClusterChunkReads;
+
+// Sends a GET of a chunk, whose value, version and tag are read into a
+// buffer owned by the request, since the GET may outlive the operation
+static void KineticCluster_ReadChunk(KineticCluster* const cluster,
+                                     KineticClusterChunkReads* const reads, int index)
+{
+    const size_t versionLength = KINETIC_MAX_VERSION_LEN;
+    const size_t tagLength = reads->entry->tag.array.len;
+    uint8_t* buffer = malloc(reads->chunkCapacity + versionLength + tagLength);
+    if (buffer == NULL) {
+        reads->replies[index] = (KineticClusterReply) {
+            .status = KINETIC_STATUS_MEMORY_ERROR,
+            .done = true,
+        };
+        return;
+    }
+    reads->chunkEntries[index] = (KineticEntry) {
+        .key = reads->entry->key,
+        .value = ByteBuffer_Create(buffer, reads->chunkCapacity),
+        .dbVersion = ByteBuffer_Create(buffer + reads->chunkCapacity, versionLength),
+        .tag = ByteBuffer_Create(buffer + reads->chunkCapacity + versionLength, tagLength),
+    };
+    reads->replies[index].entry = &reads->chunkEntries[index];
+    KineticCluster_Send(cluster, index, reads->devices[index], KINETIC_PROTO_MESSAGE_TYPE_GET,
+                        &reads->chunkEntries[index], buffer);
+}
+
+// Reassembles the value from the chunks of a stripe, decoding any data
+// chunks which were not read
+static KineticStatus KineticCluster_DecodeChunks(KineticCluster* const cluster,
+                                                 KineticClusterChunkReads* const reads,
+                                                 int first, int count)
+{
+    KineticEntry* entry = reads->entry;
+    const KineticEntry* source = reads->replies[first].entry;
+    const KineticClusterChunkHeader* header = &reads->headers[first];
+
+    // The metadata of the value is that of its chunks
+    entry->algorithm = source->algorithm;
+    if (entry->dbVersion.array.len < source->dbVersion.bytesUsed ||
+        entry->tag.array.len < source->tag.bytesUsed) {
+        return KINETIC_STATUS_BUFFER_OVERRUN;
+    }
+    if (source->dbVersion.bytesUsed > 0) {
+        memcpy(entry->dbVersion.array.data, source->dbVersion.array.data, source->dbVersion.bytesUsed);
+    }
+    entry->dbVersion.bytesUsed = source->dbVersion.bytesUsed;
+    if (source->tag.bytesUsed > 0) {
+        memcpy(entry->tag.array.data, source->tag.array.data, source->tag.bytesUsed);
+    }
+    entry->tag.bytesUsed = source->tag.bytesUsed;
+    if (entry->metadataOnly) {
+        return KINETIC_STATUS_SUCCESS;
+    }
+    if (header->valueLength > entry->value.array.len) {
+        entry->value.bytesUsed = 0;
+        return KINETIC_STATUS_BUFFER_OVERRUN;
+    }
+
+    const int dataChunks = cluster->dataChunks;
+    const size_t chunkLength = (header->valueLength + dataChunks - 1) / dataChunks;
+    uint8_t* chunks[KINETIC_CLUSTER_REPLICAS_MAX];
+    bool present[KINETIC_CLUSTER_REPLICAS_MAX];
+    int missing = 0;
+    for (int i = 0; i < count; i++) {
+        present[i] = reads->valid[i] && reads->headers[i].stripe == header->stripe &&
+                     reads->chunkEntries[i].value.bytesUsed ==
+                     KINETIC_CLUSTER_CHUNK_HEADER_LEN + chunkLength;
+        chunks[i] = present[i] ?
+                    (uint8_t*)reads->chunkEntries[i].value.array.data + KINETIC_CLUSTER_CHUNK_HEADER_LEN :
+                    NULL;
+        missing += (i < dataChunks && !present[i]) ? 1 : 0;
+    }
+
+    KineticStatus status = KINETIC_STATUS_SUCCESS;
+    uint8_t* decoded = NULL;
+    if (missing > 0) {
+        decoded = malloc(missing * chunkLength + 1);
+        if (decoded == NULL) {
+            return KINETIC_STATUS_MEMORY_ERROR;
+        }
+        for (int i = 0, next = 0; i < dataChunks; i++) {
+            if (!present[i]) {
+                chunks[i] = &decoded[chunkLength * next++];
+            }
+        }
+        status = KineticErasure_Decode(&cluster->code, chunks, present, chunkLength);
+    }
+    if (status == KINETIC_STATUS_SUCCESS) {
+        uint8_t* value = entry->value.array.data;
+        for (int i = 0; i < dataChunks; i++) {
+            size_t offset = i * chunkLength;
+            if (offset < header->valueLength) {
+                size_t len = header->valueLength - offset;
+                memcpy(&value[offset], chunks[i], (len < chunkLength) ? len : chunkLength);
+            }
+        }
+        entry->value.bytesUsed = header->valueLength;
+    }
+    free(decoded);
+    return status;
+}
+
+// Reads the data chunks of a value, and also the parity chunks if any data
+// chunk fails, differs from the others or is not read within the degraded
+// read time, returning once the chunks read include any data chunks' worth
+// of the same stripe
+static KineticStatus KineticCluster_GetChunks(KineticCluster* const cluster,
+                                              KineticEntry* const entry)
+{
+    const int dataChunks = cluster->dataChunks;
+    const int count = dataChunks + cluster->parityChunks;
+    int devices[KINETIC_CLUSTER_REPLICAS_MAX];
+    KineticCluster_GetReplicas(cluster, &entry->key, devices, count);
+
+    // Chunks are read whole for values which fit the buffer of the caller,
+    // and only their headers for metadata
+    KineticClusterChunkReads* reads = calloc(1, sizeof(KineticClusterChunkReads));
+    if (reads == NULL) {
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    size_t capacity = entry->metadataOnly ? 0 : entry->value.array.len;
+    reads->devices = devices;
+    reads->entry = entry;
+    reads->chunkCapacity = KINETIC_CLUSTER_CHUNK_HEADER_LEN + (capacity + dataChunks - 1) / dataChunks;
+    if (reads->chunkCapacity > PDU_VALUE_MAX_LEN) {
+        reads->chunkCapacity = PDU_VALUE_MAX_LEN;
+    }
+
+    KineticCluster_BeginRequest(cluster, reads->replies);
+    for (int i = 0; i < dataChunks; i++) {
+        KineticCluster_ReadChunk(cluster, reads, i);
+    }
+    int sent = dataChunks;
+    uint64_t deadline = KineticStats_Now() + (uint64_t)cluster->degradedReadMs * 1000000ull;
+    KineticStatus status = KINETIC_STATUS_INVALID;
+    int first = -1;
+    int best = 0;
+    int notFound = 0;
+    for (;;) {
+        // Count the chunks of each stripe read, and the devices without the key
+        int validCount = 0;
+        bool failed = false;
+        notFound = 0;
+        for (int i = 0; i < sent; i++) {
+            KineticClusterReply* reply = &reads->replies[i];
+            reads->valid[i] = KineticCluster_IsChunk(cluster, reply, i, &reads->headers[i]);
+            if (reads->valid[i]) {
+                validCount++;
+            }
+            else if (reply->done && reply->notFound) {
+                notFound++;
+            }
+            else if (reply->done) {
+                failed = true;
+                if (status == KINETIC_STATUS_INVALID) {
+                    status = (reply->status == KINETIC_STATUS_SUCCESS) ?
+                             KINETIC_STATUS_DATA_ERROR : reply->status;
+                }
+            }
+        }
+        best = KineticCluster_FindStripe(reads->headers, reads->valid, sent, &first);
+        if (best >= dataChunks || notFound >= dataChunks) {
+            break;
+        }
+
+        uint64_t now = KineticStats_Now();
+        if (sent < count && (failed || validCount > best || (notFound > 0 && best > 0) ||
+                             now >= deadline)) {
+            LOGF("Reading parity chunks after %s", (now >= deadline) ?
+                 "the degraded read time" : "data chunks failed or differed");
+            cluster->stats.degradedReads++;
+            for (; sent < count; sent++) {
+                KineticCluster_ReadChunk(cluster, reads, sent);
+            }
+            continue;
+        }
+        int timeoutMs = KINETIC_CLUSTER_REPLY_TIMEOUT_MS;
+        if (sent < count) {
+            timeoutMs = (int)((deadline - now + 999999) / 1000000);
+        }
+        if (KineticCluster_ReceiveNext(cluster, devices, sent, timeoutMs) ==
+            KINETIC_STATUS_NOT_ATTEMPTED) {
+            break;
+        }
+    }
+
+    if (best >= dataChunks) {
+        status = KineticCluster_DecodeChunks(cluster, reads, first, sent);
+    }
+    else if (notFound >= dataChunks || status == KINETIC_STATUS_INVALID) {
+        status = KINETIC_STATUS_DATA_ERROR;
+    }
+    KineticCluster_EndRequest(cluster);
+    for (int i = 0; i < sent; i++) {
+        free(reads->replies[i].buffer);
+    }
+    free(reads);
+    return status;
+}
+
+static KineticStatus KineticCluster_ExecuteOne(KineticCluster* const cluster,
+                                               KineticClusterOperationType type,
+                                               KineticEntry* const entry)
+{
+    assert(cluster != NULL);
+    assert(entry != NULL);
+    KineticStatus status = KINETIC_STATUS_INVALID;
+    if (cluster->dataChunks > 0) {
+        int count = cluster->dataChunks + cluster->parityChunks;
+        switch (type) {
+        case KINETIC_CLUSTER_OPERATION_PUT:
+            status = KineticCluster_PutChunks(cluster, entry);
+            break;
+        case KINETIC_CLUSTER_OPERATION_GET:
+            return KineticCluster_GetChunks(cluster, entry);
+        case KINETIC_CLUSTER_OPERATION_DELETE:
+            return KineticCluster_WriteAll(cluster, KINETIC_PROTO_MESSAGE_TYPE_DELETE, entry, count);
+        default:
+            return KINETIC_STATUS_INVALID;
+        }
+    }
+    else if (cluster->replicas > 1) {
+        switch (type) {
+        case KINETIC_CLUSTER_OPERATION_PUT:
+            status = KineticCluster_WriteAll(cluster, KINETIC_PROTO_MESSAGE_TYPE_PUT,
+                                             entry, cluster->replicas);
+            break;
+        case KINETIC_CLUSTER_OPERATION_GET:
+            return KineticCluster_ReplicateGet(cluster, entry);
+        case KINETIC_CLUSTER_OPERATION_DELETE:
+            return KineticCluster_WriteAll(cluster, KINETIC_PROTO_MESSAGE_TYPE_DELETE,
+                                           entry, cluster->replicas);
+        default:
+            return KINETIC_STATUS_INVALID;
+        }
+    }
+    else {
+        KineticClusterOperation operation = {.type = type, .entry = entry};
+        int device = KineticCluster_GetDeviceFor(cluster, &entry->key);
+        return KineticCluster_ExecuteOn(&cluster->members[device], &operation);
+    }
+
+    // Replicated and erasure coded PUTs update the entry as KineticClient_Put()
+    if (status == KINETIC_STATUS_SUCCESS) {
+        KineticCluster_UpdateVersion(entry);
+    }
+    return status;
+}
+
+KineticStatus KineticCluster_Put(KineticCluster* const cluster, KineticEntry* const entry)
+{
+    return KineticCluster_ExecuteOne(cluster, KINETIC_CLUSTER_OPERATION_PUT, entry);
+}
+
+KineticStatus KineticCluster_Get(KineticCluster* const cluster, KineticEntry* const entry)
+{
+    return KineticCluster_ExecuteOne(cluster, KINETIC_CLUSTER_OPERATION_GET, entry);
+}
+
+KineticStatus KineticCluster_Delete(KineticCluster* const cluster, KineticEntry* const entry)
+{
+    return KineticCluster_ExecuteOne(cluster, KINETIC_CLUSTER_OPERATION_DELETE, entry);
+}
+
+// Whether an operation of a batch is a PUT or DELETE whose requests to its
+// devices can all be sent ahead of its responses (erasure coded PUTs encode
+// the chunks and so are executed on their own)
+static bool KineticCluster_IsPipelined(const KineticCluster* const cluster,
+                                       const KineticClusterOperation* const operation)
+{
+    return operation->type == KINETIC_CLUSTER_OPERATION_DELETE ||
+           (operation->type == KINETIC_CLUSTER_OPERATION_PUT && cluster->dataChunks == 0);
+}
+
+// Sends the PUTs and DELETEs of a run of a batch to all of their devices
+// before receiving any of the responses, then waits for the write quorum of
+// each. The replies of each operation are those from
+// index * KINETIC_CLUSTER_REPLICAS_MAX, as for the keys of a rebuild.
+static KineticStatus KineticCluster_WriteBatch(KineticCluster* const cluster,
+                                               KineticClusterOperation* operations, int count)
+{
+    int replicas = (cluster->dataChunks > 0) ?
+                   cluster->dataChunks + cluster->parityChunks : cluster->replicas;
+    KineticClusterReply* replies = calloc(count * KINETIC_CLUSTER_REPLICAS_MAX,
+                                          sizeof(KineticClusterReply));
+    int* devices = malloc(count * KINETIC_CLUSTER_REPLICAS_MAX * sizeof(int));
+    int* counts = malloc(count * sizeof(int));
+    if (replies == NULL || devices == NULL || counts == NULL) {
+        free(replies);
+        free(devices);
+        free(counts);
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    int all[cluster->count];
+    for (int d = 0; d < cluster->count; d++) {
+        all[d] = d;
+    }
+
+    KineticCluster_BeginRequest(cluster, replies);
+    for (int i = 0; i < count; i++) {
+        KineticEntry* entry = operations[i].entry;
+        KineticProto_MessageType type = (operations[i].type == KINETIC_CLUSTER_OPERATION_PUT) ?
+                                        KINETIC_PROTO_MESSAGE_TYPE_PUT :
+                                        KINETIC_PROTO_MESSAGE_TYPE_DELETE;
+        int* opDevices = &devices[i * KINETIC_CLUSTER_REPLICAS_MAX];
+        counts[i] = KineticCluster_GetReplicas(cluster, &entry->key, opDevices, replicas);
+        for (int r = 0; r < counts[i]; r++) {
+            KineticCluster_Send(cluster, i * KINETIC_CLUSTER_REPLICAS_MAX + r, opDevices[r],
+                                type, entry, NULL);
+        }
+    }
+    bool waiting;
+    do {
+        waiting = false;
+        for (int i = 0; i < count; i++) {
+            if (!KineticCluster_Decided(&replies[i * KINETIC_CLUSTER_REPLICAS_MAX], counts[i],
+                                        cluster->writeQuorum, &operations[i].status)) {
+                waiting = true;
+            }
+        }
+    } while (waiting &&
+             KineticCluster_ReceiveNext(cluster, all, cluster->count,
+                                        KINETIC_CLUSTER_REPLY_TIMEOUT_MS) != KINETIC_STATUS_NOT_ATTEMPTED);
+    KineticCluster_EndRequest(cluster);
+
+    for (int i = 0; i < count; i++) {
+        if (operations[i].type == KINETIC_CLUSTER_OPERATION_PUT &&
+            operations[i].status == KINETIC_STATUS_SUCCESS) {
+            KineticCluster_UpdateVersion(operations[i].entry);
+        }
+    }
+    free(replies);
+    free(devices);
+    free(counts);
+    return KINETIC_STATUS_SUCCESS;
+}
+
+static void* KineticCluster_RunWork(void* arg)
+{
+    KineticClusterWork* work = arg;
+    for (int i = 0; i < work->count; i++) {
+        KineticClusterOperation* operation = &work->operations[work->indices[i]];
+        operation->status = KineticCluster_ExecuteOn(work->member, operation);
+    }
+    return NULL;
+}
+
+KineticStatus KineticCluster_Execute(KineticCluster* const cluster,
+                                     KineticClusterOperation* operations, int count)
+{
+    assert(cluster != NULL);
+    if (count < 1) {
+        return KINETIC_STATUS_SUCCESS;
+    }
+    assert(operations != NULL);
+
+    // With replication or erasure coding, each run of PUTs and DELETEs is
+    // sent as a whole before their quorums are awaited, while GETs and
+    // erasure coded PUTs are executed one at a time, in order with the runs
+    if (cluster->replicas > 1 || cluster->dataChunks > 0) {
+        for (int i = 0; i < count;) {
+            assert(operations[i].entry != NULL);
+            int run = 0;
+            while (i + run < count && KineticCluster_IsPipelined(cluster, &operations[i + run])) {
+                run++;
+            }
+            if (run > 0) {
+                KineticStatus status = KineticCluster_WriteBatch(cluster, &operations[i], run);
+                if (status != KINETIC_STATUS_SUCCESS) {
+                    for (int j = i; j < count; j++) {
+                        operations[j].status = status;
+                    }
+                    return status;
+                }
+                i += run;
+            }
+            else {
+                operations[i].status = KineticCluster_ExecuteOne(cluster, operations[i].type,
+                                                                 operations[i].entry);
+                i++;
+            }
+        }
+        KineticStatus status = KINETIC_STATUS_SUCCESS;
+        for (int i = 0; i < count && status == KINETIC_STATUS_SUCCESS; i++) {
+            status = operations[i].status;
+        }
+        return status;
+    }
+
+    // Group the operations by device, keeping their order
+    KineticClusterWork* work = calloc(cluster->count, sizeof(KineticClusterWork));
+    int* devices = malloc(count * sizeof(int));
+    int* indices = malloc(count * sizeof(int));
+    if (work == NULL || devices == NULL || indices == NULL) {
+        free(work);
+        free(devices);
+        free(indices);
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    for (int i = 0; i < count; i++) {
+        assert(operations[i].entry != NULL);
+        devices[i] = KineticCluster_GetDeviceFor(cluster, &operations[i].entry->key);
+        work[devices[i]].count++;
+    }
+    int next = 0;
+    for (int d = 0; d < cluster->count; d++) {
+        work[d].member = &cluster->members[d];
+        work[d].operations = operations;
+        work[d].indices = &indices[next];
+        next += work[d].count;
+        work[d].count = 0;
+    }
+    for (int i = 0; i < count; i++) {
+        KineticClusterWork* deviceWork = &work[devices[i]];
+        deviceWork->indices[deviceWork->count++] = i;
+    }
+
+    // Each device's operations run on a thread of their own, except for the
+    // last device with any, which runs on this thread
+    int last = -1;
+    for (int d = 0; d < cluster->count; d++) {
+        if (work[d].count == 0) {
+            continue;
+        }
+        if (last >= 0) {
+            work[last].started = (pthread_create(&work[last].thread, NULL,
+                                                 KineticCluster_RunWork, &work[last]) == 0);
+            if (!work[last].started) {
+                KineticCluster_RunWork(&work[last]);
+            }
+        }
+        last = d;
+    }
+    KineticCluster_RunWork(&work[last]);
+    for (int d = 0; d < cluster->count; d++) {
+        if (work[d].started) {
+            pthread_join(work[d].thread, NULL);
+        }
+    }
+
+    KineticStatus status = KINETIC_STATUS_SUCCESS;
+    for (int i = 0; i < count && status == KINETIC_STATUS_SUCCESS; i++) {
+        status = operations[i].status;
+    }
+    free(work);
+    free(devices);
+    free(indices);
+    return status;
+}
+
+//------------------------------------------------------------------------------
+// Rebuild
+
+#define KINETIC_CLUSTER_REBUILD_PARALLELISM (8)         // Keys rebuilt at once by default
+#define KINETIC_CLUSTER_REBUILD_PARALLELISM_MAX (256)
+#define KINETIC_CLUSTER_REBUILD_SCAN_COUNT (200)        // Keys listed by each GETKEYRANGE
+#define KINETIC_CLUSTER_REBUILD_TAG_MAX (64)
+#define KINETIC_CLUSTER_CHECKPOINT_MAGIC (0x3130444c4252434bull) // "KCRBLD01"
+
+// Progress of a rebuild, saved to its checkpoint file after each batch of
+// keys listed, followed by whether each device was available to read from
+typedef struct _KineticClusterCheckpoint {
+    uint64_t magic;
+    char name[KINETIC_CLUSTER_NAME_MAX];    // Of the device rebuilt
+    int32_t devices;
+    int32_t replicas;
+    int32_t dataChunks;
+    int32_t parityChunks;
+    int32_t scanning;       // Device whose keys are being listed
+    uint32_t keyLength;     // Of the last key of the device rebuilt (0 for none)
+    uint8_t key[KINETIC_MAX_KEY_LEN];
+    KineticClusterRebuildStats stats;
+} KineticClusterCheckpoint;
+
+// Key being rebuilt, with the entries read from its other devices
+typedef struct _KineticClusterRebuildKey {
+    ByteBuffer key;
+    int devices[KINETIC_CLUSTER_REPLICAS_MAX];
+    int count;      // Devices of the key
+    int rank;       // Of the device rebuilt among them
+    int next;       // Rank of the next device to read from
+    int sent;       // Reads sent
+    int source;     // Rank of the replica last read to be copied (or -1)
+    bool voted;     // Versions of the replicas were compared
+    bool current[KINETIC_CLUSTER_REPLICAS_MAX]; // Replicas of the version copied
+    KineticEntry reads[KINETIC_CLUSTER_REPLICAS_MAX];
+    bool charged[KINETIC_CLUSTER_REPLICAS_MAX]; // Reads whose bytes were paced
+    uint8_t versions[KINETIC_CLUSTER_REPLICAS_MAX][KINETIC_MAX_VERSION_LEN];
+    KineticEntry write;     // Of the replica or chunk of the device rebuilt
+    uint8_t* value;         // Owned value of the write (or NULL)
+    KineticStatus status;
+} KineticClusterRebuildKey;
+
+// Rebuild running on a thread of its own, with a cluster of its own
+// connected to the same devices (see KineticCluster_StartRebuild)
+struct _KineticClusterRebuilder {
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;        // Signals the thread to stop
+    pthread_t thread;
+    KineticCluster* cluster;    // Used only by the thread
+    int device;
+    KineticClusterRebuildConfig config;
+    char* checkpointPath;       // Owned copy of that of the configuration
+    bool stopping;
+    bool finished;
+    KineticClusterRebuildStats stats;   // Progress so far
+    KineticStatus status;               // Once finished
+};
+
+typedef struct _KineticClusterRebuild {
+    KineticCluster* cluster;
+    KineticClusterRebuilder* rebuilder; // Running the rebuild (or NULL)
+    int device;
+    int parallelism;
+    int64_t maxBytesPerSecond;
+    int maxOpsPerSecond;
+    int64_t maxKeys;
+    const char* checkpointPath;
+    KineticClusterCheckpoint checkpoint;
+    bool* available;        // Devices which can be read from, by index
+    int* devices;           // Indices of all devices, to receive responses from
+    KineticClusterRebuildKey* keys;
+    int keyCount;
+    KineticClusterReply* replies;   // Of the keys, by key and rank
+    uint8_t** buffers;              // Read into by the keys, by key and rank
+    uint8_t* keyData;               // Keys listed by the last GETKEYRANGE
+    size_t keyLengths[KINETIC_CLUSTER_REBUILD_SCAN_COUNT];
+    uint8_t endKey[KINETIC_MAX_KEY_LEN];
+    uint64_t start;         // Of the rebuild, from which requests are paced
+    uint64_t ops;
+    uint64_t bytes;
+    bool stopped;           // Keys of the last GETKEYRANGE were not all rebuilt
+    KineticStatus status;   // Of the first key which failed
+} KineticClusterRebuild;
+
+KineticStatus KineticCluster_ReplaceDevice(KineticCluster* const cluster, int device,
+                                           const KineticClusterDevice* replacement)
+{
+    assert(cluster != NULL);
+    assert(replacement != NULL);
+    if (device < 0 || device >= cluster->count) {
+        return KINETIC_STATUS_INVALID;
+    }
+    KineticSessionHandle handle;
+    KineticStatus status = KineticClient_Connect(&replacement->session, &handle);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        LOGF_ERROR("Failed connecting to replacement of cluster device %s",
+                   cluster->members[device].name);
+        return status;
+    }
+
+    // Requests still in flight to the device replaced are failed rather
+    // than awaited, as it has likely failed
+    KineticClusterMember* member = &cluster->members[device];
+    if (member->pendingCount > 0) {
+        KineticCluster_Abort(cluster, member, KINETIC_STATUS_CONNECTION_ERROR);
+    }
+    KineticClient_Disconnect(&member->handle);
+    member->handle = handle;
+    LOGF("Replaced cluster device %s", member->name);
+    return KINETIC_STATUS_SUCCESS;
+}
+
+// Sleeps between the requests of a rebuild, waking early if it runs in the
+// background and is stopped
+static void KineticCluster_RebuildSleep(const KineticClusterRebuild* const rebuild, uint64_t ns)
+{
+    KineticClusterRebuilder* rebuilder = rebuild->rebuilder;
+    if (rebuilder == NULL) {
+        struct timespec delay = {
+            .tv_sec = (time_t)(ns / 1000000000ull),
+            .tv_nsec = (long)(ns % 1000000000ull),
+        };
+        while (nanosleep(&delay, &delay) != 0 && errno == EINTR) {
+        }
+        return;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += (time_t)(ns / 1000000000ull);
+    deadline.tv_nsec += (long)(ns % 1000000000ull);
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    pthread_mutex_lock(&rebuilder->mutex);
+    while (!rebuilder->stopping) {
+        if (pthread_cond_timedwait(&rebuilder->wake, &rebuilder->mutex, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&rebuilder->mutex);
+}
+
+// Whether a rebuild running in the background has been asked to stop,
+// publishing its progress so far for KineticCluster_PollRebuild()
+static bool KineticCluster_RebuildStopping(const KineticClusterRebuild* const rebuild)
+{
+    KineticClusterRebuilder* rebuilder = rebuild->rebuilder;
+    if (rebuilder == NULL) {
+        return false;
+    }
+    pthread_mutex_lock(&rebuilder->mutex);
+    rebuilder->stats = rebuild->checkpoint.stats;
+    bool stopping = rebuilder->stopping;
+    pthread_mutex_unlock(&rebuilder->mutex);
+    return stopping;
+}
+
+// Paces the requests of a rebuild to its limits, waiting until the requests
+// and bytes so far, including those about to be sent, are within them
+static void KineticCluster_Throttle(KineticClusterRebuild* const rebuild, int ops, size_t bytes)
+{
+    rebuild->ops += ops;
+    rebuild->bytes += bytes;
+    double seconds = 0.0;
+    if (rebuild->maxOpsPerSecond > 0) {
+        seconds = (double)rebuild->ops / rebuild->maxOpsPerSecond;
+    }
+    if (rebuild->maxBytesPerSecond > 0 &&
+        (double)rebuild->bytes / rebuild->maxBytesPerSecond > seconds) {
+        seconds = (double)rebuild->bytes / rebuild->maxBytesPerSecond;
+    }
+    uint64_t due = rebuild->start + (uint64_t)(seconds * 1e9);
+    uint64_t now = KineticStats_Now();
+    if (due > now) {
+        KineticCluster_RebuildSleep(rebuild, due - now);
+    }
+}
+
+// Paces a rebuild to the bytes of the values read by its keys since last
+// paced, once their responses are received, as their sizes are not known
+// before. The bytes are also counted as read.
+static void KineticCluster_ChargeReads(KineticClusterRebuild* const rebuild)
+{
+    size_t bytes = 0;
+    for (int i = 0; i < rebuild->keyCount; i++) {
+        KineticClusterRebuildKey* key = &rebuild->keys[i];
+        const KineticClusterReply* replies = &rebuild->replies[i * KINETIC_CLUSTER_REPLICAS_MAX];
+        for (int r = 0; r < key->count; r++) {
+            if (!key->charged[r] && replies[r].done && replies[r].status == KINETIC_STATUS_SUCCESS) {
+                key->charged[r] = true;
+                bytes += key->reads[r].value.bytesUsed;
+            }
+        }
+    }
+    rebuild->checkpoint.stats.bytesRead += bytes;
+    KineticCluster_Throttle(rebuild, 0, bytes);
+}
+
+// Saves the progress of a rebuild, replacing the checkpoint file atomically
+static KineticStatus KineticCluster_SaveCheckpoint(const KineticClusterRebuild* const rebuild)
+{
+    const char* path = rebuild->checkpointPath;
+    if (path == NULL) {
+        return KINETIC_STATUS_SUCCESS;
+    }
+    size_t count = rebuild->cluster->count;
+    char* temp = malloc(strlen(path) + sizeof(".tmp"));
+    if (temp == NULL) {
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    sprintf(temp, "%s.tmp", path);
+
+    FILE* file = fopen(temp, "wb");
+    bool saved = (file != NULL) &&
+                 fwrite(&rebuild->checkpoint, sizeof(rebuild->checkpoint), 1, file) == 1 &&
+                 fwrite(rebuild->available, sizeof(bool), count, file) == count &&
+                 fflush(file) == 0 && fsync(fileno(file)) == 0;
+    if (file != NULL && fclose(file) != 0) {
+        saved = false;
+    }
+    if (saved && rename(temp, path) != 0) {
+        saved = false;
+    }
+    if (!saved) {
+        LOGF_ERROR("Failed saving rebuild checkpoint '%s': %s", path, strerror(errno));
+        unlink(temp);
+    }
+    free(temp);
+    return saved ? KINETIC_STATUS_SUCCESS : KINETIC_STATUS_INVALID;
+}
+
+// Loads the progress of an earlier run of the same rebuild, if any
+static bool KineticCluster_LoadCheckpoint(KineticClusterRebuild* const rebuild)
+{
+    const KineticCluster* cluster = rebuild->cluster;
+    const char* path = rebuild->checkpointPath;
+    FILE* file = (path != NULL) ? fopen(path, "rb") : NULL;
+    if (file == NULL) {
+        return false;
+    }
+    KineticClusterCheckpoint* checkpoint = &rebuild->checkpoint;
+    bool loaded = fread(checkpoint, sizeof(*checkpoint), 1, file) == 1 &&
+                  fread(rebuild->available, sizeof(bool), cluster->count, file) ==
+                  (size_t)cluster->count;
+    fclose(file);
+    if (loaded && (checkpoint->magic != KINETIC_CLUSTER_CHECKPOINT_MAGIC ||
+                   strncmp(checkpoint->name, cluster->members[rebuild->device].name,
+                           sizeof(checkpoint->name)) != 0 ||
+                   checkpoint->devices != cluster->count ||
+                   checkpoint->replicas != cluster->replicas ||
+                   checkpoint->dataChunks != cluster->dataChunks ||
+                   checkpoint->parityChunks != cluster->parityChunks ||
+                   checkpoint->scanning < 0 || checkpoint->scanning > cluster->count ||
+                   checkpoint->keyLength > KINETIC_MAX_KEY_LEN)) {
+        LOGF_ERROR("Ignoring rebuild checkpoint '%s' of a different rebuild", path);
+        loaded = false;
+    }
+    if (loaded) {
+        LOGF("Resuming rebuild of cluster device %s from checkpoint '%s'",
+             checkpoint->name, path);
+    }
+    return loaded;
+}
+
+// Starts a rebuild afresh, from the first key of the first device, reading
+// from the devices which respond
+static void KineticCluster_ResetRebuild(KineticClusterRebuild* const rebuild)
+{
+    KineticCluster* cluster = rebuild->cluster;
+    KineticClusterCheckpoint* checkpoint = &rebuild->checkpoint;
+    *checkpoint = (KineticClusterCheckpoint) {
+        .magic = KINETIC_CLUSTER_CHECKPOINT_MAGIC,
+        .devices = cluster->count,
+        .replicas = cluster->replicas,
+        .dataChunks = cluster->dataChunks,
+        .parityChunks = cluster->parityChunks,
+    };
+    snprintf(checkpoint->name, sizeof(checkpoint->name), "%s",
+             cluster->members[rebuild->device].name);
+    for (int i = 0; i < cluster->count; i++) {
+        KineticClusterMember* member = &cluster->members[i];
+        KineticConnection* connection = KineticConnection_FromHandle(member->handle);
+        rebuild->available[i] = false;
+        if (i == rebuild->device) {
+            continue;
+        }
+        KineticCluster_Drain(cluster, member);
+        if (!connection->connected) {
+            KineticConnection_Connect(connection);
+        }
+        rebuild->available[i] = connection->connected &&
+                                KineticClient_NoOp(member->handle) == KINETIC_STATUS_SUCCESS;
+        if (!rebuild->available[i]) {
+            LOGF_ERROR("Rebuilding without cluster device %s, which is unavailable", member->name);
+        }
+    }
+}
+
+// Lists the next keys of a range on a device with GETKEYRANGE
+static KineticStatus KineticCluster_ListKeys(KineticClusterRebuild* const rebuild, int device,
+                                             KineticKeyRange* const range, int* count)
+{
+    KineticCluster* cluster = rebuild->cluster;
+    KineticClusterMember* member = &cluster->members[device];
+    KineticConnection* connection = KineticConnection_FromHandle(member->handle);
+    *count = 0;
+    KineticCluster_Drain(cluster, member);
+    KineticStatus status = KINETIC_STATUS_SUCCESS;
+    if (!connection->connected) {
+        status = KineticConnection_Connect(connection);
+        if (status != KINETIC_STATUS_SUCCESS) {
+            return status;
+        }
+    }
+    KineticOperation operation = KineticOperation_Create(connection);
+    if (operation.request == NULL || operation.response == NULL) {
+        return KINETIC_STATUS_NO_PDUS_AVAVILABLE;
+    }
+    KineticOperation_BuildGetKeyRange(&operation, range);
+    KineticCluster_Throttle(rebuild, 1, 0);
+    status = KineticPDU_Send(operation.request);
+    if (status == KINETIC_STATUS_SUCCESS) {
+        operation.response->connection = connection;
+        status = KineticPDU_Receive(operation.response);
+    }
+    if (status == KINETIC_STATUS_SUCCESS) {
+        status = KineticOperation_GetStatus(&operation);
+    }
+
+    KineticProto_Range* keys = KineticPDU_GetKeyRange(operation.response);
+    if (status == KINETIC_STATUS_SUCCESS && keys != NULL) {
+        for (size_t i = 0; i < keys->n_key && i < KINETIC_CLUSTER_REBUILD_SCAN_COUNT; i++) {
+            if (keys->key[i].len > KINETIC_MAX_KEY_LEN) {
+                status = KINETIC_STATUS_BUFFER_OVERRUN;
+                break;
+            }
+            memcpy(&rebuild->keyData[i * KINETIC_MAX_KEY_LEN], keys->key[i].data, keys->key[i].len);
+            rebuild->keyLengths[i] = keys->key[i].len;
+            (*count)++;
+        }
+    }
+    KineticOperation_Free(&operation);
+    if (Kinetic_IsConnectionFailure(status)) {
+        KineticCluster_Abort(cluster, member, status);
+    }
+    return status;
+}
+
+// Sends a GET of a key to one of its devices, read into a buffer of the
+// slot of the key. Buffers are allocated when first used and then reused by
+// each batch, as the responses to a batch are all received before the next.
+static void KineticCluster_RebuildRead(KineticClusterRebuild* const rebuild, int index,
+                                       int rank, int slot)
+{
+    KineticClusterRebuildKey* key = &rebuild->keys[index];
+    int replica = index * KINETIC_CLUSTER_REPLICAS_MAX + rank;
+    uint8_t** buffer = &rebuild->buffers[index * KINETIC_CLUSTER_REPLICAS_MAX + slot];
+    if (*buffer == NULL) {
+        *buffer = malloc(PDU_VALUE_MAX_LEN + KINETIC_MAX_VERSION_LEN +
+                         KINETIC_CLUSTER_REBUILD_TAG_MAX);
+    }
+    if (*buffer == NULL) {
+        rebuild->replies[replica] = (KineticClusterReply) {
+            .status = KINETIC_STATUS_MEMORY_ERROR,
+            .done = true,
+        };
+        return;
+    }
+    key->charged[rank] = false;
+    key->reads[rank] = (KineticEntry) {
+        .key = key->key,
+        .value = ByteBuffer_Create(*buffer, PDU_VALUE_MAX_LEN),
+        .dbVersion = ByteBuffer_Create(*buffer + PDU_VALUE_MAX_LEN, KINETIC_MAX_VERSION_LEN),
+        .tag = ByteBuffer_Create(*buffer + PDU_VALUE_MAX_LEN + KINETIC_MAX_VERSION_LEN,
+                                 KINETIC_CLUSTER_REBUILD_TAG_MAX),
+    };
+    rebuild->replies[replica] = (KineticClusterReply) {.entry = &key->reads[rank]};
+    KineticCluster_Throttle(rebuild, 1, 0);
+    KineticCluster_Send(rebuild->cluster, replica, key->devices[rank],
+                        KINETIC_PROTO_MESSAGE_TYPE_GET, &key->reads[rank], NULL);
+}
+
+// Sends a GETVERSION of a key to one of its devices
+static void KineticCluster_RebuildVersion(KineticClusterRebuild* const rebuild, int index, int rank)
+{
+    KineticClusterRebuildKey* key = &rebuild->keys[index];
+    int replica = index * KINETIC_CLUSTER_REPLICAS_MAX + rank;
+    key->reads[rank] = (KineticEntry) {
+        .key = key->key,
+        .dbVersion = ByteBuffer_Create(key->versions[rank], KINETIC_MAX_VERSION_LEN),
+        .metadataOnly = true,
+    };
+    rebuild->replies[replica].entry = &key->reads[rank];
+    KineticCluster_Throttle(rebuild, 1, 0);
+    KineticCluster_Send(rebuild->cluster, replica, key->devices[rank],
+                        KINETIC_PROTO_MESSAGE_TYPE_GETVERSION, &key->reads[rank], NULL);
+}
+
+// Picks the version of a replicated key to copy from the versions its other
+// devices reported: that reported by the most, or of versions reported by
+// as many, that of the device ranked first, as for KineticCluster_Get.
+// Versions are opaque, so which is newest cannot be told from them.
+static void KineticCluster_RebuildVote(KineticClusterRebuild* const rebuild, int index)
+{
+    KineticClusterRebuildKey* key = &rebuild->keys[index];
+    const KineticClusterReply* replies = &rebuild->replies[index * KINETIC_CLUSTER_REPLICAS_MAX];
+    int winner = -1;
+    int votes = 0;
+    int responded = 0;
+    key->voted = true;
+    for (int r = 0; r < key->count; r++) {
+        if (r == key->rank || !replies[r].done) {
+            continue;
+        }
+        if (!KineticCluster_Responded(&replies[r])) {
+            if (key->status == KINETIC_STATUS_DATA_ERROR) {
+                key->status = replies[r].status;
+            }
+            continue;
+        }
+        responded++;
+        int matching = 0;
+        for (int j = 0; j < key->count; j++) {
+            if (j != key->rank && KineticCluster_Responded(&replies[j]) &&
+                KineticCluster_SameVersion(&replies[r], &replies[j])) {
+                matching++;
+            }
+        }
+        if (matching > votes) {
+            winner = r;
+            votes = matching;
+        }
+    }
+    if (winner < 0) {
+        return;
+    }
+    if (votes < responded) {
+        LOGF("Replicas of a key rebuilt to cluster device %s diverged, "
+             "with %d of %d reporting the version copied",
+             rebuild->checkpoint.name, votes, responded);
+    }
+    if (replies[winner].notFound) {
+        key->status = KINETIC_STATUS_NOT_ATTEMPTED;
+        return;
+    }
+    for (int r = 0; r < key->count; r++) {
+        key->current[r] = (r != key->rank) && KineticCluster_Responded(&replies[r]) &&
+                          KineticCluster_SameVersion(&replies[winner], &replies[r]);
+    }
+    key->next = 0;
+}
+
+// Sends the reads a replicated key still needs: the versions of the entry
+// from all its other devices first, then the entry from the first device
+// which reported the version picked, or from the next if that read fails, so
+// that a replica left behind (e.g. by a failed write) is never copied.
+// Returns whether any were sent.
+static bool KineticCluster_RebuildReplicaReads(KineticClusterRebuild* const rebuild, int index)
+{
+    KineticClusterRebuildKey* key = &rebuild->keys[index];
+    const KineticClusterReply* replies = &rebuild->replies[index * KINETIC_CLUSTER_REPLICAS_MAX];
+    if (key->sent == 0) {
+        for (int r = 0; r < key->count; r++) {
+            if (r != key->rank && rebuild->available[key->devices[r]]) {
+                KineticCluster_RebuildVersion(rebuild, index, r);
+                key->sent++;
+            }
+        }
+        return key->sent > 0;
+    }
+    if (!key->voted) {
+        KineticCluster_RebuildVote(rebuild, index);
+    }
+    else if (key->source >= 0 && KineticCluster_Responded(&replies[key->source])) {
+        return false;
+    }
+    while (key->next < key->count) {
+        int rank = key->next++;
+        if (key->current[rank]) {
+            key->source = rank;
+            KineticCluster_RebuildRead(rebuild, index, rank, 0);
+            key->sent++;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Sends the reads a key still needs: those of a replicated key, or the
+// chunks of a stripe, first from as many devices as there are data chunks
+// and then from all the others. Returns whether any were sent.
+static bool KineticCluster_RebuildReads(KineticClusterRebuild* const rebuild, int index)
+{
+    const KineticCluster* cluster = rebuild->cluster;
+    KineticClusterRebuildKey* key = &rebuild->keys[index];
+    const KineticClusterReply* replies = &rebuild->replies[index * KINETIC_CLUSTER_REPLICAS_MAX];
+    int needed = 0;
+    if (cluster->dataChunks == 0) {
+        return KineticCluster_RebuildReplicaReads(rebuild, index);
+    }
+    else if (key->sent == 0) {
+        needed = cluster->dataChunks;
+    }
+    else {
+        KineticClusterChunkHeader headers[KINETIC_CLUSTER_REPLICAS_MAX];
+        bool valid[KINETIC_CLUSTER_REPLICAS_MAX];
+        int notFound = 0;
+        for (int r = 0; r < key->count; r++) {
+            valid[r] = KineticCluster_IsChunk(cluster, &replies[r], r, &headers[r]);
+            notFound += (replies[r].done && replies[r].notFound) ? 1 : 0;
+        }
+        int first;
+        int best = KineticCluster_FindStripe(headers, valid, key->count, &first);
+        needed = (best >= cluster->dataChunks || notFound >= cluster->dataChunks) ? 0 : key->count;
+    }
+
+    bool sent = false;
+    while (needed > 0 && key->next < key->count) {
+        int rank = key->next++;
+        if (rank != key->rank && rebuild->available[key->devices[rank]]) {
+            KineticCluster_RebuildRead(rebuild, index, rank, rank);
+            key->sent++;
+            needed--;
+            sent = true;
+        }
+    }
+    return sent;
+}
+
+// Reconstructs the chunk of the device rebuilt from the chunks of the stripe
+// read, decoding the data chunks and encoding the parity chunk if it is one
+static KineticStatus KineticCluster_RebuildChunk(KineticClusterRebuild* const rebuild, int index)
+{
+    const KineticCluster* cluster = rebuild->cluster;
+    const int dataChunks = cluster->dataChunks;
+    KineticClusterRebuildKey* key = &rebuild->keys[index];
+    const KineticClusterReply* replies = &rebuild->replies[index * KINETIC_CLUSTER_REPLICAS_MAX];
+    KineticClusterChunkHeader headers[KINETIC_CLUSTER_REPLICAS_MAX];
+    bool valid[KINETIC_CLUSTER_REPLICAS_MAX];
+    int notFound = 0;
+    for (int r = 0; r < key->count; r++) {
+        valid[r] = KineticCluster_IsChunk(cluster, &replies[r], r, &headers[r]);
+        notFound += (replies[r].done && replies[r].notFound) ? 1 : 0;
+    }
+    int first = 0;
+    if (KineticCluster_FindStripe(headers, valid, key->count, &first) < dataChunks) {
+        return (notFound >= dataChunks) ? KINETIC_STATUS_NOT_ATTEMPTED : KINETIC_STATUS_DATA_ERROR;
+    }
+
+    KineticClusterChunkHeader header = headers[first];
+    const size_t chunkLength = (header.valueLength + dataChunks - 1) / dataChunks;
+    uint8_t* chunks[KINETIC_CLUSTER_REPLICAS_MAX];
+    bool present[KINETIC_CLUSTER_REPLICAS_MAX];
+    uint8_t* scratch = malloc(key->count * chunkLength + 1);
+    key->value = malloc(KINETIC_CLUSTER_CHUNK_HEADER_LEN + chunkLength);
+    if (scratch == NULL || key->value == NULL) {
+        free(scratch);
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    for (int r = 0; r < key->count; r++) {
+        present[r] = valid[r] && headers[r].stripe == header.stripe &&
+                     key->reads[r].value.bytesUsed == KINETIC_CLUSTER_CHUNK_HEADER_LEN + chunkLength;
+        chunks[r] = present[r] ?
+                    (uint8_t*)key->reads[r].value.array.data + KINETIC_CLUSTER_CHUNK_HEADER_LEN :
+                    &scratch[r * chunkLength];
+    }
+    KineticStatus status = KineticErasure_Decode(&cluster->code, chunks, present, chunkLength);
+    if (status == KINETIC_STATUS_SUCCESS && key->rank >= dataChunks) {
+        KineticErasure_Encode(&cluster->code, chunks, &chunks[dataChunks], chunkLength);
+    }
+    if (status == KINETIC_STATUS_SUCCESS) {
+        const KineticEntry* source = &key->reads[first];
+        header.index = (uint8_t)key->rank;
+        KineticCluster_WriteChunkHeader(key->value, &header);
+        memcpy(key->value + KINETIC_CLUSTER_CHUNK_HEADER_LEN, chunks[key->rank], chunkLength);
+        key->write = (KineticEntry) {
+            .key = key->key,
+            .newVersion = source->dbVersion,
+            .tag = source->tag,
+            .algorithm = source->algorithm,
+            .value = ByteBuffer_Create(key->value, KINETIC_CLUSTER_CHUNK_HEADER_LEN + chunkLength),
+        };
+        key->write.value.bytesUsed = KINETIC_CLUSTER_CHUNK_HEADER_LEN + chunkLength;
+    }
+    free(scratch);
+    return status;
+}
+
+// Prepares the write of the replica or chunk of a key to the device rebuilt,
+// returning KINETIC_STATUS_NOT_ATTEMPTED if the key was deleted since listed
+static KineticStatus KineticCluster_RebuildEntry(KineticClusterRebuild* const rebuild, int index)
+{
+    KineticClusterRebuildKey* key = &rebuild->keys[index];
+    const KineticClusterReply* replies = &rebuild->replies[index * KINETIC_CLUSTER_REPLICAS_MAX];
+    if (rebuild->cluster->dataChunks > 0) {
+        return KineticCluster_RebuildChunk(rebuild, index);
+    }
+
+    // Without a replica of the version picked read, fails as when voting
+    if (key->source < 0) {
+        return key->status;
+    }
+    const KineticClusterReply* reply = &replies[key->source];
+    if (reply->status != KINETIC_STATUS_SUCCESS) {
+        return reply->notFound ? KINETIC_STATUS_NOT_ATTEMPTED : reply->status;
+    }
+    const KineticEntry* source = &key->reads[key->source];
+    key->write = (KineticEntry) {
+        .key = key->key,
+        .newVersion = source->dbVersion,
+        .tag = source->tag,
+        .algorithm = source->algorithm,
+        .value = source->value,
+    };
+    return KINETIC_STATUS_SUCCESS;
+}
+
+// Rebuilds the keys of a batch: reads each from its other devices, then
+// writes the replica or chunk reconstructed to the device rebuilt. Writes
+// only succeed if the key is not on the device yet, so never replace
+// versioned entries written since.
+static void KineticCluster_RebuildBatch(KineticClusterRebuild* const rebuild)
+{
+    KineticCluster* cluster = rebuild->cluster;
+    KineticClusterRebuildStats* stats = &rebuild->checkpoint.stats;
+    const int count = rebuild->keyCount;
+    const int replyCount = count * KINETIC_CLUSTER_REPLICAS_MAX;
+    if (count == 0) {
+        return;
+    }
+    if (KineticCluster_RebuildStopping(rebuild)) {
+        rebuild->stopped = true;
+        rebuild->keyCount = 0;
+        return;
+    }
+    memset(rebuild->replies, 0, replyCount * sizeof(KineticClusterReply));
+
+    KineticCluster_BeginRequest(cluster, rebuild->replies);
+    bool sent;
+    do {
+        sent = false;
+        for (int i = 0; i < count; i++) {
+            sent = KineticCluster_RebuildReads(rebuild, i) || sent;
+        }
+        if (sent) {
+            KineticCluster_AwaitAll(cluster, rebuild->devices, cluster->count);
+            KineticCluster_ChargeReads(rebuild);
+        }
+    } while (sent);
+
+    for (int i = 0; i < count; i++) {
+        KineticClusterRebuildKey* key = &rebuild->keys[i];
+        key->status = KineticCluster_RebuildEntry(rebuild, i);
+        if (key->status == KINETIC_STATUS_SUCCESS) {
+            KineticCluster_Throttle(rebuild, 1, key->write.value.bytesUsed);
+            KineticCluster_Send(cluster, i * KINETIC_CLUSTER_REPLICAS_MAX + key->rank,
+                                rebuild->device, KINETIC_PROTO_MESSAGE_TYPE_PUT, &key->write, NULL);
+        }
+    }
+    KineticCluster_AwaitAll(cluster, &rebuild->device, 1);
+    KineticCluster_EndRequest(cluster);
+
+    for (int i = 0; i < count; i++) {
+        KineticClusterRebuildKey* key = &rebuild->keys[i];
+        KineticStatus status = key->status;
+        if (status == KINETIC_STATUS_SUCCESS) {
+            status = rebuild->replies[i * KINETIC_CLUSTER_REPLICAS_MAX + key->rank].status;
+        }
+        if (status == KINETIC_STATUS_SUCCESS) {
+            stats->keysRebuilt++;
+            stats->bytesWritten += key->write.value.bytesUsed;
+        }
+        else if (status == KINETIC_STATUS_NOT_ATTEMPTED || status == KINETIC_STATUS_VERSION_FAILURE) {
+            stats->keysSkipped++;
+        }
+        else {
+            LOGF_ERROR("Failed rebuilding key of cluster device %s with status: %s",
+                       rebuild->checkpoint.name, Kinetic_GetStatusDescription(status));
+            stats->keysFailed++;
+            if (rebuild->status == KINETIC_STATUS_SUCCESS) {
+                rebuild->status = status;
+            }
+        }
+        free(key->value);
+    }
+    rebuild->keyCount = 0;
+}
+
+// Adds a key listed by a device to the batch if it is placed on the device
+// rebuilt, and the device listing it is the first of its others available,
+// so that each key is rebuilt once
+static void KineticCluster_AddRebuildKey(KineticClusterRebuild* const rebuild,
+                                         int listing, int listed)
+{
+    const KineticCluster* cluster = rebuild->cluster;
+    KineticClusterRebuildKey* key = &rebuild->keys[rebuild->keyCount];
+    *key = (KineticClusterRebuildKey) {
+        .key = ByteBuffer_Create(&rebuild->keyData[listed * KINETIC_MAX_KEY_LEN],
+                                 rebuild->keyLengths[listed]),
+        .rank = -1,
+        .source = -1,
+        .status = KINETIC_STATUS_DATA_ERROR,
+    };
+    key->key.bytesUsed = rebuild->keyLengths[listed];
+    int count = (cluster->dataChunks > 0) ?
+                cluster->dataChunks + cluster->parityChunks : cluster->replicas;
+    key->count = KineticCluster_GetReplicas(cluster, &key->key, key->devices, count);
+    int first = -1;
+    for (int r = 0; r < key->count; r++) {
+        if (key->devices[r] == rebuild->device) {
+            key->rank = r;
+        }
+        else if (first < 0 && rebuild->available[key->devices[r]]) {
+            first = key->devices[r];
+        }
+    }
+    if (key->rank >= 0 && first == listing) {
+        rebuild->keyCount++;
+    }
+}
+
+// Lists the keys of each available device in turn, rebuilding those placed
+// on the device rebuilt in batches, and saving the progress after each
+// GETKEYRANGE once its keys are rebuilt
+static KineticStatus KineticCluster_RebuildKeys(KineticClusterRebuild* const rebuild)
+{
+    KineticCluster* cluster = rebuild->cluster;
+    KineticClusterCheckpoint* checkpoint = &rebuild->checkpoint;
+    uint64_t scanned = 0;
+    for (; checkpoint->scanning < cluster->count; checkpoint->scanning++, checkpoint->keyLength = 0) {
+        int device = checkpoint->scanning;
+        if (device == rebuild->device || !rebuild->available[device]) {
+            continue;
+        }
+        KineticKeyRange range = {
+            .startKey = ByteBuffer_Create(checkpoint->key, sizeof(checkpoint->key)),
+            .endKey = ByteBuffer_Create(rebuild->endKey, sizeof(rebuild->endKey)),
+            .startKeyInclusive = (checkpoint->keyLength == 0),
+            .endKeyInclusive = true,
+            .maxReturned = KINETIC_CLUSTER_REBUILD_SCAN_COUNT,
+        };
+        range.startKey.bytesUsed = checkpoint->keyLength;
+        range.endKey.bytesUsed = sizeof(rebuild->endKey);
+        int listed;
+        do {
+            if (rebuild->maxKeys > 0 && scanned >= (uint64_t)rebuild->maxKeys) {
+                return rebuild->status;
+            }
+            KineticStatus status = KineticCluster_ListKeys(rebuild, device, &range, &listed);
+            if (status != KINETIC_STATUS_SUCCESS) {
+                LOGF_ERROR("Failed listing keys of cluster device %s to rebuild %s",
+                           cluster->members[device].name, checkpoint->name);
+                return status;
+            }
+            for (int i = 0; i < listed; i++) {
+                KineticCluster_AddRebuildKey(rebuild, device, i);
+                if (rebuild->keyCount == rebuild->parallelism) {
+                    KineticCluster_RebuildBatch(rebuild);
+                }
+            }
+            KineticCluster_RebuildBatch(rebuild);
+            if (rebuild->stopped) {
+                return rebuild->status;
+            }
+            scanned += listed;
+            checkpoint->stats.keysScanned += listed;
+
+            // Continue after the last key listed
+            if (listed > 0) {
+                memcpy(checkpoint->key, &rebuild->keyData[(listed - 1) * KINETIC_MAX_KEY_LEN],
+                       rebuild->keyLengths[listed - 1]);
+                checkpoint->keyLength = rebuild->keyLengths[listed - 1];
+                range.startKey.bytesUsed = checkpoint->keyLength;
+                range.startKeyInclusive = false;
+            }
+            status = KineticCluster_SaveCheckpoint(rebuild);
+            if (status != KINETIC_STATUS_SUCCESS) {
+                return status;
+            }
+            if (KineticCluster_RebuildStopping(rebuild)) {
+                return rebuild->status;
+            }
+        } while (listed == KINETIC_CLUSTER_REBUILD_SCAN_COUNT);
+    }
+
+    checkpoint->stats.complete = true;
+    KineticStatus status = KineticCluster_SaveCheckpoint(rebuild);
+    return (status != KINETIC_STATUS_SUCCESS) ? status : rebuild->status;
+}
+
+static void KineticCluster_FreeRebuild(KineticClusterRebuild* const rebuild)
+{
+    free(rebuild->available);
+    free(rebuild->devices);
+    free(rebuild->keys);
+    free(rebuild->replies);
+    if (rebuild->buffers != NULL) {
+        for (int i = 0; i < rebuild->parallelism * KINETIC_CLUSTER_REPLICAS_MAX; i++) {
+            free(rebuild->buffers[i]);
+        }
+    }
+    free(rebuild->buffers);
+    free(rebuild->keyData);
+    free(rebuild);
+}
+
+static KineticStatus KineticCluster_CheckRebuild(const KineticCluster* const cluster, int device,
+                                                 const KineticClusterRebuildConfig* config)
+{
+    if (device < 0 || device >= cluster->count ||
+        config->parallelism < 0 || config->parallelism > KINETIC_CLUSTER_REBUILD_PARALLELISM_MAX ||
+        config->maxBytesPerSecond < 0 || config->maxOpsPerSecond < 0 || config->maxKeys < 0) {
+        LOG_ERROR("Invalid cluster rebuild configuration!");
+        return KINETIC_STATUS_INVALID;
+    }
+    if (cluster->replicas < 2 && cluster->dataChunks == 0) {
+        LOG_ERROR("Cluster devices can only be rebuilt with replication or erasure coding!");
+        return KINETIC_STATUS_INVALID;
+    }
+    return KINETIC_STATUS_SUCCESS;
+}
+
+// Rebuilds a device on the calling thread, or on that of a rebuilder
+static KineticStatus KineticCluster_RunRebuild(KineticCluster* const cluster, int device,
+                                               const KineticClusterRebuildConfig* config,
+                                               KineticClusterRebuilder* const rebuilder,
+                                               KineticClusterRebuildStats* const stats)
+{
+    KineticClusterRebuild* rebuild = calloc(1, sizeof(KineticClusterRebuild));
+    if (rebuild == NULL) {
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    *rebuild = (KineticClusterRebuild) {
+        .cluster = cluster,
+        .rebuilder = rebuilder,
+        .device = device,
+        .parallelism = (config->parallelism > 0) ?
+                       config->parallelism : KINETIC_CLUSTER_REBUILD_PARALLELISM,
+        .maxBytesPerSecond = config->maxBytesPerSecond,
+        .maxOpsPerSecond = config->maxOpsPerSecond,
+        .maxKeys = config->maxKeys,
+        .checkpointPath = config->checkpointPath,
+        .start = KineticStats_Now(),
+        .status = KINETIC_STATUS_SUCCESS,
+    };
+    memset(rebuild->endKey, 0xFF, sizeof(rebuild->endKey));
+    rebuild->available = calloc(cluster->count, sizeof(bool));
+    rebuild->devices = calloc(cluster->count, sizeof(int));
+    rebuild->keys = calloc(rebuild->parallelism, sizeof(KineticClusterRebuildKey));
+    rebuild->replies = calloc(rebuild->parallelism * KINETIC_CLUSTER_REPLICAS_MAX,
+                              sizeof(KineticClusterReply));
+    rebuild->buffers = calloc(rebuild->parallelism * KINETIC_CLUSTER_REPLICAS_MAX,
+                              sizeof(uint8_t*));
+    rebuild->keyData = malloc(KINETIC_CLUSTER_REBUILD_SCAN_COUNT * KINETIC_MAX_KEY_LEN);
+    if (rebuild->available == NULL || rebuild->devices == NULL || rebuild->keys == NULL ||
+        rebuild->replies == NULL || rebuild->buffers == NULL || rebuild->keyData == NULL) {
+        KineticCluster_FreeRebuild(rebuild);
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    for (int i = 0; i < cluster->count; i++) {
+        rebuild->devices[i] = i;
+    }
+
+    if (!KineticCluster_LoadCheckpoint(rebuild)) {
+        KineticCluster_ResetRebuild(rebuild);
+    }
+    KineticStatus status = KINETIC_STATUS_SUCCESS;
+    if (!rebuild->checkpoint.stats.complete) {
+        status = KineticCluster_RebuildKeys(rebuild);
+    }
+    LOGF("Rebuild of cluster device %s %s: %llu keys rebuilt, %llu skipped, %llu failed",
+         rebuild->checkpoint.name, rebuild->checkpoint.stats.complete ? "complete" : "stopped",
+         (unsigned long long)rebuild->checkpoint.stats.keysRebuilt,
+         (unsigned long long)rebuild->checkpoint.stats.keysSkipped,
+         (unsigned long long)rebuild->checkpoint.stats.keysFailed);
+    if (stats != NULL) {
+        *stats = rebuild->checkpoint.stats;
+    }
+    KineticCluster_FreeRebuild(rebuild);
+    return status;
+}
+
+KineticStatus KineticCluster_Rebuild(KineticCluster* const cluster, int device,
+                                     const KineticClusterRebuildConfig* config,
+                                     KineticClusterRebuildStats* const stats)
+{
+    assert(cluster != NULL);
+    assert(config != NULL);
+    KineticStatus status = KineticCluster_CheckRebuild(cluster, device, config);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        return status;
+    }
+    return KineticCluster_RunRebuild(cluster, device, config, NULL, stats);
+}
+
+// Connects a cluster of its own to the devices of a cluster, with the same
+// names, weights and replication or erasure coding, so that it places keys
+// alike. Devices which cannot be connected to are added disconnected, and
+// are retried by the rebuild as by that of the cluster.
+static KineticStatus KineticCluster_Clone(const KineticCluster* const cluster,
+                                          KineticCluster** const clone)
+{
+    KineticCluster* newCluster = calloc(1, sizeof(KineticCluster));
+    KineticClusterMember* members = calloc(cluster->count, sizeof(KineticClusterMember));
+    if (newCluster == NULL || members == NULL) {
+        free(newCluster);
+        free(members);
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    *newCluster = (KineticCluster) {
+        .members = members,
+        .replicas = cluster->replicas,
+        .writeQuorum = cluster->writeQuorum,
+        .readQuorum = cluster->readQuorum,
+        .dataChunks = cluster->dataChunks,
+        .parityChunks = cluster->parityChunks,
+        .degradedReadMs = cluster->degradedReadMs,
+        .code = cluster->code,
+    };
+    for (int i = 0; i < cluster->count; i++) {
+        const KineticClusterMember* member = &cluster->members[i];
+        KineticSession session = KineticConnection_FromHandle(member->handle)->session;
+        session.readCacheBytes = 0;
+        session.writeBackBytes = 0;
+        members[i] = (KineticClusterMember) {
+            .handle = KineticConnection_NewConnection(&session),
+            .seed = member->seed,
+            .weight = member->weight,
+        };
+        memcpy(members[i].name, member->name, sizeof(members[i].name));
+        if (members[i].handle == KINETIC_HANDLE_INVALID) {
+            LOG_ERROR("No sessions left to rebuild cluster devices with!");
+            KineticCluster_Disconnect(&newCluster);
+            return KINETIC_STATUS_SESSION_INVALID;
+        }
+        newCluster->count++;
+        if (KineticConnection_Connect(KineticConnection_FromHandle(members[i].handle)) !=
+            KINETIC_STATUS_SUCCESS) {
+            LOGF_ERROR("Failed connecting to cluster device %s to rebuild with", member->name);
+        }
+    }
+    *clone = newCluster;
+    return KINETIC_STATUS_SUCCESS;
+}
+
+static void* KineticCluster_RunRebuilder(void* arg)
+{
+    KineticClusterRebuilder* rebuilder = arg;
+    KineticClusterRebuildStats stats = rebuilder->stats;
+    KineticStatus status = KineticCluster_RunRebuild(rebuilder->cluster, rebuilder->device,
+                                                     &rebuilder->config, rebuilder, &stats);
+    pthread_mutex_lock(&rebuilder->mutex);
+    rebuilder->stats = stats;
+    rebuilder->status = status;
+    rebuilder->finished = true;
+    pthread_mutex_unlock(&rebuilder->mutex);
+    return NULL;
+}
+
+static void KineticCluster_FreeRebuilder(KineticClusterRebuilder* const rebuilder)
+{
+    if (rebuilder->cluster != NULL) {
+        KineticCluster_Disconnect(&rebuilder->cluster);
+    }
+    pthread_cond_destroy(&rebuilder->wake);
+    pthread_mutex_destroy(&rebuilder->mutex);
+    free(rebuilder->checkpointPath);
+    free(rebuilder);
+}
+
+KineticStatus KineticCluster_StartRebuild(KineticCluster* const cluster, int device,
+                                          const KineticClusterRebuildConfig* config,
+                                          KineticClusterRebuilder** const rebuilder)
+{
+    assert(cluster != NULL);
+    assert(config != NULL);
+    assert(rebuilder != NULL);
+    *rebuilder = NULL;
+    KineticStatus status = KineticCluster_CheckRebuild(cluster, device, config);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        return status;
+    }
+
+    KineticClusterRebuilder* newRebuilder = calloc(1, sizeof(KineticClusterRebuilder));
+    if (newRebuilder == NULL) {
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    pthread_mutex_init(&newRebuilder->mutex, NULL);
+    pthread_cond_init(&newRebuilder->wake, NULL);
+    newRebuilder->device = device;
+    newRebuilder->config = *config;
+    newRebuilder->status = KINETIC_STATUS_SUCCESS;
+    if (config->checkpointPath != NULL) {
+        size_t length = strlen(config->checkpointPath) + 1;
+        newRebuilder->checkpointPath = malloc(length);
+        if (newRebuilder->checkpointPath == NULL) {
+            KineticCluster_FreeRebuilder(newRebuilder);
+            return KINETIC_STATUS_MEMORY_ERROR;
+        }
+        memcpy(newRebuilder->checkpointPath, config->checkpointPath, length);
+        newRebuilder->config.checkpointPath = newRebuilder->checkpointPath;
+    }
+
+    // Requests of the rebuild are sent with sessions of its own, so that they
+    // do not hold up the operations of the cluster, or mix with them
+    status = KineticCluster_Clone(cluster, &newRebuilder->cluster);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        KineticCluster_FreeRebuilder(newRebuilder);
+        return status;
+    }
+    if (pthread_create(&newRebuilder->thread, NULL, KineticCluster_RunRebuilder, newRebuilder) != 0) {
+        LOG_ERROR("Failed starting cluster rebuild thread!");
+        KineticCluster_FreeRebuilder(newRebuilder);
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    *rebuilder = newRebuilder;
+    return KINETIC_STATUS_SUCCESS;
+}
+
+bool KineticCluster_PollRebuild(KineticClusterRebuilder* const rebuilder,
+                                KineticClusterRebuildStats* const stats,
+                                KineticStatus* const status)
+{
+    assert(rebuilder != NULL);
+    pthread_mutex_lock(&rebuilder->mutex);
+    bool finished = rebuilder->finished;
+    if (stats != NULL) {
+        *stats = rebuilder->stats;
+    }
+    if (status != NULL) {
+        *status = finished ? rebuilder->status : KINETIC_STATUS_SUCCESS;
+    }
+    pthread_mutex_unlock(&rebuilder->mutex);
+    return finished;
+}
+
+KineticStatus KineticCluster_StopRebuild(KineticClusterRebuilder** const rebuilder,
+                                         KineticClusterRebuildStats* const stats)
+{
+    if (rebuilder == NULL || *rebuilder == NULL) {
+        LOG("Invalid cluster rebuild specified!");
+        return KINETIC_STATUS_INVALID;
+    }
+    pthread_mutex_lock(&(*rebuilder)->mutex);
+    (*rebuilder)->stopping = true;
+    pthread_cond_signal(&(*rebuilder)->wake);
+    pthread_mutex_unlock(&(*rebuilder)->mutex);
+    pthread_join((*rebuilder)->thread, NULL);
+
+    KineticStatus status = (*rebuilder)->status;
+    if (stats != NULL) {
+        *stats = (*rebuilder)->stats;
+    }
+    KineticCluster_FreeRebuilder(*rebuilder);
+    *rebuilder = NULL;
+    return status;
+}
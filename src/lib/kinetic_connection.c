@@ -18,10 +18,13 @@
 *
 */
 
+#define KINETIC_LOG_SUBSYSTEM KINETIC_LOG_SUBSYSTEM_SOCKET
+
 #include "kinetic_connection.h"
 #include "kinetic_types_internal.h"
-#include "kinetic_socket.h"
+#include "kinetic_transport.h"
 #include "kinetic_logger.h"
+#include "kinetic_probes.h"
 #include <string.h>
 #include <stdlib.h>
 
@@ -54,6 +57,7 @@ void KineticConnection_FreeConnection(KineticSessionHandle* const handle)
     assert(*handle != KINETIC_HANDLE_INVALID);
     KineticConnection* connection = KineticConnection_FromHandle(*handle);
     assert(connection != NULL);
+    free(connection->stats);
     *connection = (KineticConnection) {
         .connected = false
     };
@@ -74,29 +78,31 @@ KineticStatus KineticConnection_Connect(KineticConnection* const connection)
     }
 
     connection->connected = false;
-    connection->socket = KineticSocket_Connect(
-                             connection->session.host,
-                             connection->session.port,
-                             connection->session.nonBlocking);
-    connection->connected = (connection->socket >= 0);
-
-    if (!connection->connected) {
-        LOG("Session connection failed!");
-        connection->socket = KINETIC_SOCKET_DESCRIPTOR_INVALID;
-        return KINETIC_STATUS_CONNECTION_ERROR;
+    connection->p2pMaxOperations = 0;   // The device may differ once reconnected
+    connection->p2pMaxBytes = 0;
+    KineticStatus status = KineticTransport_Connect(connection);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        LOG_ERROR("Session connection failed!");
+        KINETIC_PROBE3(connect, connection->connectionID, connection->socket, status);
+        return status;
     }
+    connection->connected = true;
 
+    KINETIC_PROBE3(connect, connection->connectionID, connection->socket,
+                   KINETIC_STATUS_SUCCESS);
     return KINETIC_STATUS_SUCCESS;
 }
 
 KineticStatus KineticConnection_Disconnect(KineticConnection* const connection)
 {
-    if (connection == NULL || connection->socket < 0) {
+    if (connection == NULL || connection->transport == NULL) {
         return KINETIC_STATUS_SESSION_INVALID;
     }
 
-    close(connection->socket);
-    connection->socket = KINETIC_HANDLE_INVALID;
+    KINETIC_PROBE3(disconnect, connection->connectionID, connection->socket,
+                   KINETIC_STATUS_SUCCESS);
+    KineticTransport_Close(connection);
+    connection->connected = false;
     return KINETIC_STATUS_SUCCESS;
 }
 
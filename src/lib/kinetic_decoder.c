@@ -0,0 +1,186 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#define KINETIC_LOG_SUBSYSTEM KINETIC_LOG_SUBSYSTEM_PDU
+
+#include "kinetic_decoder.h"
+#include "kinetic_pdu.h"
+#include "kinetic_logger.h"
+#include <pthread.h>
+
+// Responses are decoded (unpack, HMAC validation, status mapping) by a pool of
+// worker threads so the thread reading the socket only has to frame the PDU
+// and can drain the value payload, and the responses which follow it on
+// pipelined connections, in the meantime. Decoded responses are
+// published in the order they were submitted on each connection, using a
+// per-connection ticket, regardless of which worker finished first.
+
+STATIC pthread_mutex_t DecoderMutex = PTHREAD_MUTEX_INITIALIZER;
+STATIC pthread_cond_t DecoderWorkAvailable = PTHREAD_COND_INITIALIZER;
+STATIC pthread_cond_t DecoderProgress = PTHREAD_COND_INITIALIZER;
+STATIC KineticPDU* DecoderQueue[KINETIC_DECODER_QUEUE_DEPTH];
+STATIC int DecoderQueueHead = 0;
+STATIC int DecoderQueueCount = 0;
+STATIC pthread_t DecoderWorkers[KINETIC_DECODER_WORKERS_MAX];
+STATIC int DecoderWorkerCount = 0;
+STATIC bool DecoderRunning = false;
+
+static void KineticDecoder_Publish(KineticPDU* const response, KineticStatus status)
+{
+    // Must be called with DecoderMutex held
+    KineticConnection* connection = response->connection;
+    while (connection->decodeCompleted != response->decodeTicket) {
+        pthread_cond_wait(&DecoderProgress, &DecoderMutex);
+    }
+    response->decodeStatus = status;
+    response->decoded = true;
+    connection->decodeCompleted++;
+    pthread_cond_broadcast(&DecoderProgress);
+}
+
+static void* KineticDecoder_Worker(void* arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&DecoderMutex);
+    while (true) {
+        while (DecoderRunning && DecoderQueueCount == 0) {
+            pthread_cond_wait(&DecoderWorkAvailable, &DecoderMutex);
+        }
+        if (DecoderQueueCount == 0) {
+            break; // stopped and drained
+        }
+
+        KineticPDU* response = DecoderQueue[DecoderQueueHead];
+        DecoderQueueHead = (DecoderQueueHead + 1) % KINETIC_DECODER_QUEUE_DEPTH;
+        DecoderQueueCount--;
+        pthread_cond_broadcast(&DecoderProgress); // queue space available
+
+        pthread_mutex_unlock(&DecoderMutex);
+        KineticStatus status = KineticPDU_Decode(response);
+        pthread_mutex_lock(&DecoderMutex);
+
+        KineticDecoder_Publish(response, status);
+    }
+    pthread_mutex_unlock(&DecoderMutex);
+    return NULL;
+}
+
+KineticStatus KineticDecoder_Start(int workers)
+{
+    KineticDecoder_Stop();
+    if (workers <= 0) {
+        return KINETIC_STATUS_SUCCESS;
+    }
+    if (workers > KINETIC_DECODER_WORKERS_MAX) {
+        workers = KINETIC_DECODER_WORKERS_MAX;
+    }
+
+    pthread_mutex_lock(&DecoderMutex);
+    DecoderRunning = true;
+    DecoderQueueHead = 0;
+    DecoderQueueCount = 0;
+    for (DecoderWorkerCount = 0; DecoderWorkerCount < workers; DecoderWorkerCount++) {
+        if (pthread_create(&DecoderWorkers[DecoderWorkerCount], NULL,
+                           KineticDecoder_Worker, NULL) != 0) {
+            LOG_ERROR("Failed creating response decoder worker thread!");
+            break;
+        }
+    }
+    const bool started = (DecoderWorkerCount > 0);
+    pthread_mutex_unlock(&DecoderMutex);
+
+    if (!started) {
+        KineticDecoder_Stop();
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    LOGF("Started %d response decoder worker(s)", DecoderWorkerCount);
+    return KINETIC_STATUS_SUCCESS;
+}
+
+void KineticDecoder_Stop(void)
+{
+    pthread_mutex_lock(&DecoderMutex);
+    DecoderRunning = false;
+    pthread_cond_broadcast(&DecoderWorkAvailable);
+    pthread_cond_broadcast(&DecoderProgress);
+    const int workers = DecoderWorkerCount;
+    pthread_mutex_unlock(&DecoderMutex);
+
+    for (int i = 0; i < workers; i++) {
+        pthread_join(DecoderWorkers[i], NULL);
+    }
+
+    pthread_mutex_lock(&DecoderMutex);
+    DecoderWorkerCount = 0;
+    pthread_mutex_unlock(&DecoderMutex);
+}
+
+bool KineticDecoder_IsEnabled(void)
+{
+    pthread_mutex_lock(&DecoderMutex);
+    bool enabled = DecoderRunning;
+    pthread_mutex_unlock(&DecoderMutex);
+    return enabled;
+}
+
+KineticStatus KineticDecoder_Submit(KineticPDU* const response)
+{
+    assert(response != NULL);
+    assert(response->connection != NULL);
+
+    pthread_mutex_lock(&DecoderMutex);
+    while (DecoderRunning && DecoderQueueCount == KINETIC_DECODER_QUEUE_DEPTH) {
+        pthread_cond_wait(&DecoderProgress, &DecoderMutex);
+    }
+    response->decoded = false;
+    response->decodeTicket = response->connection->decodeSubmitted++;
+
+    if (!DecoderRunning) {
+        // Stage was stopped; decode inline once earlier responses are published
+        pthread_mutex_unlock(&DecoderMutex);
+        KineticStatus status = KineticPDU_Decode(response);
+        pthread_mutex_lock(&DecoderMutex);
+        KineticDecoder_Publish(response, status);
+        pthread_mutex_unlock(&DecoderMutex);
+        return KINETIC_STATUS_SUCCESS;
+    }
+
+    int tail = (DecoderQueueHead + DecoderQueueCount) % KINETIC_DECODER_QUEUE_DEPTH;
+    DecoderQueue[tail] = response;
+    DecoderQueueCount++;
+    pthread_cond_signal(&DecoderWorkAvailable);
+    pthread_mutex_unlock(&DecoderMutex);
+
+    return KINETIC_STATUS_SUCCESS;
+}
+
+KineticStatus KineticDecoder_Wait(KineticPDU* const response)
+{
+    assert(response != NULL);
+
+    pthread_mutex_lock(&DecoderMutex);
+    while (!response->decoded) {
+        pthread_cond_wait(&DecoderProgress, &DecoderMutex);
+    }
+    KineticStatus status = response->decodeStatus;
+    pthread_mutex_unlock(&DecoderMutex);
+
+    return status;
+}
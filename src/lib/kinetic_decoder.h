@@ -0,0 +1,35 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#ifndef _KINETIC_DECODER_H
+#define _KINETIC_DECODER_H
+
+#include "kinetic_types_internal.h"
+
+#define KINETIC_DECODER_WORKERS_MAX (8)
+#define KINETIC_DECODER_QUEUE_DEPTH (64)
+
+KineticStatus KineticDecoder_Start(int workers);
+void KineticDecoder_Stop(void);
+bool KineticDecoder_IsEnabled(void);
+KineticStatus KineticDecoder_Submit(KineticPDU* const response);
+KineticStatus KineticDecoder_Wait(KineticPDU* const response);
+
+#endif // _KINETIC_DECODER_H
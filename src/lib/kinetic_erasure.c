@@ -0,0 +1,333 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+
+
+#include "kinetic_erasure.h"
+#include "kinetic_logger.h"
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KINETIC_ERASURE_X86
+#include <immintrin.h>
+#endif
+
+#define KINETIC_ERASURE_POLYNOMIAL (0x11d)  // x^8 + x^4 + x^3 + x^2 + 1
+#define KINETIC_ERASURE_BLOCK (16 * 1024)   // Bytes of each chunk coded at a time,
+                                            // so that the blocks stay in cache
+
+// Adds the product of a factor and each byte of src to (XORs it into) dst
+typedef void (*KineticErasureKernel)(uint8_t factor, const uint8_t* src,
+                                     uint8_t* dst, size_t len);
+
+static uint8_t Exp[510];
+static uint8_t Log[256];
+static uint8_t Products[256][256];
+static KineticErasureKernel MultiplyAdd;
+static const char* KernelName;
+static pthread_once_t TablesOnce = PTHREAD_ONCE_INIT;
+
+static inline uint8_t KineticErasure_Inverse(uint8_t a)
+{
+    return Exp[255 - Log[a]];
+}
+
+static void KineticErasure_MultiplyAddScalar(uint8_t factor, const uint8_t* src,
+                                             uint8_t* dst, size_t len)
+{
+    const uint8_t* products = Products[factor];
+    for (size_t i = 0; i < len; i++) {
+        dst[i] ^= products[src[i]];
+    }
+}
+
+#ifdef KINETIC_ERASURE_X86
+
+// The product with a byte is the XOR of the products with its low and high
+// nibbles, so is found with two 16-entry table lookups (PSHUFB)
+static void KineticErasure_NibbleProducts(uint8_t factor, uint8_t low[16], uint8_t high[16])
+{
+    for (int i = 0; i < 16; i++) {
+        low[i] = Products[factor][i];
+        high[i] = Products[factor][i << 4];
+    }
+}
+
+__attribute__((target("ssse3")))
+static void KineticErasure_MultiplyAddSSSE3(uint8_t factor, const uint8_t* src,
+                                            uint8_t* dst, size_t len)
+{
+    uint8_t low[16], high[16];
+    KineticErasure_NibbleProducts(factor, low, high);
+    const __m128i lowTable = _mm_loadu_si128((const __m128i*)low);
+    const __m128i highTable = _mm_loadu_si128((const __m128i*)high);
+    const __m128i mask = _mm_set1_epi8(0x0f);
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i product = _mm_xor_si128(
+            _mm_shuffle_epi8(lowTable, _mm_and_si128(x, mask)),
+            _mm_shuffle_epi8(highTable, _mm_and_si128(_mm_srli_epi64(x, 4), mask)));
+        __m128i* out = (__m128i*)(dst + i);
+        _mm_storeu_si128(out, _mm_xor_si128(_mm_loadu_si128(out), product));
+    }
+    KineticErasure_MultiplyAddScalar(factor, src + i, dst + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static void KineticErasure_MultiplyAddAVX2(uint8_t factor, const uint8_t* src,
+                                           uint8_t* dst, size_t len)
+{
+    uint8_t low[16], high[16];
+    KineticErasure_NibbleProducts(factor, low, high);
+    const __m256i lowTable = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)low));
+    const __m256i highTable = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)high));
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m256i x0 = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i x1 = _mm256_loadu_si256((const __m256i*)(src + i + 32));
+        __m256i product0 = _mm256_xor_si256(
+            _mm256_shuffle_epi8(lowTable, _mm256_and_si256(x0, mask)),
+            _mm256_shuffle_epi8(highTable, _mm256_and_si256(_mm256_srli_epi64(x0, 4), mask)));
+        __m256i product1 = _mm256_xor_si256(
+            _mm256_shuffle_epi8(lowTable, _mm256_and_si256(x1, mask)),
+            _mm256_shuffle_epi8(highTable, _mm256_and_si256(_mm256_srli_epi64(x1, 4), mask)));
+        __m256i* out0 = (__m256i*)(dst + i);
+        __m256i* out1 = (__m256i*)(dst + i + 32);
+        _mm256_storeu_si256(out0, _mm256_xor_si256(_mm256_loadu_si256(out0), product0));
+        _mm256_storeu_si256(out1, _mm256_xor_si256(_mm256_loadu_si256(out1), product1));
+    }
+    for (; i + 32 <= len; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i product = _mm256_xor_si256(
+            _mm256_shuffle_epi8(lowTable, _mm256_and_si256(x, mask)),
+            _mm256_shuffle_epi8(highTable, _mm256_and_si256(_mm256_srli_epi64(x, 4), mask)));
+        __m256i* out = (__m256i*)(dst + i);
+        _mm256_storeu_si256(out, _mm256_xor_si256(_mm256_loadu_si256(out), product));
+    }
+    KineticErasure_MultiplyAddScalar(factor, src + i, dst + i, len - i);
+}
+
+#endif // KINETIC_ERASURE_X86
+
+static void KineticErasure_InitTables(void)
+{
+    int x = 1;
+    for (int i = 0; i < 255; i++) {
+        Exp[i] = Exp[i + 255] = (uint8_t)x;
+        Log[x] = (uint8_t)i;
+        x <<= 1;
+        if (x & 0x100) {
+            x ^= KINETIC_ERASURE_POLYNOMIAL;
+        }
+    }
+    for (int a = 1; a < 256; a++) {
+        for (int b = 1; b < 256; b++) {
+            Products[a][b] = Exp[Log[a] + Log[b]];
+        }
+    }
+
+    MultiplyAdd = KineticErasure_MultiplyAddScalar;
+    KernelName = "scalar";
+#ifdef KINETIC_ERASURE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        MultiplyAdd = KineticErasure_MultiplyAddAVX2;
+        KernelName = "avx2";
+    }
+    else if (__builtin_cpu_supports("ssse3")) {
+        MultiplyAdd = KineticErasure_MultiplyAddSSSE3;
+        KernelName = "ssse3";
+    }
+#endif
+    LOGF("Erasure coding with the %s kernel", KernelName);
+}
+
+uint8_t KineticErasure_Multiply(uint8_t a, uint8_t b)
+{
+    pthread_once(&TablesOnce, KineticErasure_InitTables);
+    return Products[a][b];
+}
+
+const char* KineticErasure_GetKernel(void)
+{
+    pthread_once(&TablesOnce, KineticErasure_InitTables);
+    return KernelName;
+}
+
+KineticStatus KineticErasure_Init(KineticErasureCode* const code,
+                                  int dataChunks, int parityChunks)
+{
+    assert(code != NULL);
+    pthread_once(&TablesOnce, KineticErasure_InitTables);
+    if (dataChunks < 1 || parityChunks < 0 ||
+        dataChunks + parityChunks > KINETIC_ERASURE_CHUNKS_MAX) {
+        LOGF_ERROR("Invalid erasure code of %d data and %d parity chunks",
+                   dataChunks, parityChunks);
+        return KINETIC_STATUS_INVALID;
+    }
+
+    // With distinct x_i = k + i and y_j = j, every square submatrix of the
+    // Cauchy matrix 1 / (x_i + y_j) is invertible, as is every square matrix
+    // of its rows and those of the identity
+    *code = (KineticErasureCode) {
+        .dataChunks = dataChunks,
+        .parityChunks = parityChunks,
+    };
+    for (int i = 0; i < parityChunks; i++) {
+        for (int j = 0; j < dataChunks; j++) {
+            code->parity[i][j] = KineticErasure_Inverse((uint8_t)((dataChunks + i) ^ j));
+        }
+    }
+    return KINETIC_STATUS_SUCCESS;
+}
+
+void KineticErasure_Encode(const KineticErasureCode* const code,
+                           uint8_t* const* data, uint8_t* const* parity, size_t len)
+{
+    assert(code != NULL);
+    for (size_t offset = 0; offset < len; offset += KINETIC_ERASURE_BLOCK) {
+        size_t block = len - offset;
+        if (block > KINETIC_ERASURE_BLOCK) {
+            block = KINETIC_ERASURE_BLOCK;
+        }
+        for (int i = 0; i < code->parityChunks; i++) {
+            memset(parity[i] + offset, 0, block);
+            for (int j = 0; j < code->dataChunks; j++) {
+                MultiplyAdd(code->parity[i][j], data[j] + offset, parity[i] + offset, block);
+            }
+        }
+    }
+}
+
+// Inverts a square matrix by Gauss-Jordan elimination, returning false if it
+// is singular
+static bool KineticErasure_Invert(uint8_t (*matrix)[KINETIC_ERASURE_CHUNKS_MAX],
+                                  uint8_t (*inverse)[KINETIC_ERASURE_CHUNKS_MAX], int size)
+{
+    for (int row = 0; row < size; row++) {
+        memset(inverse[row], 0, size);
+        inverse[row][row] = 1;
+    }
+    for (int col = 0; col < size; col++) {
+        int pivot = col;
+        while (pivot < size && matrix[pivot][col] == 0) {
+            pivot++;
+        }
+        if (pivot == size) {
+            return false;
+        }
+        for (int j = 0; j < size; j++) {
+            uint8_t swap = matrix[col][j];
+            matrix[col][j] = matrix[pivot][j];
+            matrix[pivot][j] = swap;
+            swap = inverse[col][j];
+            inverse[col][j] = inverse[pivot][j];
+            inverse[pivot][j] = swap;
+        }
+
+        uint8_t scale = KineticErasure_Inverse(matrix[col][col]);
+        for (int j = 0; j < size; j++) {
+            matrix[col][j] = Products[scale][matrix[col][j]];
+            inverse[col][j] = Products[scale][inverse[col][j]];
+        }
+        for (int row = 0; row < size; row++) {
+            uint8_t factor = matrix[row][col];
+            if (row == col || factor == 0) {
+                continue;
+            }
+            for (int j = 0; j < size; j++) {
+                matrix[row][j] ^= Products[factor][matrix[col][j]];
+                inverse[row][j] ^= Products[factor][inverse[col][j]];
+            }
+        }
+    }
+    return true;
+}
+
+KineticStatus KineticErasure_Decode(const KineticErasureCode* const code,
+                                    uint8_t* const* chunks, const bool* present, size_t len)
+{
+    assert(code != NULL);
+    const int dataChunks = code->dataChunks;
+
+    // The first chunks present are used, so data chunks ahead of parity
+    int sources[KINETIC_ERASURE_CHUNKS_MAX];
+    int sourceCount = 0;
+    for (int i = 0; i < dataChunks + code->parityChunks && sourceCount < dataChunks; i++) {
+        if (present[i]) {
+            sources[sourceCount++] = i;
+        }
+    }
+    if (sourceCount < dataChunks) {
+        LOGF_ERROR("Only %d of the %d chunks needed to decode are present",
+                   sourceCount, dataChunks);
+        return KINETIC_STATUS_DATA_ERROR;
+    }
+    int missing[KINETIC_ERASURE_CHUNKS_MAX];
+    int missingCount = 0;
+    for (int i = 0; i < dataChunks; i++) {
+        if (!present[i]) {
+            missing[missingCount++] = i;
+        }
+    }
+    if (missingCount == 0) {
+        return KINETIC_STATUS_SUCCESS;
+    }
+
+    // The rows of the code which produced the sources map the data to them,
+    // so its inverse maps the sources back to the data
+    uint8_t matrix[KINETIC_ERASURE_CHUNKS_MAX][KINETIC_ERASURE_CHUNKS_MAX];
+    uint8_t inverse[KINETIC_ERASURE_CHUNKS_MAX][KINETIC_ERASURE_CHUNKS_MAX];
+    for (int row = 0; row < dataChunks; row++) {
+        if (sources[row] < dataChunks) {
+            memset(matrix[row], 0, dataChunks);
+            matrix[row][sources[row]] = 1;
+        }
+        else {
+            memcpy(matrix[row], code->parity[sources[row] - dataChunks], dataChunks);
+        }
+    }
+    if (!KineticErasure_Invert(matrix, inverse, dataChunks)) {
+        return KINETIC_STATUS_DATA_ERROR;
+    }
+
+    for (size_t offset = 0; offset < len; offset += KINETIC_ERASURE_BLOCK) {
+        size_t block = len - offset;
+        if (block > KINETIC_ERASURE_BLOCK) {
+            block = KINETIC_ERASURE_BLOCK;
+        }
+        for (int i = 0; i < missingCount; i++) {
+            uint8_t* chunk = chunks[missing[i]] + offset;
+            memset(chunk, 0, block);
+            for (int j = 0; j < dataChunks; j++) {
+                uint8_t factor = inverse[missing[i]][j];
+                if (factor != 0) {
+                    MultiplyAdd(factor, chunks[sources[j]] + offset, chunk, block);
+                }
+            }
+        }
+    }
+    return KINETIC_STATUS_SUCCESS;
+}
@@ -0,0 +1,60 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+
+
+#ifndef _KINETIC_ERASURE_H
+#define _KINETIC_ERASURE_H
+
+#include "kinetic_types_internal.h"
+
+#define KINETIC_ERASURE_CHUNKS_MAX (32) // Data and parity chunks together
+
+// Systematic Reed-Solomon code over GF(2^8): the data chunks are stored as
+// they are, and each parity chunk is a combination of them by a row of a
+// Cauchy matrix, so that any dataChunks of the chunks reconstruct the data.
+// Chunks are multiplied with the SSSE3 or AVX2 table lookup kernel when the
+// CPU supports it.
+typedef struct _KineticErasureCode {
+    int dataChunks;
+    int parityChunks;
+    uint8_t parity[KINETIC_ERASURE_CHUNKS_MAX][KINETIC_ERASURE_CHUNKS_MAX];
+} KineticErasureCode;
+
+KineticStatus KineticErasure_Init(KineticErasureCode* const code,
+                                  int dataChunks, int parityChunks);
+
+// Computes the parity chunks from the data chunks, each of len bytes
+void KineticErasure_Encode(const KineticErasureCode* const code,
+                           uint8_t* const* data, uint8_t* const* parity, size_t len);
+
+// Reconstructs the data chunks which are not present from any dataChunks of
+// the chunks which are, each of len bytes. Chunks are indexed with the data
+// chunks first, then the parity chunks, and all data chunks need buffers.
+KineticStatus KineticErasure_Decode(const KineticErasureCode* const code,
+                                    uint8_t* const* chunks, const bool* present, size_t len);
+
+// Product of two elements of GF(2^8)
+uint8_t KineticErasure_Multiply(uint8_t a, uint8_t b);
+
+// Name of the multiplication kernel in use ("avx2", "ssse3" or "scalar")
+const char* KineticErasure_GetKernel(void);
+
+#endif // _KINETIC_ERASURE_H
@@ -18,15 +18,18 @@
 *
 */
 
+#define KINETIC_LOG_SUBSYSTEM KINETIC_LOG_SUBSYSTEM_HMAC
+
 #include "kinetic_hmac.h"
 #include "kinetic_nbo.h"
 #include "kinetic_logger.h"
+#include "kinetic_probes.h"
 #include <string.h>
 #include <openssl/hmac.h>
 
-static void KineticHMAC_Compute(KineticHMAC* hmac,
-                                const KineticProto* proto,
-                                const ByteArray key);
+static uint32_t KineticHMAC_Compute(KineticHMAC* hmac,
+                                    const KineticProto* proto,
+                                    const ByteArray key);
 
 void KineticHMAC_Init(KineticHMAC* hmac,
                       KineticProto_Security_ACL_HMACAlgorithm algorithm)
@@ -49,7 +52,13 @@ void KineticHMAC_Populate(KineticHMAC* hmac,
                           const ByteArray key)
 {
     KineticHMAC_Init(hmac, KINETIC_PROTO_SECURITY_ACL_HMACALGORITHM_HmacSHA1);
-    KineticHMAC_Compute(hmac, proto, key);
+    uint32_t len = KineticHMAC_Compute(hmac, proto, key);
+    KINETIC_PROBE3(hmac_compute,
+                   (proto->command->header != NULL) ?
+                   proto->command->header->sequence : -1,
+                   (proto->command->header != NULL) ?
+                   proto->command->header->messageType : 0,
+                   len);
 
     // Copy computed HMAC into message
     memcpy(proto->hmac.data, hmac->data, hmac->len);
@@ -67,20 +76,26 @@ bool KineticHMAC_Validate(const KineticProto* proto,
 
     if (proto->has_hmac) {
         KineticHMAC_Init(&tempHMAC, KINETIC_PROTO_SECURITY_ACL_HMACALGORITHM_HmacSHA1);
-        KineticHMAC_Compute(&tempHMAC, proto, key);
+        uint32_t len = KineticHMAC_Compute(&tempHMAC, proto, key);
         if (proto->hmac.len == tempHMAC.len) {
             for (i = 0; i < tempHMAC.len; i++) {
                 result |= proto->hmac.data[i] ^ tempHMAC.data[i];
             }
             success = (result == 0);
         }
+        KINETIC_PROBE4(hmac_validate,
+                       (proto->command->header != NULL) ?
+                       proto->command->header->ackSequence : -1,
+                       (proto->command->header != NULL) ?
+                       proto->command->header->messageType : 0,
+                       len, success);
 
         if (!success) {
-            LOG("HMAC did not compare!");
+            LOG_ERROR("HMAC did not compare!");
             ByteArray expected = {.data = proto->hmac.data, .len = proto->hmac.len};
-            KineticLogger_LogByteArray("expected HMAC", expected);
+            LOG_BYTE_ARRAY("expected HMAC", expected);
             ByteArray actual = {.data = tempHMAC.data, .len = tempHMAC.len};
-            KineticLogger_LogByteArray("actual HMAC", actual);
+            LOG_BYTE_ARRAY("actual HMAC", actual);
         }
     }
     return success;
@@ -88,9 +103,9 @@ bool KineticHMAC_Validate(const KineticProto* proto,
 
 #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
 
-static void KineticHMAC_Compute(KineticHMAC* hmac,
-                                const KineticProto* proto,
-                                const ByteArray key)
+static uint32_t KineticHMAC_Compute(KineticHMAC* hmac,
+                                    const KineticProto* proto,
+                                    const ByteArray key)
 {
     assert(proto->command);
     uint32_t len = protobuf_c_message_get_packed_size((ProtobufCMessage*)proto->command);
@@ -109,4 +124,5 @@ static void KineticHMAC_Compute(KineticHMAC* hmac,
     HMAC_CTX_cleanup(&ctx);
 
     free(packed);
+    return len;
 }
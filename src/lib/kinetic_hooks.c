@@ -0,0 +1,95 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#include "kinetic_hooks.h"
+#include "kinetic_logger.h"
+#include <string.h>
+
+// Operations are executed synchronously by the thread which started them, so
+// the details of the operation in progress are kept per thread. The hooks
+// registered when an operation starts are used for all of its events, so a
+// span is never split across two sets of hooks.
+
+const KineticHooks* KineticHooksRegistered = NULL;
+static __thread const KineticHooks* HooksThreadHooks = NULL;
+static __thread KineticHookInfo HooksThreadInfo;
+
+void KineticHooks_Set(const KineticHooks* hooks)
+{
+    __atomic_store_n(&KineticHooksRegistered, hooks, __ATOMIC_RELEASE);
+}
+
+void KineticHooks_BeginOperation(const KineticPDU* const request)
+{
+    assert(request != NULL);
+    HooksThreadHooks = __atomic_load_n(&KineticHooksRegistered, __ATOMIC_ACQUIRE);
+    if (HooksThreadHooks == NULL) {
+        return;
+    }
+
+    const KineticProto_Header* header = &request->protoData.message.header;
+    HooksThreadInfo = (KineticHookInfo) {
+        .connectionID = header->connectionID,
+        .sequence = header->sequence,
+        .messageType = header->has_messageType ? (int32_t)header->messageType : 0,
+        .keyLength = request->entry.key.bytesUsed,
+        .valueLength = (request->entry.value.array.data == NULL) ?
+            0 : request->entry.value.bytesUsed,
+        .responseValueLength = 0,
+        .status = KINETIC_STATUS_NOT_ATTEMPTED,
+    };
+    KineticHooks_Invoke(KINETIC_HOOK_EVENT_OPERATION_STARTED, KINETIC_STATUS_NOT_ATTEMPTED);
+}
+
+void KineticHooks_SetResponseValueLength(size_t length)
+{
+    HooksThreadInfo.responseValueLength = length;
+}
+
+void KineticHooks_Invoke(KineticHookEvent event, KineticStatus status)
+{
+    const KineticHooks* hooks = HooksThreadHooks;
+    if (hooks == NULL) {
+        // Hooks were registered after the operation in progress started
+        return;
+    }
+
+    KineticHookCallback callback = NULL;
+    switch (event) {
+    case KINETIC_HOOK_EVENT_OPERATION_STARTED:
+        callback = hooks->operationStarted; break;
+    case KINETIC_HOOK_EVENT_REQUEST_WRITTEN:
+        callback = hooks->requestWritten; break;
+    case KINETIC_HOOK_EVENT_RESPONSE_STARTED:
+        callback = hooks->responseStarted; break;
+    case KINETIC_HOOK_EVENT_OPERATION_COMPLETED:
+        callback = hooks->operationCompleted;
+        HooksThreadHooks = NULL;
+        break;
+    default:
+        LOGF_ERROR("Invalid hook event specified: %d", event);
+        return;
+    }
+
+    HooksThreadInfo.status = status;
+    if (callback != NULL) {
+        callback(&HooksThreadInfo, hooks->context);
+    }
+}
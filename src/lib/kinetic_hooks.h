@@ -0,0 +1,47 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#ifndef _KINETIC_HOOKS_H
+#define _KINETIC_HOOKS_H
+
+#include "kinetic_types_internal.h"
+
+typedef enum _KineticHookEvent {
+    KINETIC_HOOK_EVENT_OPERATION_STARTED = 0,
+    KINETIC_HOOK_EVENT_REQUEST_WRITTEN,
+    KINETIC_HOOK_EVENT_RESPONSE_STARTED,
+    KINETIC_HOOK_EVENT_OPERATION_COMPLETED,
+} KineticHookEvent;
+
+extern const KineticHooks* KineticHooksRegistered;
+
+// Hooks are only invoked if registered, otherwise the cost of each hook point
+// is a single branch on a global pointer
+#define KINETIC_HOOKS_ENABLED() \
+    (__atomic_load_n(&KineticHooksRegistered, __ATOMIC_RELAXED) != NULL)
+#define KINETIC_HOOK(event, status) do { \
+    if (KINETIC_HOOKS_ENABLED()) { KineticHooks_Invoke((event), (status)); } } while (0)
+
+void KineticHooks_Set(const KineticHooks* hooks);
+void KineticHooks_BeginOperation(const KineticPDU* const request);
+void KineticHooks_SetResponseValueLength(size_t length);
+void KineticHooks_Invoke(KineticHookEvent event, KineticStatus status);
+
+#endif // _KINETIC_HOOKS_H
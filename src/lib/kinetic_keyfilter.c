@@ -0,0 +1,449 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+
+#include "kinetic_keyfilter.h"
+#include "kinetic_connection.h"
+#include "kinetic_operation.h"
+#include "kinetic_allocator.h"
+#include "kinetic_pdu.h"
+#include "kinetic_logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#define KINETIC_KEYFILTER_INITIAL_PENDING (1024)
+
+struct _KineticKeyFilter {
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;                // Signals the background thread
+    pthread_cond_t progress;            // Signalled as each build completes
+    pthread_t thread;
+    KineticConnection connection;       // Used only by the background thread
+
+    // Filter in use (NULL until first built)
+    uint64_t* bits;
+    uint64_t bitCount;
+    uint32_t hashes;
+
+    // Hashes of the keys found by the build in progress, and of those PUT
+    // while it runs
+    uint64_t* pending;
+    size_t pendingCount;
+    size_t pendingCapacity;
+    bool building;
+
+    int rebuildSeconds;
+    bool stopping;
+    bool rebuildRequested;
+    uint64_t buildsCompleted;
+    KineticStatus lastStatus;
+    KineticKeyFilterStats stats;
+
+    uint8_t startKey[KINETIC_MAX_KEY_LEN]; // Last key of the previous scan
+    uint8_t endKey[KINETIC_MAX_KEY_LEN];   // Greatest possible key
+};
+
+// Sets the bits for a key hash, derived from two halves of the hash
+// (Kirsch and Mitzenmacher), with the mutex held
+static void KineticKeyFilter_SetBits(uint64_t* bits, uint64_t bitCount,
+                                     uint32_t hashes, uint64_t hash)
+{
+    uint64_t step = ((hash >> 32) | (hash << 32)) | 1;
+    for (uint32_t i = 0; i < hashes; i++) {
+        uint64_t bit = (hash + i * step) % bitCount;
+        bits[bit / 64] |= 1ull << (bit % 64);
+    }
+}
+
+static bool KineticKeyFilter_TestBits(const uint64_t* bits, uint64_t bitCount,
+                                      uint32_t hashes, uint64_t hash)
+{
+    uint64_t step = ((hash >> 32) | (hash << 32)) | 1;
+    for (uint32_t i = 0; i < hashes; i++) {
+        uint64_t bit = (hash + i * step) % bitCount;
+        if ((bits[bit / 64] & (1ull << (bit % 64))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Adds hashes to those of the build in progress, with the mutex held
+static bool KineticKeyFilter_AddPending(KineticKeyFilter* const filter,
+                                        const uint64_t* hashes, size_t count)
+{
+    if (filter->pendingCount + count > filter->pendingCapacity) {
+        size_t capacity = (filter->pendingCapacity > 0) ?
+                          filter->pendingCapacity : KINETIC_KEYFILTER_INITIAL_PENDING;
+        while (filter->pendingCount + count > capacity) {
+            capacity *= 2;
+        }
+        uint64_t* pending = realloc(filter->pending, capacity * sizeof(uint64_t));
+        if (pending == NULL) {
+            return false;
+        }
+        filter->pending = pending;
+        filter->pendingCapacity = capacity;
+    }
+    memcpy(&filter->pending[filter->pendingCount], hashes, count * sizeof(uint64_t));
+    filter->pendingCount += count;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Background thread
+
+// Scans the keyspace with GETKEYRANGE, adding the hashes of the keys to those
+// of the build in progress
+static KineticStatus KineticKeyFilter_Scan(KineticKeyFilter* const filter)
+{
+    KineticConnection* connection = &filter->connection;
+    KineticStatus status = KINETIC_STATUS_SUCCESS;
+    if (!connection->connected) {
+        status = KineticConnection_Connect(connection);
+        if (status != KINETIC_STATUS_SUCCESS) {
+            LOG_ERROR("Failed connecting key filter session!");
+            return status;
+        }
+    }
+
+    KineticKeyRange range = {
+        .startKey = ByteBuffer_Create(filter->startKey, sizeof(filter->startKey)),
+        .endKey = ByteBuffer_Create(filter->endKey, sizeof(filter->endKey)),
+        .startKeyInclusive = true,
+        .endKeyInclusive = true,
+        .maxReturned = KINETIC_KEYFILTER_SCAN_COUNT,
+    };
+    range.endKey.bytesUsed = sizeof(filter->endKey);
+    uint64_t hashes[KINETIC_KEYFILTER_SCAN_COUNT];
+    size_t count;
+    do {
+        KineticOperation operation = KineticOperation_Create(connection);
+        if (operation.request == NULL || operation.response == NULL) {
+            return KINETIC_STATUS_NO_PDUS_AVAVILABLE;
+        }
+        KineticOperation_BuildGetKeyRange(&operation, &range);
+        status = KineticPDU_Send(operation.request);
+        if (status == KINETIC_STATUS_SUCCESS) {
+            operation.response->connection = connection;
+            status = KineticPDU_Receive(operation.response);
+        }
+        if (status == KINETIC_STATUS_SUCCESS) {
+            status = KineticOperation_GetStatus(&operation);
+        }
+
+        count = 0;
+        KineticProto_Range* keys = KineticPDU_GetKeyRange(operation.response);
+        if (status == KINETIC_STATUS_SUCCESS && keys != NULL) {
+            count = (keys->n_key < KINETIC_KEYFILTER_SCAN_COUNT) ?
+                    keys->n_key : KINETIC_KEYFILTER_SCAN_COUNT;
+            for (size_t i = 0; i < count; i++) {
+                hashes[i] = Kinetic_HashKey(keys->key[i].data, keys->key[i].len);
+            }
+
+            // Continue after the last key returned
+            if (count > 0) {
+                ProtobufCBinaryData last = keys->key[count - 1];
+                if (last.len > sizeof(filter->startKey)) {
+                    status = KINETIC_STATUS_BUFFER_OVERRUN;
+                }
+                else {
+                    memcpy(filter->startKey, last.data, last.len);
+                    range.startKey.bytesUsed = last.len;
+                    range.startKeyInclusive = false;
+                }
+            }
+        }
+        KineticOperation_Free(&operation);
+        if (status != KINETIC_STATUS_SUCCESS) {
+            break;
+        }
+
+        pthread_mutex_lock(&filter->mutex);
+        if (filter->stopping) {
+            status = KINETIC_STATUS_NOT_ATTEMPTED;
+        }
+        else if (!KineticKeyFilter_AddPending(filter, hashes, count)) {
+            status = KINETIC_STATUS_MEMORY_ERROR;
+        }
+        pthread_mutex_unlock(&filter->mutex);
+    } while (status == KINETIC_STATUS_SUCCESS && count == KINETIC_KEYFILTER_SCAN_COUNT);
+
+    if (Kinetic_IsConnectionFailure(status)) {
+        // Reconnect for the next build, rather than read stale responses
+        KineticConnection_Disconnect(connection);
+    }
+    return status;
+}
+
+// Replaces the filter in use with one of the pending hashes, using the number
+// of hashes per key which minimizes false positives, with the mutex held
+static void KineticKeyFilter_Replace(KineticKeyFilter* const filter, uint64_t* bits)
+{
+    uint64_t keys = filter->pendingCount;
+    uint64_t hashes = (keys > 0) ? (filter->bitCount * 693 + keys * 500) / (keys * 1000) : 1;
+    if (hashes < 1) {
+        hashes = 1;
+    }
+    else if (hashes > KINETIC_KEYFILTER_HASHES_MAX) {
+        hashes = KINETIC_KEYFILTER_HASHES_MAX;
+    }
+    for (size_t i = 0; i < filter->pendingCount; i++) {
+        KineticKeyFilter_SetBits(bits, filter->bitCount, (uint32_t)hashes, filter->pending[i]);
+    }
+    free(filter->bits);
+    filter->bits = bits;
+    filter->hashes = (uint32_t)hashes;
+    filter->stats.keys = keys;
+}
+
+// Waits until the next build is due, with the mutex held. Returns false once stopped.
+static bool KineticKeyFilter_Wait(KineticKeyFilter* const filter)
+{
+    if (filter->rebuildSeconds <= 0) {
+        while (!filter->stopping && !filter->rebuildRequested) {
+            pthread_cond_wait(&filter->wake, &filter->mutex);
+        }
+        return !filter->stopping;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += filter->rebuildSeconds;
+    while (!filter->stopping && !filter->rebuildRequested) {
+        if (pthread_cond_timedwait(&filter->wake, &filter->mutex, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    return !filter->stopping;
+}
+
+static void* KineticKeyFilter_Run(void* arg)
+{
+    KineticKeyFilter* filter = arg;
+    pthread_mutex_lock(&filter->mutex);
+    do {
+        filter->rebuildRequested = false;
+        filter->building = true;
+        filter->pendingCount = 0;
+        pthread_mutex_unlock(&filter->mutex);
+
+        KineticStatus status = KineticKeyFilter_Scan(filter);
+        uint64_t* bits = NULL;
+        if (status == KINETIC_STATUS_SUCCESS) {
+            bits = calloc(filter->bitCount / 64, sizeof(uint64_t));
+            if (bits == NULL) {
+                status = KINETIC_STATUS_MEMORY_ERROR;
+            }
+        }
+
+        pthread_mutex_lock(&filter->mutex);
+        if (status == KINETIC_STATUS_SUCCESS) {
+            KineticKeyFilter_Replace(filter, bits);
+            filter->stats.rebuilds++;
+        }
+        else if (status != KINETIC_STATUS_NOT_ATTEMPTED) {
+            // Keep using the previous filter, which is still current for
+            // the keys PUT through this session
+            LOGF_ERROR("Failed building key filter (status: %s)",
+                       Kinetic_GetStatusDescription(status));
+            filter->stats.failures++;
+        }
+        filter->building = false;
+        filter->pendingCount = 0;
+        filter->lastStatus = status;
+        filter->buildsCompleted++;
+        pthread_cond_broadcast(&filter->progress);
+    } while (KineticKeyFilter_Wait(filter));
+    pthread_mutex_unlock(&filter->mutex);
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+// Session interface
+
+KineticStatus KineticKeyFilter_Create(const KineticSession* const session,
+                                      KineticKeyFilter** const filter)
+{
+    assert(session != NULL);
+    assert(filter != NULL);
+    *filter = NULL;
+
+    KineticKeyFilter* kf = calloc(1, sizeof(KineticKeyFilter));
+    if (kf == NULL) {
+        LOG_ERROR("Failed allocating key filter!");
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    kf->bitCount = (session->keyFilterBytes / sizeof(uint64_t)) * 64;
+    if (kf->bitCount == 0) {
+        kf->bitCount = 64;
+    }
+    kf->rebuildSeconds = session->keyFilterRebuildSeconds;
+    kf->lastStatus = KINETIC_STATUS_NOT_ATTEMPTED;
+    memset(kf->endKey, 0xFF, sizeof(kf->endKey));
+
+    // The keyspace is scanned through a session of its own, so that builds
+    // do not hold up the operations of the caller
+    KINETIC_CONNECTION_INIT(&kf->connection);
+    kf->connection.session = *session;
+    kf->connection.session.readCacheBytes = 0;
+    kf->connection.session.writeBackBytes = 0;
+    kf->connection.session.keyFilterBytes = 0;
+    KineticStatus status = KineticConnection_Connect(&kf->connection);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        LOG_ERROR("Failed connecting key filter session!");
+        free(kf);
+        return status;
+    }
+
+    pthread_mutex_init(&kf->mutex, NULL);
+    pthread_cond_init(&kf->wake, NULL);
+    pthread_cond_init(&kf->progress, NULL);
+    if (pthread_create(&kf->thread, NULL, KineticKeyFilter_Run, kf) != 0) {
+        LOG_ERROR("Failed starting key filter thread!");
+        KineticConnection_Disconnect(&kf->connection);
+        pthread_cond_destroy(&kf->progress);
+        pthread_cond_destroy(&kf->wake);
+        pthread_mutex_destroy(&kf->mutex);
+        free(kf);
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+
+    *filter = kf;
+    return KINETIC_STATUS_SUCCESS;
+}
+
+void KineticKeyFilter_Destroy(KineticKeyFilter* const filter)
+{
+    if (filter == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&filter->mutex);
+    filter->stopping = true;
+    pthread_cond_signal(&filter->wake);
+    pthread_mutex_unlock(&filter->mutex);
+    pthread_join(filter->thread, NULL);
+
+    if (filter->connection.connected) {
+        KineticConnection_Disconnect(&filter->connection);
+    }
+    KineticAllocator_FreeAllPDUs(&filter->connection.pdus);
+    free(filter->connection.stats);
+    pthread_cond_destroy(&filter->progress);
+    pthread_cond_destroy(&filter->wake);
+    pthread_mutex_destroy(&filter->mutex);
+    free(filter->pending);
+    free(filter->bits);
+    free(filter);
+}
+
+bool KineticKeyFilter_MayContain(KineticKeyFilter* const filter,
+                                 const ByteBuffer* const key)
+{
+    assert(filter != NULL);
+    assert(key != NULL);
+    uint64_t hash = Kinetic_HashKey(key->array.data, key->bytesUsed);
+    bool found = true;
+    pthread_mutex_lock(&filter->mutex);
+    if (filter->bits != NULL) {
+        filter->stats.lookups++;
+        found = KineticKeyFilter_TestBits(filter->bits, filter->bitCount, filter->hashes, hash);
+        if (!found) {
+            filter->stats.negatives++;
+        }
+    }
+    pthread_mutex_unlock(&filter->mutex);
+    return found;
+}
+
+void KineticKeyFilter_Add(KineticKeyFilter* const filter,
+                          const ByteBuffer* const key)
+{
+    assert(filter != NULL);
+    assert(key != NULL);
+    uint64_t hash = Kinetic_HashKey(key->array.data, key->bytesUsed);
+    pthread_mutex_lock(&filter->mutex);
+    if (filter->bits != NULL) {
+        KineticKeyFilter_SetBits(filter->bits, filter->bitCount, filter->hashes, hash);
+        filter->stats.keys++;
+    }
+    // The scan in progress may already have passed the key
+    if (filter->building && !KineticKeyFilter_AddPending(filter, &hash, 1)) {
+        LOG_ERROR("Failed adding key to the key filter being built!");
+    }
+    pthread_mutex_unlock(&filter->mutex);
+}
+
+void KineticKeyFilter_AddFalsePositive(KineticKeyFilter* const filter)
+{
+    assert(filter != NULL);
+    pthread_mutex_lock(&filter->mutex);
+    if (filter->bits != NULL) {
+        filter->stats.falsePositives++;
+    }
+    pthread_mutex_unlock(&filter->mutex);
+}
+
+KineticStatus KineticKeyFilter_Rebuild(KineticKeyFilter* const filter)
+{
+    assert(filter != NULL);
+    pthread_mutex_lock(&filter->mutex);
+
+    // A build already in progress may have passed keys since deleted
+    uint64_t target = filter->buildsCompleted + (filter->building ? 2 : 1);
+    filter->rebuildRequested = true;
+    pthread_cond_signal(&filter->wake);
+    while (filter->buildsCompleted < target) {
+        pthread_cond_wait(&filter->progress, &filter->mutex);
+    }
+    KineticStatus status = filter->lastStatus;
+    pthread_mutex_unlock(&filter->mutex);
+    return status;
+}
+
+void KineticKeyFilter_GetStats(KineticKeyFilter* const filter,
+                               KineticKeyFilterStats* const stats)
+{
+    assert(filter != NULL);
+    assert(stats != NULL);
+    pthread_mutex_lock(&filter->mutex);
+    *stats = filter->stats;
+    if (filter->bits != NULL) {
+        stats->bits = filter->bitCount;
+        stats->hashes = filter->hashes;
+
+        // A key not in the filter is a false positive if all its bits are set
+        uint64_t set = 0;
+        for (uint64_t i = 0; i < filter->bitCount / 64; i++) {
+            set += (uint64_t)__builtin_popcountll(filter->bits[i]);
+        }
+        double fill = (double)set / (double)filter->bitCount;
+        stats->expectedFalsePositiveRate = 1.0;
+        for (uint32_t i = 0; i < filter->hashes; i++) {
+            stats->expectedFalsePositiveRate *= fill;
+        }
+    }
+    uint64_t absent = stats->negatives + stats->falsePositives;
+    stats->falsePositiveRate = (absent > 0) ? (double)stats->falsePositives / (double)absent : 0.0;
+    pthread_mutex_unlock(&filter->mutex);
+}
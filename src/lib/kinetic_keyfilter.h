@@ -0,0 +1,57 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+
+#ifndef _KINETIC_KEYFILTER_H
+#define _KINETIC_KEYFILTER_H
+
+#include "kinetic_types_internal.h"
+
+#define KINETIC_KEYFILTER_SCAN_COUNT (200) // Keys requested by each GETKEYRANGE
+#define KINETIC_KEYFILTER_HASHES_MAX (16)
+
+// Bloom filter of the keys on the device of a session. A background thread
+// builds the filter by scanning the keyspace with GETKEYRANGE, through a
+// connection of its own, then rebuilds it every rebuildSeconds (if set) so
+// that keys deleted since are dropped. Keys PUT through the session are added
+// as they are written, including while a build is in progress.
+KineticStatus KineticKeyFilter_Create(const KineticSession* const session,
+                                      KineticKeyFilter** const filter);
+
+void KineticKeyFilter_Destroy(KineticKeyFilter* const filter);
+
+// Returns false if the key is certainly not on the device, or true if it may
+// be, which is always the case until the filter has first been built
+bool KineticKeyFilter_MayContain(KineticKeyFilter* const filter,
+                                 const ByteBuffer* const key);
+
+void KineticKeyFilter_Add(KineticKeyFilter* const filter,
+                          const ByteBuffer* const key);
+
+// Records that a key the filter may contain was not found on the device
+void KineticKeyFilter_AddFalsePositive(KineticKeyFilter* const filter);
+
+// Waits for the filter to be rebuilt, returning the status of the build
+KineticStatus KineticKeyFilter_Rebuild(KineticKeyFilter* const filter);
+
+void KineticKeyFilter_GetStats(KineticKeyFilter* const filter,
+                               KineticKeyFilterStats* const stats);
+
+#endif // _KINETIC_KEYFILTER_H
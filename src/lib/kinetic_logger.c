@@ -18,26 +18,257 @@
 *
 */
 
+// Filtering of dumps is applied by the caller's subsystem
+#define KINETIC_LOG_SUBSYSTEM KINETIC_LOG_SUBSYSTEM_ALL
+
 #include "kinetic_logger.h"
 // #include "zlog/zlog.h"
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+// Log messages are formatted by the calling thread directly into a slot of a
+// bounded, lock-free, multi-producer/single-consumer ring, and written out by
+// a single background writer thread which holds the log file open. If the
+// ring is full, the message is dropped and counted rather than blocking the
+// caller. The writer blocks on a condition variable while the ring is empty
+// and is signalled by the first producer to publish into it; it is only
+// running while logging is enabled and has somewhere to write. Until the
+// logger is initialized (or after it is closed), messages are written
+// synchronously to the console.
+//
+// Ring positions only ever increase, so a writer restarted by SetLevel picks
+// up where the last left off. Producers announce themselves in
+// LogProducers before checking that the writer is running, and stopping the
+// writer waits for those in flight to publish before its final drain.
+
+typedef struct _KineticLogSlot {
+    uint64_t sequence;
+    char message[KINETIC_LOGGER_MESSAGE_MAX];
+} KineticLogSlot;
 
 static char LogFile[256] = "";
 bool LogToConsole = true;
 int LogLevel = 0;
+uint32_t LogSubsystems = KINETIC_LOG_SUBSYSTEM_ALL;
 FILE* FileDesc = NULL;
+STATIC uint32_t LogProtobufSampleRate = 1;
+STATIC uint32_t LogProtobufSampleCount = 0;
+
+STATIC KineticLogSlot LogRing[KINETIC_LOGGER_RING_SLOTS];
+STATIC uint64_t LogEnqueuePosition = 0;
+STATIC uint64_t LogDequeuePosition = 0;
+STATIC uint64_t LogWrittenPosition = 0;
+STATIC uint64_t LogDropCount = 0;
+STATIC bool LogWriterRunning = false;
+STATIC bool LogWriterStopping = false;
+STATIC int LogProducers = 0;
+STATIC bool LogRingReady = false;
+STATIC pthread_t LogWriterThread;
+STATIC pthread_mutex_t LogUpdateMutex = PTHREAD_MUTEX_INITIALIZER;
+STATIC bool LogInitialized = false;
+STATIC pthread_mutex_t LogWriterMutex = PTHREAD_MUTEX_INITIALIZER;
+STATIC pthread_cond_t LogWriterWake = PTHREAD_COND_INITIALIZER;
+STATIC pthread_cond_t LogWriterProgress = PTHREAD_COND_INITIALIZER;
+STATIC bool LogWriterWaiting = false;
+STATIC int LogFlushWaiters = 0;
+
+static KineticLogSlot* KineticLogger_Reserve(void)
+{
+    uint64_t position = __atomic_load_n(&LogEnqueuePosition, __ATOMIC_RELAXED);
+    while (true) {
+        KineticLogSlot* slot = &LogRing[position % KINETIC_LOGGER_RING_SLOTS];
+        uint64_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t)(sequence - position);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&LogEnqueuePosition, &position, position + 1,
+                                            true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                return slot;
+            }
+        }
+        else if (diff < 0) {
+            // Ring is full; drop rather than block the caller
+            __atomic_add_fetch(&LogDropCount, 1, __ATOMIC_RELAXED);
+            return NULL;
+        }
+        else {
+            position = __atomic_load_n(&LogEnqueuePosition, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void KineticLogger_Publish(KineticLogSlot* slot)
+{
+    // Slot sequence encodes the ring position it was reserved for
+    uint64_t position = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->sequence, position + 1, __ATOMIC_SEQ_CST);
+
+    // Only wake the writer if it has gone idle on an empty ring; it sets the
+    // flag before its final check for messages, so one side always sees the other
+    if (__atomic_load_n(&LogWriterWaiting, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&LogWriterMutex);
+        pthread_cond_signal(&LogWriterWake);
+        pthread_mutex_unlock(&LogWriterMutex);
+    }
+}
+
+static bool KineticLogger_Pending(void)
+{
+    KineticLogSlot* slot = &LogRing[LogDequeuePosition % KINETIC_LOGGER_RING_SLOTS];
+    return __atomic_load_n(&slot->sequence, __ATOMIC_SEQ_CST) == LogDequeuePosition + 1;
+}
+
+static int KineticLogger_Drain(FILE* output)
+{
+    int count = 0;
+    while (true) {
+        KineticLogSlot* slot = &LogRing[LogDequeuePosition % KINETIC_LOGGER_RING_SLOTS];
+        uint64_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        if (sequence != LogDequeuePosition + 1) {
+            break; // empty, or next message still being formatted
+        }
+        fputs(slot->message, output);
+        fputc('\n', output);
+        __atomic_store_n(&slot->sequence,
+                         LogDequeuePosition + KINETIC_LOGGER_RING_SLOTS, __ATOMIC_RELEASE);
+        LogDequeuePosition++;
+        count++;
+    }
+    return count;
+}
+
+static void KineticLogger_ReportProgress(void)
+{
+    __atomic_store_n(&LogWrittenPosition, LogDequeuePosition, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&LogFlushWaiters, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&LogWriterMutex);
+        pthread_cond_broadcast(&LogWriterProgress);
+        pthread_mutex_unlock(&LogWriterMutex);
+    }
+}
+
+static void KineticLogger_WaitForMessages(void)
+{
+    pthread_mutex_lock(&LogWriterMutex);
+    __atomic_store_n(&LogWriterWaiting, true, __ATOMIC_SEQ_CST);
+    while (!__atomic_load_n(&LogWriterStopping, __ATOMIC_ACQUIRE) &&
+           !KineticLogger_Pending()) {
+        pthread_cond_wait(&LogWriterWake, &LogWriterMutex);
+    }
+    __atomic_store_n(&LogWriterWaiting, false, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&LogWriterMutex);
+}
+
+static void* KineticLogger_Writer(void* arg)
+{
+    (void)arg;
+    FILE* output = (FileDesc != NULL) ? FileDesc : stderr;
+    while (true) {
+        bool stopping = __atomic_load_n(&LogWriterStopping, __ATOMIC_ACQUIRE);
+        if (KineticLogger_Drain(output) > 0) {
+            fflush(output);
+            KineticLogger_ReportProgress();
+            continue;
+        }
+        KineticLogger_ReportProgress();
+        if (stopping) {
+            break;
+        }
+        KineticLogger_WaitForMessages();
+    }
+    return NULL;
+}
+
+// Stops the writer, with LogUpdateMutex held. New producers log
+// synchronously once it is no longer running, and those already reserving
+// or formatting a slot are waited for, so the final drain writes them too.
+static void KineticLogger_StopWriter(void)
+{
+    if (!__atomic_load_n(&LogWriterRunning, __ATOMIC_SEQ_CST)) {
+        return;
+    }
+    __atomic_store_n(&LogWriterRunning, false, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&LogProducers, __ATOMIC_SEQ_CST) > 0) {
+        sched_yield();
+    }
+    pthread_mutex_lock(&LogWriterMutex);
+    __atomic_store_n(&LogWriterStopping, true, __ATOMIC_RELEASE);
+    pthread_cond_signal(&LogWriterWake);
+    pthread_mutex_unlock(&LogWriterMutex);
+    pthread_join(LogWriterThread, NULL);
+}
+
+// Starts the writer, with LogUpdateMutex held. The ring is only initialized
+// the first time, as no producer can use it before then.
+static void KineticLogger_StartWriter(void)
+{
+    if (!LogRingReady) {
+        for (uint64_t i = 0; i < KINETIC_LOGGER_RING_SLOTS; i++) {
+            LogRing[i].sequence = i;
+        }
+        LogRingReady = true;
+    }
+    LogWriterWaiting = false;
+    LogWriterStopping = false;
+
+    if (pthread_create(&LogWriterThread, NULL, KineticLogger_Writer, NULL) != 0) {
+        fprintf(stderr, "Failed to start log writer thread; logging synchronously\n");
+        return;
+    }
+    __atomic_store_n(&LogWriterRunning, true, __ATOMIC_SEQ_CST);
+}
+
+// The writer is only needed while logging is enabled and has an output
+static void KineticLogger_UpdateWriter(void)
+{
+    pthread_mutex_lock(&LogUpdateMutex);
+    bool needed = LogInitialized && LogLevel > KINETIC_LOG_LEVEL_NONE &&
+                  (LogToConsole || FileDesc != NULL);
+    bool running = __atomic_load_n(&LogWriterRunning, __ATOMIC_SEQ_CST);
+    if (needed && !running) {
+        KineticLogger_StartWriter();
+    }
+    else if (!needed && running) {
+        KineticLogger_StopWriter();
+    }
+    pthread_mutex_unlock(&LogUpdateMutex);
+}
+
+// Registers a producer about to log through the ring, returning false if the
+// writer is not running, in which case it must log synchronously instead
+static bool KineticLogger_BeginProducing(void)
+{
+    __atomic_add_fetch(&LogProducers, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&LogWriterRunning, __ATOMIC_SEQ_CST)) {
+        return true;
+    }
+    __atomic_sub_fetch(&LogProducers, 1, __ATOMIC_SEQ_CST);
+    return false;
+}
+
+static void KineticLogger_EndProducing(void)
+{
+    __atomic_sub_fetch(&LogProducers, 1, __ATOMIC_SEQ_CST);
+}
 
 void KineticLogger_Init(const char* logFile)
 {
+    KineticLogger_Close();
+
     LogToConsole = true;
     FileDesc = NULL;
-    LogLevel = 0;
+    LogLevel = KINETIC_LOG_LEVEL_DEBUG;
+    LogSubsystems = KINETIC_LOG_SUBSYSTEM_ALL;
+    LogProtobufSampleRate = 1;
+    __atomic_store_n(&LogDropCount, 0, __ATOMIC_RELAXED);
+    LogInitialized = true;
 
     if (logFile != NULL) {
-        strcpy(LogFile, logFile);
+        strncpy(LogFile, logFile, sizeof(LogFile) - 1);
+        LogFile[sizeof(LogFile) - 1] = '\0';
         if (strcmp(logFile, "NONE") == 0) {
-            LogLevel = -1;
+            LogLevel = KINETIC_LOG_LEVEL_NONE;
             LogToConsole = false;
             return;
         }
@@ -53,15 +284,83 @@ void KineticLogger_Init(const char* logFile)
             }
         }
     }
+    else {
+        LogFile[0] = '\0';
+    }
+
+    KineticLogger_UpdateWriter();
 }
 
 void KineticLogger_Close(void)
 {
+    pthread_mutex_lock(&LogUpdateMutex);
+    KineticLogger_StopWriter();
+    LogInitialized = false;
+    pthread_mutex_unlock(&LogUpdateMutex);
+
     // Don't close std/already-opened streams
-    if (!LogToConsole && strlen(LogFile) > 0 &&
+    if (!LogToConsole && FileDesc != NULL &&
         FileDesc != stdout && FileDesc != stderr && FileDesc != stdin) {
         fclose(FileDesc);
     }
+    FileDesc = NULL;
+}
+
+void KineticLogger_Flush(void)
+{
+    if (!__atomic_load_n(&LogWriterRunning, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    uint64_t target = __atomic_load_n(&LogEnqueuePosition, __ATOMIC_ACQUIRE);
+    pthread_mutex_lock(&LogWriterMutex);
+    __atomic_add_fetch(&LogFlushWaiters, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&LogWrittenPosition, __ATOMIC_SEQ_CST) < target) {
+        pthread_cond_wait(&LogWriterProgress, &LogWriterMutex);
+    }
+    __atomic_sub_fetch(&LogFlushWaiters, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&LogWriterMutex);
+}
+
+uint64_t KineticLogger_GetDropCount(void)
+{
+    return __atomic_load_n(&LogDropCount, __ATOMIC_RELAXED);
+}
+
+void KineticLogger_SetLevel(KineticLogLevel level)
+{
+    LogLevel = level;
+    KineticLogger_UpdateWriter();
+}
+
+void KineticLogger_SetSubsystems(uint32_t subsystems)
+{
+    LogSubsystems = subsystems;
+}
+
+void KineticLogger_SetProtobufSampleRate(uint32_t rate)
+{
+    LogProtobufSampleRate = (rate > 0) ? rate : 1;
+}
+
+bool KineticLogger_SampleProtobuf(void)
+{
+    uint32_t rate = LogProtobufSampleRate;
+    if (rate <= 1) {
+        return true;
+    }
+    uint32_t count = __atomic_fetch_add(&LogProtobufSampleCount, 1, __ATOMIC_RELAXED);
+    return (count % rate) == 0;
+}
+
+static void KineticLogger_LogSynchronously(const char* message)
+{
+    if (LogToConsole) {
+        fprintf(stderr, "%s\n", message);
+        fflush(stderr);
+    }
+    else {
+        __atomic_add_fetch(&LogDropCount, 1, __ATOMIC_RELAXED);
+    }
 }
 
 void KineticLogger_Log(const char* message)
@@ -70,26 +369,43 @@ void KineticLogger_Log(const char* message)
         return;
     }
 
-    FileDesc = LogToConsole ? stderr : fopen(LogFile, "a");
-    if (FileDesc != NULL) {
-        fprintf(FileDesc, "%s\n", message);
-        fflush(FileDesc);
+    if (!KineticLogger_BeginProducing()) {
+        KineticLogger_LogSynchronously(message);
+        return;
+    }
+
+    KineticLogSlot* slot = KineticLogger_Reserve();
+    if (slot != NULL) {
+        strncpy(slot->message, message, KINETIC_LOGGER_MESSAGE_MAX - 1);
+        slot->message[KINETIC_LOGGER_MESSAGE_MAX - 1] = '\0';
+        KineticLogger_Publish(slot);
     }
+    KineticLogger_EndProducing();
 }
 
 int KineticLogger_LogPrintf(const char* format, ...)
 {
     int result = -1;
 
-    if (LogLevel >= 0) {
-        if (format != NULL) {
-            va_list arg_ptr;
-            char buffer[1024];
-            va_start(arg_ptr, format);
-            result = vsprintf(buffer, format, arg_ptr);
-            KineticLogger_Log(buffer);
-            va_end(arg_ptr);
+    if (LogLevel >= 0 && format != NULL) {
+        va_list arg_ptr;
+        va_start(arg_ptr, format);
+        if (KineticLogger_BeginProducing()) {
+            KineticLogSlot* slot = KineticLogger_Reserve();
+            if (slot != NULL) {
+                // Messages longer than the slot are truncated
+                result = vsnprintf(slot->message, KINETIC_LOGGER_MESSAGE_MAX,
+                                   format, arg_ptr);
+                KineticLogger_Publish(slot);
+            }
+            KineticLogger_EndProducing();
+        }
+        else {
+            char buffer[KINETIC_LOGGER_MESSAGE_MAX];
+            result = vsnprintf(buffer, sizeof(buffer), format, arg_ptr);
+            KineticLogger_LogSynchronously(buffer);
         }
+        va_end(arg_ptr);
     }
 
     return (result);
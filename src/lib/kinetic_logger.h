@@ -26,9 +26,31 @@
 #include <stdarg.h>
 
 #define KINETIC_LOG_FILE "kinetic.log"
+#define KINETIC_LOGGER_RING_SLOTS (1024)
+#define KINETIC_LOGGER_MESSAGE_MAX (512)
+
+// Messages below this level are compiled out entirely
+#ifndef KINETIC_LOG_LEVEL_MIN
+#define KINETIC_LOG_LEVEL_MIN KINETIC_LOG_LEVEL_DEBUG
+#endif
+
+// Subsystem logged by the including source file, which may define its own
+// subsystem prior to including any headers
+#ifndef KINETIC_LOG_SUBSYSTEM
+#define KINETIC_LOG_SUBSYSTEM KINETIC_LOG_SUBSYSTEM_CLIENT
+#endif
+
+extern int LogLevel;
+extern uint32_t LogSubsystems;
 
 void KineticLogger_Init(const char* logFile);
 void KineticLogger_Close(void);
+void KineticLogger_Flush(void);
+uint64_t KineticLogger_GetDropCount(void);
+void KineticLogger_SetLevel(KineticLogLevel level);
+void KineticLogger_SetSubsystems(uint32_t subsystems);
+void KineticLogger_SetProtobufSampleRate(uint32_t rate);
+bool KineticLogger_SampleProtobuf(void);
 void KineticLogger_Log(const char* message);
 int  KineticLogger_LogPrintf(const char* format, ...);
 void KineticLogger_LogHeader(const KineticPDUHeader* header);
@@ -37,8 +59,35 @@ void KineticLogger_LogStatus(KineticProto_Status* status);
 void KineticLogger_LogByteArray(const char* title, ByteArray bytes);
 void KineticLogger_LogByteBuffer(const char* title, ByteBuffer buffer);
 
-#define LOG(message) KineticLogger_Log(message)
-#define LOGF(message, ...) KineticLogger_LogPrintf(message, __VA_ARGS__)
-#define LOG_LOCATION KineticLogger_LogPrintf("@ %s:%s:%d", __func__, __FILE__, __LINE__)
+#define KINETIC_LOG_ENABLED(level, subsystem) \
+    ((level) >= KINETIC_LOG_LEVEL_MIN && \
+     LogLevel >= 0 && (level) >= LogLevel && \
+     (LogSubsystems & (subsystem)) != 0)
+
+// Arguments are only evaluated if the message passes the level filters
+#define LOG_AT(level, message) do { \
+    if (KINETIC_LOG_ENABLED(level, KINETIC_LOG_SUBSYSTEM)) { \
+        KineticLogger_Log(message); } } while (0)
+#define LOGF_AT(level, message, ...) do { \
+    if (KINETIC_LOG_ENABLED(level, KINETIC_LOG_SUBSYSTEM)) { \
+        KineticLogger_LogPrintf(message, __VA_ARGS__); } } while (0)
+
+#define LOG(message) LOG_AT(KINETIC_LOG_LEVEL_DEBUG, message)
+#define LOGF(message, ...) LOGF_AT(KINETIC_LOG_LEVEL_DEBUG, message, __VA_ARGS__)
+#define LOG_ERROR(message) LOG_AT(KINETIC_LOG_LEVEL_ERROR, message)
+#define LOGF_ERROR(message, ...) LOGF_AT(KINETIC_LOG_LEVEL_ERROR, message, __VA_ARGS__)
+#define LOG_LOCATION LOGF("@ %s:%s:%d", __func__, __FILE__, __LINE__)
+
+// Full protobuf dumps are additionally subject to 1-in-N sampling
+#define LOG_PROTOBUF(proto) do { \
+    if (KINETIC_LOG_ENABLED(KINETIC_LOG_LEVEL_DEBUG, KINETIC_LOG_SUBSYSTEM) && \
+        KineticLogger_SampleProtobuf()) { \
+        KineticLogger_LogProtobuf(proto); } } while (0)
+#define LOG_HEADER(header) do { \
+    if (KINETIC_LOG_ENABLED(KINETIC_LOG_LEVEL_DEBUG, KINETIC_LOG_SUBSYSTEM)) { \
+        KineticLogger_LogHeader(header); } } while (0)
+#define LOG_BYTE_ARRAY(title, bytes) do { \
+    if (KINETIC_LOG_ENABLED(KINETIC_LOG_LEVEL_DEBUG, KINETIC_LOG_SUBSYSTEM)) { \
+        KineticLogger_LogByteArray(title, bytes); } } while (0)
 
 #endif // _KINETIC_LOGGER_H
@@ -18,6 +18,8 @@
 
 */
 
+#define KINETIC_LOG_SUBSYSTEM KINETIC_LOG_SUBSYSTEM_PDU
+
 #include "kinetic_message.h"
 #include "kinetic_logger.h"
 
@@ -83,3 +85,92 @@ void KineticMessage_ConfigureKeyValue(KineticMessage* const message,
                 entry->synchronization);
     }
 }
+
+void KineticMessage_ConfigureKeyRange(KineticMessage* const message,
+                                      const KineticKeyRange* range)
+{
+    assert(message != NULL);
+    assert(range != NULL);
+
+    // Enable command body and range fields by pointing at
+    // pre-allocated elements in message
+    message->command.body = &message->body;
+    message->proto.command->body = &message->body;
+    message->command.body->range = &message->range;
+    message->proto.command->body->range = &message->range;
+
+    // Set range fields appropriately
+    CONFIG_FIELD_BYTE_BUFFER(startKey, message->range, range);
+    CONFIG_FIELD_BYTE_BUFFER(endKey,   message->range, range);
+
+    message->range.has_startKeyInclusive = true;
+    message->range.startKeyInclusive = range->startKeyInclusive;
+    message->range.has_endKeyInclusive = true;
+    message->range.endKeyInclusive = range->endKeyInclusive;
+    message->range.has_maxReturned = true;
+    message->range.maxReturned = range->maxReturned;
+    message->range.has_reverse = range->reverse;
+    if (message->range.has_reverse) {
+        message->range.reverse = range->reverse;
+    }
+}
+
+void KineticMessage_ConfigureGetLog(KineticMessage* const message,
+                                    KineticProto_GetLog_Type type)
+{
+    assert(message != NULL);
+
+    // Enable command body and getLog fields by pointing at
+    // pre-allocated elements in message
+    message->command.body = &message->body;
+    message->proto.command->body = &message->body;
+    message->command.body->getLog = &message->getLog;
+    message->proto.command->body->getLog = &message->getLog;
+
+    // Request the single log type
+    message->getLogType = type;
+    message->getLog.type = &message->getLogType;
+    message->getLog.n_type = 1;
+}
+
+void KineticMessage_ConfigureP2POperation(KineticMessage* const message,
+                                          const KineticP2PPeer* peer,
+                                          const KineticP2POperation* operations,
+                                          KineticProto_P2POperation_Operation** protoOperations,
+                                          size_t count)
+{
+    assert(message != NULL);
+    assert(peer != NULL);
+    assert(operations != NULL || count == 0);
+    assert(protoOperations != NULL || count == 0);
+
+    // Enable command body and p2pOperation fields by pointing at
+    // pre-allocated elements in message
+    message->command.body = &message->body;
+    message->proto.command->body = &message->body;
+    message->command.body->p2pOperation = &message->p2pOperation;
+    message->proto.command->body->p2pOperation = &message->p2pOperation;
+
+    message->p2pPeer.hostname = (char*)peer->host;
+    message->p2pPeer.has_port = true;
+    message->p2pPeer.port = peer->port;
+    message->p2pPeer.has_tls = true;
+    message->p2pPeer.tls = peer->tls;
+    message->p2pOperation.peer = &message->p2pPeer;
+
+    // The number of operations varies, so their elements are provided by
+    // the caller rather than pre-allocated in the message
+    for (size_t i = 0; i < count; i++) {
+        KineticProto_P2POperation_Operation* protoOperation = protoOperations[i];
+        KineticProto_p2_poperation_operation__init(protoOperation);
+        CONFIG_FIELD_BYTE_BUFFER(key,     *protoOperation, &operations[i]);
+        CONFIG_FIELD_BYTE_BUFFER(version, *protoOperation, &operations[i]);
+        CONFIG_FIELD_BYTE_BUFFER(newKey,  *protoOperation, &operations[i]);
+        protoOperation->has_force = operations[i].force;
+        if (protoOperation->has_force) {
+            protoOperation->force = true;
+        }
+    }
+    message->p2pOperation.operation = protoOperations;
+    message->p2pOperation.n_operation = count;
+}
@@ -27,5 +27,14 @@
 void KineticMessage_Init(KineticMessage* const message);
 void KineticMessage_ConfigureKeyValue(KineticMessage* const message,
                                       const KineticEntry* entry);
+void KineticMessage_ConfigureKeyRange(KineticMessage* const message,
+                                      const KineticKeyRange* range);
+void KineticMessage_ConfigureGetLog(KineticMessage* const message,
+                                    KineticProto_GetLog_Type type);
+void KineticMessage_ConfigureP2POperation(KineticMessage* const message,
+                                          const KineticP2PPeer* peer,
+                                          const KineticP2POperation* operations,
+                                          KineticProto_P2POperation_Operation** protoOperations,
+                                          size_t count);
 
 #endif // _KINETIC_MESSAGE_H
@@ -116,6 +116,18 @@ void KineticOperation_BuildNoop(KineticOperation* const operation)
     operation->response->entry.value = BYTE_BUFFER_NONE;
 }
 
+void KineticOperation_BuildFlush(KineticOperation* const operation)
+{
+    KineticOperation_ValidateOperation(operation);
+    KineticConnection_IncrementSequence(operation->connection);
+
+    operation->request->proto->command->header->messageType = KINETIC_PROTO_MESSAGE_TYPE_FLUSHALLDATA;
+    operation->request->proto->command->header->has_messageType = true;
+
+    operation->request->entry.value = BYTE_BUFFER_NONE;
+    operation->response->entry.value = BYTE_BUFFER_NONE;
+}
+
 void KineticOperation_BuildPut(KineticOperation* const operation,
                                KineticEntry* const entry)
 {
@@ -153,6 +165,26 @@ void KineticOperation_BuildGet(KineticOperation* const operation,
     }
 }
 
+void KineticOperation_BuildGetVersion(KineticOperation* const operation,
+                                      KineticEntry* const entry)
+{
+    KineticOperation_ValidateOperation(operation);
+    KineticConnection_IncrementSequence(operation->connection);
+
+    operation->request->proto->command->header->messageType = KINETIC_PROTO_MESSAGE_TYPE_GETVERSION;
+    operation->request->proto->command->header->has_messageType = true;
+
+    // Only the key is sent, and only the version returned
+    KineticEntry request = {.key = entry->key};
+    operation->request->entry = request;
+    operation->response->entry = request;
+
+    KineticMessage_ConfigureKeyValue(&operation->request->protoData.message, &request);
+
+    operation->request->entry.value = BYTE_BUFFER_NONE;
+    operation->response->entry.value = BYTE_BUFFER_NONE;
+}
+
 void KineticOperation_BuildDelete(KineticOperation* const operation,
                                   KineticEntry* const entry)
 {
@@ -169,3 +201,59 @@ void KineticOperation_BuildDelete(KineticOperation* const operation,
     operation->request->entry.value = BYTE_BUFFER_NONE;
     operation->response->entry.value = BYTE_BUFFER_NONE;
 }
+
+void KineticOperation_BuildGetKeyRange(KineticOperation* const operation,
+                                       KineticKeyRange* const range)
+{
+    KineticOperation_ValidateOperation(operation);
+    KineticConnection_IncrementSequence(operation->connection);
+
+    operation->request->proto->command->header->messageType = KINETIC_PROTO_MESSAGE_TYPE_GETKEYRANGE;
+    operation->request->proto->command->header->has_messageType = true;
+
+    // Keys are returned in the range of the response body, without a value
+    KineticEntry request = {.value = BYTE_BUFFER_NONE};
+    operation->request->entry = request;
+    operation->response->entry = request;
+
+    KineticMessage_ConfigureKeyRange(&operation->request->protoData.message, range);
+}
+
+void KineticOperation_BuildGetLog(KineticOperation* const operation,
+                                  KineticProto_GetLog_Type type)
+{
+    KineticOperation_ValidateOperation(operation);
+    KineticConnection_IncrementSequence(operation->connection);
+
+    operation->request->proto->command->header->messageType = KINETIC_PROTO_MESSAGE_TYPE_GETLOG;
+    operation->request->proto->command->header->has_messageType = true;
+
+    // The log is returned in the getLog of the response body
+    KineticEntry request = {.value = BYTE_BUFFER_NONE};
+    operation->request->entry = request;
+    operation->response->entry = request;
+
+    KineticMessage_ConfigureGetLog(&operation->request->protoData.message, type);
+}
+
+void KineticOperation_BuildP2POperation(KineticOperation* const operation,
+                                        const KineticP2PPeer* const peer,
+                                        const KineticP2POperation* const operations,
+                                        KineticProto_P2POperation_Operation** protoOperations,
+                                        size_t count)
+{
+    KineticOperation_ValidateOperation(operation);
+    KineticConnection_IncrementSequence(operation->connection);
+
+    operation->request->proto->command->header->messageType = KINETIC_PROTO_MESSAGE_TYPE_PEER2PEERPUSH;
+    operation->request->proto->command->header->has_messageType = true;
+
+    // Entries are copied between the devices, so neither PDU has a value,
+    // and the results are returned in the p2pOperation of the response body
+    KineticEntry request = {.value = BYTE_BUFFER_NONE};
+    operation->request->entry = request;
+    operation->response->entry = request;
+
+    KineticMessage_ConfigureP2POperation(&operation->request->protoData.message,
+                                         peer, operations, protoOperations, count);
+}
@@ -28,11 +28,23 @@ KineticStatus KineticOperation_Free(KineticOperation* const operation);
 KineticStatus KineticOperation_GetStatus(const KineticOperation* const operation);
 
 void KineticOperation_BuildNoop(KineticOperation* operation);
+void KineticOperation_BuildFlush(KineticOperation* const operation);
 void KineticOperation_BuildPut(KineticOperation* const operation,
                                KineticEntry* const entry);
 void KineticOperation_BuildGet(KineticOperation* const operation,
                                KineticEntry* const entry);
+void KineticOperation_BuildGetVersion(KineticOperation* const operation,
+                                      KineticEntry* const entry);
 void KineticOperation_BuildDelete(KineticOperation* const operation,
                                   KineticEntry* const entry);
+void KineticOperation_BuildGetKeyRange(KineticOperation* const operation,
+                                       KineticKeyRange* const range);
+void KineticOperation_BuildGetLog(KineticOperation* const operation,
+                                  KineticProto_GetLog_Type type);
+void KineticOperation_BuildP2POperation(KineticOperation* const operation,
+                                        const KineticP2PPeer* const peer,
+                                        const KineticP2POperation* const operations,
+                                        KineticProto_P2POperation_Operation** protoOperations,
+                                        size_t count);
 
 #endif // _KINETIC_OPERATION_H
@@ -18,13 +18,21 @@
 *
 */
 
+#define KINETIC_LOG_SUBSYSTEM KINETIC_LOG_SUBSYSTEM_PDU
+
 #include "kinetic_pdu.h"
 #include "kinetic_nbo.h"
 #include "kinetic_connection.h"
-#include "kinetic_socket.h"
+#include "kinetic_transport.h"
 #include "kinetic_hmac.h"
+#include "kinetic_decoder.h"
+#include "kinetic_trace.h"
+#include "kinetic_stats.h"
+#include "kinetic_hooks.h"
+#include "kinetic_probes.h"
 #include "kinetic_logger.h"
 #include "kinetic_proto.h"
+#include <stdlib.h>
 
 void KineticPDU_Init(KineticPDU* const pdu,
                      KineticConnection* const connection)
@@ -39,15 +47,17 @@ void KineticPDU_AttachEntry(KineticPDU* const pdu, KineticEntry* const entry)
     pdu->entry = *entry;
 }
 
-KineticStatus KineticPDU_Send(KineticPDU* request)
+static KineticStatus KineticPDU_SendPDU(KineticPDU* request)
 {
     assert(request != NULL);
     assert(request->connection != NULL);
-    LOGF("Receiving PDU via fd=%d", request->connection->socket);
+    LOGF("Sending PDU via %s transport (fd=%d)",
+         request->connection->transport->name, request->connection->socket);
 
     KineticStatus status = KINETIC_STATUS_INVALID;
 
     // Populate the HMAC for the protobuf
+    uint64_t stageStart = KINETIC_STATS_STAGE_BEGIN();
     KineticHMAC_Init(
         &request->hmac,
         KINETIC_PROTO_SECURITY_ACL_HMACALGORITHM_HmacSHA1);
@@ -55,14 +65,17 @@ KineticStatus KineticPDU_Send(KineticPDU* request)
         &request->hmac,
         &request->protoData.message.proto,
         request->connection->session.hmacKey);
+    KINETIC_STATS_STAGE_END(KINETIC_OPERATION_STAGE_HMAC, stageStart);
 
     // Configure PDU header length fields
+    stageStart = KINETIC_STATS_STAGE_BEGIN();
     request->header.versionPrefix = 'F';
     request->header.protobufLength =
         KineticProto__get_packed_size(&request->protoData.message.proto);
+    KINETIC_STATS_STAGE_END(KINETIC_OPERATION_STAGE_PACK, stageStart);
     request->header.valueLength =
         (request->entry.value.array.data == NULL) ? 0 : request->entry.value.bytesUsed;
-    KineticLogger_LogHeader(&request->header);
+    LOG_HEADER(&request->header);
 
     // Create NBO copy of header for sending
     request->headerNBO.versionPrefix = 'F';
@@ -71,53 +84,104 @@ KineticStatus KineticPDU_Send(KineticPDU* request)
     request->headerNBO.valueLength =
         KineticNBO_FromHostU32(request->header.valueLength);
 
-    // Pack and send the PDU header
-    ByteBuffer hdr = ByteBuffer_Create(&request->headerNBO, sizeof(KineticPDUHeader));
-    hdr.bytesUsed = hdr.array.len;
-    status = KineticSocket_Write(request->connection->socket, &hdr);
-    if (status != KINETIC_STATUS_SUCCESS) {
-        LOG("Failed to send PDU header!");
-        return status;
-    }
-
-    // Send the protobuf message
+    // Pack the protobuf message
     #ifdef KINETIC_LOG_PDU_OPERATIONS
     LOG("Sending PDU Protobuf:");
     #endif
-    KineticLogger_LogProtobuf(&request->protoData.message.proto);
-    status = KineticSocket_WriteProtobuf(
-                 request->connection->socket, request);
+    LOG_PROTOBUF(&request->protoData.message.proto);
+    uint8_t* packed = (uint8_t*)malloc(request->header.protobufLength);
+    if (packed == NULL) {
+        LOG_ERROR("Failed allocating memory for protocol buffer");
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    stageStart = KINETIC_STATS_STAGE_BEGIN();
+    size_t packedLen = KineticProto__pack(&request->protoData.message.proto, packed);
+    KINETIC_STATS_STAGE_END(KINETIC_OPERATION_STAGE_PACK, stageStart);
+    assert(packedLen == request->header.protobufLength);
+
+    // Kept until sent and traced, and released by KineticPDU_Send()
+    request->packedProtobuf = packed;
+
+    // Send the header, protobuf and value/payload (if specified) together
+    ByteBuffer hdr = ByteBuffer_Create(&request->headerNBO, sizeof(KineticPDUHeader));
+    hdr.bytesUsed = hdr.array.len;
+    ByteBuffer proto = ByteBuffer_Create(packed, packedLen);
+    proto.bytesUsed = packedLen;
+    ByteBuffer* buffers[] = {&hdr, &proto, &request->entry.value};
+    int count = (request->header.valueLength > 0) ? 3 : 2;
+
+    stageStart = KINETIC_STATS_STAGE_BEGIN();
+    status = KineticTransport_Writev(request->connection, buffers, count);
+    KINETIC_STATS_STAGE_END(KINETIC_OPERATION_STAGE_SEND, stageStart);
     if (status != KINETIC_STATUS_SUCCESS) {
-        LOG("Failed to send PDU protobuf message!");
+        LOG("Failed to send PDU!");
         return status;
     }
 
-    // Send the value/payload, if specified
-    ByteBuffer* value = &request->entry.value;
-    if ((value->array.data != NULL) && (value->array.len > 0) && (value->bytesUsed > 0)) {
-        status = KineticSocket_Write(request->connection->socket, value);
-        if (status != KINETIC_STATUS_SUCCESS) {
-            LOG("Failed to send PDU value payload!");
-            return status;
-        }
+    return KINETIC_STATUS_SUCCESS;
+}
+
+KineticStatus KineticPDU_Send(KineticPDU* request)
+{
+    KineticStatus status = KineticPDU_SendPDU(request);
+    KineticTrace_Record(KINETIC_TRACE_EVENT_REQUEST, request,
+                        &request->protoData.message.proto, status);
+    free(request->packedProtobuf);
+    request->packedProtobuf = NULL;
+    KINETIC_PROBE5(pdu_send,
+                   request->protoData.message.header.sequence,
+                   request->protoData.message.header.messageType,
+                   request->header.protobufLength,
+                   request->header.valueLength,
+                   status);
+    if (status == KINETIC_STATUS_SUCCESS) {
+        KINETIC_HOOK(KINETIC_HOOK_EVENT_REQUEST_WRITTEN, status);
     }
+    return status;
+}
 
+static KineticStatus KineticPDU_ValidateHMAC(KineticPDU* const response)
+{
+    // Validate the HMAC for the recevied protobuf message
+    uint64_t stageStart = KINETIC_STATS_STAGE_BEGIN();
+    bool valid = KineticHMAC_Validate(response->proto,
+                                      response->connection->session.hmacKey);
+    KINETIC_STATS_STAGE_END(KINETIC_OPERATION_STAGE_HMAC, stageStart);
+    if (!valid) {
+        LOG("Received PDU protobuf message has invalid HMAC!");
+        KineticMessage* msg = &response->protoData.message;
+        msg->proto.command = &msg->command;
+        msg->command.status = &msg->status;
+        msg->status.code = KINETIC_PROTO_STATUS_STATUS_CODE_DATA_ERROR;
+        return KINETIC_STATUS_DATA_ERROR;
+    }
+    else {
+        #ifdef KINETIC_LOG_PDU_OPERATIONS
+        LOG("Received protobuf HMAC validation succeeded");
+        #endif
+    }
     return KINETIC_STATUS_SUCCESS;
 }
 
-KineticStatus KineticPDU_Receive(KineticPDU* const response)
+// Reads a response off the connection: its header, protobuf and value
+// payload. With the decode stage enabled, the protobuf is only handed to it,
+// so that the caller can go on reading further responses of the connection
+// while it decodes, and KineticPDU_Complete() collects the result.
+KineticStatus KineticPDU_ReceiveFrame(KineticPDU* const response)
 {
     assert(response != NULL);
-    const int fd = response->connection->socket;
-    assert(fd >= 0);
-    LOGF("Receiving PDU via fd=%d", fd);
+    assert(response->connection->transport != NULL);
+    LOGF("Receiving PDU via %s transport (fd=%d)",
+         response->connection->transport->name, response->connection->socket);
 
     KineticStatus status;
 
-    // Receive the PDU header
+    // Receive the PDU header, which includes waiting for the device to respond
     ByteBuffer rawHeader =
         ByteBuffer_Create(&response->headerNBO, sizeof(KineticPDUHeader));
-    status = KineticSocket_Read(fd, &rawHeader, rawHeader.array.len);
+    uint64_t stageStart = KINETIC_STATS_STAGE_BEGIN();
+    status = KineticTransport_Read(response->connection, &rawHeader, rawHeader.array.len);
+    KINETIC_STATS_STAGE_END(KINETIC_OPERATION_STAGE_WAIT, stageStart);
     if (status != KINETIC_STATUS_SUCCESS) {
         LOG("Failed to receive PDU header!");
         return status;
@@ -132,36 +196,48 @@ KineticStatus KineticPDU_Receive(KineticPDU* const response)
              .protobufLength = KineticNBO_ToHostU32(headerNBO->protobufLength),
               .valueLength = KineticNBO_ToHostU32(headerNBO->valueLength),
         };
-        KineticLogger_LogHeader(&response->header);
+        LOG_HEADER(&response->header);
+        if (KINETIC_HOOKS_ENABLED()) {
+            KineticHooks_SetResponseValueLength(response->header.valueLength);
+            KineticHooks_Invoke(KINETIC_HOOK_EVENT_RESPONSE_STARTED, status);
+        }
     }
 
-    // Receive the protobuf message
-    status = KineticSocket_ReadProtobuf(fd, response);
-    if (status != KINETIC_STATUS_SUCCESS) {
-        LOG("Failed to receive PDU protobuf message!");
-        return status;
+    // Receive the protobuf message, decoding it on the decode stage if enabled
+    const bool deferDecode = KineticDecoder_IsEnabled();
+    if (deferDecode) {
+        stageStart = KINETIC_STATS_STAGE_BEGIN();
+        status = KineticTransport_ReadPackedProtobuf(response->connection, response);
+        KINETIC_STATS_STAGE_END(KINETIC_OPERATION_STAGE_RECEIVE, stageStart);
+        if (status != KINETIC_STATUS_SUCCESS) {
+            LOG("Failed to receive PDU protobuf message!");
+            return status;
+        }
+        status = KineticDecoder_Submit(response);
+        if (status != KINETIC_STATUS_SUCCESS) {
+            LOG("Failed to submit PDU protobuf message for decoding!");
+            return status;
+        }
+        response->decodePending = true;
     }
     else {
-        #ifdef KINETIC_LOG_PDU_OPERATIONS
-        LOG("Received PDU protobuf");
-        #endif
-        KineticLogger_LogProtobuf(response->proto);
-    }
+        // Reading and unpacking are timed separately
+        status = KineticTransport_ReadProtobuf(response->connection, response);
+        if (status != KINETIC_STATUS_SUCCESS) {
+            LOG("Failed to receive PDU protobuf message!");
+            return status;
+        }
+        else {
+            #ifdef KINETIC_LOG_PDU_OPERATIONS
+            LOG("Received PDU protobuf");
+            #endif
+            LOG_PROTOBUF(response->proto);
+        }
 
-    // Validate the HMAC for the recevied protobuf message
-    if (!KineticHMAC_Validate(response->proto,
-                              response->connection->session.hmacKey)) {
-        LOG("Received PDU protobuf message has invalid HMAC!");
-        KineticMessage* msg = &response->protoData.message;
-        msg->proto.command = &msg->command;
-        msg->command.status = &msg->status;
-        msg->status.code = KINETIC_PROTO_STATUS_STATUS_CODE_DATA_ERROR;
-        return KINETIC_STATUS_DATA_ERROR;
-    }
-    else {
-        #ifdef KINETIC_LOG_PDU_OPERATIONS
-        LOG("Received protobuf HMAC validation succeeded");
-        #endif
+        status = KineticPDU_ValidateHMAC(response);
+        if (status != KINETIC_STATUS_SUCCESS) {
+            return status;
+        }
     }
 
     // Receive the value payload, if specified
@@ -173,8 +249,10 @@ KineticStatus KineticPDU_Receive(KineticPDU* const response)
         #endif
 
         response->entry.value.bytesUsed = 0;
-        status = KineticSocket_Read(fd,
-                                    &response->entry.value, response->header.valueLength);
+        stageStart = KINETIC_STATS_STAGE_BEGIN();
+        status = KineticTransport_Read(response->connection,
+                                       &response->entry.value, response->header.valueLength);
+        KINETIC_STATS_STAGE_END(KINETIC_OPERATION_STAGE_RECEIVE, stageStart);
         if (status != KINETIC_STATUS_SUCCESS) {
             LOG("Failed to receive PDU value payload!");
             return status;
@@ -188,6 +266,27 @@ KineticStatus KineticPDU_Receive(KineticPDU* const response)
         // KineticLogger_LogByteBuffer("Value Buffer", response->entry.value);
     }
 
+    return KINETIC_STATUS_SUCCESS;
+}
+
+static KineticStatus KineticPDU_Collect(KineticPDU* const response, KineticStatus status)
+{
+    // Collect the decoded protobuf, even if the rest of the PDU failed to
+    // arrive, since the decode stage may still be using the response
+    if (response->decodePending) {
+        uint64_t stageStart = KINETIC_STATS_STAGE_BEGIN();
+        KineticStatus decodeStatus = KineticDecoder_Wait(response);
+        KINETIC_STATS_STAGE_END(KINETIC_OPERATION_STAGE_DECODE, stageStart);
+        response->decodePending = false;
+        if (status == KINETIC_STATUS_SUCCESS &&
+            (decodeStatus == KINETIC_STATUS_DATA_ERROR || response->proto == NULL)) {
+            status = decodeStatus;
+        }
+    }
+    if (status != KINETIC_STATUS_SUCCESS) {
+        return status;
+    }
+
     // Update connectionID to match value returned from device, if provided
     KineticProto_Command* cmd = response->proto->command;
     if ((cmd != NULL) && (cmd->header != NULL) && (cmd->header->has_connectionID)) {
@@ -197,6 +296,61 @@ KineticStatus KineticPDU_Receive(KineticPDU* const response)
     return KineticPDU_GetStatus(response);
 }
 
+// Completes a response read by KineticPDU_ReceiveFrame(), given the status of
+// reading it, and returns the status of the response
+KineticStatus KineticPDU_Complete(KineticPDU* const response, KineticStatus frameStatus)
+{
+    KineticStatus status = KineticPDU_Collect(response, frameStatus);
+    KineticTrace_Record(KINETIC_TRACE_EVENT_RESPONSE, response,
+                        response->proto, status);
+    free(response->packedProtobuf);
+    response->packedProtobuf = NULL;
+    const KineticProto_Header* header =
+        (response->proto != NULL && response->proto->command != NULL) ?
+        response->proto->command->header : NULL;
+    KINETIC_PROBE5(pdu_receive,
+                   (header != NULL) ? header->ackSequence : -1,
+                   (header != NULL) ? header->messageType : 0,
+                   response->header.protobufLength,
+                   response->header.valueLength,
+                   status);
+    return status;
+}
+
+KineticStatus KineticPDU_Receive(KineticPDU* const response)
+{
+    return KineticPDU_Complete(response, KineticPDU_ReceiveFrame(response));
+}
+
+KineticStatus KineticPDU_Decode(KineticPDU* const response)
+{
+    assert(response != NULL);
+    assert(response->connection != NULL);
+
+    if (response->packedProtobuf == NULL) {
+        LOG("No packed protobuf message available to decode!");
+        return KINETIC_STATUS_DATA_ERROR;
+    }
+
+    uint64_t stageStart = KINETIC_STATS_STAGE_BEGIN();
+    response->proto = KineticProto__unpack(
+        NULL, response->header.protobufLength, response->packedProtobuf);
+    KINETIC_STATS_STAGE_END(KINETIC_OPERATION_STAGE_DECODE, stageStart);
+    if (response->proto == NULL) {
+        response->protobufDynamicallyExtracted = false;
+        LOG("Error unpacking incoming Kinetic protobuf message!");
+        return KINETIC_STATUS_DATA_ERROR;
+    }
+    response->protobufDynamicallyExtracted = true;
+    LOG_PROTOBUF(response->proto);
+
+    KineticStatus status = KineticPDU_ValidateHMAC(response);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        return status;
+    }
+    return KineticPDU_GetStatus(response);
+}
+
 KineticStatus KineticPDU_GetStatus(KineticPDU* pdu)
 {
     KineticStatus status = KINETIC_STATUS_INVALID;
@@ -227,3 +381,45 @@ KineticProto_KeyValue* KineticPDU_GetKeyValue(KineticPDU* pdu)
     }
     return keyValue;
 }
+
+KineticProto_Range* KineticPDU_GetKeyRange(KineticPDU* pdu)
+{
+    KineticProto_Range* range = NULL;
+
+    if (pdu != NULL &&
+        pdu->proto != NULL &&
+        pdu->proto->command != NULL &&
+        pdu->proto->command->body != NULL) {
+
+        range = pdu->proto->command->body->range;
+    }
+    return range;
+}
+
+KineticProto_GetLog* KineticPDU_GetLog(KineticPDU* pdu)
+{
+    KineticProto_GetLog* getLog = NULL;
+
+    if (pdu != NULL &&
+        pdu->proto != NULL &&
+        pdu->proto->command != NULL &&
+        pdu->proto->command->body != NULL) {
+
+        getLog = pdu->proto->command->body->getLog;
+    }
+    return getLog;
+}
+
+KineticProto_P2POperation* KineticPDU_GetP2POperation(KineticPDU* pdu)
+{
+    KineticProto_P2POperation* p2pOperation = NULL;
+
+    if (pdu != NULL &&
+        pdu->proto != NULL &&
+        pdu->proto->command != NULL &&
+        pdu->proto->command->body != NULL) {
+
+        p2pOperation = pdu->proto->command->body->p2pOperation;
+    }
+    return p2pOperation;
+}
@@ -27,7 +27,13 @@ void KineticPDU_Init(KineticPDU* const pdu, KineticConnection* const connection)
 void KineticPDU_AttachEntry(KineticPDU* const pdu, KineticEntry* const entry);
 KineticStatus KineticPDU_Send(KineticPDU* request);
 KineticStatus KineticPDU_Receive(KineticPDU* response);
+KineticStatus KineticPDU_ReceiveFrame(KineticPDU* const response);
+KineticStatus KineticPDU_Complete(KineticPDU* const response, KineticStatus frameStatus);
+KineticStatus KineticPDU_Decode(KineticPDU* const response);
 KineticStatus KineticPDU_GetStatus(KineticPDU* pdu);
 KineticProto_KeyValue* KineticPDU_GetKeyValue(KineticPDU* pdu);
+KineticProto_Range* KineticPDU_GetKeyRange(KineticPDU* pdu);
+KineticProto_GetLog* KineticPDU_GetLog(KineticPDU* pdu);
+KineticProto_P2POperation* KineticPDU_GetP2POperation(KineticPDU* pdu);
 
 #endif // _KINETIC_PDU_H
@@ -0,0 +1,78 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#ifndef _KINETIC_PROBES_H
+#define _KINETIC_PROBES_H
+
+// USDT (SystemTap/DTrace style) static probes of the 'kinetic' provider, which
+// can be attached to with perf or bpftrace, e.g.
+//
+//   bpftrace -e 'usdt:./my_app:kinetic:pdu_send { @[arg1] = count(); }'
+//
+// Probes are only compiled in if KINETIC_USDT is defined (make USDT=1), which
+// requires <sys/sdt.h> (e.g. systemtap-sdt-dev). Each probe compiles to a
+// single nop, plus the argument setup, until a tracer attaches to it. Without
+// KINETIC_USDT, probes compile to nothing and their arguments are not evaluated.
+//
+// Probes and arguments:
+//   pdu_send       (sequence, messageType, protobufLength, valueLength, status)
+//   pdu_receive    (ackSequence, messageType, protobufLength, valueLength, status)
+//   socket_read    (fd, bytes, tls)
+//   socket_write   (fd, bytes, tls)
+//   hmac_compute   (sequence, messageType, bytes)
+//   hmac_validate  (ackSequence, messageType, bytes, valid)
+//   alloc_new      (item, bytes)
+//   alloc_free     (item)
+//   connect        (connectionID, fd, status)
+//   disconnect     (connectionID, fd, status)
+
+#ifdef KINETIC_USDT
+
+#include <sys/sdt.h>
+
+#define KINETIC_PROBE1(name, a) \
+    DTRACE_PROBE1(kinetic, name, a)
+#define KINETIC_PROBE2(name, a, b) \
+    DTRACE_PROBE2(kinetic, name, a, b)
+#define KINETIC_PROBE3(name, a, b, c) \
+    DTRACE_PROBE3(kinetic, name, a, b, c)
+#define KINETIC_PROBE4(name, a, b, c, d) \
+    DTRACE_PROBE4(kinetic, name, a, b, c, d)
+#define KINETIC_PROBE5(name, a, b, c, d, e) \
+    DTRACE_PROBE5(kinetic, name, a, b, c, d, e)
+
+#else
+
+// Disabled probes must not evaluate their arguments, which are only named
+// within sizeof so that variables used solely by probes are still 'used'
+#define KINETIC_PROBE1(name, a) \
+    do { (void)sizeof(a); } while (0)
+#define KINETIC_PROBE2(name, a, b) \
+    do { (void)sizeof(a); (void)sizeof(b); } while (0)
+#define KINETIC_PROBE3(name, a, b, c) \
+    do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); } while (0)
+#define KINETIC_PROBE4(name, a, b, c, d) \
+    do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); (void)sizeof(d); } while (0)
+#define KINETIC_PROBE5(name, a, b, c, d, e) \
+    do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); (void)sizeof(d); (void)sizeof(e); } while (0)
+
+#endif // KINETIC_USDT
+
+#endif // _KINETIC_PROBES_H
@@ -18,8 +18,12 @@
 *
 */
 
+#define KINETIC_LOG_SUBSYSTEM KINETIC_LOG_SUBSYSTEM_SOCKET
+
 #include "kinetic_socket.h"
 #include "kinetic_logger.h"
+#include "kinetic_stats.h"
+#include "kinetic_probes.h"
 #include "kinetic_types_internal.h"
 #include "kinetic_proto.h"
 #include "protobuf-c/protobuf-c.h"
@@ -38,6 +42,7 @@
 #include <fcntl.h>
 #include <sys/socket.h>
 #include <sys/select.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>
@@ -65,7 +70,7 @@ int KineticSocket_Connect(const char* host, int port, bool nonBlocking)
     // Open socket
     LOGF("Connecting to %s:%d", host, port);
     if (!socket99_open(&cfg, &result)) {
-        LOGF("Failed to open socket connection"
+        LOGF_ERROR("Failed to open socket connection"
              "with host: status %d, errno %d",
              result.status, result.saved_errno);
         return KINETIC_SOCKET_DESCRIPTOR_INVALID;
@@ -74,7 +79,7 @@ int KineticSocket_Connect(const char* host, int port, bool nonBlocking)
     // Configure the socket
     socket99_set_hints(&cfg, &hints);
     if (getaddrinfo(cfg.host, port_str, &hints, &ai_result) != 0) {
-        LOGF("Failed to get socket address info: errno %d", errno);
+        LOGF_ERROR("Failed to get socket address info: errno %d", errno);
         close(result.fd);
         return KINETIC_SOCKET_DESCRIPTOR_INVALID;
     }
@@ -94,7 +99,7 @@ int KineticSocket_Connect(const char* host, int port, bool nonBlocking)
         // Allow ENOTSOCK because it allows tests to use pipes instead of
         // real sockets
         if (setsockopt_result != 0 && setsockopt_result != ENOTSOCK) {
-            LOG("Failed to set SO_NOSIGPIPE on socket");
+            LOG_ERROR("Failed to set SO_NOSIGPIPE on socket");
             continue;
         }
 #endif
@@ -105,7 +110,7 @@ int KineticSocket_Connect(const char* host, int port, bool nonBlocking)
                                        SOL_SOCKET, SO_SNDBUF,
                                        &buffer_size, sizeof(buffer_size));
         if (setsockopt_result == -1) {
-            LOG("Error setting socket send buffer size");
+            LOG_ERROR("Error setting socket send buffer size");
             continue;
         }
 
@@ -115,7 +120,7 @@ int KineticSocket_Connect(const char* host, int port, bool nonBlocking)
                                        SOL_SOCKET, SO_RCVBUF,
                                        &buffer_size, sizeof(buffer_size));
         if (setsockopt_result == -1) {
-            LOG("Error setting socket receive buffer size");
+            LOG_ERROR("Error setting socket receive buffer size");
             continue;
         }
 
@@ -126,7 +131,7 @@ int KineticSocket_Connect(const char* host, int port, bool nonBlocking)
 
     if (ai == NULL || result.fd == KINETIC_SOCKET_DESCRIPTOR_INVALID) {
         // we went through all addresses without finding one we could bind to
-        LOGF("Could not connect to %s:%d", host, port);
+        LOGF_ERROR("Could not connect to %s:%d", host, port);
         return KINETIC_SOCKET_DESCRIPTOR_INVALID;
     }
     else {
@@ -146,7 +151,7 @@ void KineticSocket_Close(int socket)
             LOG("Socket closed successfully");
         }
         else {
-            LOGF("Error closing socket file descriptor!"
+            LOGF_ERROR("Error closing socket file descriptor!"
                  " (fd=%d, errno=%d, desc='%s')",
                  socket, errno, strerror(errno));
         }
@@ -179,22 +184,25 @@ KineticStatus KineticSocket_Read(int socket, ByteBuffer* dest, size_t len)
         FD_ZERO(&readSet);
         FD_SET(socket, &readSet);
         opStatus = select(socket + 1, &readSet, NULL, NULL, &timeout);
+        KineticStats_CountSyscall();
 
         if (opStatus < 0) { // Error occurred
-            LOGF("Failed waiting to read from socket!"
+            LOGF_ERROR("Failed waiting to read from socket!"
                  " status=%d, errno=%d, desc='%s'",
                  opStatus, errno, strerror(errno));
             return KINETIC_STATUS_SOCKET_ERROR;
         }
         else if (opStatus == 0) { // Timeout occurred
-            LOG("Timed out waiting for socket data to arrive!");
+            LOG_ERROR("Timed out waiting for socket data to arrive!");
             return KINETIC_STATUS_SOCKET_TIMEOUT;
         }
         else if (opStatus > 0) { // Data available to read
-            // The socket is ready for reading
+            // The socket is ready for reading, but only up to the end of
+            // this PDU, as responses to further requests may follow it
             opStatus = read(socket,
                             &dest->array.data[dest->bytesUsed],
-                            dest->array.len - dest->bytesUsed);
+                            bytesToReadIntoBuffer - dest->bytesUsed);
+            KineticStats_CountSyscall();
             // Retry if no data yet...
             if (opStatus == -1 &&
                 ((errno == EINTR) ||
@@ -204,13 +212,14 @@ KineticStatus KineticSocket_Read(int socket, ByteBuffer* dest, size_t len)
                 continue;
             }
             else if (opStatus <= 0) {
-                LOGF("Failed to read from socket!"
+                LOGF_ERROR("Failed to read from socket!"
                      " status=%d, errno=%d, desc='%s'",
                      opStatus, errno, strerror(errno));
                 return KINETIC_STATUS_SOCKET_ERROR;
             }
             else {
                 dest->bytesUsed += opStatus;
+                KineticStats_CountReceived(opStatus);
                 #ifdef KINETIC_LOG_SOCKET_OPERATIONS
                 LOGF("Received %d bytes (%zd of %zd)",
                      opStatus, dest->bytesUsed, len);
@@ -225,7 +234,7 @@ KineticStatus KineticSocket_Read(int socket, ByteBuffer* dest, size_t len)
 
         uint8_t* discardedBytes = malloc(len - dest->bytesUsed);
         if (discardedBytes == NULL) {
-            LOG("Failed allocating a socket read discard buffer!");
+            LOG_ERROR("Failed allocating a socket read discard buffer!");
             abortFlush = true;
             status = KINETIC_STATUS_MEMORY_ERROR;
         }
@@ -243,9 +252,10 @@ KineticStatus KineticSocket_Read(int socket, ByteBuffer* dest, size_t len)
             FD_ZERO(&readSet);
             FD_SET(socket, &readSet);
             opStatus = select(socket + 1, &readSet, NULL, NULL, &timeout);
+            KineticStats_CountSyscall();
 
             if (opStatus < 0) { // Error occurred
-                LOGF("Failure trying to flush read socket data!"
+                LOGF_ERROR("Failure trying to flush read socket data!"
                      " status=%d, errno=%d, desc='%s'",
                      status, errno, strerror(errno));
                 abortFlush = true;
@@ -253,7 +263,7 @@ KineticStatus KineticSocket_Read(int socket, ByteBuffer* dest, size_t len)
                 continue;
             }
             else if (opStatus == 0) { // Timeout occurred
-                LOG("Timed out waiting to flush socket data!");
+                LOG_ERROR("Timed out waiting to flush socket data!");
                 abortFlush = true;
                 status = KINETIC_STATUS_SOCKET_TIMEOUT;
                 continue;
@@ -261,6 +271,7 @@ KineticStatus KineticSocket_Read(int socket, ByteBuffer* dest, size_t len)
             else if (opStatus > 0) { // Data available to read
                 // The socket is ready for reading
                 opStatus = read(socket, discardedBytes, remainingLen);
+                KineticStats_CountSyscall();
                 // Retry if no data yet...
                 if (opStatus == -1 &&
                     ((errno == EINTR) ||
@@ -270,7 +281,7 @@ KineticStatus KineticSocket_Read(int socket, ByteBuffer* dest, size_t len)
                     continue;
                 }
                 else if (opStatus <= 0) {
-                    LOGF("Failed to read from socket while flushing!"
+                    LOGF_ERROR("Failed to read from socket while flushing!"
                          " status=%d, errno=%d, desc='%s'",
                          opStatus, errno, strerror(errno));
                     abortFlush = true;
@@ -278,6 +289,7 @@ KineticStatus KineticSocket_Read(int socket, ByteBuffer* dest, size_t len)
                 }
                 else {
                     dest->bytesUsed += opStatus;
+                    KineticStats_CountReceived(opStatus);
                     LOGF("Flushed %d bytes from socket read pipe (%zd of %zd)",
                          opStatus, dest->bytesUsed, len);
                 }
@@ -306,11 +318,42 @@ KineticStatus KineticSocket_Read(int socket, ByteBuffer* dest, size_t len)
     #ifdef KINETIC_LOG_SOCKET_OPERATIONS
     LOGF("Received %zd of %zd bytes requested", dest->bytesUsed, len);
     #endif
+    KINETIC_PROBE3(socket_read, socket, dest->bytesUsed, false);
 
     return KINETIC_STATUS_SUCCESS;
 }
 
 KineticStatus KineticSocket_ReadProtobuf(int socket, KineticPDU* pdu)
+{
+    uint64_t stageStart = KINETIC_STATS_STAGE_BEGIN();
+    KineticStatus status = KineticSocket_ReadPackedProtobuf(socket, pdu);
+    KINETIC_STATS_STAGE_END(KINETIC_OPERATION_STAGE_RECEIVE, stageStart);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        return status;
+    }
+
+    stageStart = KINETIC_STATS_STAGE_BEGIN();
+    pdu->proto = KineticProto__unpack(
+        NULL, pdu->header.protobufLength, pdu->packedProtobuf);
+    KINETIC_STATS_STAGE_END(KINETIC_OPERATION_STAGE_DECODE, stageStart);
+    free(pdu->packedProtobuf);
+    pdu->packedProtobuf = NULL;
+
+    if (pdu->proto == NULL) {
+        pdu->protobufDynamicallyExtracted = false;
+        LOG_ERROR("Error unpacking incoming Kinetic protobuf message!");
+        return KINETIC_STATUS_DATA_ERROR;
+    }
+    else {
+        pdu->protobufDynamicallyExtracted = true;
+        #ifdef KINETIC_LOG_SOCKET_OPERATIONS
+        LOG("Protobuf unpacked successfully!");
+        #endif
+        return KINETIC_STATUS_SUCCESS;
+    }
+}
+
+KineticStatus KineticSocket_ReadPackedProtobuf(int socket, KineticPDU* pdu)
 {
     size_t bytesToRead = pdu->header.protobufLength;
     #ifdef KINETIC_LOG_SOCKET_OPERATIONS
@@ -319,37 +362,41 @@ KineticStatus KineticSocket_ReadProtobuf(int socket, KineticPDU* pdu)
 
     uint8_t* packed = (uint8_t*)malloc(bytesToRead);
     if (packed == NULL) {
-        LOG("Failed allocating memory for protocol buffer");
+        LOG_ERROR("Failed allocating memory for protocol buffer");
         return KINETIC_STATUS_MEMORY_ERROR;
     }
 
     ByteBuffer recvBuffer = ByteBuffer_Create(packed, bytesToRead);
     KineticStatus status = KineticSocket_Read(socket, &recvBuffer, bytesToRead);
-
     if (status != KINETIC_STATUS_SUCCESS) {
         LOG("Protobuf read failed!");
         free(packed);
         return status;
     }
-    else {
-        pdu->proto = KineticProto__unpack(
-            NULL, recvBuffer.bytesUsed, recvBuffer.array.data);
-    }
 
-    free(packed);
+    // Ownership passes to the PDU; released once unpacked, or by the allocator
+    pdu->packedProtobuf = packed;
+    return KINETIC_STATUS_SUCCESS;
+}
 
-    if (pdu->proto == NULL) {
-        pdu->protobufDynamicallyExtracted = false;
-        LOG("Error unpacking incoming Kinetic protobuf message!");
-        return KINETIC_STATUS_DATA_ERROR;
-    }
-    else {
-        pdu->protobufDynamicallyExtracted = true;
-        #ifdef KINETIC_LOG_SOCKET_OPERATIONS
-        LOG("Protobuf unpacked successfully!");
-        #endif
-        return KINETIC_STATUS_SUCCESS;
+KineticStatus KineticSocket_Poll(int socket, int timeoutMs)
+{
+    fd_set readSet;
+    struct timeval timeout = {
+        .tv_sec = timeoutMs / 1000,
+        .tv_usec = (timeoutMs % 1000) * 1000,
+    };
+
+    FD_ZERO(&readSet);
+    FD_SET(socket, &readSet);
+    int status = select(socket + 1, &readSet, NULL, NULL, &timeout);
+    KineticStats_CountSyscall();
+    if (status < 0) {
+        LOGF_ERROR("Failed waiting to read from socket! errno=%d, desc='%s'",
+             errno, strerror(errno));
+        return KINETIC_STATUS_SOCKET_ERROR;
     }
+    return (status == 0) ? KINETIC_STATUS_SOCKET_TIMEOUT : KINETIC_STATUS_SUCCESS;
 }
 
 KineticStatus KineticSocket_Write(int socket, ByteBuffer* src)
@@ -359,7 +406,17 @@ KineticStatus KineticSocket_Write(int socket, ByteBuffer* src)
     #endif
     for (unsigned int bytesSent = 0; bytesSent < src->bytesUsed;) {
         int bytesRemaining = src->bytesUsed - bytesSent;
+#ifdef MSG_NOSIGNAL
+        // Where SO_NOSIGPIPE is not available, suppress the PIPE signal for
+        // each write instead, falling back to write() for pipes in tests
+        int status = send(socket, &src->array.data[bytesSent], bytesRemaining, MSG_NOSIGNAL);
+        if (status == -1 && errno == ENOTSOCK) {
+            status = write(socket, &src->array.data[bytesSent], bytesRemaining);
+        }
+#else
         int status = write(socket, &src->array.data[bytesSent], bytesRemaining);
+#endif
+        KineticStats_CountSyscall();
         if (status == -1 &&
             ((errno == EINTR) || (errno == EAGAIN) || (errno == EWOULDBLOCK))) {
             #ifdef KINETIC_LOG_SOCKET_OPERATIONS
@@ -368,11 +425,12 @@ KineticStatus KineticSocket_Write(int socket, ByteBuffer* src)
             continue;
         }
         else if (status <= 0) {
-            LOGF("Failed to write to socket! status=%d, errno=%d\n", status, errno);
+            LOGF_ERROR("Failed to write to socket! status=%d, errno=%d\n", status, errno);
             return KINETIC_STATUS_SOCKET_ERROR;
         }
         else {
             bytesSent += status;
+            KineticStats_CountSent(status);
             #ifdef KINETIC_LOG_SOCKET_OPERATIONS
             LOGF("Wrote %d bytes (%d of %zu sent)", status, bytesSent, src->bytesUsed);
             #endif
@@ -382,7 +440,67 @@ KineticStatus KineticSocket_Write(int socket, ByteBuffer* src)
     #ifdef KINETIC_LOG_SOCKET_OPERATIONS
     LOG("Socket write completed successfully");
     #endif
+    KINETIC_PROBE3(socket_write, socket, src->bytesUsed, false);
+
+    return KINETIC_STATUS_SUCCESS;
+}
+
+KineticStatus KineticSocket_Writev(int socket, ByteBuffer* buffers[], int count)
+{
+    assert(count <= KINETIC_SOCKET_WRITEV_MAX);
+    struct iovec iov[KINETIC_SOCKET_WRITEV_MAX];
+    int iovCount = 0;
+    size_t bytesRemaining = 0;
+    for (int i = 0; i < count; i++) {
+        if (buffers[i]->bytesUsed > 0) {
+            iov[iovCount].iov_base = buffers[i]->array.data;
+            iov[iovCount].iov_len = buffers[i]->bytesUsed;
+            bytesRemaining += buffers[i]->bytesUsed;
+            iovCount++;
+        }
+    }
+    #ifdef KINETIC_LOG_SOCKET_OPERATIONS
+    LOGF("Writing %zu bytes from %d buffers to socket...", bytesRemaining, iovCount);
+    #endif
+    const size_t bytesTotal = bytesRemaining;
+
+    struct iovec* next = iov;
+    while (bytesRemaining > 0) {
+#ifdef MSG_NOSIGNAL
+        // As for KineticSocket_Write, suppress the PIPE signal where possible
+        struct msghdr msg = {.msg_iov = next, .msg_iovlen = iovCount};
+        ssize_t status = sendmsg(socket, &msg, MSG_NOSIGNAL);
+        if (status == -1 && errno == ENOTSOCK) {
+            status = writev(socket, next, iovCount);
+        }
+#else
+        ssize_t status = writev(socket, next, iovCount);
+#endif
+        KineticStats_CountSyscall();
+        if (status == -1 &&
+            ((errno == EINTR) || (errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+            continue;
+        }
+        else if (status <= 0) {
+            LOGF_ERROR("Failed to write to socket! status=%zd, errno=%d\n", status, errno);
+            return KINETIC_STATUS_SOCKET_ERROR;
+        }
+        KineticStats_CountSent(status);
+        bytesRemaining -= status;
+
+        // Skip the buffers written, and any partially written buffer's bytes
+        while (iovCount > 0 && (size_t)status >= next->iov_len) {
+            status -= next->iov_len;
+            next++;
+            iovCount--;
+        }
+        if (iovCount > 0) {
+            next->iov_base = (uint8_t*)next->iov_base + status;
+            next->iov_len -= status;
+        }
+    }
 
+    KINETIC_PROBE3(socket_write, socket, bytesTotal, false);
     return KINETIC_STATUS_SUCCESS;
 }
 
@@ -396,16 +514,20 @@ KineticStatus KineticSocket_WriteProtobuf(int socket, KineticPDU* pdu)
     uint8_t* packed = (uint8_t*)malloc(pdu->header.protobufLength);
 
     if (packed == NULL) {
-        LOG("Failed allocating memory for protocol buffer");
+        LOG_ERROR("Failed allocating memory for protocol buffer");
         return KINETIC_STATUS_MEMORY_ERROR;
     }
+    uint64_t stageStart = KINETIC_STATS_STAGE_BEGIN();
     size_t len = KineticProto__pack(&pdu->protoData.message.proto, packed);
+    KINETIC_STATS_STAGE_END(KINETIC_OPERATION_STAGE_PACK, stageStart);
     assert(len == pdu->header.protobufLength);
 
     ByteBuffer buffer = ByteBuffer_Create(packed, len);
     buffer.bytesUsed = len;
 
+    stageStart = KINETIC_STATS_STAGE_BEGIN();
     KineticStatus status = KineticSocket_Write(socket, &buffer);
+    KINETIC_STATS_STAGE_END(KINETIC_OPERATION_STAGE_SEND, stageStart);
 
     free(packed);
     return status;
@@ -24,13 +24,18 @@
 #include "kinetic_types_internal.h"
 #include "kinetic_message.h"
 
+#define KINETIC_SOCKET_WRITEV_MAX (8)
+
 int KineticSocket_Connect(const char* host, int port, bool nonBlocking);
 void KineticSocket_Close(int socket);
 
 KineticStatus KineticSocket_Read(int socket, ByteBuffer* dest, size_t len);
 KineticStatus KineticSocket_ReadProtobuf(int socket, KineticPDU* pdu);
+KineticStatus KineticSocket_ReadPackedProtobuf(int socket, KineticPDU* pdu);
+KineticStatus KineticSocket_Poll(int socket, int timeoutMs);
 
 KineticStatus KineticSocket_Write(int socket, ByteBuffer* src);
 KineticStatus KineticSocket_WriteProtobuf(int socket, KineticPDU* pdu);
+KineticStatus KineticSocket_Writev(int socket, ByteBuffer* buffers[], int count);
 
 #endif // _KINETIC_SOCKET_H
@@ -0,0 +1,383 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#include "kinetic_stats.h"
+#include "kinetic_logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Process-wide statistics are sharded so that each thread updates its own
+// copy of the counters and histograms, which are only summed when they are
+// collected. Threads are assigned shards round-robin, so if there are more
+// threads than shards, a shard is shared, which is why updates are still
+// (relaxed) atomic. Bytes and syscalls counted by the socket layer are also
+// accumulated per thread, so the ones incurred by an operation can be
+// attributed to its session once it completes. Likewise, stage timings are
+// accumulated into the operation in progress on the calling thread, since
+// operations are executed synchronously by the thread which started them.
+
+typedef struct _KineticStatsOperation {
+    uint64_t start;
+    uint64_t bytesSent;
+    uint64_t bytesReceived;
+    uint64_t syscalls;
+    bool timed;     // Timing was enabled when the operation began
+    KineticOperationTiming timing;
+} KineticStatsOperation;
+
+#define KINETIC_STATS_SUB_BUCKET_BITS (3)
+#define KINETIC_STATS_SUB_BUCKETS (1u << KINETIC_STATS_SUB_BUCKET_BITS)
+
+// KineticStats is accessed as a flat array of counters when summing and resetting
+#define KINETIC_STATS_COUNTERS (sizeof(KineticStats) / sizeof(uint64_t))
+
+STATIC KineticStats* StatsShards[KINETIC_STATS_SHARDS];
+STATIC uint32_t StatsNextShard = 0;
+static __thread KineticStats* StatsThreadShard = NULL;
+static __thread uint64_t StatsThreadBytesSent = 0;
+static __thread uint64_t StatsThreadBytesReceived = 0;
+static __thread uint64_t StatsThreadSyscalls = 0;
+static __thread KineticStatsOperation StatsThreadOperation;
+static __thread bool StatsThreadOperationActive = false;
+static __thread KineticOperationTiming StatsThreadLastTiming;
+static __thread bool StatsThreadLastTimed = false;
+bool KineticStatsTimingEnabled = false;
+
+uint64_t KineticStats_Now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static KineticStats* KineticStats_Allocate(KineticStats** const stats)
+{
+    KineticStats* existing = __atomic_load_n(stats, __ATOMIC_ACQUIRE);
+    if (existing != NULL) {
+        return existing;
+    }
+    KineticStats* allocated = calloc(1, sizeof(KineticStats));
+    if (allocated == NULL) {
+        LOG_ERROR("Failed allocating memory for statistics!");
+        return NULL;
+    }
+    if (!__atomic_compare_exchange_n(stats, &existing, allocated,
+                                     false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        free(allocated);
+        return existing;
+    }
+    return allocated;
+}
+
+static KineticStats* KineticStats_ThreadShard(void)
+{
+    if (StatsThreadShard == NULL) {
+        uint32_t shard = __atomic_fetch_add(&StatsNextShard, 1, __ATOMIC_RELAXED);
+        StatsThreadShard = KineticStats_Allocate(&StatsShards[shard % KINETIC_STATS_SHARDS]);
+    }
+    return StatsThreadShard;
+}
+
+static inline void KineticStats_Add(uint64_t* const counter, uint64_t value)
+{
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+void KineticStats_CountSent(size_t bytes)
+{
+    StatsThreadBytesSent += bytes;
+    KineticStats* shard = KineticStats_ThreadShard();
+    if (shard != NULL) {
+        KineticStats_Add(&shard->bytesSent, bytes);
+    }
+}
+
+void KineticStats_CountReceived(size_t bytes)
+{
+    StatsThreadBytesReceived += bytes;
+    KineticStats* shard = KineticStats_ThreadShard();
+    if (shard != NULL) {
+        KineticStats_Add(&shard->bytesReceived, bytes);
+    }
+}
+
+void KineticStats_CountSyscall(void)
+{
+    StatsThreadSyscalls++;
+    KineticStats* shard = KineticStats_ThreadShard();
+    if (shard != NULL) {
+        KineticStats_Add(&shard->syscalls, 1);
+    }
+}
+
+size_t KineticStats_BucketIndex(uint64_t nanoseconds)
+{
+    if (nanoseconds < KINETIC_STATS_SUB_BUCKETS) {
+        return (size_t)nanoseconds;
+    }
+    int msb = 63 - __builtin_clzll(nanoseconds);
+    int shift = msb - KINETIC_STATS_SUB_BUCKET_BITS;
+    size_t index = (size_t)(shift + 1) * KINETIC_STATS_SUB_BUCKETS
+                   + (size_t)((nanoseconds >> shift) & (KINETIC_STATS_SUB_BUCKETS - 1));
+    return (index < KINETIC_STATS_LATENCY_BUCKETS) ? index : (KINETIC_STATS_LATENCY_BUCKETS - 1);
+}
+
+uint64_t KineticStats_BucketUpperBound(size_t index)
+{
+    if (index < KINETIC_STATS_SUB_BUCKETS) {
+        return (uint64_t)index;
+    }
+    if (index >= KINETIC_STATS_LATENCY_BUCKETS - 1) {
+        return UINT64_MAX;
+    }
+    int shift = (int)(index / KINETIC_STATS_SUB_BUCKETS) - 1;
+    uint64_t subBucket = index % KINETIC_STATS_SUB_BUCKETS;
+    uint64_t lower = (KINETIC_STATS_SUB_BUCKETS + subBucket) << shift;
+    return lower + (1ull << shift) - 1;
+}
+
+uint64_t KineticStats_Percentile(const KineticLatencyHistogram* const histogram,
+                                 double percentile)
+{
+    assert(histogram != NULL);
+    if (histogram->count == 0) {
+        return 0;
+    }
+    if (percentile < 0.0) {
+        percentile = 0.0;
+    }
+    if (percentile > 100.0) {
+        percentile = 100.0;
+    }
+    uint64_t target = (uint64_t)((percentile / 100.0) * (double)histogram->count + 0.5);
+    if (target == 0) {
+        target = 1;
+    }
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < KINETIC_STATS_LATENCY_BUCKETS; i++) {
+        cumulative += histogram->buckets[i];
+        if (cumulative >= target) {
+            return KineticStats_BucketUpperBound(i);
+        }
+    }
+    return KineticStats_BucketUpperBound(KINETIC_STATS_LATENCY_BUCKETS - 1);
+}
+
+static void KineticStats_Record(KineticStats* const stats,
+                                KineticProto_MessageType messageType,
+                                KineticStatus status,
+                                uint64_t latency)
+{
+    KineticStats_Add(&stats->operations, 1);
+    if (status >= 0 && status < KINETIC_STATUS_COUNT) {
+        KineticStats_Add(&stats->statusCounts[status], 1);
+    }
+    else {
+        KineticStats_Add(&stats->invalidStatusCount, 1);
+    }
+
+    // Unknown message types are recorded with the invalid type (0)
+    size_t type = (messageType > 0 && messageType < KINETIC_STATS_MESSAGE_TYPES) ?
+                  (size_t)messageType : 0;
+    KineticLatencyHistogram* histogram = &stats->latency[type];
+    KineticStats_Add(&histogram->count, 1);
+    KineticStats_Add(&histogram->totalNanoseconds, latency);
+    KineticStats_Add(&histogram->buckets[KineticStats_BucketIndex(latency)], 1);
+}
+
+void KineticStats_SetTimingEnabled(bool enabled)
+{
+    KineticStatsTimingEnabled = enabled;
+}
+
+void KineticStats_EndStage(KineticOperationStage stage, uint64_t start)
+{
+    KineticStatsOperation* op = &StatsThreadOperation;
+    if (StatsThreadOperationActive && op->timed && stage < KINETIC_OPERATION_STAGE_COUNT) {
+        op->timing.stageNanoseconds[stage] += KineticStats_Now() - start;
+    }
+}
+
+void KineticStats_EndBuildStage(void)
+{
+    KineticStats_EndStage(KINETIC_OPERATION_STAGE_BUILD, StatsThreadOperation.start);
+}
+
+bool KineticStats_GetLastOperationTiming(KineticOperationTiming* const timing)
+{
+    assert(timing != NULL);
+    if (!StatsThreadLastTimed) {
+        return false;
+    }
+    *timing = StatsThreadLastTiming;
+    return true;
+}
+
+static void KineticStats_RecordTiming(KineticStats* const stats,
+                                      const KineticOperationTiming* const timing)
+{
+    for (int stage = 0; stage < KINETIC_OPERATION_STAGE_COUNT; stage++) {
+        uint64_t elapsed = timing->stageNanoseconds[stage];
+        KineticLatencyHistogram* histogram = &stats->stages[stage];
+        KineticStats_Add(&histogram->count, 1);
+        KineticStats_Add(&histogram->totalNanoseconds, elapsed);
+        KineticStats_Add(&histogram->buckets[KineticStats_BucketIndex(elapsed)], 1);
+    }
+}
+
+void KineticStats_BeginOperation(void)
+{
+    KineticStatsOperation* op = &StatsThreadOperation;
+    op->timed = KineticStatsTimingEnabled;
+    if (op->timed) {
+        memset(&op->timing, 0, sizeof(op->timing));
+    }
+    op->bytesSent = StatsThreadBytesSent;
+    op->bytesReceived = StatsThreadBytesReceived;
+    op->syscalls = StatsThreadSyscalls;
+    op->start = KineticStats_Now();
+    StatsThreadOperationActive = true;
+}
+
+// Ends the operation in progress on the thread without recording it, as it
+// completed without a request (e.g. served from a cache of the session)
+void KineticStats_AbandonOperation(void)
+{
+    StatsThreadOperationActive = false;
+}
+
+void KineticStats_EndOperation(KineticConnection* const connection,
+                               KineticProto_MessageType messageType,
+                               KineticStatus status)
+{
+    if (!StatsThreadOperationActive) {
+        return;
+    }
+    StatsThreadOperationActive = false;
+    KineticStatsOperation* op = &StatsThreadOperation;
+    uint64_t latency = KineticStats_Now() - op->start;
+    StatsThreadLastTimed = op->timed;
+    if (op->timed) {
+        op->timing.totalNanoseconds = latency;
+        StatsThreadLastTiming = op->timing;
+    }
+
+    KineticStats* shard = KineticStats_ThreadShard();
+    if (shard != NULL) {
+        KineticStats_Record(shard, messageType, status, latency);
+        if (op->timed) {
+            KineticStats_RecordTiming(shard, &op->timing);
+        }
+    }
+
+    if (connection != NULL) {
+        KineticStats* stats = KineticStats_Allocate(&connection->stats);
+        if (stats != NULL) {
+            KineticStats_Record(stats, messageType, status, latency);
+            if (op->timed) {
+                KineticStats_RecordTiming(stats, &op->timing);
+            }
+            KineticStats_Add(&stats->bytesSent, StatsThreadBytesSent - op->bytesSent);
+            KineticStats_Add(&stats->bytesReceived,
+                             StatsThreadBytesReceived - op->bytesReceived);
+            KineticStats_Add(&stats->syscalls, StatsThreadSyscalls - op->syscalls);
+        }
+    }
+}
+
+// Records an operation whose request was pipelined with others, so was not
+// the operation in progress on the thread, with the latency and bytes its
+// caller measured. The bytes were already counted process-wide as they were
+// sent and received, and stage timings are not kept.
+void KineticStats_RecordOperation(KineticConnection* const connection,
+                                  KineticProto_MessageType messageType,
+                                  KineticStatus status, uint64_t latency,
+                                  uint64_t bytesSent, uint64_t bytesReceived)
+{
+    KineticStats* shard = KineticStats_ThreadShard();
+    if (shard != NULL) {
+        KineticStats_Record(shard, messageType, status, latency);
+    }
+    if (connection != NULL) {
+        KineticStats* stats = KineticStats_Allocate(&connection->stats);
+        if (stats != NULL) {
+            KineticStats_Record(stats, messageType, status, latency);
+            KineticStats_Add(&stats->bytesSent, bytesSent);
+            KineticStats_Add(&stats->bytesReceived, bytesReceived);
+        }
+    }
+}
+
+static void KineticStats_Accumulate(KineticStats* const dest, KineticStats* const src)
+{
+    uint64_t* to = (uint64_t*)dest;
+    uint64_t* from = (uint64_t*)src;
+    for (size_t i = 0; i < KINETIC_STATS_COUNTERS; i++) {
+        to[i] += __atomic_load_n(&from[i], __ATOMIC_RELAXED);
+    }
+}
+
+static void KineticStats_Clear(KineticStats* const stats)
+{
+    uint64_t* counters = (uint64_t*)stats;
+    for (size_t i = 0; i < KINETIC_STATS_COUNTERS; i++) {
+        __atomic_store_n(&counters[i], 0, __ATOMIC_RELAXED);
+    }
+}
+
+void KineticStats_Get(const KineticConnection* const connection, KineticStats* const stats)
+{
+    assert(stats != NULL);
+    memset(stats, 0, sizeof(KineticStats));
+
+    if (connection != NULL) {
+        KineticStats* sessionStats = __atomic_load_n(&connection->stats, __ATOMIC_ACQUIRE);
+        if (sessionStats != NULL) {
+            KineticStats_Accumulate(stats, sessionStats);
+        }
+        return;
+    }
+
+    for (int i = 0; i < KINETIC_STATS_SHARDS; i++) {
+        KineticStats* shard = __atomic_load_n(&StatsShards[i], __ATOMIC_ACQUIRE);
+        if (shard != NULL) {
+            KineticStats_Accumulate(stats, shard);
+        }
+    }
+}
+
+void KineticStats_Reset(KineticConnection* const connection)
+{
+    if (connection != NULL) {
+        KineticStats* sessionStats = __atomic_load_n(&connection->stats, __ATOMIC_ACQUIRE);
+        if (sessionStats != NULL) {
+            KineticStats_Clear(sessionStats);
+        }
+        return;
+    }
+
+    for (int i = 0; i < KINETIC_STATS_SHARDS; i++) {
+        KineticStats* shard = __atomic_load_n(&StatsShards[i], __ATOMIC_ACQUIRE);
+        if (shard != NULL) {
+            KineticStats_Clear(shard);
+        }
+    }
+}
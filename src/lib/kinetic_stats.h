@@ -0,0 +1,62 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#ifndef _KINETIC_STATS_H
+#define _KINETIC_STATS_H
+
+#include "kinetic_types_internal.h"
+#include "kinetic_proto.h"
+
+#define KINETIC_STATS_SHARDS (8)
+
+extern bool KineticStatsTimingEnabled;
+
+// Stage timestamps are only taken if timing is enabled, otherwise the cost of
+// instrumentation is a single branch on a global flag
+#define KINETIC_STATS_STAGE_BEGIN() \
+    (KineticStatsTimingEnabled ? KineticStats_Now() : 0)
+#define KINETIC_STATS_STAGE_END(stage, start) do { \
+    if ((start) != 0) { KineticStats_EndStage((stage), (start)); } } while (0)
+
+uint64_t KineticStats_Now(void);
+void KineticStats_CountSent(size_t bytes);
+void KineticStats_CountReceived(size_t bytes);
+void KineticStats_CountSyscall(void);
+void KineticStats_BeginOperation(void);
+void KineticStats_AbandonOperation(void);
+void KineticStats_EndOperation(KineticConnection* const connection,
+                               KineticProto_MessageType messageType,
+                               KineticStatus status);
+void KineticStats_RecordOperation(KineticConnection* const connection,
+                                  KineticProto_MessageType messageType,
+                                  KineticStatus status, uint64_t latency,
+                                  uint64_t bytesSent, uint64_t bytesReceived);
+void KineticStats_EndStage(KineticOperationStage stage, uint64_t start);
+void KineticStats_EndBuildStage(void);
+void KineticStats_SetTimingEnabled(bool enabled);
+bool KineticStats_GetLastOperationTiming(KineticOperationTiming* const timing);
+void KineticStats_Get(const KineticConnection* const connection, KineticStats* const stats);
+void KineticStats_Reset(KineticConnection* const connection);
+size_t KineticStats_BucketIndex(uint64_t nanoseconds);
+uint64_t KineticStats_BucketUpperBound(size_t index);
+uint64_t KineticStats_Percentile(const KineticLatencyHistogram* const histogram,
+                                 double percentile);
+
+#endif // _KINETIC_STATS_H
@@ -0,0 +1,427 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#define KINETIC_LOG_SUBSYSTEM KINETIC_LOG_SUBSYSTEM_SOCKET
+
+#include "kinetic_tls.h"
+#include "kinetic_socket.h"
+#include "kinetic_logger.h"
+#include "kinetic_stats.h"
+#include "kinetic_probes.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/select.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+// Kinetic devices are provisioned with self-signed certificates, so the peer
+// certificate is only verified if the session names a CA file, which may pin
+// the device's own certificate. Each CA file has a context of its own, so
+// that sessions are only resumed with the verification they were made with.
+// Every message is still authenticated by its HMAC; TLS provides
+// confidentiality of keys and values on the wire.
+
+typedef struct _KineticTLSCachedSession {
+    char host[HOST_NAME_MAX];
+    int port;
+    SSL_CTX* context;
+    SSL_SESSION* session;
+} KineticTLSCachedSession;
+
+typedef struct _KineticTLSVerifyingContext {
+    char caFile[PATH_MAX];
+    SSL_CTX* context;
+} KineticTLSVerifyingContext;
+
+STATIC SSL_CTX* TLSContext = NULL;
+STATIC pthread_once_t TLSContextOnce = PTHREAD_ONCE_INIT;
+STATIC pthread_mutex_t TLSContextMutex = PTHREAD_MUTEX_INITIALIZER;
+STATIC KineticTLSVerifyingContext TLSVerifyingContexts[KINETIC_TLS_VERIFYING_CONTEXTS_MAX];
+STATIC pthread_mutex_t TLSSessionCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+STATIC KineticTLSCachedSession TLSSessionCache[KINETIC_TLS_SESSION_CACHE_MAX];
+STATIC int TLSSessionCacheNext = 0;
+
+static KineticTLSCachedSession* KineticTLS_FindCachedSession(SSL_CTX* context,
+                                                             const char* host, int port)
+{
+    // Must be called with TLSSessionCacheMutex held
+    for (int i = 0; i < KINETIC_TLS_SESSION_CACHE_MAX; i++) {
+        KineticTLSCachedSession* entry = &TLSSessionCache[i];
+        if (entry->session != NULL && entry->context == context && entry->port == port &&
+            strncmp(entry->host, host, sizeof(entry->host)) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static int KineticTLS_StoreSession(SSL* ssl, SSL_SESSION* session)
+{
+    // Invoked by OpenSSL for each new session/ticket issued by the device,
+    // which for TLS 1.3 arrives after the handshake has completed.
+    KineticConnection* connection = (KineticConnection*)SSL_get_app_data(ssl);
+    if (connection == NULL) {
+        return 0;
+    }
+
+    SSL_CTX* context = SSL_get_SSL_CTX(ssl);
+    pthread_mutex_lock(&TLSSessionCacheMutex);
+    KineticTLSCachedSession* entry = KineticTLS_FindCachedSession(
+        context, connection->session.host, connection->session.port);
+    if (entry == NULL) {
+        entry = &TLSSessionCache[TLSSessionCacheNext];
+        TLSSessionCacheNext = (TLSSessionCacheNext + 1) % KINETIC_TLS_SESSION_CACHE_MAX;
+    }
+    if (entry->session != NULL) {
+        SSL_SESSION_free(entry->session);
+    }
+    strncpy(entry->host, connection->session.host, sizeof(entry->host) - 1);
+    entry->host[sizeof(entry->host) - 1] = '\0';
+    entry->port = connection->session.port;
+    entry->context = context;
+    entry->session = session;
+    pthread_mutex_unlock(&TLSSessionCacheMutex);
+
+    return 1; // the cache now owns the reference to the session
+}
+
+// Creates a context verifying devices against the certificates in caFile,
+// or not verifying them if NULL
+static SSL_CTX* KineticTLS_NewContext(const char* caFile)
+{
+    SSL_CTX* context = SSL_CTX_new(SSLv23_client_method());
+    if (context == NULL) {
+        LOG_ERROR("Failed creating TLS context!");
+        return NULL;
+    }
+    SSL_CTX_set_options(context, SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3);
+    SSL_CTX_set_mode(context, SSL_MODE_ENABLE_PARTIAL_WRITE);
+    if (caFile == NULL) {
+        SSL_CTX_set_verify(context, SSL_VERIFY_NONE, NULL);
+    }
+    else {
+        if (SSL_CTX_load_verify_locations(context, caFile, NULL) != 1) {
+            LOGF_ERROR("Failed loading TLS CA certificates from '%s': %s",
+                       caFile, ERR_error_string(ERR_get_error(), NULL));
+            ERR_clear_error();
+            SSL_CTX_free(context);
+            return NULL;
+        }
+        SSL_CTX_set_verify(context, SSL_VERIFY_PEER, NULL);
+        // Trust a pinned device certificate, which signs no other
+        X509_VERIFY_PARAM_set_flags(SSL_CTX_get0_param(context), X509_V_FLAG_PARTIAL_CHAIN);
+    }
+
+    // Cache sessions ourselves, keyed by host:port, in order to resume them
+    // on subsequent connections to the same device
+    SSL_CTX_set_session_cache_mode(context,
+        SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(context, KineticTLS_StoreSession);
+
+#ifdef SSL_OP_ENABLE_KTLS
+    // Offload record encryption to the kernel, where supported
+    SSL_CTX_set_options(context, SSL_OP_ENABLE_KTLS);
+#endif
+    return context;
+}
+
+static void KineticTLS_CreateContext(void)
+{
+    SSL_library_init();
+    SSL_load_error_strings();
+    TLSContext = KineticTLS_NewContext(NULL);
+}
+
+// Returns the context of the CA file of a session, creating it if needed
+static SSL_CTX* KineticTLS_GetContext(const char* caFile)
+{
+    pthread_once(&TLSContextOnce, KineticTLS_CreateContext);
+    if (caFile == NULL) {
+        return TLSContext;
+    }
+
+    pthread_mutex_lock(&TLSContextMutex);
+    SSL_CTX* context = NULL;
+    KineticTLSVerifyingContext* unused = NULL;
+    for (int i = 0; i < KINETIC_TLS_VERIFYING_CONTEXTS_MAX && context == NULL; i++) {
+        KineticTLSVerifyingContext* entry = &TLSVerifyingContexts[i];
+        if (entry->context == NULL) {
+            if (unused == NULL) {
+                unused = entry;
+            }
+        }
+        else if (strncmp(entry->caFile, caFile, sizeof(entry->caFile)) == 0) {
+            context = entry->context;
+        }
+    }
+    if (context == NULL) {
+        if (unused == NULL || strlen(caFile) >= sizeof(unused->caFile)) {
+            LOGF_ERROR("Too many TLS CA files in use, or path too long: '%s'", caFile);
+        }
+        else if ((context = KineticTLS_NewContext(caFile)) != NULL) {
+            snprintf(unused->caFile, sizeof(unused->caFile), "%s", caFile);
+            unused->context = context;
+        }
+    }
+    pthread_mutex_unlock(&TLSContextMutex);
+    return context;
+}
+
+static KineticStatus KineticTLS_WaitForSocket(SSL* ssl, int sslError)
+{
+    const int fd = SSL_get_fd(ssl);
+    fd_set fdSet;
+    struct timeval timeout;
+
+    // Time out after 5 seconds
+    timeout.tv_sec = 5;
+    timeout.tv_usec = 0;
+
+    FD_ZERO(&fdSet);
+    FD_SET(fd, &fdSet);
+    int status = select(fd + 1,
+                        (sslError == SSL_ERROR_WANT_WRITE) ? NULL : &fdSet,
+                        (sslError == SSL_ERROR_WANT_WRITE) ? &fdSet : NULL,
+                        NULL, &timeout);
+    KineticStats_CountSyscall();
+    if (status < 0) {
+        if (errno == EINTR) {
+            return KINETIC_STATUS_SUCCESS;
+        }
+        LOGF_ERROR("Failed waiting on TLS socket! errno=%d, desc='%s'",
+             errno, strerror(errno));
+        return KINETIC_STATUS_SOCKET_ERROR;
+    }
+    else if (status == 0) {
+        LOG_ERROR("Timed out waiting on TLS socket!");
+        return KINETIC_STATUS_SOCKET_TIMEOUT;
+    }
+    return KINETIC_STATUS_SUCCESS;
+}
+
+static KineticStatus KineticTLS_HandleError(SSL* ssl, int result, const char* op)
+{
+    int sslError = SSL_get_error(ssl, result);
+    if (sslError == SSL_ERROR_WANT_READ || sslError == SSL_ERROR_WANT_WRITE) {
+        return KineticTLS_WaitForSocket(ssl, sslError);
+    }
+    LOGF_ERROR("TLS %s failed! ssl_error=%d, errno=%d, desc='%s'",
+         op, sslError, errno, ERR_error_string(ERR_get_error(), NULL));
+    ERR_clear_error();
+    return KINETIC_STATUS_SOCKET_ERROR;
+}
+
+KineticStatus KineticTLS_Connect(KineticConnection* const connection)
+{
+    assert(connection != NULL);
+    assert(connection->socket >= 0);
+
+    SSL_CTX* context = KineticTLS_GetContext(connection->session.tlsCAFile);
+    if (context == NULL) {
+        return KINETIC_STATUS_CONNECTION_ERROR;
+    }
+
+    SSL* ssl = SSL_new(context);
+    if (ssl == NULL) {
+        LOG_ERROR("Failed creating TLS connection!");
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    SSL_set_app_data(ssl, connection);
+    SSL_set_fd(ssl, connection->socket);
+    SSL_set_tlsext_host_name(ssl, connection->session.host);
+    if (connection->session.tlsCAFile != NULL &&
+        SSL_set1_host(ssl, connection->session.host) != 1) {
+        LOG_ERROR("Failed setting the TLS host name to verify!");
+        SSL_free(ssl);
+        return KINETIC_STATUS_CONNECTION_ERROR;
+    }
+
+    // Attempt to resume a prior session with this device
+    pthread_mutex_lock(&TLSSessionCacheMutex);
+    KineticTLSCachedSession* cached = KineticTLS_FindCachedSession(
+        context, connection->session.host, connection->session.port);
+    if (cached != NULL) {
+        SSL_set_session(ssl, cached->session);
+    }
+    pthread_mutex_unlock(&TLSSessionCacheMutex);
+
+    LOGF("Establishing TLS session with %s:%d (fd=%d)",
+         connection->session.host, connection->session.port, connection->socket);
+    while (true) {
+        int result = SSL_connect(ssl);
+        if (result == 1) {
+            break;
+        }
+        KineticStatus status = KineticTLS_HandleError(ssl, result, "handshake");
+        if (status != KINETIC_STATUS_SUCCESS) {
+            long verifyResult = SSL_get_verify_result(ssl);
+            if (verifyResult != X509_V_OK) {
+                LOGF_ERROR("TLS device certificate verification failed: %s",
+                           X509_verify_cert_error_string(verifyResult));
+            }
+            SSL_free(ssl);
+            return KINETIC_STATUS_CONNECTION_ERROR;
+        }
+    }
+
+    connection->tls = ssl;
+    LOGF("TLS session established (%s, %s, resumed=%s, ktls=%s)",
+         SSL_get_version(ssl), SSL_get_cipher(ssl),
+         KineticTLS_SessionReused(connection) ? "yes" : "no",
+         KineticTLS_KernelOffloadEnabled(connection) ? "yes" : "no");
+
+    return KINETIC_STATUS_SUCCESS;
+}
+
+void KineticTLS_Close(KineticConnection* const connection)
+{
+    assert(connection != NULL);
+    if (connection->tls == NULL) {
+        return;
+    }
+    // Best-effort close_notify; don't wait for the device to respond
+    SSL_shutdown(connection->tls);
+    SSL_free(connection->tls);
+    connection->tls = NULL;
+}
+
+bool KineticTLS_SessionReused(const KineticConnection* const connection)
+{
+    assert(connection != NULL);
+    return (connection->tls != NULL) && (SSL_session_reused(connection->tls) != 0);
+}
+
+bool KineticTLS_KernelOffloadEnabled(const KineticConnection* const connection)
+{
+    assert(connection != NULL);
+    if (connection->tls == NULL) {
+        return false;
+    }
+#if defined(BIO_get_ktls_send) && !defined(OPENSSL_NO_KTLS)
+    return BIO_get_ktls_send(SSL_get_wbio(connection->tls)) != 0;
+#else
+    return false;
+#endif
+}
+
+KineticStatus KineticTLS_Read(KineticConnection* const connection, ByteBuffer* dest, size_t len)
+{
+    assert(connection != NULL);
+    assert(connection->tls != NULL);
+    assert(dest != NULL);
+    SSL* ssl = connection->tls;
+    #ifdef KINETIC_LOG_SOCKET_OPERATIONS
+    LOGF("Reading %zd bytes into buffer @ 0x%zX via TLS",
+         len, (size_t)dest->array.data);
+    #endif
+
+    // Read "up to" the allocated number of bytes into dest buffer, and
+    // discard the remainder in case of a truncated read w/short dest buffer
+    size_t bytesToReadIntoBuffer = (dest->array.len < len) ? dest->array.len : len;
+    size_t bytesRead = dest->bytesUsed;
+    uint8_t discard[1024];
+    while (bytesRead < len) {
+        if (SSL_pending(ssl) == 0) {
+            KineticStatus status = KineticTLS_WaitForSocket(ssl, SSL_ERROR_WANT_READ);
+            if (status != KINETIC_STATUS_SUCCESS) {
+                return status;
+            }
+        }
+
+        int result;
+        if (bytesRead < bytesToReadIntoBuffer) {
+            result = SSL_read(ssl, &dest->array.data[bytesRead],
+                              bytesToReadIntoBuffer - bytesRead);
+        }
+        else {
+            size_t remaining = len - bytesRead;
+            result = SSL_read(ssl, discard,
+                              (remaining < sizeof(discard)) ? remaining : sizeof(discard));
+        }
+
+        KineticStats_CountSyscall();
+
+        if (result > 0) {
+            bytesRead += result;
+            KineticStats_CountReceived(result);
+            if (bytesRead <= bytesToReadIntoBuffer) {
+                dest->bytesUsed = bytesRead;
+            }
+            continue;
+        }
+        KineticStatus status = KineticTLS_HandleError(ssl, result, "read");
+        if (status != KINETIC_STATUS_SUCCESS) {
+            return status;
+        }
+    }
+
+    if (bytesToReadIntoBuffer < len) {
+        LOGF("TLS read buffer was truncated due to buffer overrun!"
+             " received=%zu, copied=%zu", len, dest->array.len);
+        return KINETIC_STATUS_BUFFER_OVERRUN;
+    }
+    KINETIC_PROBE3(socket_read, SSL_get_fd(ssl), dest->bytesUsed, true);
+
+    return KINETIC_STATUS_SUCCESS;
+}
+
+KineticStatus KineticTLS_Poll(KineticConnection* const connection, int timeoutMs)
+{
+    assert(connection != NULL);
+    assert(connection->tls != NULL);
+    if (SSL_pending(connection->tls) > 0) {
+        return KINETIC_STATUS_SUCCESS;
+    }
+    return KineticSocket_Poll(connection->socket, timeoutMs);
+}
+
+KineticStatus KineticTLS_Write(KineticConnection* const connection, ByteBuffer* src)
+{
+    assert(connection != NULL);
+    assert(connection->tls != NULL);
+    assert(src != NULL);
+    #ifdef KINETIC_LOG_SOCKET_OPERATIONS
+    LOGF("Writing %zu bytes via TLS...", src->bytesUsed);
+    #endif
+
+    for (size_t bytesSent = 0; bytesSent < src->bytesUsed;) {
+        int result = SSL_write(connection->tls, &src->array.data[bytesSent],
+                               src->bytesUsed - bytesSent);
+        KineticStats_CountSyscall();
+        if (result > 0) {
+            bytesSent += result;
+            KineticStats_CountSent(result);
+            continue;
+        }
+        KineticStatus status = KineticTLS_HandleError(connection->tls, result, "write");
+        if (status != KINETIC_STATUS_SUCCESS) {
+            return status;
+        }
+    }
+    KINETIC_PROBE3(socket_write, connection->socket, src->bytesUsed, true);
+
+    return KINETIC_STATUS_SUCCESS;
+}
@@ -0,0 +1,39 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#ifndef _KINETIC_TLS_H
+#define _KINETIC_TLS_H
+
+#include "kinetic_types_internal.h"
+
+#define KINETIC_TLS_SESSION_CACHE_MAX (KINETIC_SESSIONS_MAX)
+#define KINETIC_TLS_VERIFYING_CONTEXTS_MAX (4)
+
+KineticStatus KineticTLS_Connect(KineticConnection* const connection);
+void KineticTLS_Close(KineticConnection* const connection);
+bool KineticTLS_SessionReused(const KineticConnection* const connection);
+bool KineticTLS_KernelOffloadEnabled(const KineticConnection* const connection);
+
+KineticStatus KineticTLS_Read(KineticConnection* const connection, ByteBuffer* dest, size_t len);
+KineticStatus KineticTLS_Poll(KineticConnection* const connection, int timeoutMs);
+
+KineticStatus KineticTLS_Write(KineticConnection* const connection, ByteBuffer* src);
+
+#endif // _KINETIC_TLS_H
@@ -0,0 +1,285 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#include "kinetic_trace.h"
+#include "kinetic_logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Binary trace mode records a fixed-format record per PDU sent or received
+// into a ring of records in a memory-mapped file, so tracing can be left on
+// without formatting anything at runtime. Records are reserved with an atomic
+// increment of the ring position and marked complete by a release store of
+// their commit field, so readers (including KineticTrace_Render() on a file
+// left behind by a crashed process) can skip torn or overwritten records.
+// Threads recording are counted in flight, and closing the trace waits for
+// them before unmapping the file, so it can be closed while operations, e.g.
+// of write-back or rebuild threads, are in progress.
+
+STATIC KineticTraceFileHeader* TraceFile = NULL;
+STATIC size_t TraceFileSize = 0;
+STATIC int TraceRecorders = 0;
+STATIC pthread_mutex_t TraceMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static size_t KineticTrace_MappedSize(uint32_t records, uint32_t recordSize)
+{
+    return sizeof(KineticTraceFileHeader) + (size_t)records * recordSize;
+}
+
+// Stops recording and unmaps the trace file, with TraceMutex held
+static void KineticTrace_CloseFile(void)
+{
+    KineticTraceFileHeader* header = __atomic_exchange_n(&TraceFile, NULL, __ATOMIC_SEQ_CST);
+    if (header == NULL) {
+        return;
+    }
+    while (__atomic_load_n(&TraceRecorders, __ATOMIC_SEQ_CST) > 0) {
+        sched_yield();
+    }
+    msync(header, TraceFileSize, MS_ASYNC);
+    munmap(header, TraceFileSize);
+    TraceFileSize = 0;
+}
+
+// Maps a new trace file, with TraceMutex held
+static KineticStatus KineticTrace_OpenFile(const char* path, uint32_t records, uint32_t captureBytes)
+{
+    KineticTrace_CloseFile();
+
+    if (records == 0) {
+        records = KINETIC_TRACE_RECORDS_DEFAULT;
+    }
+    if (captureBytes > KINETIC_TRACE_CAPTURE_MAX) {
+        captureBytes = KINETIC_TRACE_CAPTURE_MAX;
+    }
+    // Keep records 8-byte aligned
+    uint32_t recordSize = sizeof(KineticTraceRecord) + ((captureBytes + 7) & ~7u);
+    size_t size = KineticTrace_MappedSize(records, recordSize);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        LOGF_ERROR("Failed creating trace file '%s'!", path);
+        return KINETIC_STATUS_INVALID;
+    }
+    if (ftruncate(fd, (off_t)size) != 0) {
+        LOGF_ERROR("Failed sizing trace file '%s' to %zu bytes!", path, size);
+        close(fd);
+        return KINETIC_STATUS_INVALID;
+    }
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        LOGF_ERROR("Failed mapping trace file '%s'!", path);
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+
+    KineticTraceFileHeader* header = map;
+    memcpy(header->magic, KINETIC_TRACE_MAGIC, sizeof(header->magic));
+    header->version = KINETIC_TRACE_VERSION;
+    header->recordSize = recordSize;
+    header->recordCount = records;
+    header->position = 0;
+
+    TraceFileSize = size;
+    __atomic_store_n(&TraceFile, header, __ATOMIC_SEQ_CST);
+    LOGF("Binary trace enabled to '%s' (%u records of %u bytes)",
+         path, records, recordSize);
+    return KINETIC_STATUS_SUCCESS;
+}
+
+KineticStatus KineticTrace_Open(const char* path, uint32_t records, uint32_t captureBytes)
+{
+    assert(path != NULL);
+    pthread_mutex_lock(&TraceMutex);
+    KineticStatus status = KineticTrace_OpenFile(path, records, captureBytes);
+    pthread_mutex_unlock(&TraceMutex);
+    return status;
+}
+
+void KineticTrace_Close(void)
+{
+    pthread_mutex_lock(&TraceMutex);
+    KineticTrace_CloseFile();
+    pthread_mutex_unlock(&TraceMutex);
+}
+
+bool KineticTrace_IsEnabled(void)
+{
+    return __atomic_load_n(&TraceFile, __ATOMIC_RELAXED) != NULL;
+}
+
+void KineticTrace_Record(KineticTraceEvent event, const KineticPDU* pdu,
+                         const KineticProto* proto, KineticStatus status)
+{
+    if (__atomic_load_n(&TraceFile, __ATOMIC_RELAXED) == NULL) {
+        return;
+    }
+    __atomic_add_fetch(&TraceRecorders, 1, __ATOMIC_SEQ_CST);
+    KineticTraceFileHeader* header = __atomic_load_n(&TraceFile, __ATOMIC_SEQ_CST);
+    if (header == NULL) {
+        __atomic_sub_fetch(&TraceRecorders, 1, __ATOMIC_SEQ_CST);
+        return;
+    }
+    assert(pdu != NULL);
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    uint64_t position = __atomic_fetch_add(&header->position, 1, __ATOMIC_RELAXED);
+    uint8_t* records = (uint8_t*)header + sizeof(KineticTraceFileHeader);
+    KineticTraceRecord* record = (KineticTraceRecord*)
+        &records[(position % header->recordCount) * header->recordSize];
+    __atomic_store_n(&record->commit, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    record->timestamp = (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+    record->connectionID = (pdu->connection != NULL) ? pdu->connection->connectionID : 0;
+    record->sequence = -1;
+    record->ackSequence = -1;
+    record->messageType = KINETIC_PROTO_MESSAGE_TYPE_INVALID_MESSAGE_TYPE;
+    record->status = status;
+    record->protobufLength = pdu->header.protobufLength;
+    record->valueLength = pdu->header.valueLength;
+    record->event = (uint16_t)event;
+    record->capturedLength = 0;
+    record->reserved = 0;
+
+    if (proto != NULL && proto->command != NULL && proto->command->header != NULL) {
+        const KineticProto_Header* cmdHeader = proto->command->header;
+        if (cmdHeader->has_sequence) {
+            record->sequence = cmdHeader->sequence;
+        }
+        if (cmdHeader->has_ackSequence) {
+            record->ackSequence = cmdHeader->ackSequence;
+        }
+        if (cmdHeader->has_messageType) {
+            record->messageType = cmdHeader->messageType;
+        }
+    }
+
+    // Capture the protobuf as packed on the wire, only if it fits in its
+    // entirety, rather than packing it again
+    size_t captureMax = header->recordSize - sizeof(KineticTraceRecord);
+    if (pdu->packedProtobuf != NULL && pdu->header.protobufLength > 0 &&
+        pdu->header.protobufLength <= captureMax) {
+        memcpy(record->protobuf, pdu->packedProtobuf, pdu->header.protobufLength);
+        record->capturedLength = (uint16_t)pdu->header.protobufLength;
+    }
+
+    __atomic_store_n(&record->commit, position + 1, __ATOMIC_RELEASE);
+    __atomic_sub_fetch(&TraceRecorders, 1, __ATOMIC_SEQ_CST);
+}
+
+static void KineticTrace_RenderRecord(const KineticTraceRecord* record)
+{
+    time_t seconds = (time_t)(record->timestamp / 1000000000ull);
+    struct tm tm;
+    char timestamp[32];
+    gmtime_r(&seconds, &tm);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &tm);
+
+    const ProtobufCEnumValue* type = protobuf_c_enum_descriptor_get_value(
+        &KineticProto_message_type__descriptor, record->messageType);
+    KineticLogger_LogPrintf("[%s.%09llu] %s connectionID=%lld sequence=%lld"
+        " ackSequence=%lld messageType=%s status=%s",
+        timestamp, (unsigned long long)(record->timestamp % 1000000000ull),
+        (record->event == KINETIC_TRACE_EVENT_REQUEST) ? "SEND" : "RECEIVE",
+        (long long)record->connectionID, (long long)record->sequence,
+        (long long)record->ackSequence, (type != NULL) ? type->name : "INVALID",
+        Kinetic_GetStatusDescription((KineticStatus)record->status));
+
+    KineticPDUHeader pduHeader = {
+        .versionPrefix = 'F',
+        .protobufLength = record->protobufLength,
+        .valueLength = record->valueLength,
+    };
+    KineticLogger_LogHeader(&pduHeader);
+
+    if (record->capturedLength > 0) {
+        KineticProto* proto = KineticProto__unpack(NULL,
+            record->capturedLength, record->protobuf);
+        if (proto != NULL) {
+            KineticLogger_LogProtobuf(proto);
+            KineticProto__free_unpacked(proto, NULL);
+        }
+        else {
+            KineticLogger_Log("Kinetic Protobuf: <corrupt>");
+        }
+    }
+}
+
+KineticStatus KineticTrace_Render(const char* path)
+{
+    assert(path != NULL);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        LOGF_ERROR("Failed opening trace file '%s'!", path);
+        return KINETIC_STATUS_INVALID;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(KineticTraceFileHeader)) {
+        LOGF_ERROR("Trace file '%s' is truncated!", path);
+        close(fd);
+        return KINETIC_STATUS_INVALID;
+    }
+    size_t size = (size_t)info.st_size;
+    void* map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        LOGF_ERROR("Failed mapping trace file '%s'!", path);
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+
+    KineticStatus status = KINETIC_STATUS_SUCCESS;
+    const KineticTraceFileHeader* header = map;
+    if (memcmp(header->magic, KINETIC_TRACE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != KINETIC_TRACE_VERSION ||
+        header->recordSize < sizeof(KineticTraceRecord) ||
+        header->recordCount == 0 ||
+        KineticTrace_MappedSize(header->recordCount, header->recordSize) > size) {
+        LOGF_ERROR("File '%s' is not a valid trace file!", path);
+        status = KINETIC_STATUS_INVALID;
+    }
+    else {
+        const uint8_t* records = (const uint8_t*)map + sizeof(KineticTraceFileHeader);
+        uint64_t end = header->position;
+        uint64_t start = (end > header->recordCount) ? (end - header->recordCount) : 0;
+        for (uint64_t position = start; position < end; position++) {
+            const KineticTraceRecord* record = (const KineticTraceRecord*)
+                &records[(position % header->recordCount) * header->recordSize];
+            // Skip records which were never completed or have been overwritten
+            if (record->commit == position + 1) {
+                KineticTrace_RenderRecord(record);
+            }
+        }
+    }
+
+    munmap(map, size);
+    return status;
+}
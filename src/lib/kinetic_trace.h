@@ -0,0 +1,74 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#ifndef _KINETIC_TRACE_H
+#define _KINETIC_TRACE_H
+
+#include "kinetic_types_internal.h"
+#include "kinetic_proto.h"
+
+#define KINETIC_TRACE_MAGIC "KTRACE1"
+#define KINETIC_TRACE_VERSION (1)
+#define KINETIC_TRACE_RECORDS_DEFAULT (65536)
+#define KINETIC_TRACE_CAPTURE_MAX (4096)
+
+typedef enum _KineticTraceEvent {
+    KINETIC_TRACE_EVENT_REQUEST = 1,
+    KINETIC_TRACE_EVENT_RESPONSE = 2,
+} KineticTraceEvent;
+
+// Trace file header, followed by 'recordCount' records of 'recordSize' bytes
+typedef struct _KineticTraceFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t recordCount;
+    uint64_t position;      // Total records ever reserved
+    uint8_t reserved[32];
+} KineticTraceFileHeader;
+
+// Fixed-format trace record, followed by up to 'recordSize - sizeof(record)'
+// bytes of the packed protobuf, if captured
+typedef struct _KineticTraceRecord {
+    uint64_t commit;        // Ring position + 1, once the record is complete
+    uint64_t timestamp;     // CLOCK_REALTIME in nanoseconds
+    int64_t connectionID;
+    int64_t sequence;
+    int64_t ackSequence;
+    int32_t messageType;
+    int32_t status;
+    uint32_t protobufLength;
+    uint32_t valueLength;
+    uint16_t event;
+    uint16_t capturedLength;
+    uint32_t reserved;
+    uint8_t protobuf[];
+} KineticTraceRecord;
+
+KineticStatus KineticTrace_Open(const char* path, uint32_t records, uint32_t captureBytes);
+void KineticTrace_Close(void);
+bool KineticTrace_IsEnabled(void);
+// Records a PDU sent or received, capturing its packed protobuf if it is
+// still held by the PDU (see KineticPDU_Send() and KineticPDU_Complete())
+void KineticTrace_Record(KineticTraceEvent event, const KineticPDU* pdu,
+                         const KineticProto* proto, KineticStatus status);
+KineticStatus KineticTrace_Render(const char* path);
+
+#endif // _KINETIC_TRACE_H
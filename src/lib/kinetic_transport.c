@@ -0,0 +1,221 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#define KINETIC_LOG_SUBSYSTEM KINETIC_LOG_SUBSYSTEM_SOCKET
+
+#include "kinetic_transport.h"
+#include "kinetic_socket.h"
+#include "kinetic_tls.h"
+#include "kinetic_stats.h"
+#include "kinetic_logger.h"
+#include "kinetic_proto.h"
+#include "protobuf-c/protobuf-c.h"
+#include <stdlib.h>
+
+//------------------------------------------------------------------------------
+// TCP transport
+
+static KineticStatus KineticTransport_TCPConnect(KineticConnection* const connection)
+{
+    connection->socket = KineticSocket_Connect(
+                             connection->session.host,
+                             connection->session.port,
+                             connection->session.nonBlocking);
+    if (connection->socket < 0) {
+        connection->socket = KINETIC_SOCKET_DESCRIPTOR_INVALID;
+        return KINETIC_STATUS_CONNECTION_ERROR;
+    }
+    return KINETIC_STATUS_SUCCESS;
+}
+
+static KineticStatus KineticTransport_TCPWritev(KineticConnection* const connection,
+                                                ByteBuffer* buffers[], int count)
+{
+    return KineticSocket_Writev(connection->socket, buffers, count);
+}
+
+static KineticStatus KineticTransport_TCPRead(KineticConnection* const connection,
+                                              ByteBuffer* dest, size_t len)
+{
+    return KineticSocket_Read(connection->socket, dest, len);
+}
+
+static KineticStatus KineticTransport_TCPPoll(KineticConnection* const connection, int timeoutMs)
+{
+    return KineticSocket_Poll(connection->socket, timeoutMs);
+}
+
+static void KineticTransport_TCPClose(KineticConnection* const connection)
+{
+    KineticSocket_Close(connection->socket);
+    connection->socket = KINETIC_SOCKET_DESCRIPTOR_INVALID;
+}
+
+const KineticTransport KineticTransport_TCP = {
+    .name = "tcp",
+    .connect = KineticTransport_TCPConnect,
+    .writev = KineticTransport_TCPWritev,
+    .read = KineticTransport_TCPRead,
+    .poll = KineticTransport_TCPPoll,
+    .close = KineticTransport_TCPClose,
+};
+
+//------------------------------------------------------------------------------
+// TLS transport, over a TCP connection
+
+static KineticStatus KineticTransport_TLSConnect(KineticConnection* const connection)
+{
+    KineticStatus status = KineticTransport_TCPConnect(connection);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        return status;
+    }
+    status = KineticTLS_Connect(connection);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        LOG_ERROR("Session TLS negotiation failed!");
+        KineticTransport_TCPClose(connection);
+    }
+    return status;
+}
+
+static KineticStatus KineticTransport_TLSWritev(KineticConnection* const connection,
+                                                ByteBuffer* buffers[], int count)
+{
+    for (int i = 0; i < count; i++) {
+        KineticStatus status = KineticTLS_Write(connection, buffers[i]);
+        if (status != KINETIC_STATUS_SUCCESS) {
+            return status;
+        }
+    }
+    return KINETIC_STATUS_SUCCESS;
+}
+
+static void KineticTransport_TLSClose(KineticConnection* const connection)
+{
+    KineticTLS_Close(connection);
+    KineticTransport_TCPClose(connection);
+}
+
+const KineticTransport KineticTransport_TLS = {
+    .name = "tls",
+    .connect = KineticTransport_TLSConnect,
+    .writev = KineticTransport_TLSWritev,
+    .read = KineticTLS_Read,
+    .poll = KineticTLS_Poll,
+    .close = KineticTransport_TLSClose,
+};
+
+//------------------------------------------------------------------------------
+// Dispatch to the transport of a connection
+
+KineticStatus KineticTransport_Connect(KineticConnection* const connection)
+{
+    assert(connection != NULL);
+    const KineticTransport* transport = connection->session.transport;
+    if (transport == NULL) {
+        transport = connection->session.useTls ?
+                    &KineticTransport_TLS : &KineticTransport_TCP;
+    }
+
+    KineticStatus status = transport->connect(connection);
+    if (status == KINETIC_STATUS_SUCCESS) {
+        connection->transport = transport;
+    }
+    return status;
+}
+
+void KineticTransport_Close(KineticConnection* const connection)
+{
+    assert(connection != NULL);
+    if (connection->transport != NULL) {
+        connection->transport->close(connection);
+        connection->transport = NULL;
+    }
+}
+
+KineticStatus KineticTransport_Read(KineticConnection* const connection,
+                                    ByteBuffer* dest, size_t len)
+{
+    assert(connection != NULL);
+    assert(connection->transport != NULL);
+    return connection->transport->read(connection, dest, len);
+}
+
+KineticStatus KineticTransport_ReadProtobuf(KineticConnection* const connection,
+                                            KineticPDU* pdu)
+{
+    uint64_t stageStart = KINETIC_STATS_STAGE_BEGIN();
+    KineticStatus status = KineticTransport_ReadPackedProtobuf(connection, pdu);
+    KINETIC_STATS_STAGE_END(KINETIC_OPERATION_STAGE_RECEIVE, stageStart);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        return status;
+    }
+
+    stageStart = KINETIC_STATS_STAGE_BEGIN();
+    pdu->proto = KineticProto__unpack(
+        NULL, pdu->header.protobufLength, pdu->packedProtobuf);
+    KINETIC_STATS_STAGE_END(KINETIC_OPERATION_STAGE_DECODE, stageStart);
+
+    if (pdu->proto == NULL) {
+        pdu->protobufDynamicallyExtracted = false;
+        LOG_ERROR("Error unpacking incoming Kinetic protobuf message!");
+        return KINETIC_STATUS_DATA_ERROR;
+    }
+    pdu->protobufDynamicallyExtracted = true;
+    return KINETIC_STATUS_SUCCESS;
+}
+
+KineticStatus KineticTransport_ReadPackedProtobuf(KineticConnection* const connection,
+                                                  KineticPDU* pdu)
+{
+    size_t bytesToRead = pdu->header.protobufLength;
+    uint8_t* packed = (uint8_t*)malloc(bytesToRead);
+    if (packed == NULL) {
+        LOG_ERROR("Failed allocating memory for protocol buffer");
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+
+    ByteBuffer recvBuffer = ByteBuffer_Create(packed, bytesToRead);
+    KineticStatus status = KineticTransport_Read(connection, &recvBuffer, bytesToRead);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        LOG("Protobuf read failed!");
+        free(packed);
+        return status;
+    }
+
+    // Ownership passes to the PDU; kept for the trace until the response is
+    // completed (see KineticPDU_Complete()), or released by the allocator
+    pdu->packedProtobuf = packed;
+    return KINETIC_STATUS_SUCCESS;
+}
+
+KineticStatus KineticTransport_Poll(KineticConnection* const connection, int timeoutMs)
+{
+    assert(connection != NULL);
+    assert(connection->transport != NULL);
+    return connection->transport->poll(connection, timeoutMs);
+}
+
+KineticStatus KineticTransport_Writev(KineticConnection* const connection,
+                                      ByteBuffer* buffers[], int count)
+{
+    assert(connection != NULL);
+    assert(connection->transport != NULL);
+    return connection->transport->writev(connection, buffers, count);
+}
@@ -0,0 +1,64 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#ifndef _KINETIC_TRANSPORT_H
+#define _KINETIC_TRANSPORT_H
+
+#include "kinetic_types_internal.h"
+
+// Byte stream carrying the PDUs of a connection. A session uses the transport
+// set in its configuration, or TCP (TLS if useTls is set) if none is set.
+// Transports keep any per-connection state in the connection's transportState.
+struct _KineticTransport {
+    const char* name;
+    void* context;  // Passed through to the transport (e.g. a simulator)
+
+    KineticStatus (*connect)(KineticConnection* const connection);
+    // Writes all used bytes of each buffer, in order
+    KineticStatus (*writev)(KineticConnection* const connection,
+                            ByteBuffer* buffers[], int count);
+    // Reads len bytes into dest, discarding any which do not fit
+    // (as KineticSocket_Read)
+    KineticStatus (*read)(KineticConnection* const connection,
+                          ByteBuffer* dest, size_t len);
+    // Waits until data can be read, returning KINETIC_STATUS_SOCKET_TIMEOUT
+    // if none arrives within the timeout
+    KineticStatus (*poll)(KineticConnection* const connection, int timeoutMs);
+    void (*close)(KineticConnection* const connection);
+};
+
+extern const KineticTransport KineticTransport_TCP;
+extern const KineticTransport KineticTransport_TLS;
+
+KineticStatus KineticTransport_Connect(KineticConnection* const connection);
+void KineticTransport_Close(KineticConnection* const connection);
+
+KineticStatus KineticTransport_Read(KineticConnection* const connection,
+                                    ByteBuffer* dest, size_t len);
+KineticStatus KineticTransport_ReadProtobuf(KineticConnection* const connection,
+                                            KineticPDU* pdu);
+KineticStatus KineticTransport_ReadPackedProtobuf(KineticConnection* const connection,
+                                                  KineticPDU* pdu);
+KineticStatus KineticTransport_Poll(KineticConnection* const connection, int timeoutMs);
+
+KineticStatus KineticTransport_Writev(KineticConnection* const connection,
+                                      ByteBuffer* buffers[], int count);
+
+#endif // _KINETIC_TRANSPORT_H
@@ -288,6 +288,25 @@ bool Copy_KineticProto_KeyValue_to_KineticEntry(KineticProto_KeyValue* keyValue,
     return !bufferOverflow;
 }
 
+uint64_t Kinetic_HashKey(const uint8_t* data, size_t len)
+{
+    uint64_t hash = KINETIC_FNV_OFFSET;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ data[i]) * KINETIC_FNV_PRIME;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+bool Kinetic_IsConnectionFailure(KineticStatus status)
+{
+    return status == KINETIC_STATUS_CONNECTION_ERROR ||
+           status == KINETIC_STATUS_SOCKET_ERROR ||
+           status == KINETIC_STATUS_SOCKET_TIMEOUT;
+}
+
 
 
 
@@ -59,6 +59,10 @@ typedef struct _KineticList {
 } KineticList;
 
 typedef struct _KineticPDU KineticPDU;
+typedef struct _KineticCache KineticCache;
+typedef struct _KineticCacheFile KineticCacheFile;
+typedef struct _KineticWriteBack KineticWriteBack;
+typedef struct _KineticKeyFilter KineticKeyFilter;
 
 // Kinetic Device Client Connection
 typedef struct _KineticConnection {
@@ -68,6 +72,19 @@ typedef struct _KineticConnection {
     int64_t sequence;        // increments for each request in a session
     KineticList pdus;        // list of dynamically allocated PDUs
     KineticSession session;  // session configuration
+    struct ssl_st* tls;      // TLS connection state (NULL if not using TLS)
+    const KineticTransport* transport; // transport connected with (NULL if not connected)
+    void*   transportState;  // per-connection state of the transport
+    uint64_t decodeSubmitted; // responses handed to the decode stage
+    uint64_t decodeCompleted; // responses published by the decode stage (in order)
+    KineticStats* stats;     // session statistics (allocated on first operation)
+    KineticCache* cache;     // read cache (NULL if not enabled for the session)
+    KineticCacheFile* cacheFile; // second tier of the read cache (NULL if not enabled)
+    KineticWriteBack* writeBack; // write-back buffer (NULL if not enabled for the session)
+    KineticCache* versions;  // last-known entries, for KineticClient_Update (NULL until used)
+    KineticKeyFilter* keyFilter; // filter of keys on the device (NULL if not enabled for the session)
+    size_t  p2pMaxOperations; // PEER2PEERPUSH batch limits of the device (0 until read since connecting)
+    size_t  p2pMaxBytes;
 } KineticConnection;
 #define KINETIC_CONNECTION_INIT(_con) { \
     (*_con) = (KineticConnection) { \
@@ -98,6 +115,11 @@ typedef struct _KineticMessage {
     KineticProto_Security       security;
     KineticProto_Security_ACL   acl;
     KineticProto_KeyValue       keyValue;
+    KineticProto_Range          range;
+    KineticProto_GetLog         getLog;
+    KineticProto_GetLog_Type    getLogType;
+    KineticProto_P2POperation   p2pOperation;
+    KineticProto_P2POperation_Peer p2pPeer;
     uint8_t                     hmacData[KINETIC_HMAC_MAX_LEN];
 } KineticMessage;
 #define KINETIC_MESSAGE_HEADER_INIT(_hdr, _con) { \
@@ -122,6 +144,10 @@ typedef struct _KineticMessage {
     KineticProto_status__init(&(msg)->status); \
     KineticProto_body__init(&(msg)->body); \
     KineticProto_key_value__init(&(msg)->keyValue); \
+    KineticProto_range__init(&(msg)->range); \
+    KineticProto_get_log__init(&(msg)->getLog); \
+    KineticProto_p2_poperation__init(&(msg)->p2pOperation); \
+    KineticProto_p2_poperation_peer__init(&(msg)->p2pPeer); \
     memset((msg)->hmacData, 0, SHA_DIGEST_LENGTH); \
     (msg)->proto.hmac.data = (msg)->hmacData; \
     (msg)->proto.hmac.len = KINETIC_HMAC_MAX_LEN; \
@@ -160,6 +186,13 @@ struct _KineticPDU {
     KineticProto* proto;
     bool protobufDynamicallyExtracted;
 
+    // Packed protobuf awaiting decode (only used with the decode stage enabled)
+    uint8_t* packedProtobuf;
+    uint64_t decodeTicket;
+    bool decodePending; // submitted to the decode stage, but not yet collected
+    bool decoded;
+    KineticStatus decodeStatus;
+
     // Object meta-data to be used/populated if provided and pertinent to the operation
     KineticEntry entry;
 
@@ -218,4 +251,15 @@ ByteArray ProtobufCBinaryData_to_ByteArray(ProtobufCBinaryData protoData);
 bool Copy_ProtobufCBinaryData_to_ByteBuffer(ByteBuffer dest, ProtobufCBinaryData src);
 bool Copy_KineticProto_KeyValue_to_KineticEntry(KineticProto_KeyValue* keyValue, KineticEntry* entry);
 
+// 64 bit FNV-1a parameters
+#define KINETIC_FNV_OFFSET (0xcbf29ce484222325ull)
+#define KINETIC_FNV_PRIME (0x100000001b3ull)
+
+// FNV-1a hash of a key, with a final mix so that all bits depend on the whole key
+uint64_t Kinetic_HashKey(const uint8_t* data, size_t len);
+
+// Whether a status means the connection can no longer be used, and must be
+// reconnected rather than read for further responses
+bool Kinetic_IsConnectionFailure(KineticStatus status);
+
 #endif // _KINETIC_TYPES_INTERNAL_H
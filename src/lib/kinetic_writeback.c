@@ -0,0 +1,689 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+
+#include "kinetic_writeback.h"
+#include "kinetic_connection.h"
+#include "kinetic_operation.h"
+#include "kinetic_allocator.h"
+#include "kinetic_pdu.h"
+#include "kinetic_decoder.h"
+#include "kinetic_logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#define KINETIC_WRITEBACK_INITIAL_BUCKETS (64)
+
+typedef struct _KineticWriteBackItem {
+    struct _KineticWriteBackItem* hashNext;
+    struct _KineticWriteBackItem* next; // Towards the most recently written
+    struct _KineticWriteBackItem* prev;
+    uint64_t hash;
+    bool inFlight;                      // Being written by the background thread
+    bool superseded;                    // Replaced by a later PUT while in flight
+    size_t keyLen;
+    size_t versionLen;
+    size_t tagLen;
+    size_t valueLen;
+    KineticAlgorithm algorithm;
+    uint8_t data[];                     // Key, version, tag and value
+} KineticWriteBackItem;
+
+struct _KineticWriteBack {
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;                // Signals the background thread
+    pthread_cond_t progress;            // Signalled as each batch completes
+    pthread_t thread;
+    KineticConnection connection;       // Used only by the background thread
+
+    // Buffered entries, by key. Entries are queued in the order written until
+    // taken by a batch, and only leave the table once written.
+    KineticWriteBackItem** buckets;
+    size_t bucketCount;                 // Power of 2
+    KineticWriteBackItem* first;
+    KineticWriteBackItem* last;
+    size_t entries;
+    size_t bytes;                       // Including superseded entries in flight
+    size_t capacity;
+    int intervalMs;
+
+    bool stopping;
+    bool flushRequested;
+    bool batchInProgress;
+    uint64_t batchesCompleted;
+    KineticStatus lastStatus;
+    KineticWriteBackStats stats;
+};
+
+static inline size_t KineticWriteBack_ItemSize(const KineticWriteBackItem* const item)
+{
+    return sizeof(KineticWriteBackItem) +
+           item->keyLen + item->versionLen + item->tagLen + item->valueLen;
+}
+
+static inline uint8_t* KineticWriteBack_ItemVersion(KineticWriteBackItem* const item)
+{
+    return item->data + item->keyLen;
+}
+
+static inline uint8_t* KineticWriteBack_ItemTag(KineticWriteBackItem* const item)
+{
+    return KineticWriteBack_ItemVersion(item) + item->versionLen;
+}
+
+static inline uint8_t* KineticWriteBack_ItemValue(KineticWriteBackItem* const item)
+{
+    return KineticWriteBack_ItemTag(item) + item->tagLen;
+}
+
+static KineticWriteBackItem** KineticWriteBack_Link(KineticWriteBack* const writeBack,
+                                                    const uint8_t* key, size_t keyLen,
+                                                    uint64_t hash)
+{
+    KineticWriteBackItem** link = &writeBack->buckets[hash & (writeBack->bucketCount - 1)];
+    while (*link != NULL) {
+        KineticWriteBackItem* item = *link;
+        if (item->hash == hash && item->keyLen == keyLen &&
+            memcmp(item->data, key, keyLen) == 0) {
+            break;
+        }
+        link = &item->hashNext;
+    }
+    return link;
+}
+
+static void KineticWriteBack_Grow(KineticWriteBack* const writeBack)
+{
+    size_t bucketCount = writeBack->bucketCount * 2;
+    KineticWriteBackItem** buckets = calloc(bucketCount, sizeof(KineticWriteBackItem*));
+    if (buckets == NULL) {
+        return; // Chains just get longer
+    }
+    for (size_t i = 0; i < writeBack->bucketCount; i++) {
+        KineticWriteBackItem* item = writeBack->buckets[i];
+        while (item != NULL) {
+            KineticWriteBackItem* next = item->hashNext;
+            KineticWriteBackItem** bucket = &buckets[item->hash & (bucketCount - 1)];
+            item->hashNext = *bucket;
+            *bucket = item;
+            item = next;
+        }
+    }
+    free(writeBack->buckets);
+    writeBack->buckets = buckets;
+    writeBack->bucketCount = bucketCount;
+}
+
+static void KineticWriteBack_Enqueue(KineticWriteBack* const writeBack,
+                                     KineticWriteBackItem* const item)
+{
+    item->next = NULL;
+    item->prev = writeBack->last;
+    if (writeBack->last != NULL) {
+        writeBack->last->next = item;
+    }
+    else {
+        writeBack->first = item;
+    }
+    writeBack->last = item;
+}
+
+static void KineticWriteBack_Dequeue(KineticWriteBack* const writeBack,
+                                     KineticWriteBackItem* const item)
+{
+    if (item->prev != NULL) {
+        item->prev->next = item->next;
+    }
+    else {
+        writeBack->first = item->next;
+    }
+    if (item->next != NULL) {
+        item->next->prev = item->prev;
+    }
+    else {
+        writeBack->last = item->prev;
+    }
+    item->next = item->prev = NULL;
+}
+
+static void KineticWriteBack_Release(KineticWriteBack* const writeBack,
+                                     KineticWriteBackItem* const item)
+{
+    writeBack->bytes -= KineticWriteBack_ItemSize(item);
+    free(item);
+}
+
+//------------------------------------------------------------------------------
+// Background thread
+
+static KineticStatus KineticWriteBack_Frame(KineticOperation* const operation)
+{
+    operation->response->connection = operation->request->connection;
+    return KineticPDU_ReceiveFrame(operation->response);
+}
+
+static KineticStatus KineticWriteBack_Complete(KineticOperation* const operation,
+                                               KineticStatus frameStatus)
+{
+    KineticStatus status = KineticPDU_Complete(operation->response, frameStatus);
+    if (status == KINETIC_STATUS_SUCCESS) {
+        status = KineticOperation_GetStatus(operation);
+    }
+    KineticOperation_Free(operation);
+    return status;
+}
+
+static KineticStatus KineticWriteBack_Receive(KineticOperation* const operation)
+{
+    return KineticWriteBack_Complete(operation, KineticWriteBack_Frame(operation));
+}
+
+// Writes a batch of entries as pipelined PUTs, keeping up to
+// KINETIC_WRITEBACK_WINDOW in flight, then flushes them. The device responds
+// to the requests of a connection in order. With the decode stage enabled,
+// each response is read before the previous one is completed, so that it is
+// decoded meanwhile.
+static KineticStatus KineticWriteBack_WriteBatch(KineticWriteBack* const writeBack,
+                                                 KineticWriteBackItem** items, size_t count)
+{
+    KineticConnection* connection = &writeBack->connection;
+    KineticStatus status = KINETIC_STATUS_SUCCESS;
+    if (!connection->connected) {
+        status = KineticConnection_Connect(connection);
+        if (status != KINETIC_STATUS_SUCCESS) {
+            LOG_ERROR("Failed connecting write-back session!");
+            return status;
+        }
+    }
+
+    KineticOperation operations[KINETIC_WRITEBACK_WINDOW];
+    KineticEntry entries[KINETIC_WRITEBACK_WINDOW];
+    KineticStatus frameStatus[KINETIC_WRITEBACK_WINDOW];
+    const size_t readAhead = KineticDecoder_IsEnabled() ? 1 : 0;
+    KineticStatus readStatus = KINETIC_STATUS_SUCCESS;
+    size_t sent = 0, framed = 0, received = 0;
+    while (received < count) {
+        while (status == KINETIC_STATUS_SUCCESS && sent < count &&
+               sent - received < KINETIC_WRITEBACK_WINDOW) {
+            KineticWriteBackItem* item = items[sent];
+            KineticEntry* entry = &entries[sent % KINETIC_WRITEBACK_WINDOW];
+            *entry = (KineticEntry) {
+                .key = ByteBuffer_Create(item->data, item->keyLen),
+                .newVersion = ByteBuffer_Create(KineticWriteBack_ItemVersion(item), item->versionLen),
+                .tag = ByteBuffer_Create(KineticWriteBack_ItemTag(item), item->tagLen),
+                .value = ByteBuffer_Create(KineticWriteBack_ItemValue(item), item->valueLen),
+                .algorithm = item->algorithm,
+                .synchronization = KINETIC_SYNCHRONIZATION_WRITEBACK,
+                .force = true,
+            };
+            entry->key.bytesUsed = item->keyLen;
+            entry->newVersion.bytesUsed = item->versionLen;
+            entry->tag.bytesUsed = item->tagLen;
+            entry->value.bytesUsed = item->valueLen;
+            if (item->versionLen == 0) {
+                entry->newVersion = BYTE_BUFFER_NONE;
+            }
+            if (item->tagLen == 0) {
+                entry->tag = BYTE_BUFFER_NONE;
+            }
+
+            KineticOperation* operation = &operations[sent % KINETIC_WRITEBACK_WINDOW];
+            *operation = KineticOperation_Create(connection);
+            if (operation->request == NULL || operation->response == NULL) {
+                status = KINETIC_STATUS_NO_PDUS_AVAVILABLE;
+                break;
+            }
+            KineticOperation_BuildPut(operation, entry);
+            status = KineticPDU_Send(operation->request);
+            if (status != KINETIC_STATUS_SUCCESS) {
+                KineticOperation_Free(operation);
+                break;
+            }
+            sent++;
+        }
+        if (received == sent) {
+            break;
+        }
+
+        // Read the oldest response (and the next, to decode meanwhile), but
+        // once a read fails the rest in flight can no longer be read
+        while (framed < sent && framed <= received + readAhead) {
+            if (readStatus == KINETIC_STATUS_SUCCESS) {
+                readStatus = KineticWriteBack_Frame(&operations[framed % KINETIC_WRITEBACK_WINDOW]);
+            }
+            frameStatus[framed % KINETIC_WRITEBACK_WINDOW] = readStatus;
+            framed++;
+        }
+        KineticStatus putStatus = KineticWriteBack_Complete(
+            &operations[received % KINETIC_WRITEBACK_WINDOW],
+            frameStatus[received % KINETIC_WRITEBACK_WINDOW]);
+        if (status == KINETIC_STATUS_SUCCESS) {
+            status = putStatus;
+        }
+        received++;
+    }
+
+    if (status == KINETIC_STATUS_SUCCESS) {
+        KineticOperation operation = KineticOperation_Create(connection);
+        if (operation.request == NULL || operation.response == NULL) {
+            return KINETIC_STATUS_NO_PDUS_AVAVILABLE;
+        }
+        KineticOperation_BuildFlush(&operation);
+        status = KineticPDU_Send(operation.request);
+        if (status == KINETIC_STATUS_SUCCESS) {
+            status = KineticWriteBack_Receive(&operation);
+        }
+        else {
+            KineticOperation_Free(&operation);
+        }
+    }
+
+    if (Kinetic_IsConnectionFailure(status)) {
+        // Reconnect for the next batch, rather than read stale responses
+        KineticConnection_Disconnect(connection);
+    }
+    return status;
+}
+
+// Waits for entries to write, with the mutex held. Returns false once stopped.
+static bool KineticWriteBack_Wait(KineticWriteBack* const writeBack)
+{
+    while (!writeBack->stopping && !writeBack->flushRequested && writeBack->first == NULL) {
+        pthread_cond_wait(&writeBack->wake, &writeBack->mutex);
+    }
+
+    // Give further PUTs of the same keys the interval to replace the entries
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += writeBack->intervalMs / 1000;
+    deadline.tv_nsec += (writeBack->intervalMs % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    while (!writeBack->stopping && !writeBack->flushRequested) {
+        if (pthread_cond_timedwait(&writeBack->wake, &writeBack->mutex, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    return !writeBack->stopping || writeBack->first != NULL;
+}
+
+static void* KineticWriteBack_Run(void* arg)
+{
+    KineticWriteBack* writeBack = arg;
+    pthread_mutex_lock(&writeBack->mutex);
+    while (KineticWriteBack_Wait(writeBack)) {
+        // Take all queued entries
+        size_t count = 0;
+        for (KineticWriteBackItem* item = writeBack->first; item != NULL; item = item->next) {
+            count++;
+        }
+        KineticWriteBackItem** items = NULL;
+        if (count > 0) {
+            items = malloc(count * sizeof(KineticWriteBackItem*));
+            if (items == NULL) {
+                LOG_ERROR("Failed allocating write-back batch!");
+                count = 0;
+            }
+        }
+        for (size_t i = 0; i < count; i++) {
+            items[i] = writeBack->first;
+            KineticWriteBack_Dequeue(writeBack, items[i]);
+            items[i]->inFlight = true;
+        }
+        writeBack->flushRequested = false;
+        writeBack->batchInProgress = true;
+
+        KineticStatus status = KINETIC_STATUS_SUCCESS;
+        if (count > 0) {
+            pthread_mutex_unlock(&writeBack->mutex);
+            status = KineticWriteBack_WriteBatch(writeBack, items, count);
+            pthread_mutex_lock(&writeBack->mutex);
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            KineticWriteBackItem* item = items[i];
+            item->inFlight = false;
+            if (item->superseded) {
+                KineticWriteBack_Release(writeBack, item);
+            }
+            else if (status == KINETIC_STATUS_SUCCESS) {
+                KineticWriteBackItem** link = KineticWriteBack_Link(writeBack,
+                    item->data, item->keyLen, item->hash);
+                *link = item->hashNext;
+                writeBack->entries--;
+                KineticWriteBack_Release(writeBack, item);
+            }
+            else {
+                KineticWriteBack_Enqueue(writeBack, item); // Retried in the next batch
+            }
+        }
+        free(items);
+
+        if (count > 0) {
+            if (status == KINETIC_STATUS_SUCCESS) {
+                writeBack->stats.written += count;
+                writeBack->stats.flushes++;
+            }
+            else {
+                LOGF_ERROR("Failed writing %zu buffered entries (status: %s)",
+                           count, Kinetic_GetStatusDescription(status));
+                writeBack->stats.failures++;
+            }
+        }
+        writeBack->lastStatus = status;
+        writeBack->batchInProgress = false;
+        writeBack->batchesCompleted++;
+        pthread_cond_broadcast(&writeBack->progress);
+
+        if (writeBack->stopping && status != KINETIC_STATUS_SUCCESS) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&writeBack->mutex);
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+// Session interface
+
+KineticStatus KineticWriteBack_Create(const KineticSession* const session,
+                                      KineticWriteBack** const writeBack)
+{
+    assert(session != NULL);
+    assert(writeBack != NULL);
+    *writeBack = NULL;
+
+    KineticWriteBack* wb = calloc(1, sizeof(KineticWriteBack));
+    if (wb == NULL) {
+        LOG_ERROR("Failed allocating write-back buffer!");
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    wb->bucketCount = KINETIC_WRITEBACK_INITIAL_BUCKETS;
+    wb->buckets = calloc(wb->bucketCount, sizeof(KineticWriteBackItem*));
+    if (wb->buckets == NULL) {
+        LOG_ERROR("Failed allocating write-back buffer!");
+        free(wb);
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    wb->capacity = session->writeBackBytes;
+    wb->intervalMs = (session->writeBackIntervalMs > 0) ?
+                     session->writeBackIntervalMs : KINETIC_WRITEBACK_INTERVAL_MS_DEFAULT;
+    wb->lastStatus = KINETIC_STATUS_SUCCESS;
+
+    // Batches are written through a session of their own, so that they do not
+    // hold up the operations of the caller
+    KINETIC_CONNECTION_INIT(&wb->connection);
+    wb->connection.session = *session;
+    wb->connection.session.readCacheBytes = 0;
+    wb->connection.session.writeBackBytes = 0;
+    KineticStatus status = KineticConnection_Connect(&wb->connection);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        LOG_ERROR("Failed connecting write-back session!");
+        free(wb->buckets);
+        free(wb);
+        return status;
+    }
+
+    pthread_mutex_init(&wb->mutex, NULL);
+    pthread_cond_init(&wb->wake, NULL);
+    pthread_cond_init(&wb->progress, NULL);
+    if (pthread_create(&wb->thread, NULL, KineticWriteBack_Run, wb) != 0) {
+        LOG_ERROR("Failed starting write-back thread!");
+        KineticConnection_Disconnect(&wb->connection);
+        pthread_cond_destroy(&wb->progress);
+        pthread_cond_destroy(&wb->wake);
+        pthread_mutex_destroy(&wb->mutex);
+        free(wb->buckets);
+        free(wb);
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+
+    *writeBack = wb;
+    return KINETIC_STATUS_SUCCESS;
+}
+
+void KineticWriteBack_Destroy(KineticWriteBack* const writeBack)
+{
+    if (writeBack == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&writeBack->mutex);
+    writeBack->stopping = true;
+    pthread_cond_signal(&writeBack->wake);
+    pthread_mutex_unlock(&writeBack->mutex);
+    pthread_join(writeBack->thread, NULL);
+
+    if (writeBack->entries > 0) {
+        LOGF_ERROR("Discarding %zu buffered entries which could not be written!",
+                   writeBack->entries);
+    }
+    KineticWriteBackItem* item = writeBack->first;
+    while (item != NULL) {
+        KineticWriteBackItem* next = item->next;
+        free(item);
+        item = next;
+    }
+
+    if (writeBack->connection.connected) {
+        KineticConnection_Disconnect(&writeBack->connection);
+    }
+    KineticAllocator_FreeAllPDUs(&writeBack->connection.pdus);
+    free(writeBack->connection.stats);
+    pthread_cond_destroy(&writeBack->progress);
+    pthread_cond_destroy(&writeBack->wake);
+    pthread_mutex_destroy(&writeBack->mutex);
+    free(writeBack->buckets);
+    free(writeBack);
+}
+
+KineticStatus KineticWriteBack_Put(KineticWriteBack* const writeBack,
+                                   const KineticEntry* const entry)
+{
+    assert(writeBack != NULL);
+    assert(entry != NULL);
+
+    // Versioned PUTs need the device to check the version, and other
+    // synchronizations must reach the device before the PUT completes
+    if (!entry->force ||
+        entry->synchronization == KINETIC_SYNCHRONIZATION_WRITETHROUGH ||
+        entry->synchronization == KINETIC_SYNCHRONIZATION_FLUSH) {
+        return KINETIC_STATUS_NOT_ATTEMPTED;
+    }
+
+    size_t versionLen = (entry->newVersion.array.data != NULL) ? entry->newVersion.bytesUsed : 0;
+    size_t tagLen = (entry->tag.array.data != NULL) ? entry->tag.bytesUsed : 0;
+    size_t valueLen = (entry->value.array.data != NULL) ? entry->value.bytesUsed : 0;
+    size_t size = sizeof(KineticWriteBackItem) + entry->key.bytesUsed +
+                  versionLen + tagLen + valueLen;
+    if (size > writeBack->capacity) {
+        return KINETIC_STATUS_NOT_ATTEMPTED;
+    }
+    KineticWriteBackItem* item = malloc(size);
+    if (item == NULL) {
+        return KINETIC_STATUS_NOT_ATTEMPTED;
+    }
+    *item = (KineticWriteBackItem) {
+        .hash = Kinetic_HashKey(entry->key.array.data, entry->key.bytesUsed),
+        .keyLen = entry->key.bytesUsed,
+        .versionLen = versionLen,
+        .tagLen = tagLen,
+        .valueLen = valueLen,
+        .algorithm = entry->algorithm,
+    };
+    memcpy(item->data, entry->key.array.data, item->keyLen);
+    if (versionLen > 0) {
+        memcpy(KineticWriteBack_ItemVersion(item), entry->newVersion.array.data, versionLen);
+    }
+    if (tagLen > 0) {
+        memcpy(KineticWriteBack_ItemTag(item), entry->tag.array.data, tagLen);
+    }
+    if (valueLen > 0) {
+        memcpy(KineticWriteBack_ItemValue(item), entry->value.array.data, valueLen);
+    }
+
+    pthread_mutex_lock(&writeBack->mutex);
+
+    // Replace any buffered entry of the key
+    KineticWriteBackItem** link = KineticWriteBack_Link(writeBack,
+        item->data, item->keyLen, item->hash);
+    KineticWriteBackItem* buffered = *link;
+    if (buffered != NULL) {
+        *link = buffered->hashNext;
+        writeBack->entries--;
+        if (buffered->inFlight) {
+            buffered->superseded = true;
+        }
+        else {
+            KineticWriteBack_Dequeue(writeBack, buffered);
+            KineticWriteBack_Release(writeBack, buffered);
+        }
+    }
+
+    // Wait for the buffer to drain if full, unless it cannot be written
+    while (writeBack->bytes > 0 && writeBack->bytes + size > writeBack->capacity) {
+        uint64_t batch = writeBack->batchesCompleted;
+        writeBack->flushRequested = true;
+        pthread_cond_signal(&writeBack->wake);
+        while (writeBack->batchesCompleted == batch) {
+            pthread_cond_wait(&writeBack->progress, &writeBack->mutex);
+        }
+        if (writeBack->lastStatus != KINETIC_STATUS_SUCCESS) {
+            KineticStatus status = writeBack->lastStatus;
+            pthread_mutex_unlock(&writeBack->mutex);
+            free(item);
+            return status;
+        }
+    }
+
+    if (writeBack->entries >= writeBack->bucketCount) {
+        KineticWriteBack_Grow(writeBack);
+    }
+    link = &writeBack->buckets[item->hash & (writeBack->bucketCount - 1)];
+    item->hashNext = *link;
+    *link = item;
+    KineticWriteBack_Enqueue(writeBack, item);
+    writeBack->entries++;
+    writeBack->bytes += size;
+    writeBack->stats.absorbed++;
+
+    // Start writing early once half full, so that PUTs rarely have to wait
+    if (writeBack->bytes > writeBack->capacity / 2) {
+        writeBack->flushRequested = true;
+    }
+    pthread_cond_signal(&writeBack->wake);
+    pthread_mutex_unlock(&writeBack->mutex);
+    return KINETIC_STATUS_SUCCESS;
+}
+
+// Copies buffered data into an entry buffer, as a GET would from the response
+static bool KineticWriteBack_CopyOut(ByteBuffer* const dest, const uint8_t* data, size_t len)
+{
+    dest->bytesUsed = len;
+    if (len == 0) {
+        return true;
+    }
+    if (dest->array.data == NULL || dest->array.len < len) {
+        return false;
+    }
+    memcpy(dest->array.data, data, len);
+    return true;
+}
+
+KineticStatus KineticWriteBack_Get(KineticWriteBack* const writeBack,
+                                   KineticEntry* const entry)
+{
+    assert(writeBack != NULL);
+    assert(entry != NULL);
+    uint64_t hash = Kinetic_HashKey(entry->key.array.data, entry->key.bytesUsed);
+    pthread_mutex_lock(&writeBack->mutex);
+
+    KineticWriteBackItem* item = *KineticWriteBack_Link(writeBack,
+        entry->key.array.data, entry->key.bytesUsed, hash);
+    if (item == NULL) {
+        pthread_mutex_unlock(&writeBack->mutex);
+        return KINETIC_STATUS_NOT_ATTEMPTED;
+    }
+    bool copied = KineticWriteBack_CopyOut(&entry->dbVersion,
+        KineticWriteBack_ItemVersion(item), item->versionLen);
+    copied = KineticWriteBack_CopyOut(&entry->tag,
+        KineticWriteBack_ItemTag(item), item->tagLen) && copied;
+    if (!entry->metadataOnly) {
+        copied = KineticWriteBack_CopyOut(&entry->value,
+            KineticWriteBack_ItemValue(item), item->valueLen) && copied;
+    }
+    entry->algorithm = item->algorithm;
+    pthread_mutex_unlock(&writeBack->mutex);
+
+    if (!copied) {
+        LOG("Buffered entry does not fit in the buffers of the entry!");
+        return KINETIC_STATUS_BUFFER_OVERRUN;
+    }
+    return KINETIC_STATUS_SUCCESS;
+}
+
+bool KineticWriteBack_Contains(KineticWriteBack* const writeBack,
+                               const ByteBuffer* const key)
+{
+    assert(writeBack != NULL);
+    assert(key != NULL);
+    uint64_t hash = Kinetic_HashKey(key->array.data, key->bytesUsed);
+    pthread_mutex_lock(&writeBack->mutex);
+    bool found = (*KineticWriteBack_Link(writeBack, key->array.data, key->bytesUsed, hash) != NULL);
+    pthread_mutex_unlock(&writeBack->mutex);
+    return found;
+}
+
+KineticStatus KineticWriteBack_Flush(KineticWriteBack* const writeBack)
+{
+    assert(writeBack != NULL);
+    pthread_mutex_lock(&writeBack->mutex);
+    if (writeBack->bytes == 0) {
+        pthread_mutex_unlock(&writeBack->mutex);
+        return KINETIC_STATUS_SUCCESS;
+    }
+
+    // A batch already in progress may not include all the buffered entries
+    uint64_t target = writeBack->batchesCompleted + (writeBack->batchInProgress ? 2 : 1);
+    writeBack->flushRequested = true;
+    pthread_cond_signal(&writeBack->wake);
+    while (writeBack->batchesCompleted < target) {
+        pthread_cond_wait(&writeBack->progress, &writeBack->mutex);
+    }
+    KineticStatus status = writeBack->lastStatus;
+    pthread_mutex_unlock(&writeBack->mutex);
+    return status;
+}
+
+void KineticWriteBack_GetStats(KineticWriteBack* const writeBack,
+                               KineticWriteBackStats* const stats)
+{
+    assert(writeBack != NULL);
+    assert(stats != NULL);
+    pthread_mutex_lock(&writeBack->mutex);
+    *stats = writeBack->stats;
+    stats->dirtyEntries = writeBack->entries;
+    stats->dirtyBytes = writeBack->bytes;
+    pthread_mutex_unlock(&writeBack->mutex);
+}
@@ -0,0 +1,63 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+
+#ifndef _KINETIC_WRITEBACK_H
+#define _KINETIC_WRITEBACK_H
+
+#include "kinetic_types_internal.h"
+
+#define KINETIC_WRITEBACK_INTERVAL_MS_DEFAULT (100)
+#define KINETIC_WRITEBACK_WINDOW (8) // PUTs in flight while writing a batch
+
+// Write-back buffer of forced PUTs of a session. Buffered entries are written
+// in batches by a background thread, through a connection of its own, as
+// pipelined PUTs with KINETIC_SYNCHRONIZATION_WRITEBACK followed by a
+// FLUSHALLDATA. A PUT of a key which is already buffered replaces the
+// buffered entry, so a key is written at most once per batch.
+KineticStatus KineticWriteBack_Create(const KineticSession* const session,
+                                      KineticWriteBack** const writeBack);
+
+// Writes any buffered entries, then stops the background thread
+void KineticWriteBack_Destroy(KineticWriteBack* const writeBack);
+
+// Buffers a PUT of the entry, waiting for the buffer to drain if it is full.
+// Returns KINETIC_STATUS_NOT_ATTEMPTED if the entry must be written directly
+// instead, as it is not forced, requests another synchronization or does not
+// fit in the buffer.
+KineticStatus KineticWriteBack_Put(KineticWriteBack* const writeBack,
+                                   const KineticEntry* const entry);
+
+// Copies the buffered entry with the key of the specified entry into it, as a
+// GET would. Returns KINETIC_STATUS_NOT_ATTEMPTED if the key is not buffered.
+KineticStatus KineticWriteBack_Get(KineticWriteBack* const writeBack,
+                                   KineticEntry* const entry);
+
+bool KineticWriteBack_Contains(KineticWriteBack* const writeBack,
+                               const ByteBuffer* const key);
+
+// Waits until all entries buffered before the call are written and flushed,
+// returning the status of the last batch written
+KineticStatus KineticWriteBack_Flush(KineticWriteBack* const writeBack);
+
+void KineticWriteBack_GetStats(KineticWriteBack* const writeBack,
+                               KineticWriteBackStats* const stats);
+
+#endif // _KINETIC_WRITEBACK_H
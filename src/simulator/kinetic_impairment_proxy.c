@@ -0,0 +1,526 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#define KINETIC_LOG_SUBSYSTEM KINETIC_LOG_SUBSYSTEM_SOCKET
+
+#include "kinetic_impairment_proxy.h"
+#include "kinetic_simulator_socket.h"
+#include "kinetic_stats.h"
+#include "kinetic_logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define PROXY_MAX_EVENTS (64)
+#define PROXY_READ_CHUNK (64 * 1024)
+#define PROXY_MAX_QUEUED (4 * 1024 * 1024)
+#define NANOS_PER_MILLI (1000000ull)
+#define NANOS_PER_SECOND (1000000000ull)
+
+// Data received from one side of a connection, to be written to the other
+// side once released
+typedef struct _ProxyChunk ProxyChunk;
+struct _ProxyChunk {
+    ProxyChunk* next;
+    uint64_t releaseTime;
+    bool reset;
+    size_t len;
+    size_t sent;
+    uint8_t data[];
+};
+
+// Data flowing in one direction of a connection. Chunks are released in
+// order, after the link has had time to transmit them and the delay since.
+typedef struct _ProxyDirection {
+    int to;
+    ProxyChunk* head;
+    ProxyChunk* tail;
+    size_t queued;
+    uint64_t random;
+    uint64_t linkFree;
+    uint64_t lastRelease;
+    bool eof;
+    bool blocked;
+    bool shutdown;
+} ProxyDirection;
+
+typedef struct _ProxyConnection ProxyConnection;
+
+typedef struct _ProxyEndpoint {
+    ProxyConnection* connection;
+    int fd;
+    ProxyDirection* in;     // Data read from the endpoint
+    ProxyDirection* out;    // Data written to the endpoint
+    uint32_t events;
+} ProxyEndpoint;
+
+struct _ProxyConnection {
+    ProxyEndpoint client;
+    ProxyEndpoint server;
+    ProxyDirection upstream;
+    ProxyDirection downstream;
+    bool failed;
+    ProxyConnection* previous;
+    ProxyConnection* next;
+};
+
+struct _KineticImpairmentProxy {
+    KineticImpairmentProxyConfig config;
+    int port;
+    int listener;
+    int epoll;
+    int wakeFds[2];
+    pthread_t thread;
+    ProxyConnection* connections;
+    uint64_t connectionCount;
+    uint8_t buffer[PROXY_READ_CHUNK];
+};
+
+static uint64_t NextRandom(uint64_t* state)
+{
+    // xorshift64*
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+// Returns true with the given probability
+static bool RandomChance(uint64_t* state, double probability)
+{
+    if (probability <= 0.0) {
+        return false;
+    }
+    return (double)(NextRandom(state) >> 11) / (double)(1ull << 53) < probability;
+}
+
+static uint64_t SeedDirection(uint64_t seed, uint64_t stream)
+{
+    // splitmix64, so that every direction gets a distinct non-zero sequence
+    uint64_t z = seed + (stream + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    return (z != 0) ? z : 1;
+}
+
+static bool Enqueue(const KineticImpairmentProxyConfig* config, ProxyDirection* dir,
+                    const uint8_t* data, size_t len, uint64_t now)
+{
+    size_t offset = 0;
+    while (offset < len) {
+        size_t size = len - offset;
+        if (config->maxWriteSize > 0) {
+            size_t max = (size < config->maxWriteSize) ? size : config->maxWriteSize;
+            size = 1 + NextRandom(&dir->random) % max;
+        }
+        ProxyChunk* chunk = malloc(sizeof(ProxyChunk) + size);
+        if (chunk == NULL) {
+            return false;
+        }
+        memcpy(chunk->data, &data[offset], size);
+        chunk->next = NULL;
+        chunk->len = size;
+        chunk->sent = 0;
+        chunk->reset = RandomChance(&dir->random, config->resetProbability);
+
+        uint64_t start = (now > dir->linkFree) ? now : dir->linkFree;
+        if (RandomChance(&dir->random, config->stallProbability)) {
+            start += config->stallMs * NANOS_PER_MILLI;
+        }
+        if (config->bandwidth > 0) {
+            start += size * NANOS_PER_SECOND / config->bandwidth;
+        }
+        dir->linkFree = start;
+
+        uint64_t delay = config->latencyMs * NANOS_PER_MILLI;
+        if (config->jitterMs > 0) {
+            delay += NextRandom(&dir->random) % (config->jitterMs * NANOS_PER_MILLI + 1);
+        }
+        chunk->releaseTime = start + delay;
+        if (chunk->releaseTime < dir->lastRelease) {
+            chunk->releaseTime = dir->lastRelease;
+        }
+        dir->lastRelease = chunk->releaseTime;
+
+        if (dir->tail != NULL) {
+            dir->tail->next = chunk;
+        }
+        else {
+            dir->head = chunk;
+        }
+        dir->tail = chunk;
+        dir->queued += size;
+        offset += size;
+    }
+    return true;
+}
+
+// Reads all data available from an endpoint. Returns false if the
+// connection should be dropped.
+static bool ReadEndpoint(KineticImpairmentProxy* proxy, ProxyEndpoint* endpoint)
+{
+    ProxyDirection* dir = endpoint->in;
+    while (!dir->eof && dir->queued < PROXY_MAX_QUEUED) {
+        ssize_t received = recv(endpoint->fd, proxy->buffer, sizeof(proxy->buffer), 0);
+        if (received > 0) {
+            KineticSimulatorSocket_QuickAck(endpoint->fd);
+            if (!Enqueue(&proxy->config, dir, proxy->buffer, received, KineticStats_Now())) {
+                return false;
+            }
+            continue;
+        }
+        if (received == 0) {
+            dir->eof = true;
+            break;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        return (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+    return true;
+}
+
+// Writes all released data in a direction. Returns false if the connection
+// should be dropped, or reset.
+static bool Flush(ProxyDirection* dir, uint64_t now, bool* reset)
+{
+    while (!dir->blocked && dir->head != NULL && dir->head->releaseTime <= now) {
+        ProxyChunk* chunk = dir->head;
+        if (chunk->reset) {
+            *reset = true;
+            return false;
+        }
+        ssize_t written = send(dir->to, &chunk->data[chunk->sent],
+                               chunk->len - chunk->sent, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                dir->blocked = true;
+                break;
+            }
+            return false;
+        }
+        chunk->sent += written;
+        if (chunk->sent == chunk->len) {
+            dir->head = chunk->next;
+            if (dir->head == NULL) {
+                dir->tail = NULL;
+            }
+            dir->queued -= chunk->len;
+            free(chunk);
+        }
+    }
+
+    // Pass on a half-close once everything before it has been written
+    if (dir->eof && dir->head == NULL && !dir->shutdown) {
+        shutdown(dir->to, SHUT_WR);
+        dir->shutdown = true;
+    }
+    return true;
+}
+
+static bool UpdateEvents(KineticImpairmentProxy* proxy, ProxyEndpoint* endpoint)
+{
+    uint32_t events = 0;
+    if (!endpoint->in->eof && endpoint->in->queued < PROXY_MAX_QUEUED) {
+        events |= EPOLLIN;
+    }
+    if (endpoint->out->blocked) {
+        events |= EPOLLOUT;
+    }
+    if (events == endpoint->events) {
+        return true;
+    }
+    struct epoll_event event = {.events = events, .data.ptr = endpoint};
+    endpoint->events = events;
+    return epoll_ctl(proxy->epoll, EPOLL_CTL_MOD, endpoint->fd, &event) == 0;
+}
+
+static void FreeChunks(ProxyDirection* dir)
+{
+    while (dir->head != NULL) {
+        ProxyChunk* next = dir->head->next;
+        free(dir->head);
+        dir->head = next;
+    }
+    dir->tail = NULL;
+}
+
+static void CloseConnection(KineticImpairmentProxy* proxy, ProxyConnection* conn, bool reset)
+{
+    ProxyEndpoint* endpoints[] = {&conn->client, &conn->server};
+    for (int i = 0; i < 2; i++) {
+        epoll_ctl(proxy->epoll, EPOLL_CTL_DEL, endpoints[i]->fd, NULL);
+        if (reset) {
+            // Closing with a zero linger timeout sends a reset
+            struct linger linger = {.l_onoff = 1, .l_linger = 0};
+            setsockopt(endpoints[i]->fd, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+        }
+        close(endpoints[i]->fd);
+    }
+    FreeChunks(&conn->upstream);
+    FreeChunks(&conn->downstream);
+
+    if (conn->previous != NULL) {
+        conn->previous->next = conn->next;
+    }
+    else {
+        proxy->connections = conn->next;
+    }
+    if (conn->next != NULL) {
+        conn->next->previous = conn->previous;
+    }
+    free(conn);
+}
+
+static bool AddEndpoint(KineticImpairmentProxy* proxy, ProxyConnection* conn,
+                        ProxyEndpoint* endpoint, int fd,
+                        ProxyDirection* in, ProxyDirection* out)
+{
+    *endpoint = (ProxyEndpoint) {
+        .connection = conn,
+        .fd = fd,
+        .in = in,
+        .out = out,
+        .events = EPOLLIN,
+    };
+    out->to = fd;
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = endpoint};
+    return epoll_ctl(proxy->epoll, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+static void AcceptConnections(KineticImpairmentProxy* proxy)
+{
+    while (true) {
+        int clientFd = accept(proxy->listener, NULL, NULL);
+        if (clientFd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOGF_ERROR("Proxy failed accepting connection: %s", strerror(errno));
+            }
+            return;
+        }
+
+        int enabled = 1;
+        setsockopt(clientFd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+        const char* targetHost = (proxy->config.targetHost != NULL) ?
+                                 proxy->config.targetHost : "127.0.0.1";
+        int serverFd = KineticSimulatorSocket_Connect(targetHost, proxy->config.targetPort);
+        ProxyConnection* conn = calloc(1, sizeof(ProxyConnection));
+        if (serverFd < 0 || conn == NULL ||
+            !KineticSimulatorSocket_SetNonBlocking(clientFd)) {
+            LOGF_ERROR("Proxy failed connecting to %s:%d",
+                       targetHost, proxy->config.targetPort);
+            free(conn);
+            close(clientFd);
+            if (serverFd >= 0) {
+                close(serverFd);
+            }
+            continue;
+        }
+
+        uint64_t stream = 2 * proxy->connectionCount++;
+        conn->upstream.random = SeedDirection(proxy->config.seed, stream);
+        conn->downstream.random = SeedDirection(proxy->config.seed, stream + 1);
+        conn->next = proxy->connections;
+        if (conn->next != NULL) {
+            conn->next->previous = conn;
+        }
+        proxy->connections = conn;
+        if (!AddEndpoint(proxy, conn, &conn->client, clientFd,
+                         &conn->upstream, &conn->downstream) ||
+            !AddEndpoint(proxy, conn, &conn->server, serverFd,
+                         &conn->downstream, &conn->upstream)) {
+            CloseConnection(proxy, conn, false);
+        }
+    }
+}
+
+// Returns the time to wait for the next chunk to be released, in
+// milliseconds, or -1 if there are none waiting
+static int NextTimeout(KineticImpairmentProxy* proxy, uint64_t now)
+{
+    uint64_t next = UINT64_MAX;
+    for (ProxyConnection* conn = proxy->connections; conn != NULL; conn = conn->next) {
+        ProxyDirection* dirs[] = {&conn->upstream, &conn->downstream};
+        for (int i = 0; i < 2; i++) {
+            if (!dirs[i]->blocked && dirs[i]->head != NULL &&
+                dirs[i]->head->releaseTime < next) {
+                next = dirs[i]->head->releaseTime;
+            }
+        }
+    }
+    if (next == UINT64_MAX) {
+        return -1;
+    }
+    if (next <= now) {
+        return 0;
+    }
+    return (int)((next - now + NANOS_PER_MILLI - 1) / NANOS_PER_MILLI);
+}
+
+static void* RunProxy(void* arg)
+{
+    KineticImpairmentProxy* proxy = arg;
+    struct epoll_event events[PROXY_MAX_EVENTS];
+
+    while (true) {
+        int timeout = NextTimeout(proxy, KineticStats_Now());
+        int count = epoll_wait(proxy->epoll, events, PROXY_MAX_EVENTS, timeout);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOGF_ERROR("Proxy epoll_wait failed: %s", strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.ptr == &proxy->listener) {
+                AcceptConnections(proxy);
+                continue;
+            }
+            if (events[i].data.ptr == &proxy->wakeFds) {
+                return NULL; // Stopping
+            }
+
+            ProxyEndpoint* endpoint = events[i].data.ptr;
+            ProxyConnection* conn = endpoint->connection;
+            if (events[i].events & EPOLLOUT) {
+                endpoint->out->blocked = false;
+            }
+            if (events[i].events & EPOLLHUP) {
+                conn->failed = true;
+            }
+            else if (!conn->failed && (events[i].events & (EPOLLIN | EPOLLERR))) {
+                conn->failed = !ReadEndpoint(proxy, endpoint);
+            }
+        }
+
+        uint64_t now = KineticStats_Now();
+        ProxyConnection* conn = proxy->connections;
+        while (conn != NULL) {
+            ProxyConnection* next = conn->next;
+            bool reset = false;
+            bool ok = !conn->failed &&
+                      Flush(&conn->upstream, now, &reset) &&
+                      Flush(&conn->downstream, now, &reset);
+            bool done = conn->upstream.shutdown && conn->downstream.shutdown;
+            if (!ok || done ||
+                !UpdateEvents(proxy, &conn->client) || !UpdateEvents(proxy, &conn->server)) {
+                CloseConnection(proxy, conn, reset);
+            }
+            conn = next;
+        }
+    }
+    return NULL;
+}
+
+KineticStatus KineticImpairmentProxy_Start(const KineticImpairmentProxyConfig* config,
+                                           KineticImpairmentProxy** proxy)
+{
+    if (config == NULL || proxy == NULL) {
+        return KINETIC_STATUS_SESSION_EMPTY;
+    }
+    *proxy = NULL;
+
+    KineticImpairmentProxy* p = calloc(1, sizeof(KineticImpairmentProxy));
+    if (p == NULL) {
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    p->config = *config;
+    p->config.host = NULL;
+    p->listener = p->epoll = p->wakeFds[0] = p->wakeFds[1] = -1;
+
+    p->listener = KineticSimulatorSocket_Listen(
+        (config->host != NULL) ? config->host : "127.0.0.1", config->port);
+    if (p->listener < 0) {
+        LOGF_ERROR("Proxy failed listening on port %d", config->port);
+        goto failure;
+    }
+    p->port = KineticSimulatorSocket_GetPort(p->listener);
+
+    p->epoll = epoll_create(PROXY_MAX_EVENTS);
+    if (p->epoll < 0 || pipe(p->wakeFds) != 0) {
+        goto failure;
+    }
+    struct epoll_event listenEvent = {.events = EPOLLIN, .data.ptr = &p->listener};
+    struct epoll_event wakeEvent = {.events = EPOLLIN, .data.ptr = &p->wakeFds};
+    if (epoll_ctl(p->epoll, EPOLL_CTL_ADD, p->listener, &listenEvent) != 0 ||
+        epoll_ctl(p->epoll, EPOLL_CTL_ADD, p->wakeFds[0], &wakeEvent) != 0) {
+        goto failure;
+    }
+
+    if (pthread_create(&p->thread, NULL, RunProxy, p) != 0) {
+        goto failure;
+    }
+
+    LOGF("Proxy listening on port %d, forwarding to port %d", p->port, config->targetPort);
+    *proxy = p;
+    return KINETIC_STATUS_SUCCESS;
+
+failure:
+    if (p->listener >= 0) {close(p->listener);}
+    if (p->epoll >= 0) {close(p->epoll);}
+    if (p->wakeFds[0] >= 0) {close(p->wakeFds[0]);}
+    if (p->wakeFds[1] >= 0) {close(p->wakeFds[1]);}
+    free(p);
+    return KINETIC_STATUS_CONNECTION_ERROR;
+}
+
+int KineticImpairmentProxy_GetPort(const KineticImpairmentProxy* proxy)
+{
+    assert(proxy != NULL);
+    return proxy->port;
+}
+
+void KineticImpairmentProxy_Stop(KineticImpairmentProxy* proxy)
+{
+    if (proxy == NULL) {
+        return;
+    }
+
+    uint8_t wake = 1;
+    while (write(proxy->wakeFds[1], &wake, 1) < 0 && errno == EINTR) {;}
+    pthread_join(proxy->thread, NULL);
+
+    while (proxy->connections != NULL) {
+        CloseConnection(proxy, proxy->connections, false);
+    }
+    close(proxy->listener);
+    close(proxy->epoll);
+    close(proxy->wakeFds[0]);
+    close(proxy->wakeFds[1]);
+    free(proxy);
+}
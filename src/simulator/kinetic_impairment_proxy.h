@@ -0,0 +1,73 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#ifndef _KINETIC_IMPAIRMENT_PROXY_H
+#define _KINETIC_IMPAIRMENT_PROXY_H
+
+#include "kinetic_types.h"
+
+// TCP proxy which forwards connections to a target (e.g. a simulator) while
+// impairing the network between them, for testing how the client behaves
+// over a slow or unreliable network. Impairments are applied independently
+// in each direction, using random sequences derived from the seed so that
+// runs are repeatable.
+typedef struct _KineticImpairmentProxyConfig {
+    const char* host;           // Address to listen on (NULL for loopback)
+    int port;                   // Port to listen on (0 for any free port)
+    const char* targetHost;     // Address to forward to (NULL for loopback)
+    int targetPort;             // Port to forward to
+
+    uint64_t seed;
+    int latencyMs;              // Delay added to all data
+    int jitterMs;               // Additional random delay, up to this
+    int64_t bandwidth;          // Bytes per second (0 for unlimited)
+    double stallProbability;    // Probability of each write stalling
+    int stallMs;                // Duration of each stall
+    size_t maxWriteSize;        // Forward data in random writes of up to this
+                                // many bytes (0 for as received)
+    double resetProbability;    // Probability of each write instead resetting
+                                // the connection
+} KineticImpairmentProxyConfig;
+
+typedef struct _KineticImpairmentProxy KineticImpairmentProxy;
+
+/**
+ * @brief Starts a proxy listening on the configured address, which connects
+ * to the target for each connection accepted.
+ *
+ * @param config        Proxy configuration
+ * @param proxy         Populated with the running proxy
+ *
+ * @return              Returns the resulting KineticStatus
+ */
+KineticStatus KineticImpairmentProxy_Start(const KineticImpairmentProxyConfig* config,
+                                           KineticImpairmentProxy** proxy);
+
+/**
+ * @brief Returns the port the proxy is listening on.
+ */
+int KineticImpairmentProxy_GetPort(const KineticImpairmentProxy* proxy);
+
+/**
+ * @brief Stops the proxy, closing all connections.
+ */
+void KineticImpairmentProxy_Stop(KineticImpairmentProxy* proxy);
+
+#endif // _KINETIC_IMPAIRMENT_PROXY_H
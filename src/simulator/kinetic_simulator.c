@@ -0,0 +1,1176 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#define KINETIC_LOG_SUBSYSTEM KINETIC_LOG_SUBSYSTEM_SOCKET
+
+#include "kinetic_simulator.h"
+#include "kinetic_simulator_store.h"
+#include "kinetic_simulator_socket.h"
+#include "kinetic_client.h"
+#include "kinetic_types_internal.h"
+#include "kinetic_transport.h"
+#include "kinetic_stats.h"
+#include "kinetic_proto.h"
+#include "kinetic_hmac.h"
+#include "kinetic_nbo.h"
+#include "kinetic_logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define SIMULATOR_MAX_EVENTS (64)
+#define SIMULATOR_READ_CHUNK (64 * 1024)
+#define SIMULATOR_DEFAULT_HMAC_KEY "asdfasdf"
+#define SIMULATOR_READ_TIMEOUT_MS (5000)
+
+// State of a client connection. Requests are read into `in` until complete,
+// and responses are appended to `out` until written, so requests pipelined by
+// a client are handled in order.
+typedef struct _SimulatorConnection SimulatorConnection;
+struct _SimulatorConnection {
+    int fd;
+    int64_t connectionID;
+    uint8_t* in;
+    size_t inLen;
+    size_t inCapacity;
+    uint8_t* out;
+    size_t outLen;
+    size_t outSent;
+    size_t outCapacity;
+    bool writable;
+    SimulatorConnection* previous;
+    SimulatorConnection* next;
+};
+
+struct _KineticSimulator {
+    KineticSimulatorConfig config;
+    uint8_t hmacKeyData[KINETIC_MAX_KEY_LEN];
+    int port;
+    int listener;
+    int epoll;
+    int wakeFds[2];
+    pthread_t thread;
+    pthread_mutex_t lock;   // Held while handling requests
+    pthread_cond_t output;  // Signalled when responses are buffered in-process
+    KineticTransport transport;
+    KineticSimulatorStore* store;
+    SimulatorConnection* connections;
+    struct _SimulatorResponse* response;
+    int64_t nextConnectionID;
+    uint64_t random;
+    int serviceBusyRemaining;
+    uint64_t requestCounts[KINETIC_STATS_MESSAGE_TYPES];
+    uint64_t requestBytes[KINETIC_STATS_MESSAGE_TYPES];
+};
+
+// Storage for all parts of a response, reused for each request
+typedef struct _SimulatorResponse {
+    KineticProto proto;
+    KineticProto_Command command;
+    KineticProto_Header header;
+    KineticProto_Body body;
+    KineticProto_Status status;
+    KineticProto_KeyValue keyValue;
+    KineticProto_Range range;
+    KineticProto_GetLog getLog;
+    KineticProto_GetLog_Type logTypes[8];
+    KineticProto_GetLog_Utilization utilization;
+    KineticProto_GetLog_Utilization* utilizations[1];
+    KineticProto_GetLog_Temperature temperature;
+    KineticProto_GetLog_Temperature* temperatures[1];
+    KineticProto_GetLog_Capacity capacity;
+    KineticProto_GetLog_Configuration configuration;
+    KineticProto_GetLog_Statistics statistics[KINETIC_STATS_MESSAGE_TYPES];
+    KineticProto_GetLog_Statistics* statisticsList[KINETIC_STATS_MESSAGE_TYPES];
+    KineticProto_GetLog_Limits limits;
+    ProtobufCBinaryData keys[KINETIC_SIMULATOR_MAX_KEY_RANGE_COUNT];
+    KineticProto_P2POperation p2pOperation;
+    KineticProto_P2POperation_Operation p2pOperations[KINETIC_SIMULATOR_MAX_P2P_OPERATIONS];
+    KineticProto_P2POperation_Operation* p2pOperationList[KINETIC_SIMULATOR_MAX_P2P_OPERATIONS];
+    KineticProto_Status p2pStatuses[KINETIC_SIMULATOR_MAX_P2P_OPERATIONS];
+    uint8_t hmacData[KINETIC_HMAC_MAX_LEN];
+    ByteArray value;
+} SimulatorResponse;
+
+static ByteArray ToByteArray(ProtobufCBinaryData data, protobuf_c_boolean has)
+{
+    return has ? (ByteArray) {.data = data.data, .len = data.len} : BYTE_ARRAY_NONE;
+}
+
+static ProtobufCBinaryData ToBinaryData(ByteArray array)
+{
+    return (ProtobufCBinaryData) {.data = array.data, .len = array.len};
+}
+
+static ByteBuffer ToByteBuffer(ByteArray array)
+{
+    ByteBuffer buffer = ByteBuffer_CreateWithArray(array);
+    buffer.bytesUsed = array.len;
+    return buffer;
+}
+
+static void SetStatus(SimulatorResponse* response,
+                      KineticProto_Status_StatusCode code, char* message)
+{
+    response->status.code = code;
+    response->status.has_code = true;
+    response->status.statusMessage = message;
+}
+
+static void SetEntry(SimulatorResponse* response,
+                     const KineticSimulatorEntry* entry, bool metadataOnly)
+{
+    KineticProto_KeyValue* keyValue = &response->keyValue;
+    keyValue->key = ToBinaryData(entry->key);
+    keyValue->has_key = true;
+    if (entry->version.len > 0) {
+        keyValue->dbVersion = ToBinaryData(entry->version);
+        keyValue->has_dbVersion = true;
+    }
+    if (entry->tag.len > 0) {
+        keyValue->tag = ToBinaryData(entry->tag);
+        keyValue->has_tag = true;
+    }
+    if (entry->algorithm != 0) {
+        keyValue->algorithm = entry->algorithm;
+        keyValue->has_algorithm = true;
+    }
+    response->body.keyValue = keyValue;
+    if (!metadataOnly) {
+        response->value = entry->value;
+    }
+}
+
+// The version specified in a request must match the stored version, unless
+// forced. Missing entries have an empty version.
+static bool VersionMatches(const KineticProto_KeyValue* keyValue,
+                           const KineticSimulatorEntry* entry)
+{
+    if (keyValue->has_force && keyValue->force) {
+        return true;
+    }
+    ByteArray expected = ToByteArray(keyValue->dbVersion, keyValue->has_dbVersion);
+    ByteArray actual = (entry != NULL) ? entry->version : BYTE_ARRAY_NONE;
+    return expected.len == actual.len &&
+           (expected.len == 0 || memcmp(expected.data, actual.data, expected.len) == 0);
+}
+
+static KineticProto_KeyValue* GetKeyValue(const KineticProto_Command* command)
+{
+    if (command->body == NULL || command->body->keyValue == NULL ||
+        !command->body->keyValue->has_key ||
+        command->body->keyValue->key.len > KINETIC_MAX_KEY_LEN) {
+        return NULL;
+    }
+    return command->body->keyValue;
+}
+
+static void HandlePut(KineticSimulator* sim, const KineticProto_Command* command,
+                      ByteArray value, SimulatorResponse* response)
+{
+    KineticProto_KeyValue* keyValue = GetKeyValue(command);
+    if (keyValue == NULL) {
+        SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_INVALID_REQUEST,
+                  "PUT requires a key");
+        return;
+    }
+    ByteArray key = ToByteArray(keyValue->key, true);
+    if (!VersionMatches(keyValue, KineticSimulatorStore_Get(sim->store, key))) {
+        SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_VERSION_MISMATCH, NULL);
+        return;
+    }
+    if (KineticSimulatorStore_Put(sim->store, key, value,
+            ToByteArray(keyValue->newVersion, keyValue->has_newVersion),
+            ToByteArray(keyValue->tag, keyValue->has_tag),
+            keyValue->has_algorithm ? keyValue->algorithm : 0) == NULL) {
+        SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_NO_SPACE, NULL);
+        return;
+    }
+    SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_SUCCESS, NULL);
+}
+
+static void HandleGet(KineticSimulator* sim, const KineticProto_Command* command,
+                      SimulatorResponse* response)
+{
+    KineticProto_KeyValue* keyValue = GetKeyValue(command);
+    if (keyValue == NULL) {
+        SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_INVALID_REQUEST,
+                  "GET requires a key");
+        return;
+    }
+    ByteArray key = ToByteArray(keyValue->key, true);
+    bool metadataOnly = keyValue->has_metadataOnly && keyValue->metadataOnly;
+
+    KineticSimulatorEntry* entry = NULL;
+    switch (command->header->messageType) {
+    case KINETIC_PROTO_MESSAGE_TYPE_GETNEXT:
+        entry = KineticSimulatorStore_Next(sim->store, key, false);
+        break;
+    case KINETIC_PROTO_MESSAGE_TYPE_GETPREVIOUS:
+        entry = KineticSimulatorStore_Previous(sim->store, key, false);
+        break;
+    case KINETIC_PROTO_MESSAGE_TYPE_GETVERSION:
+        metadataOnly = true;
+    // fall through
+    default:
+        entry = KineticSimulatorStore_Get(sim->store, key);
+        break;
+    }
+
+    if (entry == NULL) {
+        SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_NOT_FOUND, NULL);
+        return;
+    }
+    SetEntry(response, entry, metadataOnly);
+    SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_SUCCESS, NULL);
+}
+
+static void HandleDelete(KineticSimulator* sim, const KineticProto_Command* command,
+                         SimulatorResponse* response)
+{
+    KineticProto_KeyValue* keyValue = GetKeyValue(command);
+    if (keyValue == NULL) {
+        SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_INVALID_REQUEST,
+                  "DELETE requires a key");
+        return;
+    }
+    ByteArray key = ToByteArray(keyValue->key, true);
+    KineticSimulatorEntry* entry = KineticSimulatorStore_Get(sim->store, key);
+    if (entry == NULL) {
+        SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_NOT_FOUND, NULL);
+        return;
+    }
+    if (!VersionMatches(keyValue, entry)) {
+        SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_VERSION_MISMATCH, NULL);
+        return;
+    }
+    KineticSimulatorStore_Delete(sim->store, key);
+    SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_SUCCESS, NULL);
+}
+
+static bool InRange(const KineticProto_Range* range, const ByteArray key, bool forward)
+{
+    // Bound on the far side of the iteration
+    if (forward && range->has_endKey) {
+        int cmp = KineticSimulatorStore_CompareKeys(key, ToByteArray(range->endKey, true));
+        return cmp < 0 || (cmp == 0 && range->has_endKeyInclusive && range->endKeyInclusive);
+    }
+    if (!forward && range->has_startKey) {
+        int cmp = KineticSimulatorStore_CompareKeys(key, ToByteArray(range->startKey, true));
+        return cmp > 0 || (cmp == 0 && range->has_startKeyInclusive && range->startKeyInclusive);
+    }
+    return true;
+}
+
+static void HandleGetKeyRange(KineticSimulator* sim, const KineticProto_Command* command,
+                              SimulatorResponse* response)
+{
+    const KineticProto_Range* range = (command->body != NULL) ? command->body->range : NULL;
+    if (range == NULL || !range->has_maxReturned || range->maxReturned <= 0 ||
+        range->maxReturned > KINETIC_SIMULATOR_MAX_KEY_RANGE_COUNT) {
+        SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_INVALID_REQUEST,
+                  "GETKEYRANGE requires a range with a valid maxReturned");
+        return;
+    }
+
+    bool forward = !(range->has_reverse && range->reverse);
+    KineticSimulatorEntry* entry;
+    if (forward) {
+        entry = range->has_startKey ?
+            KineticSimulatorStore_Next(sim->store, ToByteArray(range->startKey, true),
+                range->has_startKeyInclusive && range->startKeyInclusive) :
+            KineticSimulatorStore_First(sim->store);
+    }
+    else {
+        entry = range->has_endKey ?
+            KineticSimulatorStore_Previous(sim->store, ToByteArray(range->endKey, true),
+                range->has_endKeyInclusive && range->endKeyInclusive) :
+            KineticSimulatorStore_Last(sim->store);
+    }
+
+    size_t count = 0;
+    while (entry != NULL && count < (size_t)range->maxReturned &&
+           InRange(range, entry->key, forward)) {
+        response->keys[count++] = ToBinaryData(entry->key);
+        entry = forward ? entry->next[0] : entry->previous;
+    }
+
+    response->range.n_key = count;
+    response->range.key = response->keys;
+    response->body.range = &response->range;
+    SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_SUCCESS, NULL);
+}
+
+static void HandleGetLog(KineticSimulator* sim, const KineticProto_Command* command,
+                         SimulatorResponse* response)
+{
+    const KineticProto_GetLog* request = (command->body != NULL) ? command->body->getLog : NULL;
+    if (request == NULL || request->n_type == 0) {
+        SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_INVALID_REQUEST,
+                  "GETLOG requires at least one log type");
+        return;
+    }
+
+    KineticProto_GetLog* log = &response->getLog;
+    for (size_t i = 0; i < request->n_type; i++) {
+        switch (request->type[i]) {
+        case KINETIC_PROTO_GET_LOG_TYPE_UTILIZATIONS:
+            response->utilization.name = "HDA";
+            response->utilization.value = 0.0f;
+            response->utilization.has_value = true;
+            response->utilizations[0] = &response->utilization;
+            log->utilization = response->utilizations;
+            log->n_utilization = 1;
+            break;
+        case KINETIC_PROTO_GET_LOG_TYPE_TEMPERATURES:
+            response->temperature.name = "HDA";
+            response->temperature.current = 25.0f;
+            response->temperature.has_current = true;
+            response->temperatures[0] = &response->temperature;
+            log->temperature = response->temperatures;
+            log->n_temperature = 1;
+            break;
+        case KINETIC_PROTO_GET_LOG_TYPE_CAPACITIES:
+            // Memory is the only capacity limit, so report usage unless a
+            // capacity is configured
+            if (sim->config.capacityBytes > 0) {
+                response->capacity.nominalCapacityInBytes = sim->config.capacityBytes;
+                response->capacity.portionFull =
+                    (float)sim->store->bytes / sim->config.capacityBytes;
+            }
+            else {
+                response->capacity.nominalCapacityInBytes = sim->store->bytes;
+                response->capacity.portionFull = 0.0f;
+            }
+            response->capacity.has_nominalCapacityInBytes = true;
+            response->capacity.has_portionFull = true;
+            log->capacity = &response->capacity;
+            break;
+        case KINETIC_PROTO_GET_LOG_TYPE_CONFIGURATION:
+            response->configuration.vendor = "kinetic-c";
+            response->configuration.model = "Simulator";
+            response->configuration.version = "1.0";
+            response->configuration.port = sim->port;
+            response->configuration.has_port = true;
+            log->configuration = &response->configuration;
+            break;
+        case KINETIC_PROTO_GET_LOG_TYPE_STATISTICS: {
+            size_t count = 0;
+            for (int type = 0; type < KINETIC_STATS_MESSAGE_TYPES; type++) {
+                if (sim->requestCounts[type] == 0) {
+                    continue;
+                }
+                KineticProto_GetLog_Statistics* stats = &response->statistics[count];
+                *stats = (KineticProto_GetLog_Statistics)KINETIC_PROTO_GET_LOG_STATISTICS__INIT;
+                stats->messageType = type;
+                stats->has_messageType = true;
+                stats->count = sim->requestCounts[type];
+                stats->has_count = true;
+                stats->bytes = sim->requestBytes[type];
+                stats->has_bytes = true;
+                response->statisticsList[count++] = stats;
+            }
+            log->statistics = response->statisticsList;
+            log->n_statistics = count;
+        } break;
+        case KINETIC_PROTO_GET_LOG_TYPE_MESSAGES:
+            log->messages = (ProtobufCBinaryData) {.data = NULL, .len = 0};
+            log->has_messages = true;
+            break;
+        case KINETIC_PROTO_GET_LOG_TYPE_LIMITS:
+            response->limits.maxKeySize = KINETIC_MAX_KEY_LEN;
+            response->limits.has_maxKeySize = true;
+            response->limits.maxValueSize = PDU_VALUE_MAX_LEN;
+            response->limits.has_maxValueSize = true;
+            response->limits.maxVersionSize = KINETIC_MAX_VERSION_LEN;
+            response->limits.has_maxVersionSize = true;
+            response->limits.maxMessageSize = PDU_PROTO_MAX_LEN;
+            response->limits.has_maxMessageSize = true;
+            response->limits.maxKeyRangeCount = KINETIC_SIMULATOR_MAX_KEY_RANGE_COUNT;
+            response->limits.has_maxKeyRangeCount = true;
+            response->limits.maxOutstandingWriteRequests = KINETIC_SIMULATOR_MAX_P2P_OPERATIONS;
+            response->limits.has_maxOutstandingWriteRequests = true;
+            log->limits = &response->limits;
+            break;
+        default:
+            SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_NOT_FOUND,
+                      "Log type not supported");
+            return;
+        }
+    }
+
+    size_t types = (request->n_type < 8) ? request->n_type : 8;
+    memcpy(response->logTypes, request->type, types * sizeof(KineticProto_GetLog_Type));
+    log->type = response->logTypes;
+    log->n_type = types;
+    response->body.getLog = log;
+    SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_SUCCESS, NULL);
+}
+
+// Status reported for an entry pushed to a peer, from the status of its PUT
+static KineticProto_Status_StatusCode PeerStatusCode(KineticStatus status)
+{
+    switch (status) {
+    case KINETIC_STATUS_SUCCESS:
+        return KINETIC_PROTO_STATUS_STATUS_CODE_SUCCESS;
+    case KINETIC_STATUS_VERSION_FAILURE:
+        return KINETIC_PROTO_STATUS_STATUS_CODE_VERSION_MISMATCH;
+    case KINETIC_STATUS_DEVICE_BUSY:
+        return KINETIC_PROTO_STATUS_STATUS_CODE_SERVICE_BUSY;
+    case KINETIC_STATUS_CONNECTION_ERROR:
+    case KINETIC_STATUS_SOCKET_ERROR:
+    case KINETIC_STATUS_SOCKET_TIMEOUT:
+        return KINETIC_PROTO_STATUS_STATUS_CODE_REMOTE_CONNECTION_ERROR;
+    default:
+        return KINETIC_PROTO_STATUS_STATUS_CODE_INTERNAL_ERROR;
+    }
+}
+
+// Copies entries to a peer with PUTs, connecting to it as a client. The
+// simulator handles no other requests meanwhile, so cannot push to itself.
+static void HandleP2PPush(KineticSimulator* sim, const KineticProto_Command* command,
+                          SimulatorResponse* response)
+{
+    const KineticProto_P2POperation* request =
+        (command->body != NULL) ? command->body->p2pOperation : NULL;
+    if (request == NULL || request->peer == NULL || request->peer->hostname == NULL ||
+        !request->peer->has_port || request->n_operation > KINETIC_SIMULATOR_MAX_P2P_OPERATIONS) {
+        SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_INVALID_REQUEST,
+                  "PEER2PEERPUSH requires a peer and at most the maximum outstanding writes");
+        return;
+    }
+
+    KineticSession session = {
+        .port = request->peer->port,
+        .useTls = request->peer->has_tls && request->peer->tls,
+        .clusterVersion = sim->config.clusterVersion,
+        .identity = sim->config.identity,
+        .hmacKey = sim->config.hmacKey,
+    };
+    snprintf(session.host, sizeof(session.host), "%s", request->peer->hostname);
+    KineticSessionHandle handle = KINETIC_HANDLE_INVALID;
+    KineticStatus connectStatus = KineticClient_Connect(&session, &handle);
+    if (connectStatus != KINETIC_STATUS_SUCCESS) {
+        LOGF_ERROR("Simulator failed connecting to peer %s:%d",
+                   session.host, session.port);
+    }
+
+    bool succeeded = true;
+    for (size_t i = 0; i < request->n_operation; i++) {
+        const KineticProto_P2POperation_Operation* operation = request->operation[i];
+        KineticProto_P2POperation_Operation* result = &response->p2pOperations[i];
+        KineticProto_Status* status = &response->p2pStatuses[i];
+        *result = (KineticProto_P2POperation_Operation)KINETIC_PROTO_P2_POPERATION_OPERATION__INIT;
+        *status = (KineticProto_Status)KINETIC_PROTO_STATUS__INIT;
+        result->key = operation->key;
+        result->has_key = operation->has_key;
+        result->version = operation->version;
+        result->has_version = operation->has_version;
+        result->newKey = operation->newKey;
+        result->has_newKey = operation->has_newKey;
+        result->force = operation->force;
+        result->has_force = operation->has_force;
+
+        ByteArray key = ToByteArray(operation->key, operation->has_key);
+        KineticSimulatorEntry* entry = NULL;
+        if (key.len == 0 || key.len > KINETIC_MAX_KEY_LEN) {
+            status->code = KINETIC_PROTO_STATUS_STATUS_CODE_INVALID_REQUEST;
+        }
+        else if (connectStatus != KINETIC_STATUS_SUCCESS) {
+            status->code = KINETIC_PROTO_STATUS_STATUS_CODE_REMOTE_CONNECTION_ERROR;
+        }
+        else if ((entry = KineticSimulatorStore_Get(sim->store, key)) == NULL) {
+            status->code = KINETIC_PROTO_STATUS_STATUS_CODE_NOT_FOUND;
+        }
+        else {
+            ByteArray newKey = ToByteArray(operation->newKey, operation->has_newKey);
+            KineticEntry copy = {
+                .key = ToByteBuffer((newKey.len > 0) ? newKey : key),
+                .value = ToByteBuffer(entry->value),
+                .newVersion = ToByteBuffer(entry->version),
+                .dbVersion = ToByteBuffer(ToByteArray(operation->version, operation->has_version)),
+                .tag = ToByteBuffer(entry->tag),
+                .algorithm = KineticAlgorithm_from_KineticProto_Algorithm(entry->algorithm),
+                .force = operation->has_force && operation->force,
+            };
+            status->code = PeerStatusCode(KineticClient_Put(handle, &copy));
+        }
+        status->has_code = true;
+        result->status = status;
+        response->p2pOperationList[i] = result;
+        succeeded = succeeded && (status->code == KINETIC_PROTO_STATUS_STATUS_CODE_SUCCESS);
+    }
+    if (connectStatus == KINETIC_STATUS_SUCCESS) {
+        KineticClient_Disconnect(&handle);
+    }
+
+    response->p2pOperation.operation = response->p2pOperationList;
+    response->p2pOperation.n_operation = request->n_operation;
+    response->p2pOperation.allChildOperationsSucceeded = succeeded;
+    response->p2pOperation.has_allChildOperationsSucceeded = true;
+    response->body.p2pOperation = &response->p2pOperation;
+    if (connectStatus != KINETIC_STATUS_SUCCESS) {
+        SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_REMOTE_CONNECTION_ERROR,
+                  "Failed connecting to peer");
+        return;
+    }
+    SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_SUCCESS, NULL);
+}
+
+// Returns true if the request should be rejected as part of a SERVICE_BUSY storm
+static bool ServiceBusy(KineticSimulator* sim)
+{
+    if (sim->serviceBusyRemaining > 0) {
+        sim->serviceBusyRemaining--;
+        return true;
+    }
+    if (sim->config.serviceBusyProbability <= 0.0) {
+        return false;
+    }
+
+    // xorshift64*, scaled to [0, 1)
+    uint64_t x = sim->random;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    sim->random = x;
+    double sample = (double)((x * 0x2545F4914F6CDD1Dull) >> 11) / (double)(1ull << 53);
+    if (sample >= sim->config.serviceBusyProbability) {
+        return false;
+    }
+    sim->serviceBusyRemaining = sim->config.serviceBusyStormLength - 1;
+    return true;
+}
+
+static void HandleCommand(KineticSimulator* sim, const KineticProto* request,
+                          ByteArray value, SimulatorResponse* response)
+{
+    const KineticProto_Command* command = request->command;
+    const KineticProto_Header* header = command->header;
+    const ByteArray key = sim->config.hmacKey;
+
+    if (!header->has_identity || header->identity != sim->config.identity ||
+        !KineticHMAC_Validate(request, key)) {
+        SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_HMAC_FAILURE, NULL);
+        return;
+    }
+    if (header->has_clusterVersion && header->clusterVersion != sim->config.clusterVersion) {
+        SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_VERSION_FAILURE,
+                  "Cluster version mismatch");
+        return;
+    }
+    if (ServiceBusy(sim)) {
+        SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_SERVICE_BUSY, NULL);
+        return;
+    }
+
+    switch (header->messageType) {
+    case KINETIC_PROTO_MESSAGE_TYPE_NOOP:
+    case KINETIC_PROTO_MESSAGE_TYPE_FLUSHALLDATA:
+        // Entries are only held in memory, so there is nothing to flush
+        SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_SUCCESS, NULL);
+        break;
+    case KINETIC_PROTO_MESSAGE_TYPE_PUT:
+        HandlePut(sim, command, value, response);
+        break;
+    case KINETIC_PROTO_MESSAGE_TYPE_GET:
+    case KINETIC_PROTO_MESSAGE_TYPE_GETNEXT:
+    case KINETIC_PROTO_MESSAGE_TYPE_GETPREVIOUS:
+    case KINETIC_PROTO_MESSAGE_TYPE_GETVERSION:
+        HandleGet(sim, command, response);
+        break;
+    case KINETIC_PROTO_MESSAGE_TYPE_DELETE:
+        HandleDelete(sim, command, response);
+        break;
+    case KINETIC_PROTO_MESSAGE_TYPE_GETKEYRANGE:
+        HandleGetKeyRange(sim, command, response);
+        break;
+    case KINETIC_PROTO_MESSAGE_TYPE_GETLOG:
+        HandleGetLog(sim, command, response);
+        break;
+    case KINETIC_PROTO_MESSAGE_TYPE_PEER2PEERPUSH:
+        HandleP2PPush(sim, command, response);
+        break;
+    default:
+        SetStatus(response, KINETIC_PROTO_STATUS_STATUS_CODE_INVALID_REQUEST,
+                  "Operation not supported by simulator");
+        break;
+    }
+}
+
+static bool Reserve(uint8_t** buffer, size_t* capacity, size_t needed)
+{
+    if (needed <= *capacity) {
+        return true;
+    }
+    size_t newCapacity = (*capacity > 0) ? *capacity : SIMULATOR_READ_CHUNK;
+    while (newCapacity < needed) {
+        newCapacity *= 2;
+    }
+    uint8_t* newBuffer = realloc(*buffer, newCapacity);
+    if (newBuffer == NULL) {
+        return false;
+    }
+    *buffer = newBuffer;
+    *capacity = newCapacity;
+    return true;
+}
+
+// Handles a complete request PDU, appending the response PDU to the
+// connection output. Returns false if the connection should be dropped.
+static bool HandlePDU(KineticSimulator* sim, SimulatorConnection* conn,
+                      const uint8_t* protoData, size_t protoLen, ByteArray value)
+{
+    KineticProto* request = KineticProto__unpack(NULL, protoLen, protoData);
+    if (request == NULL || request->command == NULL || request->command->header == NULL) {
+        LOG_ERROR("Simulator received an invalid request protobuf");
+        if (request != NULL) {
+            KineticProto__free_unpacked(request, NULL);
+        }
+        return false;
+    }
+    const KineticProto_Header* requestHeader = request->command->header;
+    int messageType = requestHeader->has_messageType ? (int)requestHeader->messageType : 0;
+    if (messageType > 0 && messageType < KINETIC_STATS_MESSAGE_TYPES) {
+        sim->requestCounts[messageType]++;
+        sim->requestBytes[messageType] += PDU_HEADER_LEN + protoLen + value.len;
+    }
+
+    SimulatorResponse* response = sim->response;
+    response->proto = (KineticProto)KINETIC_PROTO__INIT;
+    response->command = (KineticProto_Command)KINETIC_PROTO_COMMAND__INIT;
+    response->header = (KineticProto_Header)KINETIC_PROTO_HEADER__INIT;
+    response->body = (KineticProto_Body)KINETIC_PROTO_BODY__INIT;
+    response->status = (KineticProto_Status)KINETIC_PROTO_STATUS__INIT;
+    response->keyValue = (KineticProto_KeyValue)KINETIC_PROTO_KEY_VALUE__INIT;
+    response->range = (KineticProto_Range)KINETIC_PROTO_RANGE__INIT;
+    response->getLog = (KineticProto_GetLog)KINETIC_PROTO_GET_LOG__INIT;
+    response->utilization = (KineticProto_GetLog_Utilization)KINETIC_PROTO_GET_LOG_UTILIZATION__INIT;
+    response->temperature = (KineticProto_GetLog_Temperature)KINETIC_PROTO_GET_LOG_TEMPERATURE__INIT;
+    response->capacity = (KineticProto_GetLog_Capacity)KINETIC_PROTO_GET_LOG_CAPACITY__INIT;
+    response->configuration = (KineticProto_GetLog_Configuration)KINETIC_PROTO_GET_LOG_CONFIGURATION__INIT;
+    response->limits = (KineticProto_GetLog_Limits)KINETIC_PROTO_GET_LOG_LIMITS__INIT;
+    response->p2pOperation = (KineticProto_P2POperation)KINETIC_PROTO_P2_POPERATION__INIT;
+    response->value = BYTE_ARRAY_NONE;
+
+    response->header.connectionID = conn->connectionID;
+    response->header.has_connectionID = true;
+    response->header.ackSequence = requestHeader->sequence;
+    response->header.has_ackSequence = requestHeader->has_sequence;
+    if (requestHeader->has_messageType) {
+        // Response message types precede the request types
+        response->header.messageType = requestHeader->messageType - 1;
+        response->header.has_messageType = true;
+    }
+
+    HandleCommand(sim, request, value, response);
+
+    response->command.header = &response->header;
+    response->command.body = &response->body;
+    response->command.status = &response->status;
+    response->proto.command = &response->command;
+    response->proto.hmac.data = response->hmacData;
+    KineticHMAC hmac;
+    KineticHMAC_Populate(&hmac, &response->proto, sim->config.hmacKey);
+
+    size_t packedLen = KineticProto__get_packed_size(&response->proto);
+    bool ok = Reserve(&conn->out, &conn->outCapacity,
+                      conn->outLen + PDU_HEADER_LEN + packedLen + response->value.len);
+    if (ok) {
+        uint8_t* pdu = &conn->out[conn->outLen];
+        uint32_t protoLenNBO = KineticNBO_FromHostU32(packedLen);
+        uint32_t valueLenNBO = KineticNBO_FromHostU32(response->value.len);
+        pdu[0] = 'F';
+        memcpy(&pdu[1], &protoLenNBO, sizeof(uint32_t));
+        memcpy(&pdu[5], &valueLenNBO, sizeof(uint32_t));
+        KineticProto__pack(&response->proto, &pdu[PDU_HEADER_LEN]);
+        if (response->value.len > 0) {
+            memcpy(&pdu[PDU_HEADER_LEN + packedLen], response->value.data, response->value.len);
+        }
+        conn->outLen += PDU_HEADER_LEN + packedLen + response->value.len;
+    }
+
+    KineticProto__free_unpacked(request, NULL);
+    return ok;
+}
+
+// Handles all complete requests received. Returns false if the connection
+// should be dropped.
+static bool HandleInput(KineticSimulator* sim, SimulatorConnection* conn)
+{
+    size_t offset = 0;
+    while (conn->inLen - offset >= PDU_HEADER_LEN) {
+        const uint8_t* pdu = &conn->in[offset];
+        uint32_t protoLen, valueLen;
+        memcpy(&protoLen, &pdu[1], sizeof(uint32_t));
+        memcpy(&valueLen, &pdu[5], sizeof(uint32_t));
+        protoLen = KineticNBO_ToHostU32(protoLen);
+        valueLen = KineticNBO_ToHostU32(valueLen);
+        if (pdu[0] != 'F' || protoLen > PDU_PROTO_MAX_LEN || valueLen > PDU_VALUE_MAX_LEN) {
+            LOG_ERROR("Simulator received an invalid PDU header");
+            return false;
+        }
+
+        size_t total = PDU_HEADER_LEN + protoLen + valueLen;
+        if (conn->inLen - offset < total) {
+            if (!Reserve(&conn->in, &conn->inCapacity, conn->inLen - offset + total)) {
+                return false;
+            }
+            break;
+        }
+
+        ByteArray value = {
+            .data = (uint8_t*)&pdu[PDU_HEADER_LEN + protoLen],
+            .len = valueLen,
+        };
+        if (!HandlePDU(sim, conn, &pdu[PDU_HEADER_LEN], protoLen, value)) {
+            return false;
+        }
+        offset += total;
+    }
+
+    if (offset > 0) {
+        memmove(conn->in, &conn->in[offset], conn->inLen - offset);
+        conn->inLen -= offset;
+    }
+    return true;
+}
+
+static void CloseConnection(KineticSimulator* sim, SimulatorConnection* conn)
+{
+    epoll_ctl(sim->epoll, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    if (conn->previous != NULL) {
+        conn->previous->next = conn->next;
+    }
+    else {
+        sim->connections = conn->next;
+    }
+    if (conn->next != NULL) {
+        conn->next->previous = conn->previous;
+    }
+    free(conn->in);
+    free(conn->out);
+    free(conn);
+}
+
+// Writes pending output, waiting for the socket to become writable if the
+// output does not fit. Returns false if the connection should be dropped.
+static bool FlushOutput(KineticSimulator* sim, SimulatorConnection* conn)
+{
+    while (conn->outSent < conn->outLen) {
+        ssize_t written = send(conn->fd, &conn->out[conn->outSent],
+                               conn->outLen - conn->outSent, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return false;
+        }
+        conn->outSent += written;
+    }
+
+    if (conn->outSent == conn->outLen) {
+        conn->outSent = conn->outLen = 0;
+    }
+
+    bool writable = (conn->outLen > 0);
+    if (writable != conn->writable) {
+        struct epoll_event event = {
+            .events = EPOLLIN | (writable ? EPOLLOUT : 0),
+            .data.ptr = conn,
+        };
+        if (epoll_ctl(sim->epoll, EPOLL_CTL_MOD, conn->fd, &event) != 0) {
+            return false;
+        }
+        conn->writable = writable;
+    }
+    return true;
+}
+
+static bool ReadInput(SimulatorConnection* conn)
+{
+    while (true) {
+        if (!Reserve(&conn->in, &conn->inCapacity, conn->inLen + SIMULATOR_READ_CHUNK)) {
+            return false;
+        }
+        ssize_t received = recv(conn->fd, &conn->in[conn->inLen],
+                                conn->inCapacity - conn->inLen, 0);
+        if (received > 0) {
+            conn->inLen += received;
+            KineticSimulatorSocket_QuickAck(conn->fd);
+            continue;
+        }
+        if (received == 0) {
+            return false; // Closed by the client
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        return (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+}
+
+static void AcceptConnections(KineticSimulator* sim)
+{
+    while (true) {
+        int fd = accept(sim->listener, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOGF_ERROR("Simulator failed accepting connection: %s", strerror(errno));
+            }
+            return;
+        }
+
+        int enabled = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+        SimulatorConnection* conn = calloc(1, sizeof(SimulatorConnection));
+        if (conn == NULL || !KineticSimulatorSocket_SetNonBlocking(fd)) {
+            free(conn);
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        pthread_mutex_lock(&sim->lock);
+        conn->connectionID = sim->nextConnectionID++;
+        pthread_mutex_unlock(&sim->lock);
+
+        struct epoll_event event = {.events = EPOLLIN, .data.ptr = conn};
+        if (epoll_ctl(sim->epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+            free(conn);
+            close(fd);
+            continue;
+        }
+        conn->next = sim->connections;
+        if (conn->next != NULL) {
+            conn->next->previous = conn;
+        }
+        sim->connections = conn;
+    }
+}
+
+static void* RunSimulator(void* arg)
+{
+    KineticSimulator* sim = arg;
+    struct epoll_event events[SIMULATOR_MAX_EVENTS];
+
+    while (true) {
+        int count = epoll_wait(sim->epoll, events, SIMULATOR_MAX_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOGF_ERROR("Simulator epoll_wait failed: %s", strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.ptr == &sim->listener) {
+                AcceptConnections(sim);
+                continue;
+            }
+            if (events[i].data.ptr == &sim->wakeFds) {
+                return NULL; // Stopping
+            }
+
+            SimulatorConnection* conn = events[i].data.ptr;
+            bool ok = true;
+            if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                // Handle any requests received before the connection closed
+                bool open = ReadInput(conn);
+                pthread_mutex_lock(&sim->lock);
+                ok = HandleInput(sim, conn) && open;
+                pthread_mutex_unlock(&sim->lock);
+            }
+            if (ok || conn->outLen > 0) {
+                ok = FlushOutput(sim, conn) && ok;
+            }
+            if (!ok) {
+                CloseConnection(sim, conn);
+            }
+        }
+    }
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+// In-process transport. Requests are handled in the client's thread as they
+// are written, and the responses buffered for the client to read, so no
+// sockets or system calls are involved.
+
+static KineticStatus MemoryConnect(KineticConnection* const connection)
+{
+    KineticSimulator* sim = connection->session.transport->context;
+    SimulatorConnection* conn = calloc(1, sizeof(SimulatorConnection));
+    if (conn == NULL) {
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    conn->fd = -1;
+    pthread_mutex_lock(&sim->lock);
+    conn->connectionID = sim->nextConnectionID++;
+    pthread_mutex_unlock(&sim->lock);
+    connection->transportState = conn;
+    return KINETIC_STATUS_SUCCESS;
+}
+
+static KineticStatus MemoryWritev(KineticConnection* const connection,
+                                  ByteBuffer* buffers[], int count)
+{
+    KineticSimulator* sim = connection->transport->context;
+    SimulatorConnection* conn = connection->transportState;
+    size_t total = 0;
+    for (int i = 0; i < count; i++) {
+        total += buffers[i]->bytesUsed;
+    }
+
+    pthread_mutex_lock(&sim->lock);
+    bool ok = Reserve(&conn->in, &conn->inCapacity, conn->inLen + total);
+    if (ok) {
+        for (int i = 0; i < count; i++) {
+            if (buffers[i]->bytesUsed > 0) {
+                memcpy(&conn->in[conn->inLen], buffers[i]->array.data, buffers[i]->bytesUsed);
+                conn->inLen += buffers[i]->bytesUsed;
+            }
+        }
+        ok = HandleInput(sim, conn);
+    }
+    pthread_cond_broadcast(&sim->output);
+    pthread_mutex_unlock(&sim->lock);
+
+    if (!ok) {
+        return KINETIC_STATUS_SOCKET_ERROR;
+    }
+    KineticStats_CountSent(total);
+    return KINETIC_STATUS_SUCCESS;
+}
+
+// Waits for the specified number of bytes of output, with the lock held
+static bool MemoryWaitForOutput(KineticSimulator* sim, SimulatorConnection* conn,
+                                size_t needed, int timeoutMs)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeoutMs / 1000;
+    deadline.tv_nsec += (timeoutMs % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    while (conn->outLen - conn->outSent < needed) {
+        if (pthread_cond_timedwait(&sim->output, &sim->lock, &deadline) == ETIMEDOUT) {
+            return (conn->outLen - conn->outSent >= needed);
+        }
+    }
+    return true;
+}
+
+static KineticStatus MemoryRead(KineticConnection* const connection,
+                                ByteBuffer* dest, size_t len)
+{
+    KineticSimulator* sim = connection->transport->context;
+    SimulatorConnection* conn = connection->transportState;
+    assert(dest->bytesUsed <= len);
+
+    // As for a socket, read "up to" the allocated number of bytes into the
+    // buffer, discarding the remainder
+    size_t needed = len - dest->bytesUsed;
+    size_t fit = (dest->array.len < len) ? dest->array.len : len;
+    pthread_mutex_lock(&sim->lock);
+    if (!MemoryWaitForOutput(sim, conn, needed, SIMULATOR_READ_TIMEOUT_MS)) {
+        pthread_mutex_unlock(&sim->lock);
+        LOG_ERROR("Timed out waiting for simulator response!");
+        return KINETIC_STATUS_SOCKET_TIMEOUT;
+    }
+    if (dest->bytesUsed < fit) {
+        memcpy(&dest->array.data[dest->bytesUsed], &conn->out[conn->outSent],
+               fit - dest->bytesUsed);
+        dest->bytesUsed = fit;
+    }
+    conn->outSent += needed;
+    if (conn->outSent == conn->outLen) {
+        conn->outSent = conn->outLen = 0;
+    }
+    pthread_mutex_unlock(&sim->lock);
+
+    KineticStats_CountReceived(needed);
+    return (fit < len) ? KINETIC_STATUS_BUFFER_OVERRUN : KINETIC_STATUS_SUCCESS;
+}
+
+static KineticStatus MemoryPoll(KineticConnection* const connection, int timeoutMs)
+{
+    KineticSimulator* sim = connection->transport->context;
+    SimulatorConnection* conn = connection->transportState;
+    pthread_mutex_lock(&sim->lock);
+    bool ready = MemoryWaitForOutput(sim, conn, 1, timeoutMs);
+    pthread_mutex_unlock(&sim->lock);
+    return ready ? KINETIC_STATUS_SUCCESS : KINETIC_STATUS_SOCKET_TIMEOUT;
+}
+
+static void MemoryClose(KineticConnection* const connection)
+{
+    SimulatorConnection* conn = connection->transportState;
+    if (conn != NULL) {
+        free(conn->in);
+        free(conn->out);
+        free(conn);
+        connection->transportState = NULL;
+    }
+}
+
+KineticStatus KineticSimulator_Start(const KineticSimulatorConfig* config,
+                                     KineticSimulator** simulator)
+{
+    if (config == NULL || simulator == NULL) {
+        return KINETIC_STATUS_SESSION_EMPTY;
+    }
+    if (config->hmacKey.len > KINETIC_MAX_KEY_LEN) {
+        return KINETIC_STATUS_HMAC_EMPTY;
+    }
+    *simulator = NULL;
+
+    KineticSimulator* sim = calloc(1, sizeof(KineticSimulator));
+    if (sim == NULL) {
+        return KINETIC_STATUS_MEMORY_ERROR;
+    }
+    sim->config = *config;
+    if (config->hmacKey.data == NULL || config->hmacKey.len == 0) {
+        sim->config.hmacKey = ByteArray_CreateWithCString(SIMULATOR_DEFAULT_HMAC_KEY);
+        if (config->identity == 0) {
+            sim->config.identity = 1;
+        }
+    }
+    memcpy(sim->hmacKeyData, sim->config.hmacKey.data, sim->config.hmacKey.len);
+    sim->config.hmacKey.data = sim->hmacKeyData;
+    sim->config.host = NULL;
+    sim->nextConnectionID = 1;
+    sim->random = (config->seed != 0) ? config->seed : 0x9E3779B97F4A7C15ull;
+    if (sim->config.serviceBusyStormLength < 1) {
+        sim->config.serviceBusyStormLength = 1;
+    }
+    sim->listener = sim->epoll = sim->wakeFds[0] = sim->wakeFds[1] = -1;
+    pthread_mutex_init(&sim->lock, NULL);
+    pthread_cond_init(&sim->output, NULL);
+    sim->transport = (KineticTransport) {
+        .name = "simulator",
+        .context = sim,
+        .connect = MemoryConnect,
+        .writev = MemoryWritev,
+        .read = MemoryRead,
+        .poll = MemoryPoll,
+        .close = MemoryClose,
+    };
+
+    KineticStatus status = KINETIC_STATUS_CONNECTION_ERROR;
+    sim->store = KineticSimulatorStore_Create();
+    sim->response = malloc(sizeof(SimulatorResponse));
+    if (sim->store == NULL || sim->response == NULL) {
+        status = KINETIC_STATUS_MEMORY_ERROR;
+        goto failure;
+    }
+
+    sim->listener = KineticSimulatorSocket_Listen((config->host != NULL) ? config->host : "127.0.0.1", config->port);
+    if (sim->listener < 0) {
+        LOGF_ERROR("Simulator failed listening on port %d", config->port);
+        goto failure;
+    }
+    sim->port = KineticSimulatorSocket_GetPort(sim->listener);
+
+    sim->epoll = epoll_create(SIMULATOR_MAX_EVENTS);
+    if (sim->epoll < 0 || pipe(sim->wakeFds) != 0) {
+        goto failure;
+    }
+    struct epoll_event listenEvent = {.events = EPOLLIN, .data.ptr = &sim->listener};
+    struct epoll_event wakeEvent = {.events = EPOLLIN, .data.ptr = &sim->wakeFds};
+    if (epoll_ctl(sim->epoll, EPOLL_CTL_ADD, sim->listener, &listenEvent) != 0 ||
+        epoll_ctl(sim->epoll, EPOLL_CTL_ADD, sim->wakeFds[0], &wakeEvent) != 0) {
+        goto failure;
+    }
+
+    if (pthread_create(&sim->thread, NULL, RunSimulator, sim) != 0) {
+        goto failure;
+    }
+
+    LOGF("Simulator listening on port %d", sim->port);
+    *simulator = sim;
+    return KINETIC_STATUS_SUCCESS;
+
+failure:
+    if (sim->listener >= 0) {close(sim->listener);}
+    if (sim->epoll >= 0) {close(sim->epoll);}
+    if (sim->wakeFds[0] >= 0) {close(sim->wakeFds[0]);}
+    if (sim->wakeFds[1] >= 0) {close(sim->wakeFds[1]);}
+    KineticSimulatorStore_Destroy(sim->store);
+    pthread_mutex_destroy(&sim->lock);
+    pthread_cond_destroy(&sim->output);
+    free(sim->response);
+    free(sim);
+    return status;
+}
+
+int KineticSimulator_GetPort(const KineticSimulator* simulator)
+{
+    assert(simulator != NULL);
+    return simulator->port;
+}
+
+const KineticTransport* KineticSimulator_GetTransport(KineticSimulator* simulator)
+{
+    assert(simulator != NULL);
+    return &simulator->transport;
+}
+
+void KineticSimulator_Stop(KineticSimulator* simulator)
+{
+    if (simulator == NULL) {
+        return;
+    }
+
+    // Wake the server thread, then close whatever connections remain
+    uint8_t wake = 1;
+    while (write(simulator->wakeFds[1], &wake, 1) < 0 && errno == EINTR) {;}
+    pthread_join(simulator->thread, NULL);
+
+    while (simulator->connections != NULL) {
+        CloseConnection(simulator, simulator->connections);
+    }
+    close(simulator->listener);
+    close(simulator->wakeFds[0]);
+    close(simulator->wakeFds[1]);
+    close(simulator->epoll);
+    KineticSimulatorStore_Destroy(simulator->store);
+    pthread_mutex_destroy(&simulator->lock);
+    pthread_cond_destroy(&simulator->output);
+    free(simulator->response);
+    free(simulator);
+}
@@ -0,0 +1,91 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#ifndef _KINETIC_SIMULATOR_H
+#define _KINETIC_SIMULATOR_H
+
+#include "kinetic_types.h"
+
+// Lightweight Kinetic device simulator, which serves connections from a
+// background thread using the same PDU framing and HMAC scheme as a device.
+// Entries are kept in memory, so are lost when the simulator is stopped.
+//
+// Supported operations: NOOP, PUT, GET, DELETE, GETNEXT, GETPREVIOUS,
+// GETVERSION, GETKEYRANGE, GETLOG, FLUSHALLDATA and PEER2PEERPUSH (without
+// nested operations). Other operations are rejected with an INVALID_REQUEST
+// status. Entries are pushed to peers with the identity, HMAC key and
+// cluster version of the simulator.
+
+#define KINETIC_SIMULATOR_MAX_KEY_RANGE_COUNT (200)
+// Operations of a PEER2PEERPUSH, reported as the writes it may have outstanding
+#define KINETIC_SIMULATOR_MAX_P2P_OPERATIONS (64)
+
+typedef struct _KineticSimulatorConfig {
+    const char* host;       // Address to listen on (NULL for loopback)
+    int port;               // Port to listen on (0 for any free port)
+    int64_t clusterVersion; // Cluster version expected in requests
+    int64_t identity;       // Identity expected in requests
+    ByteArray hmacKey;      // HMAC key of the identity
+    uint64_t capacityBytes; // Nominal capacity reported by GETLOG (0 to report the bytes stored)
+
+    // Fault injection. Each request starts a storm of SERVICE_BUSY responses
+    // with the given probability, using a random sequence derived from the
+    // seed so that runs are repeatable.
+    double serviceBusyProbability;
+    int serviceBusyStormLength; // Requests rejected per storm (default 1)
+    uint64_t seed;
+} KineticSimulatorConfig;
+
+typedef struct _KineticSimulator KineticSimulator;
+
+/**
+ * @brief Starts a simulator listening on the configured address. Identity 1
+ * with HMAC key "asdfasdf" is used if no HMAC key is configured, matching the
+ * defaults of the Java simulator.
+ *
+ * @param config        Simulator configuration
+ * @param simulator     Populated with the running simulator
+ *
+ * @return              Returns the resulting KineticStatus
+ */
+KineticStatus KineticSimulator_Start(const KineticSimulatorConfig* config,
+                                     KineticSimulator** simulator);
+
+/**
+ * @brief Returns the port the simulator is listening on.
+ */
+int KineticSimulator_GetPort(const KineticSimulator* simulator);
+
+/**
+ * @brief Returns a transport connecting sessions to the simulator in-process,
+ * for use as the transport of a KineticSession. Requests are handled in the
+ * client's thread as they are written, without any sockets, so the client's
+ * own CPU cost can be measured. Sessions must be disconnected before the
+ * simulator is stopped.
+ */
+const KineticTransport* KineticSimulator_GetTransport(KineticSimulator* simulator);
+
+/**
+ * @brief Stops the simulator, closing all connections and discarding all
+ * entries.
+ */
+void KineticSimulator_Stop(KineticSimulator* simulator);
+
+#endif // _KINETIC_SIMULATOR_H
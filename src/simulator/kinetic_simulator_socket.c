@@ -0,0 +1,123 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#include "kinetic_simulator_socket.h"
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+bool KineticSimulatorSocket_SetNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+void KineticSimulatorSocket_QuickAck(int fd)
+{
+#ifdef TCP_QUICKACK
+    int enabled = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &enabled, sizeof(enabled));
+#else
+    (void)fd;
+#endif
+}
+
+int KineticSimulatorSocket_Listen(const char* host, int port)
+{
+    char portString[16];
+    snprintf(portString, sizeof(portString), "%d", port);
+    struct addrinfo hints = {
+        .ai_family = AF_UNSPEC,
+        .ai_socktype = SOCK_STREAM,
+        .ai_flags = AI_PASSIVE,
+    };
+    struct addrinfo* addresses = NULL;
+    if (getaddrinfo(host, portString, &hints, &addresses) != 0) {
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo* ai = addresses; ai != NULL; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        int enabled = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof(enabled));
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 &&
+            listen(fd, SOMAXCONN) == 0 && KineticSimulatorSocket_SetNonBlocking(fd)) {
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(addresses);
+    return fd;
+}
+
+int KineticSimulatorSocket_GetPort(int fd)
+{
+    struct sockaddr_storage address;
+    socklen_t len = sizeof(address);
+    if (getsockname(fd, (struct sockaddr*)&address, &len) != 0) {
+        return -1;
+    }
+    if (address.ss_family == AF_INET6) {
+        return ntohs(((struct sockaddr_in6*)&address)->sin6_port);
+    }
+    return ntohs(((struct sockaddr_in*)&address)->sin_port);
+}
+
+int KineticSimulatorSocket_Connect(const char* host, int port)
+{
+    char portString[16];
+    snprintf(portString, sizeof(portString), "%d", port);
+    struct addrinfo hints = {
+        .ai_family = AF_UNSPEC,
+        .ai_socktype = SOCK_STREAM,
+    };
+    struct addrinfo* addresses = NULL;
+    if (getaddrinfo(host, portString, &hints, &addresses) != 0) {
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo* ai = addresses; ai != NULL; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0 &&
+            KineticSimulatorSocket_SetNonBlocking(fd)) {
+            int enabled = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(addresses);
+    return fd;
+}
@@ -0,0 +1,45 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#ifndef _KINETIC_SIMULATOR_SOCKET_H
+#define _KINETIC_SIMULATOR_SOCKET_H
+
+#include <stdbool.h>
+
+// Socket helpers shared by the simulator and the impairment proxy
+
+// Returns a non-blocking socket listening on the host and port (0 for any
+// free port), or -1 on failure
+int KineticSimulatorSocket_Listen(const char* host, int port);
+
+// Returns the port a socket is bound to, or -1 on failure
+int KineticSimulatorSocket_GetPort(int fd);
+
+// Returns a non-blocking socket connected to the host and port, with
+// TCP_NODELAY set, or -1 on failure
+int KineticSimulatorSocket_Connect(const char* host, int port);
+
+bool KineticSimulatorSocket_SetNonBlocking(int fd);
+
+// Acknowledges received data immediately. Clients write each PDU in pieces
+// without TCP_NODELAY, so delayed ACKs would stall them on Nagle's algorithm.
+void KineticSimulatorSocket_QuickAck(int fd);
+
+#endif // _KINETIC_SIMULATOR_SOCKET_H
@@ -0,0 +1,265 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#include "kinetic_simulator_store.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+// Entries are kept in a skip list, with a back link at the bottom level for
+// iterating in reverse. Each entry is a single allocation holding its links,
+// key and data, so an update of an entry's value replaces the entry.
+
+static KineticSimulatorEntry* NewEntry(int levels,
+    const ByteArray key, const ByteArray value, const ByteArray version,
+    const ByteArray tag, int32_t algorithm)
+{
+    size_t linksSize = levels * sizeof(KineticSimulatorEntry*);
+    size_t dataSize = key.len + value.len + version.len + tag.len;
+    KineticSimulatorEntry* entry = malloc(sizeof(KineticSimulatorEntry) + linksSize + dataSize);
+    if (entry == NULL) {
+        return NULL;
+    }
+    memset(entry, 0, sizeof(KineticSimulatorEntry) + linksSize);
+    entry->levels = levels;
+    entry->algorithm = algorithm;
+
+    uint8_t* data = (uint8_t*)&entry->next[levels];
+    ByteArray* fields[] = {&entry->key, &entry->value, &entry->version, &entry->tag};
+    const ByteArray sources[] = {key, value, version, tag};
+    for (int i = 0; i < 4; i++) {
+        *fields[i] = (ByteArray) {.data = data, .len = sources[i].len};
+        if (sources[i].len > 0) {
+            memcpy(data, sources[i].data, sources[i].len);
+        }
+        data += sources[i].len;
+    }
+    return entry;
+}
+
+static size_t EntryBytes(const KineticSimulatorEntry* entry)
+{
+    return entry->key.len + entry->value.len + entry->version.len + entry->tag.len;
+}
+
+static int RandomLevels(KineticSimulatorStore* store)
+{
+    // xorshift64, with each level 1/4 as likely as the one below
+    uint64_t x = store->random;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    store->random = x;
+
+    int levels = 1;
+    while (levels < KINETIC_SIMULATOR_STORE_MAX_LEVELS && (x & 3) == 0) {
+        levels++;
+        x >>= 2;
+    }
+    return levels;
+}
+
+int KineticSimulatorStore_CompareKeys(const ByteArray a, const ByteArray b)
+{
+    size_t len = (a.len < b.len) ? a.len : b.len;
+    int result = (len > 0) ? memcmp(a.data, b.data, len) : 0;
+    if (result == 0) {
+        result = (a.len > b.len) - (a.len < b.len);
+    }
+    return result;
+}
+
+// Finds the last entry before the key at each level
+static void FindPredecessors(KineticSimulatorStore* store, const ByteArray key,
+                             KineticSimulatorEntry** predecessors)
+{
+    KineticSimulatorEntry* entry = store->head;
+    for (int level = KINETIC_SIMULATOR_STORE_MAX_LEVELS - 1; level >= 0; level--) {
+        while (entry->next[level] != NULL &&
+               KineticSimulatorStore_CompareKeys(entry->next[level]->key, key) < 0) {
+            entry = entry->next[level];
+        }
+        predecessors[level] = entry;
+    }
+}
+
+KineticSimulatorStore* KineticSimulatorStore_Create(void)
+{
+    KineticSimulatorStore* store = calloc(1, sizeof(KineticSimulatorStore));
+    if (store == NULL) {
+        return NULL;
+    }
+    store->head = NewEntry(KINETIC_SIMULATOR_STORE_MAX_LEVELS,
+                           BYTE_ARRAY_NONE, BYTE_ARRAY_NONE, BYTE_ARRAY_NONE,
+                           BYTE_ARRAY_NONE, 0);
+    if (store->head == NULL) {
+        free(store);
+        return NULL;
+    }
+    store->random = 0x2545F4914F6CDD1Dull;
+    return store;
+}
+
+void KineticSimulatorStore_Clear(KineticSimulatorStore* store)
+{
+    assert(store != NULL);
+    KineticSimulatorEntry* entry = store->head->next[0];
+    while (entry != NULL) {
+        KineticSimulatorEntry* next = entry->next[0];
+        free(entry);
+        entry = next;
+    }
+    memset(store->head->next, 0,
+           KINETIC_SIMULATOR_STORE_MAX_LEVELS * sizeof(KineticSimulatorEntry*));
+    store->count = 0;
+    store->bytes = 0;
+}
+
+void KineticSimulatorStore_Destroy(KineticSimulatorStore* store)
+{
+    if (store != NULL) {
+        KineticSimulatorStore_Clear(store);
+        free(store->head);
+        free(store);
+    }
+}
+
+KineticSimulatorEntry* KineticSimulatorStore_Get(KineticSimulatorStore* store,
+    const ByteArray key)
+{
+    KineticSimulatorEntry* entry = KineticSimulatorStore_Next(store, key, true);
+    if (entry != NULL && KineticSimulatorStore_CompareKeys(entry->key, key) == 0) {
+        return entry;
+    }
+    return NULL;
+}
+
+KineticSimulatorEntry* KineticSimulatorStore_Put(KineticSimulatorStore* store,
+    const ByteArray key, const ByteArray value, const ByteArray version,
+    const ByteArray tag, int32_t algorithm)
+{
+    assert(store != NULL);
+    KineticSimulatorEntry* predecessors[KINETIC_SIMULATOR_STORE_MAX_LEVELS];
+    FindPredecessors(store, key, predecessors);
+
+    KineticSimulatorEntry* existing = predecessors[0]->next[0];
+    if (existing != NULL && KineticSimulatorStore_CompareKeys(existing->key, key) != 0) {
+        existing = NULL;
+    }
+
+    int levels = (existing != NULL) ? existing->levels : RandomLevels(store);
+    KineticSimulatorEntry* entry = NewEntry(levels, key, value, version, tag, algorithm);
+    if (entry == NULL) {
+        return NULL;
+    }
+
+    KineticSimulatorEntry* following = (existing != NULL) ?
+        existing->next[0] : predecessors[0]->next[0];
+    for (int level = 0; level < levels; level++) {
+        entry->next[level] = (existing != NULL) ?
+            existing->next[level] : predecessors[level]->next[level];
+        predecessors[level]->next[level] = entry;
+    }
+    entry->previous = (predecessors[0] == store->head) ? NULL : predecessors[0];
+    if (following != NULL) {
+        following->previous = entry;
+    }
+
+    if (existing != NULL) {
+        store->bytes -= EntryBytes(existing);
+        free(existing);
+    }
+    else {
+        store->count++;
+    }
+    store->bytes += EntryBytes(entry);
+    return entry;
+}
+
+bool KineticSimulatorStore_Delete(KineticSimulatorStore* store, const ByteArray key)
+{
+    assert(store != NULL);
+    KineticSimulatorEntry* predecessors[KINETIC_SIMULATOR_STORE_MAX_LEVELS];
+    FindPredecessors(store, key, predecessors);
+
+    KineticSimulatorEntry* entry = predecessors[0]->next[0];
+    if (entry == NULL || KineticSimulatorStore_CompareKeys(entry->key, key) != 0) {
+        return false;
+    }
+
+    for (int level = 0; level < entry->levels; level++) {
+        predecessors[level]->next[level] = entry->next[level];
+    }
+    if (entry->next[0] != NULL) {
+        entry->next[0]->previous = entry->previous;
+    }
+    store->count--;
+    store->bytes -= EntryBytes(entry);
+    free(entry);
+    return true;
+}
+
+KineticSimulatorEntry* KineticSimulatorStore_Next(KineticSimulatorStore* store,
+    const ByteArray key, bool inclusive)
+{
+    assert(store != NULL);
+    KineticSimulatorEntry* predecessors[KINETIC_SIMULATOR_STORE_MAX_LEVELS];
+    FindPredecessors(store, key, predecessors);
+
+    KineticSimulatorEntry* entry = predecessors[0]->next[0];
+    if (entry != NULL && !inclusive &&
+        KineticSimulatorStore_CompareKeys(entry->key, key) == 0) {
+        entry = entry->next[0];
+    }
+    return entry;
+}
+
+KineticSimulatorEntry* KineticSimulatorStore_Previous(KineticSimulatorStore* store,
+    const ByteArray key, bool inclusive)
+{
+    assert(store != NULL);
+    KineticSimulatorEntry* predecessors[KINETIC_SIMULATOR_STORE_MAX_LEVELS];
+    FindPredecessors(store, key, predecessors);
+
+    KineticSimulatorEntry* entry = predecessors[0]->next[0];
+    if (inclusive && entry != NULL &&
+        KineticSimulatorStore_CompareKeys(entry->key, key) == 0) {
+        return entry;
+    }
+    return (predecessors[0] == store->head) ? NULL : predecessors[0];
+}
+
+KineticSimulatorEntry* KineticSimulatorStore_First(KineticSimulatorStore* store)
+{
+    assert(store != NULL);
+    return store->head->next[0];
+}
+
+KineticSimulatorEntry* KineticSimulatorStore_Last(KineticSimulatorStore* store)
+{
+    assert(store != NULL);
+    KineticSimulatorEntry* entry = store->head;
+    for (int level = KINETIC_SIMULATOR_STORE_MAX_LEVELS - 1; level >= 0; level--) {
+        while (entry->next[level] != NULL) {
+            entry = entry->next[level];
+        }
+    }
+    return (entry == store->head) ? NULL : entry;
+}
@@ -0,0 +1,73 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#ifndef _KINETIC_SIMULATOR_STORE_H
+#define _KINETIC_SIMULATOR_STORE_H
+
+#include "kinetic_types.h"
+
+// In-memory key/value store of the simulator, ordered by key (compared
+// bytewise, with a prefix ordered before longer keys). Not thread-safe.
+
+#define KINETIC_SIMULATOR_STORE_MAX_LEVELS (24)
+
+typedef struct _KineticSimulatorEntry KineticSimulatorEntry;
+struct _KineticSimulatorEntry {
+    ByteArray key;
+    ByteArray value;
+    ByteArray version;
+    ByteArray tag;
+    int32_t algorithm;
+    KineticSimulatorEntry* previous;
+    int levels;
+    KineticSimulatorEntry* next[];
+};
+
+typedef struct _KineticSimulatorStore {
+    KineticSimulatorEntry* head;
+    uint64_t random;
+    size_t count;
+    size_t bytes;
+} KineticSimulatorStore;
+
+KineticSimulatorStore* KineticSimulatorStore_Create(void);
+void KineticSimulatorStore_Destroy(KineticSimulatorStore* store);
+void KineticSimulatorStore_Clear(KineticSimulatorStore* store);
+
+KineticSimulatorEntry* KineticSimulatorStore_Get(KineticSimulatorStore* store,
+    const ByteArray key);
+KineticSimulatorEntry* KineticSimulatorStore_Put(KineticSimulatorStore* store,
+    const ByteArray key, const ByteArray value, const ByteArray version,
+    const ByteArray tag, int32_t algorithm);
+bool KineticSimulatorStore_Delete(KineticSimulatorStore* store,
+    const ByteArray key);
+
+// First entry after (or at, if inclusive) the key
+KineticSimulatorEntry* KineticSimulatorStore_Next(KineticSimulatorStore* store,
+    const ByteArray key, bool inclusive);
+// Last entry before (or at, if inclusive) the key
+KineticSimulatorEntry* KineticSimulatorStore_Previous(KineticSimulatorStore* store,
+    const ByteArray key, bool inclusive);
+KineticSimulatorEntry* KineticSimulatorStore_First(KineticSimulatorStore* store);
+KineticSimulatorEntry* KineticSimulatorStore_Last(KineticSimulatorStore* store);
+
+int KineticSimulatorStore_CompareKeys(const ByteArray a, const ByteArray b);
+
+#endif // _KINETIC_SIMULATOR_STORE_H
@@ -0,0 +1,174 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#include "kinetic_simulator.h"
+#include "kinetic_impairment_proxy.h"
+#include "kinetic_client.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <signal.h>
+#include <pthread.h>
+
+static void Usage(const char* program)
+{
+    printf("Usage: %s [options]\n"
+           "  --host HOST             Address to listen on (default: 127.0.0.1)\n"
+           "  --port PORT             Port to listen on, 0 for any (default: %d)\n"
+           "  --identity ID           Identity of the client (default: 1)\n"
+           "  --hmac-key KEY          HMAC key of the identity (default: asdfasdf)\n"
+           "  --cluster-version N     Cluster version of the device (default: 0)\n"
+           "  --log FILE              Log file, or NONE (default: NONE)\n"
+           "  --capacity BYTES        Capacity reported by GETLOG (default: bytes stored)\n"
+           "\n"
+           "Fault injection:\n"
+           "  --seed N                Seed of random faults (default: 1)\n"
+           "  --busy-probability P    Probability of a request starting a SERVICE_BUSY storm\n"
+           "  --busy-storm N          Requests rejected in each storm (default: 1)\n"
+           "\n"
+           "Network impairment, applied in each direction by a proxy on PORT:\n"
+           "  --latency MS            Delay added to all data\n"
+           "  --jitter MS             Additional random delay, up to this\n"
+           "  --bandwidth BYTES       Bytes per second\n"
+           "  --stall-probability P   Probability of each write stalling\n"
+           "  --stall MS              Duration of each stall (default: 100)\n"
+           "  --max-write N           Forward data in random writes of up to N bytes\n"
+           "  --reset-probability P   Probability of each write resetting the connection\n",
+           program, KINETIC_PORT);
+}
+
+int main(int argc, char** argv)
+{
+    static char hmacKey[KINETIC_MAX_KEY_LEN + 1] = "asdfasdf";
+    const char* logFile = "NONE";
+    KineticSimulatorConfig config = {
+        .host = "127.0.0.1",
+        .port = KINETIC_PORT,
+        .identity = 1,
+        .seed = 1,
+    };
+    KineticImpairmentProxyConfig proxyConfig = {
+        .stallMs = 100,
+    };
+
+    struct option long_options[] = {
+        {"host",              required_argument, 0, 'h'},
+        {"port",              required_argument, 0, 'p'},
+        {"identity",          required_argument, 0, 'i'},
+        {"hmac-key",          required_argument, 0, 'k'},
+        {"cluster-version",   required_argument, 0, 'c'},
+        {"log",               required_argument, 0, 'l'},
+        {"capacity",          required_argument, 0, 'C'},
+        {"seed",              required_argument, 0, 'S'},
+        {"busy-probability",  required_argument, 0, 'B'},
+        {"busy-storm",        required_argument, 0, 'N'},
+        {"latency",           required_argument, 0, 'L'},
+        {"jitter",            required_argument, 0, 'J'},
+        {"bandwidth",         required_argument, 0, 'W'},
+        {"stall-probability", required_argument, 0, 'P'},
+        {"stall",             required_argument, 0, 'T'},
+        {"max-write",         required_argument, 0, 'M'},
+        {"reset-probability", required_argument, 0, 'R'},
+        {"help",              no_argument,       0, '?'},
+        {0,                   0,                 0, 0},
+    };
+
+    int option, optionIndex = 0;
+    while ((option = getopt_long(argc, argv, "h:p:", long_options, &optionIndex)) != -1) {
+        switch (option) {
+        case 'h': config.host = optarg; break;
+        case 'p': config.port = atoi(optarg); break;
+        case 'i': config.identity = strtoll(optarg, NULL, 10); break;
+        case 'k':
+            strncpy(hmacKey, optarg, sizeof(hmacKey) - 1);
+            break;
+        case 'c': config.clusterVersion = strtoll(optarg, NULL, 10); break;
+        case 'l': logFile = optarg; break;
+        case 'C': config.capacityBytes = strtoull(optarg, NULL, 10); break;
+        case 'S': config.seed = strtoull(optarg, NULL, 10); break;
+        case 'B': config.serviceBusyProbability = atof(optarg); break;
+        case 'N': config.serviceBusyStormLength = atoi(optarg); break;
+        case 'L': proxyConfig.latencyMs = atoi(optarg); break;
+        case 'J': proxyConfig.jitterMs = atoi(optarg); break;
+        case 'W': proxyConfig.bandwidth = strtoll(optarg, NULL, 10); break;
+        case 'P': proxyConfig.stallProbability = atof(optarg); break;
+        case 'T': proxyConfig.stallMs = atoi(optarg); break;
+        case 'M': proxyConfig.maxWriteSize = strtoul(optarg, NULL, 10); break;
+        case 'R': proxyConfig.resetProbability = atof(optarg); break;
+        default:
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    config.hmacKey = ByteArray_CreateWithCString(hmacKey);
+    KineticClient_Init(logFile);
+
+    // Block termination signals in all threads, so they can be waited for
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    // Impair the network with a proxy in front of the simulator, if requested
+    bool impaired = proxyConfig.latencyMs > 0 || proxyConfig.jitterMs > 0 ||
+                    proxyConfig.bandwidth > 0 || proxyConfig.stallProbability > 0 ||
+                    proxyConfig.maxWriteSize > 0 || proxyConfig.resetProbability > 0;
+    if (impaired) {
+        proxyConfig.host = config.host;
+        proxyConfig.port = config.port;
+        proxyConfig.seed = config.seed;
+        config.host = "127.0.0.1";
+        config.port = 0;
+    }
+
+    KineticSimulator* simulator = NULL;
+    KineticStatus status = KineticSimulator_Start(&config, &simulator);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        fprintf(stderr, "Failed starting simulator on %s:%d (status: %s)\n",
+                config.host, config.port, Kinetic_GetStatusDescription(status));
+        return 1;
+    }
+    KineticImpairmentProxy* proxy = NULL;
+    if (impaired) {
+        proxyConfig.targetPort = KineticSimulator_GetPort(simulator);
+        status = KineticImpairmentProxy_Start(&proxyConfig, &proxy);
+        if (status != KINETIC_STATUS_SUCCESS) {
+            fprintf(stderr, "Failed starting impairment proxy on %s:%d (status: %s)\n",
+                    proxyConfig.host, proxyConfig.port, Kinetic_GetStatusDescription(status));
+            KineticSimulator_Stop(simulator);
+            return 1;
+        }
+    }
+    printf("Kinetic simulator listening on %s:%d%s\n",
+           impaired ? proxyConfig.host : config.host,
+           impaired ? KineticImpairmentProxy_GetPort(proxy) : KineticSimulator_GetPort(simulator),
+           impaired ? " (impaired)" : "");
+    fflush(stdout);
+
+    int received = 0;
+    sigwait(&signals, &received);
+
+    KineticImpairmentProxy_Stop(proxy);
+    KineticSimulator_Stop(simulator);
+    printf("Kinetic simulator stopped\n");
+    return 0;
+}
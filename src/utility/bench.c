@@ -0,0 +1,778 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+// kinetic-bench: load generator for a Kinetic device or simulator.
+//
+// Worker threads issue a configurable mix of operations over a shared set of
+// sessions, against keys drawn from a uniform or zipfian distribution. Each
+// session carries one operation at a time, since the client API is
+// synchronous, so the concurrency of the load is the number of threads, up to
+// the number of connections. Latency percentiles are taken from the
+// process-wide statistics collected by the client library.
+
+#include "kinetic_client.h"
+#include "kinetic_proto.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+
+#define BENCH_MAX_THREADS (1024)
+#define BENCH_KEY_LEN_MAX (64)
+
+typedef enum _BenchOp {
+    BENCH_OP_NOOP = 0,
+    BENCH_OP_PUT,
+    BENCH_OP_GET,
+    BENCH_OP_DELETE,
+    BENCH_OP_COUNT
+} BenchOp;
+
+// Names and request message type codes, which index the latency histograms
+static const struct {
+    const char* name;
+    int messageType;
+} BenchOps[BENCH_OP_COUNT] = {
+    [BENCH_OP_NOOP] = {"noop", KINETIC_PROTO_MESSAGE_TYPE_NOOP},
+    [BENCH_OP_PUT] = {"put", KINETIC_PROTO_MESSAGE_TYPE_PUT},
+    [BENCH_OP_GET] = {"get", KINETIC_PROTO_MESSAGE_TYPE_GET},
+    [BENCH_OP_DELETE] = {"delete", KINETIC_PROTO_MESSAGE_TYPE_DELETE},
+};
+
+static struct {
+    char host[HOST_NAME_MAX];
+    int port;
+    int useTls;
+    char hmacKey[KINETIC_MAX_KEY_LEN];
+    const char* logFile;
+    unsigned mix[BENCH_OP_COUNT];
+    unsigned mixTotal;
+    uint64_t keys;
+    const char* keyPrefix;
+    int zipfian;
+    double theta;
+    size_t valueMin;
+    size_t valueMax;
+    int threads;
+    int connections;
+    double duration;
+    double rate;
+    double interval;
+    int prefill;
+    int json;
+    uint64_t seed;
+} Config = {
+    .host = "localhost",
+    .port = KINETIC_PORT,
+    .hmacKey = "asdfasdf",
+    .logFile = "NONE",
+    .mix = {[BENCH_OP_PUT] = 50, [BENCH_OP_GET] = 50},
+    .mixTotal = 100,
+    .keys = 10000,
+    .keyPrefix = "kbench",
+    .theta = 0.99,
+    .valueMin = 4096,
+    .valueMax = 4096,
+    .threads = 1,
+    .connections = 0, // One per thread
+    .duration = 10.0,
+    .interval = 1.0,
+    .seed = 1,
+};
+
+static uint8_t HmacData[KINETIC_MAX_KEY_LEN];
+static KineticSessionHandle* Sessions;
+static pthread_mutex_t* SessionLocks;
+static bool SessionsShared;
+static int Stopping;
+
+// Operations executed and failed by type, counted by the workers
+static uint64_t OpCounts[BENCH_OP_COUNT];
+static uint64_t OpFailures[BENCH_OP_COUNT];
+static uint64_t FailuresByStatus[KINETIC_STATUS_COUNT];
+
+// Zipfian generator constants (Gray et al., "Quickly Generating
+// Billion-Record Synthetic Databases"), computed once for the key space
+static struct {
+    double alpha;
+    double zetan;
+    double eta;
+    double halfPowTheta;
+} Zipf;
+
+typedef struct _BenchWorker {
+    pthread_t thread;
+    int index;
+    uint64_t random;
+    uint8_t* value;
+    bool prefillOnly;
+} BenchWorker;
+
+static uint64_t NowNanoseconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static void SleepNanoseconds(uint64_t nanoseconds)
+{
+    struct timespec delay = {
+        .tv_sec = nanoseconds / 1000000000ull,
+        .tv_nsec = nanoseconds % 1000000000ull,
+    };
+    while (nanosleep(&delay, &delay) != 0 && errno == EINTR) {;}
+}
+
+// xorshift64* generator, seeded per worker so runs are repeatable
+static uint64_t NextRandom(uint64_t* state)
+{
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 2685821657736338717ull;
+}
+
+static double NextRandomDouble(uint64_t* state)
+{
+    return (NextRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void InitZipfian(uint64_t n, double theta)
+{
+    double zeta2 = 1.0 + pow(0.5, theta);
+    double zetan = 0.0;
+    for (uint64_t i = 1; i <= n; i++) {
+        zetan += 1.0 / pow((double)i, theta);
+    }
+    Zipf.alpha = 1.0 / (1.0 - theta);
+    Zipf.zetan = zetan;
+    Zipf.eta = (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+    Zipf.halfPowTheta = pow(0.5, theta);
+}
+
+static uint64_t NextKeyIndex(uint64_t* random)
+{
+    if (!Config.zipfian) {
+        return NextRandom(random) % Config.keys;
+    }
+
+    double u = NextRandomDouble(random);
+    double uz = u * Zipf.zetan;
+    if (uz < 1.0) {
+        return 0;
+    }
+    if (uz < 1.0 + Zipf.halfPowTheta) {
+        return 1;
+    }
+    uint64_t index = (uint64_t)(Config.keys *
+                                pow(Zipf.eta * u - Zipf.eta + 1.0, Zipf.alpha));
+    return (index < Config.keys) ? index : Config.keys - 1;
+}
+
+static BenchOp NextOp(uint64_t* random)
+{
+    unsigned pick = NextRandom(random) % Config.mixTotal;
+    for (int op = 0; op < BENCH_OP_COUNT; op++) {
+        if (pick < Config.mix[op]) {
+            return (BenchOp)op;
+        }
+        pick -= Config.mix[op];
+    }
+    return BENCH_OP_NOOP;
+}
+
+static size_t NextValueSize(uint64_t* random)
+{
+    size_t range = Config.valueMax - Config.valueMin;
+    if (range == 0) {
+        return Config.valueMin;
+    }
+    return Config.valueMin + NextRandom(random) % (range + 1);
+}
+
+static KineticStatus ExecuteOp(BenchWorker* worker, BenchOp op, uint64_t keyIndex)
+{
+    // GET copies the stored tag back into the entry, so it must be writable
+    char tag[] = "kinetic-bench";
+    char key[BENCH_KEY_LEN_MAX];
+    int keyLen = snprintf(key, sizeof(key), "%s-%012llu",
+                          Config.keyPrefix, (unsigned long long)keyIndex);
+
+    KineticEntry entry = {
+        .key = ByteBuffer_Create(key, keyLen),
+        .tag = ByteBuffer_Create(tag, sizeof(tag) - 1),
+        .algorithm = KINETIC_ALGORITHM_SHA1,
+        .force = true,
+    };
+    entry.key.bytesUsed = keyLen;
+    entry.tag.bytesUsed = sizeof(tag) - 1;
+
+    int session = worker->index % Config.connections;
+    KineticSessionHandle handle = Sessions[session];
+    KineticStatus status;
+
+    if (SessionsShared) {
+        pthread_mutex_lock(&SessionLocks[session]);
+    }
+    switch (op) {
+    case BENCH_OP_PUT:
+        entry.value = ByteBuffer_Create(worker->value, Config.valueMax);
+        entry.value.bytesUsed = NextValueSize(&worker->random);
+        status = KineticClient_Put(handle, &entry);
+        break;
+    case BENCH_OP_GET:
+        entry.value = ByteBuffer_Create(worker->value, Config.valueMax);
+        status = KineticClient_Get(handle, &entry);
+        break;
+    case BENCH_OP_DELETE:
+        status = KineticClient_Delete(handle, &entry);
+        break;
+    default:
+        status = KineticClient_NoOp(handle);
+        break;
+    }
+    if (SessionsShared) {
+        pthread_mutex_unlock(&SessionLocks[session]);
+    }
+
+    __atomic_add_fetch(&OpCounts[op], 1, __ATOMIC_RELAXED);
+    if (status != KINETIC_STATUS_SUCCESS) {
+        __atomic_add_fetch(&OpFailures[op], 1, __ATOMIC_RELAXED);
+        if ((int)status >= 0 && status < KINETIC_STATUS_COUNT) {
+            __atomic_add_fetch(&FailuresByStatus[status], 1, __ATOMIC_RELAXED);
+        }
+    }
+    return status;
+}
+
+static void* RunWorker(void* arg)
+{
+    BenchWorker* worker = arg;
+
+    // Prefill stores every key once, split across the workers
+    if (worker->prefillOnly) {
+        for (uint64_t key = worker->index; key < Config.keys; key += Config.threads) {
+            ExecuteOp(worker, BENCH_OP_PUT, key);
+        }
+        return NULL;
+    }
+
+    // Rate limiting paces each worker at an equal share of the target rate
+    uint64_t pacing = (Config.rate > 0.0) ?
+        (uint64_t)(1e9 * Config.threads / Config.rate) : 0;
+    uint64_t next = NowNanoseconds();
+
+    while (!__atomic_load_n(&Stopping, __ATOMIC_RELAXED)) {
+        if (pacing > 0) {
+            uint64_t now = NowNanoseconds();
+            if (now < next) {
+                SleepNanoseconds(next - now);
+            }
+            else if (now - next > 1000000000ull) {
+                // Don't try to catch up after falling more than 1s behind
+                next = now;
+            }
+            next += pacing;
+        }
+        BenchOp op = NextOp(&worker->random);
+        ExecuteOp(worker, op, NextKeyIndex(&worker->random));
+    }
+    return NULL;
+}
+
+static bool RunWorkers(BenchWorker* workers, bool prefillOnly)
+{
+    for (int i = 0; i < Config.threads; i++) {
+        workers[i].prefillOnly = prefillOnly;
+        if (pthread_create(&workers[i].thread, NULL, RunWorker, &workers[i]) != 0) {
+            fprintf(stderr, "Failed creating worker thread %d\n", i);
+            __atomic_store_n(&Stopping, true, __ATOMIC_RELAXED);
+            for (int j = 0; j < i; j++) {
+                pthread_join(workers[j].thread, NULL);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+static void JoinWorkers(BenchWorker* workers)
+{
+    for (int i = 0; i < Config.threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+}
+
+// Latency observed between two snapshots of the process-wide statistics
+static void DiffHistogram(KineticLatencyHistogram* diff,
+                          const KineticLatencyHistogram* now,
+                          const KineticLatencyHistogram* then)
+{
+    diff->count = now->count - then->count;
+    diff->totalNanoseconds = now->totalNanoseconds - then->totalNanoseconds;
+    for (int i = 0; i < KINETIC_STATS_LATENCY_BUCKETS; i++) {
+        diff->buckets[i] = now->buckets[i] - then->buckets[i];
+    }
+}
+
+static double PercentileMicroseconds(const KineticLatencyHistogram* histogram,
+                                     double percentile)
+{
+    return KineticClient_GetLatencyPercentile(histogram, percentile) / 1000.0;
+}
+
+static void ReportInterval(double elapsed, double seconds,
+                           const KineticStats* now, const KineticStats* then,
+                           const uint64_t* failures, const uint64_t* lastFailures)
+{
+    KineticLatencyHistogram diff;
+    uint64_t total = 0;
+    for (int op = 0; op < BENCH_OP_COUNT; op++) {
+        int type = BenchOps[op].messageType;
+        total += now->latency[type].count - then->latency[type].count;
+    }
+
+    printf("[%7.1fs] %10.0f ops/s", elapsed, total / seconds);
+    for (int op = 0; op < BENCH_OP_COUNT; op++) {
+        if (Config.mix[op] == 0) {
+            continue;
+        }
+        int type = BenchOps[op].messageType;
+        DiffHistogram(&diff, &now->latency[type], &then->latency[type]);
+        printf(" | %s %.0f/s p50 %.0fus p99 %.0fus p999 %.0fus",
+               BenchOps[op].name, diff.count / seconds,
+               PercentileMicroseconds(&diff, 50.0),
+               PercentileMicroseconds(&diff, 99.0),
+               PercentileMicroseconds(&diff, 99.9));
+        if (failures[op] != lastFailures[op]) {
+            printf(" err %llu", (unsigned long long)(failures[op] - lastFailures[op]));
+        }
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+static void ReportSummary(double seconds, const KineticStats* stats)
+{
+    uint64_t total = 0;
+    for (int op = 0; op < BENCH_OP_COUNT; op++) {
+        total += stats->latency[BenchOps[op].messageType].count;
+    }
+
+    if (Config.json) {
+        printf("{\"duration_s\":%.3f,\"threads\":%d,\"connections\":%d,"
+               "\"keys\":%llu,\"distribution\":\"%s\",\"ops_per_s\":%.1f,\"ops\":{",
+               seconds, Config.threads, Config.connections,
+               (unsigned long long)Config.keys,
+               Config.zipfian ? "zipfian" : "uniform", total / seconds);
+        bool first = true;
+        for (int op = 0; op < BENCH_OP_COUNT; op++) {
+            if (Config.mix[op] == 0) {
+                continue;
+            }
+            const KineticLatencyHistogram* h = &stats->latency[BenchOps[op].messageType];
+            printf("%s\"%s\":{\"count\":%llu,\"errors\":%llu,\"ops_per_s\":%.1f,"
+                   "\"p50_us\":%.1f,\"p99_us\":%.1f,\"p999_us\":%.1f}",
+                   first ? "" : ",", BenchOps[op].name,
+                   (unsigned long long)h->count,
+                   (unsigned long long)OpFailures[op], h->count / seconds,
+                   PercentileMicroseconds(h, 50.0),
+                   PercentileMicroseconds(h, 99.0),
+                   PercentileMicroseconds(h, 99.9));
+            first = false;
+        }
+        printf("}}\n");
+        return;
+    }
+
+    printf("\n"
+           "Summary (%.1fs, %d threads, %d connections, %llu %s keys):\n"
+           "-----------------------------------------------------------------------------\n"
+           "  %-8s %12s %10s %12s %10s %10s %10s\n",
+           seconds, Config.threads, Config.connections,
+           (unsigned long long)Config.keys, Config.zipfian ? "zipfian" : "uniform",
+           "op", "count", "errors", "ops/s", "p50(us)", "p99(us)", "p999(us)");
+    for (int op = 0; op < BENCH_OP_COUNT; op++) {
+        if (Config.mix[op] == 0) {
+            continue;
+        }
+        const KineticLatencyHistogram* h = &stats->latency[BenchOps[op].messageType];
+        printf("  %-8s %12llu %10llu %12.1f %10.1f %10.1f %10.1f\n",
+               BenchOps[op].name,
+               (unsigned long long)h->count, (unsigned long long)OpFailures[op],
+               h->count / seconds,
+               PercentileMicroseconds(h, 50.0),
+               PercentileMicroseconds(h, 99.0),
+               PercentileMicroseconds(h, 99.9));
+    }
+    printf("  %-8s %12llu %10s %12.1f\n", "total",
+           (unsigned long long)total, "", total / seconds);
+
+    bool failed = false;
+    for (int status = 0; status < KINETIC_STATUS_COUNT; status++) {
+        if (FailuresByStatus[status] > 0) {
+            if (!failed) {
+                printf("\nFailures:\n");
+                failed = true;
+            }
+            printf("  %-40s %llu\n", Kinetic_GetStatusDescription(status),
+                   (unsigned long long)FailuresByStatus[status]);
+        }
+    }
+    printf("\n");
+}
+
+static bool ParseMix(const char* spec)
+{
+    unsigned mix[BENCH_OP_COUNT] = {0};
+    unsigned total = 0;
+    char buffer[256];
+    strncpy(buffer, spec, sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = '\0';
+
+    char* saveptr = NULL;
+    for (char* item = strtok_r(buffer, ",", &saveptr); item != NULL;
+         item = strtok_r(NULL, ",", &saveptr)) {
+        char* equals = strchr(item, '=');
+        if (equals == NULL) {
+            return false;
+        }
+        *equals = '\0';
+        int op;
+        for (op = 0; op < BENCH_OP_COUNT; op++) {
+            if (strcmp(item, BenchOps[op].name) == 0) {
+                break;
+            }
+        }
+        if (op == BENCH_OP_COUNT) {
+            return false;
+        }
+        mix[op] = (unsigned)strtoul(equals + 1, NULL, 10);
+        total += mix[op];
+    }
+    if (total == 0) {
+        return false;
+    }
+
+    memcpy(Config.mix, mix, sizeof(mix));
+    Config.mixTotal = total;
+    return true;
+}
+
+static bool ParseValueSize(const char* spec)
+{
+    char* end = NULL;
+    unsigned long min = strtoul(spec, &end, 10);
+    unsigned long max = min;
+    if (*end == '-') {
+        max = strtoul(end + 1, &end, 10);
+    }
+    if (*end != '\0' || min > max || max > PDU_VALUE_MAX_LEN) {
+        return false;
+    }
+    Config.valueMin = min;
+    Config.valueMax = max;
+    return true;
+}
+
+static void Usage(const char* program)
+{
+    printf("Usage: %s [options]\n"
+           "  --host HOST           Host to connect to (default: localhost)\n"
+           "  --port PORT           Port to connect to (default: %d, or %d with --tls)\n"
+           "  --tls                 Connect using TLS\n"
+           "  --hmac-key KEY        HMAC key (default: asdfasdf)\n"
+           "  --mix OP=W,...        Weights of noop/put/get/delete (default: put=50,get=50)\n"
+           "  --keys N              Size of the key space (default: 10000)\n"
+           "  --key-prefix PREFIX   Prefix of generated keys (default: kbench)\n"
+           "  --zipfian[=THETA]     Zipfian key distribution (default theta: 0.99)\n"
+           "  --value-size N[-M]    Value size in bytes, or uniform range (default: 4096)\n"
+           "  --threads N           Worker threads (default: 1)\n"
+           "  --connections N       Sessions shared by the workers (default: one per thread)\n"
+           "  --duration SECS       Duration of the run (default: 10)\n"
+           "  --rate OPS            Target total operations per second (default: unlimited)\n"
+           "  --interval SECS       Interval between progress reports, 0 for none (default: 1)\n"
+           "  --prefill             Store every key once before the run\n"
+           "  --seed N              Random seed (default: 1)\n"
+           "  --json                Print the summary as a single JSON object\n"
+           "  --log FILE            Client log file, or NONE (default: NONE)\n",
+           program, KINETIC_PORT, KINETIC_TLS_PORT);
+}
+
+static bool ParseOptions(int argc, char** argv)
+{
+    int port = 0;
+    struct option long_options[] = {
+        {"host",        required_argument, 0,               'h'},
+        {"port",        required_argument, 0,               'p'},
+        {"tls",         no_argument,       &Config.useTls,  true},
+        {"hmac-key",    required_argument, 0,               'k'},
+        {"mix",         required_argument, 0,               'm'},
+        {"keys",        required_argument, 0,               'n'},
+        {"key-prefix",  required_argument, 0,               'x'},
+        {"zipfian",     optional_argument, 0,               'z'},
+        {"value-size",  required_argument, 0,               'v'},
+        {"threads",     required_argument, 0,               't'},
+        {"connections", required_argument, 0,               'c'},
+        {"duration",    required_argument, 0,               'd'},
+        {"rate",        required_argument, 0,               'r'},
+        {"interval",    required_argument, 0,               'i'},
+        {"prefill",     no_argument,       &Config.prefill, true},
+        {"seed",        required_argument, 0,               's'},
+        {"json",        no_argument,       &Config.json,    true},
+        {"log",         required_argument, 0,               'l'},
+        {"help",        no_argument,       0,               '?'},
+        {0,             0,                 0,               0},
+    };
+
+    int option, optionIndex = 0;
+    while ((option = getopt_long(argc, argv, "h:p:t:c:d:r:", long_options, &optionIndex)) != -1) {
+        switch (option) {
+        case 0: break;
+        case 'h':
+            strncpy(Config.host, optarg, sizeof(Config.host) - 1);
+            break;
+        case 'p': port = atoi(optarg); break;
+        case 'k':
+            strncpy(Config.hmacKey, optarg, sizeof(Config.hmacKey) - 1);
+            break;
+        case 'm':
+            if (!ParseMix(optarg)) {
+                fprintf(stderr, "Invalid operation mix: '%s'\n", optarg);
+                return false;
+            }
+            break;
+        case 'n': Config.keys = strtoull(optarg, NULL, 10); break;
+        case 'x': Config.keyPrefix = optarg; break;
+        case 'z':
+            Config.zipfian = true;
+            if (optarg != NULL) {
+                Config.theta = atof(optarg);
+            }
+            break;
+        case 'v':
+            if (!ParseValueSize(optarg)) {
+                fprintf(stderr, "Invalid value size: '%s'\n", optarg);
+                return false;
+            }
+            break;
+        case 't': Config.threads = atoi(optarg); break;
+        case 'c': Config.connections = atoi(optarg); break;
+        case 'd': Config.duration = atof(optarg); break;
+        case 'r': Config.rate = atof(optarg); break;
+        case 'i': Config.interval = atof(optarg); break;
+        case 's': Config.seed = strtoull(optarg, NULL, 10); break;
+        case 'l': Config.logFile = optarg; break;
+        default:
+            Usage(argv[0]);
+            return false;
+        }
+    }
+
+    if (Config.keys == 0 || Config.threads < 1 || Config.threads > BENCH_MAX_THREADS ||
+        Config.connections < 0 || Config.duration <= 0.0 ||
+        Config.theta <= 0.0 || Config.theta >= 1.0 ||
+        strlen(Config.keyPrefix) > BENCH_KEY_LEN_MAX - 24) {
+        fprintf(stderr, "Invalid configuration specified\n");
+        Usage(argv[0]);
+        return false;
+    }
+
+    if (Config.connections == 0 || Config.connections > Config.threads) {
+        Config.connections = Config.threads;
+    }
+    if (port > 0) {
+        Config.port = port;
+    }
+    else if (Config.useTls) {
+        Config.port = KINETIC_TLS_PORT;
+    }
+    return true;
+}
+
+static bool Connect(void)
+{
+    KineticSession sessionConfig = {
+        .port = Config.port,
+        .useTls = Config.useTls,
+        .clusterVersion = 0,
+        .identity = 1,
+        .hmacKey = ByteArray_Create(HmacData, strlen(Config.hmacKey)),
+    };
+    memcpy(HmacData, Config.hmacKey, strlen(Config.hmacKey));
+    snprintf(sessionConfig.host, sizeof(sessionConfig.host), "%s", Config.host);
+
+    Sessions = calloc(Config.connections, sizeof(*Sessions));
+    SessionLocks = calloc(Config.connections, sizeof(*SessionLocks));
+    if (Sessions == NULL || SessionLocks == NULL) {
+        fprintf(stderr, "Failed allocating sessions\n");
+        return false;
+    }
+    SessionsShared = (Config.connections < Config.threads);
+
+    for (int i = 0; i < Config.connections; i++) {
+        pthread_mutex_init(&SessionLocks[i], NULL);
+    }
+    for (int i = 0; i < Config.connections; i++) {
+        KineticStatus status = KineticClient_Connect(&sessionConfig, &Sessions[i]);
+        if (status != KINETIC_STATUS_SUCCESS) {
+            fprintf(stderr, "Failed connecting to host %s:%d (status: %s)\n",
+                    Config.host, Config.port, Kinetic_GetStatusDescription(status));
+            return false;
+        }
+    }
+    return true;
+}
+
+static void Disconnect(void)
+{
+    if (Sessions == NULL || SessionLocks == NULL) {
+        free(Sessions);
+        free(SessionLocks);
+        return;
+    }
+    for (int i = 0; i < Config.connections; i++) {
+        if (Sessions[i] != KINETIC_HANDLE_INVALID) {
+            KineticClient_Disconnect(&Sessions[i]);
+        }
+        pthread_mutex_destroy(&SessionLocks[i]);
+    }
+    free(Sessions);
+    free(SessionLocks);
+}
+
+int main(int argc, char** argv)
+{
+    if (!ParseOptions(argc, argv)) {
+        return 1;
+    }
+
+    KineticClient_Init(Config.logFile);
+    if (Config.zipfian) {
+        InitZipfian(Config.keys, Config.theta);
+    }
+
+    BenchWorker* workers = calloc(Config.threads, sizeof(*workers));
+    if (workers == NULL) {
+        fprintf(stderr, "Failed allocating workers\n");
+        return 1;
+    }
+    for (int i = 0; i < Config.threads; i++) {
+        workers[i].index = i;
+        workers[i].random = (Config.seed + i + 1) * 0x9E3779B97F4A7C15ull;
+        workers[i].value = malloc(Config.valueMax > 0 ? Config.valueMax : 1);
+        if (workers[i].value == NULL) {
+            fprintf(stderr, "Failed allocating value buffers\n");
+            return 1;
+        }
+        for (size_t b = 0; b < Config.valueMax; b++) {
+            workers[i].value[b] = (uint8_t)(b * 31 + i);
+        }
+    }
+
+    int result = 1;
+    if (!Connect()) {
+        goto cleanup;
+    }
+
+    if (Config.prefill) {
+        printf("Prefilling %llu keys...\n", (unsigned long long)Config.keys);
+        if (!RunWorkers(workers, true)) {
+            goto cleanup;
+        }
+        JoinWorkers(workers);
+        memset(OpCounts, 0, sizeof(OpCounts));
+        memset(OpFailures, 0, sizeof(OpFailures));
+        memset(FailuresByStatus, 0, sizeof(FailuresByStatus));
+    }
+
+    KineticStats* last = calloc(1, sizeof(KineticStats));
+    KineticStats* now = calloc(1, sizeof(KineticStats));
+    if (last == NULL || now == NULL) {
+        fprintf(stderr, "Failed allocating statistics\n");
+        free(last);
+        free(now);
+        goto cleanup;
+    }
+    uint64_t lastFailures[BENCH_OP_COUNT] = {0};
+    uint64_t failures[BENCH_OP_COUNT];
+
+    KineticClient_ResetStats(KINETIC_HANDLE_INVALID);
+    uint64_t start = NowNanoseconds();
+    uint64_t end = start + (uint64_t)(Config.duration * 1e9);
+    uint64_t lastReport = start;
+    if (!RunWorkers(workers, false)) {
+        free(last);
+        free(now);
+        goto cleanup;
+    }
+
+    for (uint64_t t = NowNanoseconds(); t < end; t = NowNanoseconds()) {
+        uint64_t wait = end - t;
+        if (Config.interval > 0.0) {
+            uint64_t nextReport = lastReport + (uint64_t)(Config.interval * 1e9);
+            wait = (nextReport > t) ? nextReport - t : 0;
+            if (nextReport > end) {
+                wait = end - t;
+            }
+        }
+        SleepNanoseconds(wait);
+
+        // Skip reporting a final partial interval of less than half the period
+        t = NowNanoseconds();
+        if (Config.interval > 0.0 && (t - lastReport) >= Config.interval * 0.5e9) {
+            KineticClient_GetStats(KINETIC_HANDLE_INVALID, now);
+            for (int op = 0; op < BENCH_OP_COUNT; op++) {
+                failures[op] = __atomic_load_n(&OpFailures[op], __ATOMIC_RELAXED);
+            }
+            ReportInterval((t - start) / 1e9, (t - lastReport) / 1e9,
+                           now, last, failures, lastFailures);
+            KineticStats* swap = last;
+            last = now;
+            now = swap;
+            memcpy(lastFailures, failures, sizeof(failures));
+            lastReport = t;
+        }
+    }
+
+    __atomic_store_n(&Stopping, true, __ATOMIC_RELAXED);
+    JoinWorkers(workers);
+    double elapsed = (NowNanoseconds() - start) / 1e9;
+
+    KineticClient_GetStats(KINETIC_HANDLE_INVALID, now);
+    ReportSummary(elapsed, now);
+    free(last);
+    free(now);
+    result = 0;
+
+cleanup:
+    Disconnect();
+    for (int i = 0; i < Config.threads; i++) {
+        free(workers[i].value);
+    }
+    free(workers);
+    return result;
+}
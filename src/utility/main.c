@@ -179,6 +179,8 @@ void ReportOperationConfiguration(
            "  host: %s\n"
            "  port: %d\n"
            "  non-blocking: %s\n"
+           "  tls: %s\n"
+           "  tls CA file: %s\n"
            "  clusterVersion: %lld\n"
            "  identity: %lld\n"
            "  key: %zd bytes\n"
@@ -187,6 +189,8 @@ void ReportOperationConfiguration(
            config->host,
            config->port,
            config->nonBlocking ? "true" : "false",
+           config->useTls ? "true" : "false",
+           (config->tlsCAFile != NULL) ? config->tlsCAFile : "(not verified)",
            (long long int)config->clusterVersion,
            (long long int)config->identity,
            entry->key.bytesUsed,
@@ -205,6 +209,7 @@ void ParseOptions(
         int port;
         int nonBlocking;
         int useTls;
+        const char* tlsCAFile;
         int64_t clusterVersion;
         int64_t identity;
         char hmacKey[KINETIC_MAX_KEY_LEN];
@@ -217,6 +222,7 @@ void ParseOptions(
         .port = KINETIC_PORT,
         .nonBlocking = false,
         .useTls = false,
+        .tlsCAFile = NULL,
         .clusterVersion = 0,
         .identity = 1,
         .hmacKey = "asdfasdf",
@@ -230,7 +236,8 @@ void ParseOptions(
     struct option long_options[] = {
         {"non-blocking", no_argument,       &cfg.nonBlocking, true},
         {"blocking",     no_argument,       &cfg.nonBlocking, false},
-        {"tls",          no_argument,       &cfg.port,        KINETIC_TLS_PORT},
+        {"tls",          no_argument,       &cfg.useTls,      true},
+        {"tls-ca",       required_argument, 0,                'c'},
         {"host",         required_argument, 0,                'h'},
         {0,              0,                 0,                0},
     };
@@ -246,6 +253,8 @@ void ParseOptions(
             }
         // Configure host
         case 'h': strcpy(cfg.host, optarg); break;
+        // Verify the device with TLS against a CA or pinned certificate
+        case 'c': cfg.tlsCAFile = optarg; cfg.useTls = true; break;
         // Discard '?', since getopt_long already printed info
         case '?': break;
         // Abort upon error
@@ -253,9 +262,16 @@ void ParseOptions(
         }
     }
 
+    // Secure sessions are established on the TLS port
+    if (cfg.useTls) {
+        cfg.port = KINETIC_TLS_PORT;
+    }
+
     // Configure session for connection
     *sessionConfig = (KineticSession) {
         .port = cfg.port,
+         .useTls = cfg.useTls,
+         .tlsCAFile = cfg.tlsCAFile,
          .clusterVersion = cfg.clusterVersion,
           .identity = cfg.identity,
            .nonBlocking = cfg.nonBlocking,
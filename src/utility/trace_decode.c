@@ -0,0 +1,46 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#include "kinetic_trace.h"
+#include "kinetic_logger.h"
+#include <stdio.h>
+#include <string.h>
+
+// Renders a binary trace file, recorded by a client configured with
+// KineticClient_StartTrace(), into the library's text log format.
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 3 || strcmp(argv[1], "--help") == 0) {
+        fprintf(stderr, "Usage: %s <trace file> [output log file]\n", argv[0]);
+        return (argc == 2) ? 0 : -1;
+    }
+
+    KineticLogger_Init((argc == 3) ? argv[2] : "/dev/stdout");
+    KineticStatus status = KineticTrace_Render(argv[1]);
+    KineticLogger_Close();
+
+    if (status != KINETIC_STATUS_SUCCESS) {
+        fprintf(stderr, "Failed rendering trace file '%s' (status: %s)\n",
+                argv[1], Kinetic_GetStatusDescription(status));
+        return -1;
+    }
+    return 0;
+}
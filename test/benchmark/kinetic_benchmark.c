@@ -0,0 +1,682 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+// Microbenchmarks of the client's CPU hot paths, run with 'make bench'.
+//
+// Each benchmark is run with an increasing number of iterations until it runs
+// for at least the minimum benchmark time, and the result is written to STDOUT
+// as a JSON object per line:
+//
+//   {"name":"hmac_populate_put","iterations":262144,"ns_per_op":1843.2,
+//    "allocs_per_op":1.00,"bytes_per_op":117.0}
+//
+// Allocations are counted by wrapping malloc/calloc/realloc at link time
+// (-Wl,--wrap=...), so cover the library and vendored protobuf-c, but not
+// allocations made internally by shared libraries, such as OpenSSL.
+//
+// The simulator_* benchmarks run complete client operations against the C
+// simulator through its in-process transport, so measure the client's (and
+// simulator's) CPU cost per operation without any kernel networking.
+
+#include "kinetic_types_internal.h"
+#include "kinetic_allocator.h"
+#include "kinetic_hmac.h"
+#include "kinetic_logger.h"
+#include "kinetic_message.h"
+#include "kinetic_nbo.h"
+#include "kinetic_pdu.h"
+#include "kinetic_proto.h"
+#include "kinetic_socket.h"
+#include "kinetic_transport.h"
+#include "kinetic_client.h"
+#include "kinetic_erasure.h"
+#include "kinetic_simulator.h"
+#include "byte_array.h"
+#include "protobuf-c/protobuf-c.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define BENCH_MIN_TIME_DEFAULT (0.5)
+#define BENCH_MAX_ITERATIONS (1ull << 32)
+#define BENCH_CONTENDED_THREADS (4)
+#define BENCH_PACK_BUFFER_LEN (64 * 1024)
+
+//------------------------------------------------------------------------------
+// Allocation counting
+
+static uint64_t BenchAllocs = 0;
+static uint64_t BenchAllocBytes = 0;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+static inline void BenchCountAllocation(size_t bytes)
+{
+    __atomic_add_fetch(&BenchAllocs, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&BenchAllocBytes, bytes, __ATOMIC_RELAXED);
+}
+
+void* __wrap_malloc(size_t size)
+{
+    BenchCountAllocation(size);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+    BenchCountAllocation(count * size);
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size)
+{
+    BenchCountAllocation(size);
+    return __real_realloc(ptr, size);
+}
+
+//------------------------------------------------------------------------------
+// Benchmark fixtures
+
+static KineticConnection Connection;
+static uint8_t KeyData[32];
+static uint8_t TagData[20];
+static uint8_t VersionData[] = "v1.0";
+static KineticEntry Entry;
+static KineticPDU PutRequest;
+static KineticPDU GetRequest;
+static KineticPDU PutResponse;
+static KineticPDU GetResponse;
+static uint8_t PackBuffer[BENCH_PACK_BUFFER_LEN];
+static uint8_t PutResponsePacked[BENCH_PACK_BUFFER_LEN];
+static size_t PutResponsePackedLen;
+static uint8_t GetResponsePacked[BENCH_PACK_BUFFER_LEN];
+static size_t GetResponsePackedLen;
+static volatile uint64_t Sink;
+
+static void BuildMessage(KineticPDU* const pdu,
+                         KineticProto_MessageType messageType,
+                         const KineticEntry* const entry,
+                         bool success)
+{
+    KINETIC_PDU_INIT_WITH_MESSAGE(pdu, &Connection);
+    KineticMessage* message = &pdu->protoData.message;
+    message->header.messageType = messageType;
+    message->header.has_messageType = true;
+    if (entry != NULL) {
+        KineticMessage_ConfigureKeyValue(message, entry);
+    }
+    if (success) {
+        message->header.ackSequence = message->header.sequence;
+        message->header.has_ackSequence = true;
+        message->status.code = KINETIC_PROTO_STATUS_STATUS_CODE_SUCCESS;
+        message->status.has_code = true;
+        message->command.status = &message->status;
+    }
+    KineticHMAC_Populate(&pdu->hmac, &message->proto, Connection.session.hmacKey);
+}
+
+static void SetupFixtures(void)
+{
+    KINETIC_CONNECTION_INIT(&Connection);
+    Connection.session.hmacKey = ByteArray_CreateWithCString("asdfasdf");
+
+    memset(KeyData, 'k', sizeof(KeyData));
+    memset(TagData, 't', sizeof(TagData));
+    Entry = (KineticEntry) {
+        .key = ByteBuffer_Create(KeyData, sizeof(KeyData)),
+        .newVersion = ByteBuffer_Create(VersionData, strlen((char*)VersionData)),
+        .tag = ByteBuffer_Create(TagData, sizeof(TagData)),
+        .algorithm = KINETIC_ALGORITHM_SHA1,
+    };
+    Entry.key.bytesUsed = Entry.key.array.len;
+    Entry.newVersion.bytesUsed = Entry.newVersion.array.len;
+    Entry.tag.bytesUsed = Entry.tag.array.len;
+
+    KineticEntry getEntry = {.key = Entry.key};
+    KineticEntry getResponseEntry = Entry;
+    getResponseEntry.newVersion = BYTE_BUFFER_NONE;
+    getResponseEntry.dbVersion = Entry.newVersion;
+
+    BuildMessage(&PutRequest, KINETIC_PROTO_MESSAGE_TYPE_PUT, &Entry, false);
+    BuildMessage(&GetRequest, KINETIC_PROTO_MESSAGE_TYPE_GET, &getEntry, false);
+    BuildMessage(&PutResponse, KINETIC_PROTO_MESSAGE_TYPE_PUT_RESPONSE, NULL, true);
+    BuildMessage(&GetResponse, KINETIC_PROTO_MESSAGE_TYPE_GET_RESPONSE,
+                 &getResponseEntry, true);
+
+    PutResponsePackedLen = KineticProto__pack(PutResponse.proto, PutResponsePacked);
+    GetResponsePackedLen = KineticProto__pack(GetResponse.proto, GetResponsePacked);
+}
+
+//------------------------------------------------------------------------------
+// Protocol buffer packing/unpacking
+
+static void BenchPackPutRequest(uint64_t iterations)
+{
+    for (uint64_t i = 0; i < iterations; i++) {
+        Sink += KineticProto__pack(PutRequest.proto, PackBuffer);
+    }
+}
+
+static void BenchPackGetRequest(uint64_t iterations)
+{
+    for (uint64_t i = 0; i < iterations; i++) {
+        Sink += KineticProto__pack(GetRequest.proto, PackBuffer);
+    }
+}
+
+static void BenchUnpack(const uint8_t* packed, size_t len, uint64_t iterations)
+{
+    for (uint64_t i = 0; i < iterations; i++) {
+        KineticProto* proto = KineticProto__unpack(NULL, len, packed);
+        if (proto != NULL) {
+            KineticProto__free_unpacked(proto, NULL);
+        }
+    }
+}
+
+static void BenchUnpackPutResponse(uint64_t iterations)
+{
+    BenchUnpack(PutResponsePacked, PutResponsePackedLen, iterations);
+}
+
+static void BenchUnpackGetResponse(uint64_t iterations)
+{
+    BenchUnpack(GetResponsePacked, GetResponsePackedLen, iterations);
+}
+
+//------------------------------------------------------------------------------
+// HMAC calculation/validation
+
+static void BenchHMACPopulatePut(uint64_t iterations)
+{
+    for (uint64_t i = 0; i < iterations; i++) {
+        KineticHMAC_Populate(&PutRequest.hmac,
+                             PutRequest.proto, Connection.session.hmacKey);
+    }
+}
+
+static void BenchHMACValidateGetResponse(uint64_t iterations)
+{
+    for (uint64_t i = 0; i < iterations; i++) {
+        Sink += KineticHMAC_Validate(GetResponse.proto, Connection.session.hmacKey);
+    }
+}
+
+//------------------------------------------------------------------------------
+// Network byte order conversion
+
+static void BenchNBOU32(uint64_t iterations)
+{
+    uint32_t value = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        value += KineticNBO_ToHostU32(KineticNBO_FromHostU32((uint32_t)i));
+    }
+    Sink += value;
+}
+
+static void BenchNBOU64(uint64_t iterations)
+{
+    uint64_t value = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        value += KineticNBO_ToHostU64(KineticNBO_FromHostU64(i));
+    }
+    Sink += value;
+}
+
+//------------------------------------------------------------------------------
+// PDU allocation
+
+static KineticList SharedPDUs;
+
+static void BenchAllocatePDUs(KineticList* const list, uint64_t iterations)
+{
+    for (uint64_t i = 0; i < iterations; i++) {
+        KineticPDU* pdu = KineticAllocator_NewPDU(list);
+        KineticAllocator_FreePDU(list, pdu);
+    }
+}
+
+static void BenchAllocatorPDU(uint64_t iterations)
+{
+    KineticList list = {.start = NULL, .last = NULL};
+    BenchAllocatePDUs(&list, iterations);
+}
+
+static void* BenchAllocatorThread(void* arg)
+{
+    BenchAllocatePDUs(&SharedPDUs, *(uint64_t*)arg);
+    return NULL;
+}
+
+static void BenchAllocatorPDUContended(uint64_t iterations)
+{
+    pthread_t threads[BENCH_CONTENDED_THREADS];
+    uint64_t perThread = (iterations + BENCH_CONTENDED_THREADS - 1) / BENCH_CONTENDED_THREADS;
+    SharedPDUs = (KineticList) {.start = NULL, .last = NULL};
+    for (int i = 0; i < BENCH_CONTENDED_THREADS; i++) {
+        pthread_create(&threads[i], NULL, BenchAllocatorThread, &perThread);
+    }
+    for (int i = 0; i < BENCH_CONTENDED_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+//------------------------------------------------------------------------------
+// ByteBuffer appending
+
+static void BenchByteBufferAppend(uint64_t iterations)
+{
+    uint8_t chunk[64];
+    memset(chunk, 'a', sizeof(chunk));
+    ByteBuffer buffer = ByteBuffer_Create(PackBuffer, sizeof(PackBuffer));
+    for (uint64_t i = 0; i < iterations; i++) {
+        if (!ByteBuffer_Append(&buffer, chunk, sizeof(chunk))) {
+            ByteBuffer_Reset(&buffer);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// Loopback socket PDU round trip, against a thread which replies to each
+// request PDU with a canned NOOP response
+
+static int ListenSocket = -1;
+static int ServerSocket = -1;
+static pthread_t ServerThread;
+static uint8_t NoopResponse[BENCH_PACK_BUFFER_LEN];
+static size_t NoopResponseLen;
+
+static bool BenchReadFully(int fd, void* data, size_t len)
+{
+    for (size_t offset = 0; offset < len;) {
+        ssize_t result = read(fd, (uint8_t*)data + offset, len - offset);
+        if (result <= 0) {
+            return false;
+        }
+        offset += result;
+    }
+    return true;
+}
+
+static void* BenchServer(void* arg)
+{
+    (void)arg;
+    ServerSocket = accept(ListenSocket, NULL, NULL);
+    KineticPDUHeader header;
+    while (ServerSocket >= 0 && BenchReadFully(ServerSocket, &header, sizeof(header))) {
+        size_t len = KineticNBO_ToHostU32(header.protobufLength) +
+                     KineticNBO_ToHostU32(header.valueLength);
+        if (len > sizeof(PackBuffer) || !BenchReadFully(ServerSocket, PackBuffer, len)) {
+            break;
+        }
+        if (write(ServerSocket, NoopResponse, NoopResponseLen) != (ssize_t)NoopResponseLen) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static bool SetupLoopback(void)
+{
+    KineticPDU response;
+    BuildMessage(&response, KINETIC_PROTO_MESSAGE_TYPE_NOOP_RESPONSE, NULL, true);
+    uint32_t protobufLength = KineticProto__pack(response.proto, &NoopResponse[PDU_HEADER_LEN]);
+    KineticPDUHeader header = {
+        .versionPrefix = 'F',
+        .protobufLength = KineticNBO_FromHostU32(protobufLength),
+        .valueLength = 0,
+    };
+    memcpy(NoopResponse, &header, PDU_HEADER_LEN);
+    NoopResponseLen = PDU_HEADER_LEN + protobufLength;
+
+    struct sockaddr_in addr = {.sin_family = AF_INET};
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(addr);
+    ListenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (ListenSocket < 0 ||
+        bind(ListenSocket, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(ListenSocket, 1) != 0 ||
+        getsockname(ListenSocket, (struct sockaddr*)&addr, &addrLen) != 0 ||
+        pthread_create(&ServerThread, NULL, BenchServer, NULL) != 0) {
+        fprintf(stderr, "Failed setting up loopback server!\n");
+        return false;
+    }
+
+    Connection.socket = KineticSocket_Connect("localhost", ntohs(addr.sin_port), false);
+    Connection.connected = (Connection.socket >= 0);
+    Connection.transport = &KineticTransport_TCP;
+    return Connection.connected;
+}
+
+static void TeardownLoopback(void)
+{
+    if (Connection.socket >= 0) {
+        KineticSocket_Close(Connection.socket);
+        Connection.socket = -1;
+        Connection.connected = false;
+    }
+    Connection.transport = NULL;
+    pthread_join(ServerThread, NULL);
+    close(ServerSocket);
+    close(ListenSocket);
+}
+
+static void BenchSocketRoundTrip(uint64_t iterations)
+{
+    KineticPDU request, response;
+    for (uint64_t i = 0; i < iterations; i++) {
+        KINETIC_PDU_INIT_WITH_MESSAGE(&request, &Connection);
+        request.protoData.message.header.messageType = KINETIC_PROTO_MESSAGE_TYPE_NOOP;
+        request.protoData.message.header.has_messageType = true;
+        KINETIC_PDU_INIT(&response, &Connection);
+
+        KineticStatus status = KineticPDU_Send(&request);
+        if (status == KINETIC_STATUS_SUCCESS) {
+            status = KineticPDU_Receive(&response);
+        }
+        if (response.proto != NULL && response.protobufDynamicallyExtracted) {
+            KineticProto__free_unpacked(response.proto, NULL);
+        }
+        if (status != KINETIC_STATUS_SUCCESS) {
+            fprintf(stderr, "Loopback round trip failed: %s\n",
+                    Kinetic_GetStatusDescription(status));
+            exit(1);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// Client operations against the simulator, through its in-process transport
+
+#define BENCH_SIMULATOR_VALUE_LEN (4096)
+
+static KineticSimulator* Simulator;
+static KineticSessionHandle SimulatorHandle = KINETIC_HANDLE_INVALID;
+static uint8_t SimulatorValue[BENCH_SIMULATOR_VALUE_LEN];
+
+static bool SetupSimulator(void)
+{
+    KineticSimulatorConfig config = {.port = 0};
+    if (KineticSimulator_Start(&config, &Simulator) != KINETIC_STATUS_SUCCESS) {
+        fprintf(stderr, "Failed starting simulator!\n");
+        return false;
+    }
+    KineticSession session = {
+        .clusterVersion = 0,
+        .identity = 1,
+        .hmacKey = ByteArray_CreateWithCString("asdfasdf"),
+        .transport = KineticSimulator_GetTransport(Simulator),
+    };
+    if (KineticClient_Connect(&session, &SimulatorHandle) != KINETIC_STATUS_SUCCESS) {
+        fprintf(stderr, "Failed connecting to simulator!\n");
+        KineticSimulator_Stop(Simulator);
+        return false;
+    }
+    return true;
+}
+
+static void TeardownSimulator(void)
+{
+    KineticClient_Disconnect(&SimulatorHandle);
+    KineticSimulator_Stop(Simulator);
+    Simulator = NULL;
+}
+
+static void BenchCheckStatus(const char* operation, KineticStatus status)
+{
+    if (status != KINETIC_STATUS_SUCCESS) {
+        fprintf(stderr, "Simulator %s failed: %s\n",
+                operation, Kinetic_GetStatusDescription(status));
+        exit(1);
+    }
+}
+
+static void BenchSimulatorNoOp(uint64_t iterations)
+{
+    for (uint64_t i = 0; i < iterations; i++) {
+        BenchCheckStatus("NOOP", KineticClient_NoOp(SimulatorHandle));
+    }
+}
+
+static void BenchSimulatorPutGet(uint64_t iterations)
+{
+    uint8_t value[BENCH_SIMULATOR_VALUE_LEN];
+    uint8_t tag[64];
+    uint8_t version[KINETIC_MAX_VERSION_LEN];
+    for (uint64_t i = 0; i < iterations; i++) {
+        KineticEntry put = {
+            .key = Entry.key,
+            .tag = Entry.tag,
+            .value = ByteBuffer_Create(SimulatorValue, sizeof(SimulatorValue)),
+            .algorithm = KINETIC_ALGORITHM_SHA1,
+            .force = true,
+        };
+        put.value.bytesUsed = sizeof(SimulatorValue);
+        BenchCheckStatus("PUT", KineticClient_Put(SimulatorHandle, &put));
+
+        KineticEntry get = {
+            .key = Entry.key,
+            .tag = ByteBuffer_Create(tag, sizeof(tag)),
+            .dbVersion = ByteBuffer_Create(version, sizeof(version)),
+            .value = ByteBuffer_Create(value, sizeof(value)),
+        };
+        BenchCheckStatus("GET", KineticClient_Get(SimulatorHandle, &get));
+    }
+}
+
+//------------------------------------------------------------------------------
+// Erasure coding of 1MB values as 4 data and 2 parity chunks
+
+#define BENCH_ERASURE_DATA_CHUNKS (4)
+#define BENCH_ERASURE_PARITY_CHUNKS (2)
+#define BENCH_ERASURE_CHUNK_LEN ((1024 * 1024) / BENCH_ERASURE_DATA_CHUNKS)
+
+static KineticErasureCode ErasureCode;
+static uint8_t* ErasureStripe;
+static uint8_t* ErasureChunks[BENCH_ERASURE_DATA_CHUNKS + BENCH_ERASURE_PARITY_CHUNKS];
+
+static bool SetupErasure(void)
+{
+    const int count = BENCH_ERASURE_DATA_CHUNKS + BENCH_ERASURE_PARITY_CHUNKS;
+    if (KineticErasure_Init(&ErasureCode, BENCH_ERASURE_DATA_CHUNKS,
+                            BENCH_ERASURE_PARITY_CHUNKS) != KINETIC_STATUS_SUCCESS) {
+        return false;
+    }
+    ErasureStripe = malloc(count * BENCH_ERASURE_CHUNK_LEN);
+    if (ErasureStripe == NULL) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        ErasureChunks[i] = &ErasureStripe[i * BENCH_ERASURE_CHUNK_LEN];
+    }
+    for (size_t i = 0; i < BENCH_ERASURE_DATA_CHUNKS * BENCH_ERASURE_CHUNK_LEN; i++) {
+        ErasureStripe[i] = (uint8_t)(i * 31 + i / 251);
+    }
+    KineticErasure_Encode(&ErasureCode, ErasureChunks,
+                          &ErasureChunks[BENCH_ERASURE_DATA_CHUNKS], BENCH_ERASURE_CHUNK_LEN);
+    fprintf(stderr, "Erasure coding kernel: %s\n", KineticErasure_GetKernel());
+    return true;
+}
+
+static void TeardownErasure(void)
+{
+    free(ErasureStripe);
+    ErasureStripe = NULL;
+}
+
+static void BenchErasureEncode(uint64_t iterations)
+{
+    for (uint64_t i = 0; i < iterations; i++) {
+        KineticErasure_Encode(&ErasureCode, ErasureChunks,
+                              &ErasureChunks[BENCH_ERASURE_DATA_CHUNKS], BENCH_ERASURE_CHUNK_LEN);
+    }
+    Sink += ErasureChunks[BENCH_ERASURE_DATA_CHUNKS][0];
+}
+
+// Recovers two lost data chunks, the worst case of the code
+static void BenchErasureDecode(uint64_t iterations)
+{
+    bool present[BENCH_ERASURE_DATA_CHUNKS + BENCH_ERASURE_PARITY_CHUNKS] = {
+        false, true, false, true, true, true
+    };
+    for (uint64_t i = 0; i < iterations; i++) {
+        KineticStatus status = KineticErasure_Decode(&ErasureCode, ErasureChunks, present,
+                                                     BENCH_ERASURE_CHUNK_LEN);
+        if (status != KINETIC_STATUS_SUCCESS) {
+            fprintf(stderr, "Erasure decoding failed: %s\n",
+                    Kinetic_GetStatusDescription(status));
+            exit(1);
+        }
+    }
+    Sink += ErasureChunks[0][0];
+}
+
+//------------------------------------------------------------------------------
+// Benchmark runner
+
+typedef struct _Benchmark {
+    const char* name;
+    void (*run)(uint64_t iterations);
+    bool (*setup)(void);
+    void (*teardown)(void);
+} Benchmark;
+
+static const Benchmark Benchmarks[] = {
+    {"proto_pack_put_request", BenchPackPutRequest, NULL, NULL},
+    {"proto_pack_get_request", BenchPackGetRequest, NULL, NULL},
+    {"proto_unpack_put_response", BenchUnpackPutResponse, NULL, NULL},
+    {"proto_unpack_get_response", BenchUnpackGetResponse, NULL, NULL},
+    {"hmac_populate_put", BenchHMACPopulatePut, NULL, NULL},
+    {"hmac_validate_get_response", BenchHMACValidateGetResponse, NULL, NULL},
+    {"nbo_u32", BenchNBOU32, NULL, NULL},
+    {"nbo_u64", BenchNBOU64, NULL, NULL},
+    {"allocator_pdu", BenchAllocatorPDU, NULL, NULL},
+    {"allocator_pdu_contended", BenchAllocatorPDUContended, NULL, NULL},
+    {"byte_buffer_append_64", BenchByteBufferAppend, NULL, NULL},
+    {"socket_pdu_round_trip", BenchSocketRoundTrip, SetupLoopback, TeardownLoopback},
+    {"simulator_noop", BenchSimulatorNoOp, SetupSimulator, TeardownSimulator},
+    {"simulator_put_get_4k", BenchSimulatorPutGet, SetupSimulator, TeardownSimulator},
+    {"erasure_encode_4_2_1m", BenchErasureEncode, SetupErasure, TeardownErasure},
+    {"erasure_decode_4_2_1m", BenchErasureDecode, SetupErasure, TeardownErasure},
+};
+
+static uint64_t BenchNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static void RunBenchmark(const Benchmark* const benchmark, double minTime)
+{
+    if (benchmark->setup != NULL && !benchmark->setup()) {
+        fprintf(stderr, "Skipping benchmark '%s', since setup failed!\n", benchmark->name);
+        return;
+    }
+
+    // Grow the iteration count until a run takes at least the minimum time
+    const uint64_t minNanoseconds = (uint64_t)(minTime * 1e9);
+    uint64_t iterations = 1, elapsed = 0, allocs = 0, allocBytes = 0;
+    while (true) {
+        uint64_t allocsBefore = __atomic_load_n(&BenchAllocs, __ATOMIC_RELAXED);
+        uint64_t bytesBefore = __atomic_load_n(&BenchAllocBytes, __ATOMIC_RELAXED);
+        uint64_t start = BenchNow();
+        benchmark->run(iterations);
+        elapsed = BenchNow() - start;
+        allocs = __atomic_load_n(&BenchAllocs, __ATOMIC_RELAXED) - allocsBefore;
+        allocBytes = __atomic_load_n(&BenchAllocBytes, __ATOMIC_RELAXED) - bytesBefore;
+        if (elapsed >= minNanoseconds || iterations >= BENCH_MAX_ITERATIONS) {
+            break;
+        }
+        uint64_t next = (elapsed == 0) ? iterations * 100 :
+                        (uint64_t)(iterations * 1.2 * minNanoseconds / elapsed);
+        if (next > iterations * 100) {
+            next = iterations * 100;
+        }
+        iterations = (next > iterations) ? next : iterations + 1;
+    }
+
+    if (benchmark->teardown != NULL) {
+        benchmark->teardown();
+    }
+
+    printf("{\"name\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.1f,"
+           "\"allocs_per_op\":%.2f,\"bytes_per_op\":%.1f}\n",
+           benchmark->name, (unsigned long long)iterations,
+           (double)elapsed / iterations,
+           (double)allocs / iterations,
+           (double)allocBytes / iterations);
+    fflush(stdout);
+}
+
+static void PrintUsage(const char* program)
+{
+    fprintf(stderr,
+            "Usage: %s [-t min_seconds] [-l] [name_filter...]\n"
+            "  -t  Minimum time to run each benchmark for (default: %.1fs)\n"
+            "  -l  List benchmarks and exit\n",
+            program, BENCH_MIN_TIME_DEFAULT);
+}
+
+int main(int argc, char** argv)
+{
+    double minTime = BENCH_MIN_TIME_DEFAULT;
+    int option;
+    while ((option = getopt(argc, argv, "t:lh")) != -1) {
+        switch (option) {
+        case 't':
+            minTime = atof(optarg);
+            break;
+        case 'l':
+            for (size_t i = 0; i < sizeof(Benchmarks) / sizeof(Benchmarks[0]); i++) {
+                printf("%s\n", Benchmarks[i].name);
+            }
+            return 0;
+        default:
+            PrintUsage(argv[0]);
+            return (option == 'h') ? 0 : 1;
+        }
+    }
+
+    KineticLogger_Init("NONE");
+    SetupFixtures();
+
+    for (size_t i = 0; i < sizeof(Benchmarks) / sizeof(Benchmarks[0]); i++) {
+        bool selected = (optind >= argc);
+        for (int arg = optind; arg < argc && !selected; arg++) {
+            selected = (strstr(Benchmarks[i].name, argv[arg]) != NULL);
+        }
+        if (selected) {
+            RunBenchmark(&Benchmarks[i], minTime);
+        }
+    }
+
+    KineticLogger_Close();
+    return 0;
+}
@@ -0,0 +1,1228 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+
+#include "kinetic_cluster.h"
+#include "kinetic_simulator.h"
+#include "kinetic_simulator_store.h"
+#include "kinetic_simulator_socket.h"
+#include "kinetic_impairment_proxy.h"
+#include "kinetic_client.h"
+#include "kinetic_types.h"
+#include "kinetic_types_internal.h"
+#include "kinetic_proto.h"
+#include "kinetic_allocator.h"
+#include "kinetic_message.h"
+#include "kinetic_pdu.h"
+#include "kinetic_decoder.h"
+#include "kinetic_logger.h"
+#include "kinetic_operation.h"
+#include "kinetic_hmac.h"
+#include "kinetic_connection.h"
+#include "kinetic_socket.h"
+#include "kinetic_transport.h"
+#include "kinetic_tls.h"
+#include "kinetic_trace.h"
+#include "kinetic_stats.h"
+#include "kinetic_hooks.h"
+#include "kinetic_nbo.h"
+
+#include "byte_array.h"
+#include "unity.h"
+#include "unity_helper.h"
+#include "protobuf-c/protobuf-c.h"
+#include "socket99/socket99.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+// Runs clusters of C simulators, so these tests do not require devices
+
+#define MAX_DEVICES (6)
+
+static KineticSimulator* Simulators[MAX_DEVICES];
+static KineticImpairmentProxy* Proxies[MAX_DEVICES];
+static int SimulatorCount;
+static KineticCluster* Cluster;
+static uint8_t HmacKeyData[] = "asdfasdf";
+
+void setUp(void)
+{
+    KineticClient_Init("NONE");
+    SimulatorCount = 0;
+    Cluster = NULL;
+}
+
+void tearDown(void)
+{
+    if (Cluster != NULL) {
+        KineticCluster_Disconnect(&Cluster);
+    }
+    for (int i = 0; i < SimulatorCount; i++) {
+        KineticImpairmentProxy_Stop(Proxies[i]);
+        KineticSimulator_Stop(Simulators[i]);
+        Proxies[i] = NULL;
+    }
+}
+
+// Starts a simulator, returning a cluster device of it with the weight
+static KineticClusterDevice StartDevice(double weight, uint64_t capacityBytes)
+{
+    TEST_ASSERT_TRUE(SimulatorCount < MAX_DEVICES);
+    KineticSimulatorConfig config = {.port = 0, .capacityBytes = capacityBytes};
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticSimulator_Start(&config, &Simulators[SimulatorCount]));
+
+    KineticClusterDevice device = {
+        .session = {
+            .host = "localhost",
+            .port = KineticSimulator_GetPort(Simulators[SimulatorCount]),
+            .clusterVersion = 0,
+            .identity = 1,
+            .hmacKey = ByteArray_Create(HmacKeyData, strlen((char*)HmacKeyData)),
+        },
+        .weight = weight,
+    };
+    SimulatorCount++;
+    return device;
+}
+
+static void ConnectCluster(const double* weights, int count)
+{
+    KineticClusterDevice devices[MAX_DEVICES];
+    for (int i = 0; i < count; i++) {
+        devices[i] = StartDevice(weights[i], 0);
+    }
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Connect(devices, count, &Cluster));
+    TEST_ASSERT_EQUAL(count, KineticCluster_GetDeviceCount(Cluster));
+}
+
+static ByteBuffer Key(char* buffer, size_t len, int i)
+{
+    ByteBuffer key = ByteBuffer_Create(buffer, len);
+    key.bytesUsed = snprintf(buffer, len, "key%06d", i);
+    return key;
+}
+
+// Starts a simulator behind a proxy adding latency, returning a cluster device
+// of the proxy
+static KineticClusterDevice StartSlowDevice(int latencyMs)
+{
+    KineticClusterDevice device = StartDevice(1.0, 0);
+    KineticImpairmentProxyConfig config = {
+        .targetPort = device.session.port,
+        .latencyMs = latencyMs,
+        .seed = 1,
+    };
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticImpairmentProxy_Start(&config, &Proxies[SimulatorCount - 1]));
+    device.session.port = KineticImpairmentProxy_GetPort(Proxies[SimulatorCount - 1]);
+    return device;
+}
+
+static double Milliseconds(uint64_t start)
+{
+    return (KineticStats_Now() - start) / 1000000.0;
+}
+
+// Counts the keys of a series placed on each device
+static void CountPlacements(int keys, int* counts)
+{
+    char buffer[16];
+    memset(counts, 0, MAX_DEVICES * sizeof(int));
+    for (int i = 0; i < keys; i++) {
+        ByteBuffer key = Key(buffer, sizeof(buffer), i);
+        counts[KineticCluster_GetDeviceFor(Cluster, &key)]++;
+    }
+}
+
+void test_KineticCluster_should_place_keys_in_proportion_to_device_weights(void)
+{
+    const double weights[] = {1.0, 1.0, 1.0, 2.0};
+    ConnectCluster(weights, 4);
+
+    const int keys = 10000;
+    int counts[MAX_DEVICES];
+    CountPlacements(keys, counts);
+    for (int i = 0; i < 4; i++) {
+        double expected = keys * weights[i] / 5.0;
+        printf("Device %d (weight %.0f): %d keys (expected %.0f)\n",
+               i, weights[i], counts[i], expected);
+        TEST_ASSERT_TRUE(counts[i] > expected * 0.9);
+        TEST_ASSERT_TRUE(counts[i] < expected * 1.1);
+    }
+}
+
+void test_KineticCluster_should_only_move_keys_placed_on_an_added_device(void)
+{
+    const double weights[] = {1.0, 1.0, 1.0};
+    ConnectCluster(weights, 3);
+
+    const int keys = 10000;
+    char buffer[16];
+    int* before = malloc(keys * sizeof(int));
+    TEST_ASSERT_NOT_NULL(before);
+    for (int i = 0; i < keys; i++) {
+        ByteBuffer key = Key(buffer, sizeof(buffer), i);
+        before[i] = KineticCluster_GetDeviceFor(Cluster, &key);
+    }
+
+    KineticClusterDevice device = StartDevice(1.0, 0);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_AddDevice(Cluster, &device));
+
+    // Devices must have distinct names
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticCluster_AddDevice(Cluster, &device));
+
+    int moved = 0;
+    for (int i = 0; i < keys; i++) {
+        ByteBuffer key = Key(buffer, sizeof(buffer), i);
+        int after = KineticCluster_GetDeviceFor(Cluster, &key);
+        if (after != before[i]) {
+            TEST_ASSERT_EQUAL(3, after);
+            moved++;
+        }
+    }
+    free(before);
+
+    // The new device takes a quarter of the keys
+    printf("Keys moved to the added device: %d of %d\n", moved, keys);
+    TEST_ASSERT_TRUE(moved > keys / 4 * 0.9);
+    TEST_ASSERT_TRUE(moved < keys / 4 * 1.1);
+}
+
+void test_KineticCluster_should_weight_devices_by_reported_capacity(void)
+{
+    KineticClusterDevice devices[] = {
+        StartDevice(0.0, 1000000000ull),
+        StartDevice(0.0, 3000000000ull),
+    };
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Connect(devices, 2, &Cluster));
+
+    int counts[MAX_DEVICES];
+    CountPlacements(8000, counts);
+    TEST_ASSERT_TRUE(counts[0] > 2000 * 0.9);
+    TEST_ASSERT_TRUE(counts[0] < 2000 * 1.1);
+
+    // Devices reporting no capacity need a weight
+    KineticClusterDevice device = StartDevice(0.0, 0);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticCluster_AddDevice(Cluster, &device));
+    TEST_ASSERT_EQUAL(2, KineticCluster_GetDeviceCount(Cluster));
+}
+
+void test_KineticCluster_should_route_batches_of_operations_to_the_owning_devices(void)
+{
+    const double weights[] = {1.0, 1.0, 1.0};
+    ConnectCluster(weights, 3);
+
+    enum { COUNT = 300 };
+    static char keys[COUNT][16];
+    static char values[COUNT][16];
+    static KineticEntry entries[COUNT];
+    KineticClusterOperation operations[COUNT];
+    for (int i = 0; i < COUNT; i++) {
+        entries[i] = (KineticEntry) {
+            .key = Key(keys[i], sizeof(keys[i]), i),
+            .value = ByteBuffer_Create(values[i], sizeof(values[i])),
+            .algorithm = KINETIC_ALGORITHM_SHA1,
+            .force = true,
+        };
+        entries[i].value.bytesUsed = snprintf(values[i], sizeof(values[i]), "value%d", i);
+        operations[i] = (KineticClusterOperation) {
+            .type = KINETIC_CLUSTER_OPERATION_PUT,
+            .entry = &entries[i],
+        };
+    }
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Execute(Cluster, operations, COUNT));
+
+    // Each entry is only on the device it is placed on
+    uint8_t value[16];
+    for (int i = 0; i < COUNT; i++) {
+        int owner = KineticCluster_GetDeviceFor(Cluster, &entries[i].key);
+        for (int d = 0; d < 3; d++) {
+            KineticEntry entry = {
+                .key = entries[i].key,
+                .value = ByteBuffer_Create(value, sizeof(value)),
+            };
+            KineticStatus status = KineticClient_Get(KineticCluster_GetSession(Cluster, d), &entry);
+            TEST_ASSERT_EQUAL_KineticStatus((d == owner) ?
+                KINETIC_STATUS_SUCCESS : KINETIC_STATUS_DATA_ERROR, status);
+        }
+    }
+
+    // GETs return the entries, and report the first failure
+    static uint8_t readValues[COUNT][16];
+    for (int i = 0; i < COUNT; i++) {
+        entries[i].value = ByteBuffer_Create(readValues[i], sizeof(readValues[i]));
+        entries[i].force = false;
+        operations[i].type = (i == 150) ?
+            KINETIC_CLUSTER_OPERATION_DELETE : KINETIC_CLUSTER_OPERATION_GET;
+    }
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Execute(Cluster, operations, COUNT));
+    for (int i = 0; i < COUNT; i++) {
+        if (i != 150) {
+            TEST_ASSERT_EQUAL(strlen(values[i]), entries[i].value.bytesUsed);
+            TEST_ASSERT_EQUAL_MEMORY(values[i], readValues[i], strlen(values[i]));
+        }
+    }
+
+    for (int i = 0; i < COUNT; i++) {
+        entries[i].value = ByteBuffer_Create(readValues[i], sizeof(readValues[i]));
+        operations[i].type = KINETIC_CLUSTER_OPERATION_GET;
+    }
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_DATA_ERROR,
+        KineticCluster_Execute(Cluster, operations, COUNT));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_DATA_ERROR, operations[150].status);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, operations[149].status);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, operations[151].status);
+}
+
+// Entry with buffers for a value and version, and the key and value set
+typedef struct _TestEntry {
+    char key[16];
+    uint8_t value[32];
+    uint8_t dbVersion[16];
+    uint8_t newVersion[16];
+    KineticEntry entry;
+} TestEntry;
+
+static KineticEntry* InitEntry(TestEntry* entry, const char* key, const char* value,
+                               const char* version)
+{
+    entry->entry = (KineticEntry) {
+        .key = ByteBuffer_Create(entry->key, sizeof(entry->key)),
+        .value = ByteBuffer_Create(entry->value, sizeof(entry->value)),
+        .dbVersion = ByteBuffer_Create(entry->dbVersion, sizeof(entry->dbVersion)),
+        .algorithm = KINETIC_ALGORITHM_SHA1,
+        .force = true,
+    };
+    entry->entry.key.bytesUsed = snprintf(entry->key, sizeof(entry->key), "%s", key);
+    entry->entry.value.bytesUsed = snprintf((char*)entry->value, sizeof(entry->value), "%s", value);
+    entry->entry.dbVersion.bytesUsed = 0;
+    if (version != NULL) {
+        entry->entry.newVersion = ByteBuffer_Create(entry->newVersion, sizeof(entry->newVersion));
+        entry->entry.newVersion.bytesUsed =
+            snprintf((char*)entry->newVersion, sizeof(entry->newVersion), "%s", version);
+    }
+    return &entry->entry;
+}
+
+// Reads an entry from a device directly, returning the status
+static KineticStatus GetFromDevice(int device, const char* key, TestEntry* entry)
+{
+    InitEntry(entry, key, "", NULL);
+    return KineticClient_Get(KineticCluster_GetSession(Cluster, device), &entry->entry);
+}
+
+void test_KineticCluster_should_reject_invalid_replication(void)
+{
+    const double weights[] = {1.0, 1.0, 1.0};
+    ConnectCluster(weights, 3);
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticCluster_SetReplication(Cluster, 4, 2, 2));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticCluster_SetReplication(Cluster, 3, 4, 2));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticCluster_SetReplication(Cluster, 3, 2, 0));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_SetReplication(Cluster, 3, 2, 2));
+
+    // Replicas are ranked by score, the first being where keys are placed
+    char buffer[16];
+    for (int i = 0; i < 100; i++) {
+        ByteBuffer key = Key(buffer, sizeof(buffer), i);
+        int devices[MAX_DEVICES];
+        TEST_ASSERT_EQUAL(3, KineticCluster_GetReplicas(Cluster, &key, devices, MAX_DEVICES));
+        TEST_ASSERT_EQUAL(KineticCluster_GetDeviceFor(Cluster, &key), devices[0]);
+        TEST_ASSERT_TRUE(devices[0] != devices[1] && devices[1] != devices[2] &&
+                         devices[0] != devices[2]);
+    }
+}
+
+void test_KineticCluster_should_write_replicas_in_parallel(void)
+{
+    const int latencyMs = 20;
+    KineticClusterDevice devices[] = {
+        StartSlowDevice(latencyMs),
+        StartSlowDevice(latencyMs),
+        StartSlowDevice(latencyMs),
+    };
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Connect(devices, 3, &Cluster));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_SetReplication(Cluster, 3, 3, 1));
+
+    const int count = 10;
+    TestEntry entry;
+    char key[16];
+    uint64_t start = KineticStats_Now();
+    for (int i = 0; i < count; i++) {
+        snprintf(key, sizeof(key), "parallel%d", i);
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            KineticCluster_Put(Cluster, InitEntry(&entry, key, "value", NULL)));
+    }
+    double elapsed = Milliseconds(start);
+
+    // Each PUT waits for the round trip of the slowest replica, rather than
+    // for the round trips of all replicas in turn
+    double roundTrip = 2 * latencyMs;
+    printf("%d PUTs to 3 replicas with %.0fms round trips: %.0fms\n",
+           count, roundTrip, elapsed);
+    TEST_ASSERT_TRUE(elapsed >= count * roundTrip);
+    TEST_ASSERT_TRUE(elapsed < count * roundTrip * 1.5);
+
+    for (int d = 0; d < 3; d++) {
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            GetFromDevice(d, "parallel9", &entry));
+    }
+    KineticClusterStats stats;
+    KineticCluster_GetStats(Cluster, &stats);
+    TEST_ASSERT_EQUAL(3 * count, stats.replicaWrites);
+    TEST_ASSERT_EQUAL(0, stats.replicaFailures);
+}
+
+void test_KineticCluster_should_pipeline_the_replicated_writes_of_a_batch(void)
+{
+    const int latencyMs = 20;
+    KineticClusterDevice devices[] = {
+        StartSlowDevice(latencyMs),
+        StartSlowDevice(latencyMs),
+        StartSlowDevice(latencyMs),
+    };
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Connect(devices, 3, &Cluster));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_SetReplication(Cluster, 3, 3, 1));
+
+    enum { COUNT = 10 };
+    static TestEntry entries[COUNT];
+    KineticClusterOperation operations[COUNT];
+    char key[16];
+    for (int i = 0; i < COUNT; i++) {
+        snprintf(key, sizeof(key), "batch%d", i);
+        operations[i] = (KineticClusterOperation) {
+            .type = KINETIC_CLUSTER_OPERATION_PUT,
+            .entry = InitEntry(&entries[i], key, "value", "v1"),
+        };
+    }
+    uint64_t start = KineticStats_Now();
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Execute(Cluster, operations, COUNT));
+    double elapsed = Milliseconds(start);
+
+    // All PUTs are sent before any response is awaited, so the batch takes
+    // about one round trip rather than one per PUT
+    double roundTrip = 2 * latencyMs;
+    printf("Batch of %d PUTs to 3 replicas with %.0fms round trips: %.0fms\n",
+           COUNT, roundTrip, elapsed);
+    TEST_ASSERT_TRUE(elapsed >= roundTrip);
+    TEST_ASSERT_TRUE(elapsed < 4 * roundTrip);
+    TestEntry entry;
+    for (int i = 0; i < COUNT; i++) {
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, operations[i].status);
+        TEST_ASSERT_EQUAL(2, entries[i].entry.dbVersion.bytesUsed);
+        TEST_ASSERT_EQUAL_MEMORY("v1", entries[i].entry.dbVersion.array.data, 2);
+        for (int d = 0; d < 3; d++) {
+            TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+                GetFromDevice(d, entries[i].key, &entry));
+        }
+    }
+
+    // GETs are executed in order with the runs of writes around them
+    TestEntry deleted, read;
+    KineticClusterOperation mixed[] = {
+        {.type = KINETIC_CLUSTER_OPERATION_DELETE, .entry = InitEntry(&deleted, "batch0", "", NULL)},
+        {.type = KINETIC_CLUSTER_OPERATION_GET, .entry = InitEntry(&read, "batch0", "", NULL)},
+        {.type = KINETIC_CLUSTER_OPERATION_PUT, .entry = InitEntry(&entries[0], "batch0", "again", NULL)},
+    };
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_DATA_ERROR,
+        KineticCluster_Execute(Cluster, mixed, 3));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, mixed[0].status);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_DATA_ERROR, mixed[1].status);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, mixed[2].status);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, GetFromDevice(0, "batch0", &entry));
+    TEST_ASSERT_EQUAL_MEMORY("again", entry.value, 5);
+}
+
+void test_KineticCluster_should_return_writes_once_the_write_quorum_succeeds(void)
+{
+    const int latencyMs = 200;
+    KineticClusterDevice devices[] = {
+        StartDevice(1.0, 0),
+        StartDevice(1.0, 0),
+        StartSlowDevice(latencyMs),
+    };
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Connect(devices, 3, &Cluster));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_SetReplication(Cluster, 3, 2, 2));
+
+    TestEntry entry;
+    uint64_t start = KineticStats_Now();
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Put(Cluster, InitEntry(&entry, "quorum", "value", "v1")));
+    TEST_ASSERT_TRUE(Milliseconds(start) < latencyMs);
+    TEST_ASSERT_EQUAL_MEMORY("v1", entry.entry.dbVersion.array.data, 2);
+
+    KineticClusterStats stats;
+    KineticCluster_GetStats(Cluster, &stats);
+    TEST_ASSERT_EQUAL(0, stats.lateAcks);
+
+    // The slow replica's response is received before the session is used
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        GetFromDevice(2, "quorum", &entry));
+    KineticCluster_GetStats(Cluster, &stats);
+    TEST_ASSERT_EQUAL(1, stats.lateAcks);
+}
+
+void test_KineticCluster_should_drain_late_acks_through_the_decode_stage(void)
+{
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, KineticClient_SetDecodeWorkers(2));
+    KineticClusterDevice devices[] = {
+        StartDevice(1.0, 0),
+        StartDevice(1.0, 0),
+        StartDevice(1.0, 0),
+    };
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Connect(devices, 3, &Cluster));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_SetReplication(Cluster, 3, 1, 1));
+
+    const int count = 12;
+    TestEntry entry;
+    char key[16];
+    for (int i = 0; i < count; i++) {
+        snprintf(key, sizeof(key), "late%d", i);
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            KineticCluster_Put(Cluster, InitEntry(&entry, key, "value", NULL)));
+    }
+
+    // Responses still in flight are all read before they are completed
+    for (int d = 0; d < 3; d++) {
+        KineticCluster_GetSession(Cluster, d);
+    }
+    KineticClusterStats stats;
+    KineticCluster_GetStats(Cluster, &stats);
+    TEST_ASSERT_EQUAL(2 * count, stats.lateAcks);
+    TEST_ASSERT_EQUAL(0, stats.replicaFailures);
+    for (int d = 0; d < 3; d++) {
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            GetFromDevice(d, "late11", &entry));
+    }
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, KineticClient_SetDecodeWorkers(0));
+}
+
+void test_KineticCluster_should_keep_device_sessions_consistent_with_replica_requests(void)
+{
+    KineticClusterDevice devices[3];
+    for (int i = 0; i < 3; i++) {
+        devices[i] = StartDevice(1.0, 0);
+        devices[i].session.readCacheBytes = 64 * 1024;
+    }
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Connect(devices, 3, &Cluster));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_SetReplication(Cluster, 3, 2, 2));
+
+    TestEntry entry;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Put(Cluster, InitEntry(&entry, "consistent", "old", "v1")));
+    for (int d = 0; d < 3; d++) {
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            GetFromDevice(d, "consistent", &entry));
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            KineticClient_ResetStats(KineticCluster_GetSession(Cluster, d)));
+    }
+
+    // Rewritten with the same version, so only invalidating the entries
+    // cached by the sessions keeps them from returning the old value
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Put(Cluster, InitEntry(&entry, "consistent", "new", "v1")));
+    for (int d = 0; d < 3; d++) {
+        KineticSessionHandle handle = KineticCluster_GetSession(Cluster, d);
+        KineticStats stats;
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            KineticClient_GetStats(handle, &stats));
+        TEST_ASSERT_EQUAL(1, stats.operations);
+        TEST_ASSERT_EQUAL(1, stats.latency[KINETIC_PROTO_MESSAGE_TYPE_PUT].count);
+        TEST_ASSERT_TRUE(stats.bytesSent > 0);
+        TEST_ASSERT_TRUE(stats.bytesReceived > 0);
+
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            GetFromDevice(d, "consistent", &entry));
+        TEST_ASSERT_EQUAL(3, entry.entry.value.bytesUsed);
+        TEST_ASSERT_EQUAL_MEMORY("new", entry.value, 3);
+    }
+}
+
+void test_KineticCluster_should_read_the_version_most_replicas_report(void)
+{
+    const double weights[] = {1.0, 1.0, 1.0};
+    ConnectCluster(weights, 3);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_SetReplication(Cluster, 3, 3, 3));
+
+    TestEntry entry;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Put(Cluster, InitEntry(&entry, "divergent", "latest", "v2")));
+
+    // The first replica misses the write, e.g. as it was restored from a
+    // backup, so holds an older version
+    int replicas[3];
+    ByteBuffer key = entry.entry.key;
+    TEST_ASSERT_EQUAL(3, KineticCluster_GetReplicas(Cluster, &key, replicas, 3));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_Put(KineticCluster_GetSession(Cluster, replicas[0]),
+                          InitEntry(&entry, "divergent", "stale", "v1")));
+
+    InitEntry(&entry, "divergent", "", NULL);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Get(Cluster, &entry.entry));
+    TEST_ASSERT_EQUAL(strlen("latest"), entry.entry.value.bytesUsed);
+    TEST_ASSERT_EQUAL_MEMORY("latest", entry.value, strlen("latest"));
+    TEST_ASSERT_EQUAL(2, entry.entry.dbVersion.bytesUsed);
+    TEST_ASSERT_EQUAL_MEMORY("v2", entry.dbVersion, 2);
+
+    KineticClusterStats stats;
+    KineticCluster_GetStats(Cluster, &stats);
+    TEST_ASSERT_EQUAL(1, stats.divergentReads);
+
+    // Keys missing from most replicas are reported as not found
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_Delete(KineticCluster_GetSession(Cluster, replicas[1]), &entry.entry));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_Delete(KineticCluster_GetSession(Cluster, replicas[2]), &entry.entry));
+    InitEntry(&entry, "divergent", "", NULL);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_DATA_ERROR,
+        KineticCluster_Get(Cluster, &entry.entry));
+}
+
+void test_KineticCluster_should_read_and_write_with_a_failed_replica(void)
+{
+    const double weights[] = {1.0, 1.0, 1.0};
+    ConnectCluster(weights, 3);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_SetReplication(Cluster, 3, 2, 1));
+
+    // Fail the device on which the key is placed
+    TestEntry entry;
+    InitEntry(&entry, "failover", "value", NULL);
+    int failed = KineticCluster_GetDeviceFor(Cluster, &entry.entry.key);
+    KineticSimulator_Stop(Simulators[failed]);
+    Simulators[failed] = NULL;
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Put(Cluster, &entry.entry));
+    InitEntry(&entry, "failover", "", NULL);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Get(Cluster, &entry.entry));
+    TEST_ASSERT_EQUAL_MEMORY("value", entry.value, strlen("value"));
+
+    KineticClusterStats stats;
+    KineticCluster_GetStats(Cluster, &stats);
+    TEST_ASSERT_TRUE(stats.replicaFailures >= 2);
+
+    // Writes fail once too few replicas remain
+    for (int d = 0; d < 3; d++) {
+        if (d != failed) {
+            KineticSimulator_Stop(Simulators[d]);
+            Simulators[d] = NULL;
+            break;
+        }
+    }
+    InitEntry(&entry, "failover", "value", NULL);
+    TEST_ASSERT_TRUE(KineticCluster_Put(Cluster, &entry.entry) != KINETIC_STATUS_SUCCESS);
+}
+
+// Values of erasure coded entries, up to 3 data chunks of the largest values
+#define LARGE_VALUE_LEN (3 * (PDU_VALUE_MAX_LEN - 16))
+static uint8_t LargeValue[LARGE_VALUE_LEN];
+static uint8_t ReadValue[LARGE_VALUE_LEN];
+
+// Initializes an entry of the large value, of the specified length
+static KineticEntry* InitLargeEntry(TestEntry* entry, const char* key, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        LargeValue[i] = (uint8_t)(i * 7 + i / 251);
+    }
+    InitEntry(entry, key, "", NULL);
+    entry->entry.value = ByteBuffer_Create(LargeValue, len);
+    entry->entry.value.bytesUsed = len;
+    return &entry->entry;
+}
+
+// Reads an erasure coded entry into the read value, returning the status
+static KineticStatus GetLarge(const char* key, TestEntry* entry)
+{
+    InitEntry(entry, key, "", NULL);
+    memset(ReadValue, 0, sizeof(ReadValue));
+    entry->entry.value = ByteBuffer_Create(ReadValue, sizeof(ReadValue));
+    return KineticCluster_Get(Cluster, &entry->entry);
+}
+
+static void ConnectErasureCoded(int devices, int dataChunks, int parityChunks, int degradedReadMs)
+{
+    double weights[MAX_DEVICES];
+    for (int i = 0; i < devices; i++) {
+        weights[i] = 1.0;
+    }
+    ConnectCluster(weights, devices);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_SetErasureCoding(Cluster, dataChunks, parityChunks,
+                                        dataChunks + parityChunks, degradedReadMs));
+}
+
+void test_KineticCluster_should_reject_invalid_erasure_coding(void)
+{
+    const double weights[] = {1.0, 1.0, 1.0, 1.0};
+    ConnectCluster(weights, 4);
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticCluster_SetErasureCoding(Cluster, 3, 2, 4, 10));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticCluster_SetErasureCoding(Cluster, 0, 2, 2, 10));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticCluster_SetErasureCoding(Cluster, 2, 2, 1, 10));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticCluster_SetErasureCoding(Cluster, 2, 2, 5, 10));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_SetErasureCoding(Cluster, 2, 2, 3, 10));
+}
+
+void test_KineticCluster_should_erasure_code_values_across_devices(void)
+{
+    ConnectErasureCoded(6, 4, 2, 1000);
+
+    const size_t len = 10001;
+    TestEntry entry;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Put(Cluster, InitLargeEntry(&entry, "coded", len)));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, GetLarge("coded", &entry));
+    TEST_ASSERT_EQUAL(len, entry.entry.value.bytesUsed);
+    TEST_ASSERT_EQUAL_MEMORY(LargeValue, ReadValue, len);
+
+    // Each device of the key holds a chunk of a quarter of the value
+    int devices[6];
+    TEST_ASSERT_EQUAL(6, KineticCluster_GetReplicas(Cluster, &entry.entry.key, devices, 6));
+    for (int i = 0; i < 6; i++) {
+        InitEntry(&entry, "coded", "", NULL);
+        entry.entry.value = ByteBuffer_Create(ReadValue, sizeof(ReadValue));
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            KineticClient_Get(KineticCluster_GetSession(Cluster, devices[i]), &entry.entry));
+        TEST_ASSERT_EQUAL(16 + (len + 3) / 4, entry.entry.value.bytesUsed);
+    }
+
+    KineticClusterStats stats;
+    KineticCluster_GetStats(Cluster, &stats);
+    TEST_ASSERT_EQUAL(6, stats.replicaWrites);
+    TEST_ASSERT_EQUAL(0, stats.degradedReads);
+
+    // Deleted values are not found
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Delete(Cluster, InitEntry(&entry, "coded", "", NULL)));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_DATA_ERROR, GetLarge("coded", &entry));
+}
+
+void test_KineticCluster_should_decode_values_with_failed_devices(void)
+{
+    ConnectErasureCoded(6, 4, 2, 1000);
+
+    const size_t len = 100000;
+    TestEntry entry;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Put(Cluster, InitLargeEntry(&entry, "degraded", len)));
+
+    // Fail the devices of two data chunks
+    int devices[6];
+    KineticCluster_GetReplicas(Cluster, &entry.entry.key, devices, 6);
+    for (int i = 1; i <= 2; i++) {
+        KineticSimulator_Stop(Simulators[devices[i]]);
+        Simulators[devices[i]] = NULL;
+    }
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, GetLarge("degraded", &entry));
+    TEST_ASSERT_EQUAL(len, entry.entry.value.bytesUsed);
+    TEST_ASSERT_EQUAL_MEMORY(LargeValue, ReadValue, len);
+    KineticClusterStats stats;
+    KineticCluster_GetStats(Cluster, &stats);
+    TEST_ASSERT_EQUAL(1, stats.degradedReads);
+
+    // Values are written while enough devices remain for the write quorum
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_SetErasureCoding(Cluster, 4, 2, 4, 1000));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Put(Cluster, InitLargeEntry(&entry, "degraded", len / 2)));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, GetLarge("degraded", &entry));
+    TEST_ASSERT_EQUAL(len / 2, entry.entry.value.bytesUsed);
+    TEST_ASSERT_EQUAL_MEMORY(LargeValue, ReadValue, len / 2);
+}
+
+void test_KineticCluster_should_read_parity_chunks_once_data_chunks_are_slow(void)
+{
+    const int latencyMs = 300;
+    KineticClusterDevice devices[] = {
+        StartDevice(1.0, 0),
+        StartDevice(1.0, 0),
+        StartSlowDevice(latencyMs),
+    };
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Connect(devices, 3, &Cluster));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_SetErasureCoding(Cluster, 2, 1, 3, 20));
+
+    // Find a key with a data chunk on the slow device
+    char key[16];
+    for (int i = 0;; i++) {
+        ByteBuffer buffer = Key(key, sizeof(key), i);
+        int replicas[3];
+        KineticCluster_GetReplicas(Cluster, &buffer, replicas, 3);
+        if (replicas[0] == 2) {
+            break;
+        }
+    }
+    TestEntry entry;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Put(Cluster, InitLargeEntry(&entry, key, 5000)));
+
+    uint64_t start = KineticStats_Now();
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, GetLarge(key, &entry));
+    double elapsed = Milliseconds(start);
+    printf("Degraded GET with a %dms slow data chunk: %.0fms\n", 2 * latencyMs, elapsed);
+    TEST_ASSERT_TRUE(elapsed < latencyMs);
+    TEST_ASSERT_EQUAL_MEMORY(LargeValue, ReadValue, 5000);
+
+    KineticClusterStats stats;
+    KineticCluster_GetStats(Cluster, &stats);
+    TEST_ASSERT_EQUAL(1, stats.degradedReads);
+}
+
+void test_KineticCluster_should_erasure_code_values_larger_than_devices_accept(void)
+{
+    ConnectErasureCoded(4, 3, 1, 1000);
+
+    TestEntry entry;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Put(Cluster, InitLargeEntry(&entry, "large", LARGE_VALUE_LEN)));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, GetLarge("large", &entry));
+    TEST_ASSERT_EQUAL(LARGE_VALUE_LEN, entry.entry.value.bytesUsed);
+    TEST_ASSERT_EQUAL_MEMORY(LargeValue, ReadValue, LARGE_VALUE_LEN);
+
+    // Values which do not fit the data chunks are rejected
+    InitLargeEntry(&entry, "large", LARGE_VALUE_LEN);
+    entry.entry.value.bytesUsed++;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_BUFFER_OVERRUN,
+        KineticCluster_Put(Cluster, &entry.entry));
+
+    // As are values read into buffers too small for them
+    InitEntry(&entry, "large", "", NULL);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_BUFFER_OVERRUN,
+        KineticCluster_Get(Cluster, &entry.entry));
+}
+
+#define REBUILD_CHECKPOINT_PATH "build/test_kinetic_cluster_rebuild.dat"
+
+// Fails a device of the cluster, and replaces it with an empty one
+static void ReplaceDevice(int device)
+{
+    KineticSimulator_Stop(Simulators[device]);
+    Simulators[device] = NULL;
+    KineticClusterDevice replacement = StartDevice(1.0, 0);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_ReplaceDevice(Cluster, device, &replacement));
+}
+
+// Writes a series of versioned keys, returning the number placed on a device
+static int PutKeys(int count, int device, int devicesPerKey)
+{
+    int placed = 0;
+    for (int i = 0; i < count; i++) {
+        char key[16], value[16], version[16];
+        snprintf(key, sizeof(key), "key%06d", i);
+        snprintf(value, sizeof(value), "value%d", i);
+        snprintf(version, sizeof(version), "v%d", i);
+        TestEntry entry;
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            KineticCluster_Put(Cluster, InitEntry(&entry, key, value, version)));
+
+        int devices[KINETIC_CLUSTER_REPLICAS_MAX];
+        int replicas = KineticCluster_GetReplicas(Cluster, &entry.entry.key, devices, devicesPerKey);
+        for (int r = 0; r < replicas; r++) {
+            placed += (devices[r] == device) ? 1 : 0;
+        }
+    }
+    return placed;
+}
+
+void test_KineticCluster_should_rebuild_the_replicas_of_a_replaced_device(void)
+{
+    const double weights[] = {1.0, 1.0, 1.0, 1.0};
+    ConnectCluster(weights, 4);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_SetReplication(Cluster, 3, 2, 1));
+    const int count = 500;
+    int placed = PutKeys(count, 1, 3);
+    ReplaceDevice(1);
+
+    const int maxOpsPerSecond = 2000;
+    KineticClusterRebuildConfig config = {.parallelism = 16, .maxOpsPerSecond = maxOpsPerSecond};
+    KineticClusterRebuildStats stats;
+    uint64_t start = KineticStats_Now();
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Rebuild(Cluster, 1, &config, &stats));
+    double elapsed = Milliseconds(start);
+    printf("Rebuilt %d of %d keys in %.0fms\n", placed, count, elapsed);
+    TEST_ASSERT_TRUE(stats.complete);
+    TEST_ASSERT_EQUAL(placed, stats.keysRebuilt);
+    TEST_ASSERT_EQUAL(0, stats.keysSkipped);
+    TEST_ASSERT_EQUAL(0, stats.keysFailed);
+    TEST_ASSERT_EQUAL(3 * count - placed, stats.keysScanned);
+
+    // Each key is read and written, at no more than the requests per second
+    TEST_ASSERT_TRUE(elapsed >= 2 * placed * 1000.0 / maxOpsPerSecond);
+
+    // The device has the replicas, with their versions
+    for (int i = 0; i < count; i++) {
+        char key[16], value[16], version[16];
+        snprintf(key, sizeof(key), "key%06d", i);
+        TestEntry entry;
+        InitEntry(&entry, key, "", NULL);
+        int devices[3];
+        KineticCluster_GetReplicas(Cluster, &entry.entry.key, devices, 3);
+        if (devices[0] != 1 && devices[1] != 1 && devices[2] != 1) {
+            continue;
+        }
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, GetFromDevice(1, key, &entry));
+        snprintf(value, sizeof(value), "value%d", i);
+        snprintf(version, sizeof(version), "v%d", i);
+        TEST_ASSERT_EQUAL(strlen(value), entry.entry.value.bytesUsed);
+        TEST_ASSERT_EQUAL_MEMORY(value, entry.value, strlen(value));
+        TEST_ASSERT_EQUAL(strlen(version), entry.entry.dbVersion.bytesUsed);
+        TEST_ASSERT_EQUAL_MEMORY(version, entry.dbVersion, strlen(version));
+    }
+}
+
+void test_KineticCluster_should_rebuild_replicas_of_the_version_most_replicas_report(void)
+{
+    const double weights[] = {1.0, 1.0, 1.0, 1.0, 1.0};
+    ConnectCluster(weights, 5);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_SetReplication(Cluster, 4, 2, 1));
+    TestEntry entry;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Put(Cluster, InitEntry(&entry, "divergent", "latest", "v2")));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Put(Cluster, InitEntry(&entry, "deleted", "value", "v1")));
+
+    // The replica ranked first holds an older version, which would be read
+    // first, and the other key was deleted from most replicas, though not
+    // from that ranked first which lists it
+    int divergent[4], deleted[4];
+    InitEntry(&entry, "divergent", "", NULL);
+    TEST_ASSERT_EQUAL(4, KineticCluster_GetReplicas(Cluster, &entry.entry.key, divergent, 4));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_Put(KineticCluster_GetSession(Cluster, divergent[0]),
+                          InitEntry(&entry, "divergent", "stale", "v1")));
+    InitEntry(&entry, "deleted", "", NULL);
+    TEST_ASSERT_EQUAL(4, KineticCluster_GetReplicas(Cluster, &entry.entry.key, deleted, 4));
+    int device = divergent[3];
+    int removed = 0;
+    for (int r = 3; r >= 0 && removed < 2; r--) {
+        if (deleted[r] != device) {
+            TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+                KineticClient_Delete(KineticCluster_GetSession(Cluster, deleted[r]), &entry.entry));
+            removed++;
+        }
+    }
+    bool placed = (deleted[0] == device || deleted[1] == device ||
+                   deleted[2] == device || deleted[3] == device);
+    ReplaceDevice(device);
+
+    KineticClusterRebuildConfig config = {.parallelism = 4};
+    KineticClusterRebuildStats stats;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Rebuild(Cluster, device, &config, &stats));
+    TEST_ASSERT_TRUE(stats.complete);
+    TEST_ASSERT_EQUAL(1, stats.keysRebuilt);
+    TEST_ASSERT_EQUAL(placed ? 1 : 0, stats.keysSkipped);
+    TEST_ASSERT_EQUAL(0, stats.keysFailed);
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, GetFromDevice(device, "divergent", &entry));
+    TEST_ASSERT_EQUAL(strlen("latest"), entry.entry.value.bytesUsed);
+    TEST_ASSERT_EQUAL_MEMORY("latest", entry.value, strlen("latest"));
+    TEST_ASSERT_EQUAL(2, entry.entry.dbVersion.bytesUsed);
+    TEST_ASSERT_EQUAL_MEMORY("v2", entry.dbVersion, 2);
+    TEST_ASSERT_TRUE(GetFromDevice(device, "deleted", &entry) != KINETIC_STATUS_SUCCESS);
+}
+
+void test_KineticCluster_should_rebuild_the_chunks_of_a_replaced_device(void)
+{
+    ConnectErasureCoded(4, 2, 1, 1000);
+    TestEntry entry;
+    const size_t len = 100000;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Put(Cluster, InitLargeEntry(&entry, "large", len)));
+    int placed = PutKeys(300, 0, 3);
+    ReplaceDevice(0);
+
+    KineticClusterRebuildConfig config = {.maxBytesPerSecond = 50 * 1000 * 1000};
+    KineticClusterRebuildStats stats;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Rebuild(Cluster, 0, &config, &stats));
+    TEST_ASSERT_TRUE(stats.complete);
+    TEST_ASSERT_TRUE(stats.keysRebuilt >= (uint64_t)placed);
+    TEST_ASSERT_EQUAL(0, stats.keysFailed);
+
+    // Values whose chunks were on the device can be read without another
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_SetErasureCoding(Cluster, 2, 1, 2, 1000));
+    KineticSimulator_Stop(Simulators[2]);
+    Simulators[2] = NULL;
+    for (int i = 0; i < 300; i++) {
+        char key[16], value[16];
+        snprintf(key, sizeof(key), "key%06d", i);
+        snprintf(value, sizeof(value), "value%d", i);
+        InitEntry(&entry, key, "", NULL);
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            KineticCluster_Get(Cluster, &entry.entry));
+        TEST_ASSERT_EQUAL(strlen(value), entry.entry.value.bytesUsed);
+        TEST_ASSERT_EQUAL_MEMORY(value, entry.value, strlen(value));
+    }
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, GetLarge("large", &entry));
+    TEST_ASSERT_EQUAL(len, entry.entry.value.bytesUsed);
+    TEST_ASSERT_EQUAL_MEMORY(LargeValue, ReadValue, len);
+}
+
+void test_KineticCluster_should_resume_rebuilds_from_their_checkpoint(void)
+{
+    const double weights[] = {1.0, 1.0, 1.0};
+    ConnectCluster(weights, 3);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_SetReplication(Cluster, 2, 2, 1));
+    const int count = 1000;
+    int placed = PutKeys(count, 0, 2);
+    ReplaceDevice(0);
+    unlink(REBUILD_CHECKPOINT_PATH);
+
+    // Stop after the first keys listed, as if the rebuild was interrupted
+    KineticClusterRebuildConfig config = {
+        .maxKeys = 400,
+        .checkpointPath = REBUILD_CHECKPOINT_PATH,
+    };
+    KineticClusterRebuildStats stats;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Rebuild(Cluster, 0, &config, &stats));
+    TEST_ASSERT_FALSE(stats.complete);
+    TEST_ASSERT_EQUAL(400, stats.keysScanned);
+    uint64_t rebuilt = stats.keysRebuilt;
+    TEST_ASSERT_TRUE(rebuilt > 0);
+    TEST_ASSERT_TRUE(rebuilt < (uint64_t)placed);
+
+    // The restarted rebuild continues from the last key listed
+    KineticClusterStats clusterStats;
+    KineticCluster_GetStats(Cluster, &clusterStats);
+    uint64_t writes = clusterStats.replicaWrites;
+    config.maxKeys = 0;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Rebuild(Cluster, 0, &config, &stats));
+    TEST_ASSERT_TRUE(stats.complete);
+    TEST_ASSERT_EQUAL(2 * count - placed, stats.keysScanned);
+    TEST_ASSERT_EQUAL(placed, stats.keysRebuilt);
+    TEST_ASSERT_EQUAL(0, stats.keysSkipped);
+    KineticCluster_GetStats(Cluster, &clusterStats);
+    TEST_ASSERT_EQUAL(placed - rebuilt, clusterStats.replicaWrites - writes);
+
+    // Completed rebuilds are not repeated
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Rebuild(Cluster, 0, &config, &stats));
+    TEST_ASSERT_EQUAL(placed, stats.keysRebuilt);
+    KineticCluster_GetStats(Cluster, &clusterStats);
+    TEST_ASSERT_EQUAL(placed - rebuilt, clusterStats.replicaWrites - writes);
+    unlink(REBUILD_CHECKPOINT_PATH);
+}
+
+void test_KineticCluster_should_pace_rebuilds_to_the_bytes_read_and_written(void)
+{
+    const double weights[] = {1.0, 1.0, 1.0};
+    ConnectCluster(weights, 3);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_SetReplication(Cluster, 2, 2, 1));
+    const size_t len = 100000;
+    for (int i = 0; i < 20; i++) {
+        char key[16];
+        snprintf(key, sizeof(key), "key%06d", i);
+        TestEntry entry;
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            KineticCluster_Put(Cluster, InitLargeEntry(&entry, key, len)));
+    }
+    ReplaceDevice(0);
+
+    const int64_t maxBytesPerSecond = 4 * 1000 * 1000;
+    KineticClusterRebuildConfig config = {.maxBytesPerSecond = maxBytesPerSecond};
+    KineticClusterRebuildStats stats;
+    uint64_t start = KineticStats_Now();
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Rebuild(Cluster, 0, &config, &stats));
+    double elapsed = Milliseconds(start);
+    printf("Rebuilt %llu bytes in %.0fms\n", (unsigned long long)stats.bytesWritten, elapsed);
+    TEST_ASSERT_TRUE(stats.keysRebuilt > 0);
+    TEST_ASSERT_EQUAL(stats.keysRebuilt * len, stats.bytesRead);
+    TEST_ASSERT_EQUAL(stats.keysRebuilt * len, stats.bytesWritten);
+
+    // The values read count towards the bytes per second, as well as those
+    // written
+    TEST_ASSERT_TRUE(elapsed >= (stats.bytesRead + stats.bytesWritten) * 1000.0 / maxBytesPerSecond);
+}
+
+void test_KineticCluster_should_rebuild_in_the_background(void)
+{
+    const double weights[] = {1.0, 1.0, 1.0};
+    ConnectCluster(weights, 3);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_SetReplication(Cluster, 2, 2, 1));
+    const int count = 500;
+    int placed = PutKeys(count, 0, 2);
+    ReplaceDevice(0);
+
+    KineticClusterRebuildConfig config = {.maxOpsPerSecond = 2000};
+    KineticClusterRebuilder* rebuilder = NULL;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_StartRebuild(Cluster, 0, &config, &rebuilder));
+    TEST_ASSERT_NOT_NULL(rebuilder);
+
+    // The cluster stays in use while the rebuild runs
+    KineticClusterRebuildStats stats;
+    KineticStatus status;
+    int writes = 0;
+    while (!KineticCluster_PollRebuild(rebuilder, &stats, &status)) {
+        char key[32];
+        snprintf(key, sizeof(key), "other%d", writes++);
+        TestEntry entry;
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            KineticCluster_Put(Cluster, InitEntry(&entry, key, "value", NULL)));
+        usleep(10000);
+    }
+    TEST_ASSERT_TRUE(writes > 0);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, status);
+    TEST_ASSERT_TRUE(stats.complete);
+    TEST_ASSERT_EQUAL(0, stats.keysFailed);
+
+    // Keys written meanwhile may also be listed, and rebuilt or skipped
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_StopRebuild(&rebuilder, &stats));
+    TEST_ASSERT_NULL(rebuilder);
+    TEST_ASSERT_TRUE(stats.keysRebuilt >= (uint64_t)placed);
+    for (int i = 0; i < writes; i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "other%d", i);
+        TestEntry entry;
+        InitEntry(&entry, key, "", NULL);
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            KineticCluster_Get(Cluster, &entry.entry));
+    }
+}
+
+void test_KineticCluster_should_stop_background_rebuilds_and_resume_them(void)
+{
+    const double weights[] = {1.0, 1.0, 1.0};
+    ConnectCluster(weights, 3);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_SetReplication(Cluster, 2, 2, 1));
+    const int count = 1000;
+    int placed = PutKeys(count, 0, 2);
+    ReplaceDevice(0);
+    unlink(REBUILD_CHECKPOINT_PATH);
+
+    KineticClusterRebuildConfig config = {
+        .parallelism = 16,
+        .maxOpsPerSecond = 500,
+        .checkpointPath = REBUILD_CHECKPOINT_PATH,
+    };
+    KineticClusterRebuilder* rebuilder = NULL;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_StartRebuild(Cluster, 0, &config, &rebuilder));
+    KineticClusterRebuildStats stats;
+    do {
+        usleep(10000);
+        TEST_ASSERT_FALSE(KineticCluster_PollRebuild(rebuilder, &stats, NULL));
+    } while (stats.keysRebuilt == 0);
+
+    // Stopping wakes the rebuild from its pacing, rather than awaiting the
+    // seconds the rest of it would take
+    uint64_t start = KineticStats_Now();
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_StopRebuild(&rebuilder, &stats));
+    TEST_ASSERT_TRUE(Milliseconds(start) < 500.0);
+    TEST_ASSERT_NULL(rebuilder);
+    TEST_ASSERT_FALSE(stats.complete);
+    TEST_ASSERT_TRUE(stats.keysRebuilt < (uint64_t)placed);
+
+    // A later rebuild completes it, skipping the keys already rebuilt
+    config.maxOpsPerSecond = 0;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_Rebuild(Cluster, 0, &config, &stats));
+    TEST_ASSERT_TRUE(stats.complete);
+    TEST_ASSERT_EQUAL(placed, stats.keysRebuilt + stats.keysSkipped);
+    TEST_ASSERT_EQUAL(0, stats.keysFailed);
+    for (int i = 0; i < count; i++) {
+        char key[16];
+        snprintf(key, sizeof(key), "key%06d", i);
+        TestEntry entry;
+        InitEntry(&entry, key, "", NULL);
+        int devices[2];
+        KineticCluster_GetReplicas(Cluster, &entry.entry.key, devices, 2);
+        if (devices[0] == 0 || devices[1] == 0) {
+            TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, GetFromDevice(0, key, &entry));
+        }
+    }
+    unlink(REBUILD_CHECKPOINT_PATH);
+}
+
+void test_KineticCluster_should_reject_invalid_background_rebuilds(void)
+{
+    const double weights[] = {1.0, 1.0, 1.0};
+    ConnectCluster(weights, 3);
+    KineticClusterRebuildConfig config = {.parallelism = 0};
+    KineticClusterRebuilder* rebuilder = NULL;
+
+    // Without replication or erasure coding, nothing can be rebuilt from
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticCluster_StartRebuild(Cluster, 0, &config, &rebuilder));
+    TEST_ASSERT_NULL(rebuilder);
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCluster_SetReplication(Cluster, 2, 2, 1));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticCluster_StartRebuild(Cluster, 3, &config, &rebuilder));
+    TEST_ASSERT_NULL(rebuilder);
+    config.parallelism = 1000;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticCluster_StartRebuild(Cluster, 0, &config, &rebuilder));
+    TEST_ASSERT_NULL(rebuilder);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticCluster_StopRebuild(&rebuilder, NULL));
+}
@@ -22,11 +22,17 @@
 #include "kinetic_logger.h"
 #include "kinetic_proto.h"
 #include "protobuf-c/protobuf-c.h"
+#include <sched.h>
+#include <pthread.h>
 // #include "zlog/zlog.h"
 
 extern bool LogToConsole;
 extern FILE* FileDesc;
 extern int LogLevel;
+extern bool LogWriterRunning;
+extern bool LogWriterWaiting;
+extern uint64_t LogEnqueuePosition;
+extern uint64_t LogWrittenPosition;
 
 void setUp(void)
 {
@@ -90,7 +96,210 @@ void test_KineticLogger_Log_should_write_log_message_to_file(void)
     KineticLogger_Init(TEST_LOG_FILE);
 
     KineticLogger_Log(msg);
+    KineticLogger_Flush();
 
     TEST_ASSERT_EQUAL_FILE_CONTENT(TEST_LOG_FILE, content, length);
 }
 
+void test_KineticLogger_LogPrintf_should_truncate_messages_longer_than_a_log_slot(void)
+{
+    LOG_LOCATION;
+    char longMessage[KINETIC_LOGGER_MESSAGE_MAX * 2];
+    memset(longMessage, 'x', sizeof(longMessage) - 1);
+    longMessage[sizeof(longMessage) - 1] = '\0';
+    char content[KINETIC_LOGGER_MESSAGE_MAX + 1];
+    memset(content, 'x', KINETIC_LOGGER_MESSAGE_MAX - 1);
+    content[KINETIC_LOGGER_MESSAGE_MAX - 1] = '\n';
+    content[KINETIC_LOGGER_MESSAGE_MAX] = '\0';
+
+    KineticLogger_Init(TEST_LOG_FILE);
+
+    KineticLogger_LogPrintf("%s", longMessage);
+    KineticLogger_Flush();
+
+    TEST_ASSERT_EQUAL_FILE_CONTENT(TEST_LOG_FILE, content, strlen(content));
+}
+
+void test_KineticLogger_Log_should_drop_and_count_messages_if_ring_is_full(void)
+{
+    LOG_LOCATION;
+    KineticLogger_Init(TEST_LOG_FILE);
+    TEST_ASSERT_EQUAL(0, (int)KineticLogger_GetDropCount());
+
+    // Producers never block, so flooding the ring faster than the writer
+    // drains it must account for every message as either written or dropped
+    const int count = KINETIC_LOGGER_RING_SLOTS * 8;
+    for (int i = 0; i < count; i++) {
+        KineticLogger_LogPrintf("message %d", i);
+    }
+    KineticLogger_Flush();
+
+    FILE* file = fopen(TEST_LOG_FILE, "r");
+    TEST_ASSERT_NOT_NULL(file);
+    int lines = 0;
+    for (int c = fgetc(file); c != EOF; c = fgetc(file)) {
+        if (c == '\n') {
+            lines++;
+        }
+    }
+    fclose(file);
+
+    TEST_ASSERT_EQUAL(count, lines + (int)KineticLogger_GetDropCount());
+}
+
+void test_KineticLogger_should_only_run_writer_while_logging_is_enabled(void)
+{
+    LOG_LOCATION;
+    KineticLogger_Init("NONE");
+    TEST_ASSERT_FALSE(LogWriterRunning);
+
+    KineticLogger_Init(TEST_LOG_FILE);
+    TEST_ASSERT_TRUE(LogWriterRunning);
+    KineticLogger_SetLevel(KINETIC_LOG_LEVEL_NONE);
+    TEST_ASSERT_FALSE(LogWriterRunning);
+
+    KineticLogger_SetLevel(KINETIC_LOG_LEVEL_DEBUG);
+    TEST_ASSERT_TRUE(LogWriterRunning);
+    KineticLogger_Log("after re-enabling");
+    KineticLogger_Flush();
+    TEST_ASSERT_EQUAL_FILE_CONTENT(TEST_LOG_FILE,
+        "after re-enabling\n", strlen("after re-enabling\n"));
+}
+
+void test_KineticLogger_writer_should_block_until_a_message_is_published(void)
+{
+    LOG_LOCATION;
+    KineticLogger_Init(TEST_LOG_FILE);
+
+    // Once the ring is empty the writer parks on its condition variable
+    for (int i = 0; i < 1000000 && !__atomic_load_n(&LogWriterWaiting, __ATOMIC_SEQ_CST); i++) {
+        sched_yield();
+    }
+    TEST_ASSERT_TRUE(__atomic_load_n(&LogWriterWaiting, __ATOMIC_SEQ_CST));
+
+    KineticLogger_Log("wake up");
+    KineticLogger_Flush();
+    TEST_ASSERT_EQUAL_FILE_CONTENT(TEST_LOG_FILE, "wake up\n", strlen("wake up\n"));
+}
+
+static bool ProducersStopping;
+
+static void* ProduceMessages(void* arg)
+{
+    (void)arg;
+    while (!__atomic_load_n(&ProducersStopping, __ATOMIC_SEQ_CST)) {
+        KineticLogger_LogPrintf("message");
+    }
+    return NULL;
+}
+
+void test_KineticLogger_SetLevel_should_write_every_message_of_producers_in_flight(void)
+{
+    LOG_LOCATION;
+    KineticLogger_Init(TEST_LOG_FILE);
+    uint64_t first = __atomic_load_n(&LogEnqueuePosition, __ATOMIC_SEQ_CST);
+
+    // Restart the writer repeatedly while other threads log
+    pthread_t producers[4];
+    __atomic_store_n(&ProducersStopping, false, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(0, pthread_create(&producers[i], NULL, ProduceMessages, NULL));
+    }
+    for (int i = 0; i < 200; i++) {
+        KineticLogger_SetLevel((i % 2 == 0) ? KINETIC_LOG_LEVEL_NONE : KINETIC_LOG_LEVEL_DEBUG);
+    }
+    __atomic_store_n(&ProducersStopping, true, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < 4; i++) {
+        pthread_join(producers[i], NULL);
+    }
+    KineticLogger_Flush();
+
+    // Ring positions carry on across restarts, and each message reserved in
+    // the ring is written intact
+    uint64_t last = __atomic_load_n(&LogEnqueuePosition, __ATOMIC_SEQ_CST);
+    TEST_ASSERT_TRUE(last > first);
+    TEST_ASSERT_TRUE(last == __atomic_load_n(&LogWrittenPosition, __ATOMIC_SEQ_CST));
+    KineticLogger_Close();
+    FILE* file = fopen(TEST_LOG_FILE, "r");
+    TEST_ASSERT_NOT_NULL(file);
+    char line[KINETIC_LOGGER_MESSAGE_MAX];
+    uint64_t lines = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        TEST_ASSERT_EQUAL_STRING("message\n", line);
+        lines++;
+    }
+    fclose(file);
+    TEST_ASSERT_TRUE(lines == last - first);
+}
+
+static int EvaluationCount;
+static const char* CountEvaluation(const char* message)
+{
+    EvaluationCount++;
+    return message;
+}
+
+void test_LOG_should_not_evaluate_arguments_if_level_is_filtered(void)
+{
+    LOG_LOCATION;
+    KineticLogger_Init(TEST_LOG_FILE);
+    KineticLogger_SetLevel(KINETIC_LOG_LEVEL_ERROR);
+    EvaluationCount = 0;
+
+    LOG(CountEvaluation("debug message"));
+    LOGF("%s", CountEvaluation("debug message"));
+    TEST_ASSERT_EQUAL(0, EvaluationCount);
+
+    LOGF_ERROR("%s", CountEvaluation("error message"));
+    TEST_ASSERT_EQUAL(1, EvaluationCount);
+
+    KineticLogger_Flush();
+    TEST_ASSERT_EQUAL_FILE_CONTENT(TEST_LOG_FILE, "error message\n", strlen("error message\n"));
+}
+
+void test_LOG_should_not_evaluate_arguments_if_logging_is_disabled(void)
+{
+    LOG_LOCATION;
+    KineticLogger_Init(TEST_LOG_FILE);
+    KineticLogger_SetLevel(KINETIC_LOG_LEVEL_NONE);
+    EvaluationCount = 0;
+
+    LOG_ERROR(CountEvaluation("error message"));
+
+    TEST_ASSERT_EQUAL(0, EvaluationCount);
+}
+
+void test_LOG_should_discard_messages_from_subsystems_not_in_mask(void)
+{
+    LOG_LOCATION;
+    KineticLogger_Init(NULL);
+    KineticLogger_SetSubsystems(KINETIC_LOG_SUBSYSTEM_SOCKET);
+
+    TEST_ASSERT_TRUE(KINETIC_LOG_ENABLED(KINETIC_LOG_LEVEL_DEBUG, KINETIC_LOG_SUBSYSTEM_SOCKET));
+    TEST_ASSERT_FALSE(KINETIC_LOG_ENABLED(KINETIC_LOG_LEVEL_ERROR, KINETIC_LOG_SUBSYSTEM_PDU));
+    TEST_ASSERT_FALSE(KINETIC_LOG_ENABLED(KINETIC_LOG_LEVEL_ERROR, KINETIC_LOG_SUBSYSTEM_HMAC));
+    TEST_ASSERT_FALSE(KINETIC_LOG_ENABLED(KINETIC_LOG_LEVEL_ERROR, KINETIC_LOG_SUBSYSTEM_ALLOCATOR));
+
+    EvaluationCount = 0;
+    LOG_ERROR(CountEvaluation("client message"));
+    TEST_ASSERT_EQUAL(0, EvaluationCount);
+}
+
+void test_KineticLogger_SampleProtobuf_should_sample_1_in_N_protobuf_dumps(void)
+{
+    LOG_LOCATION;
+    KineticLogger_Init(NULL);
+
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(KineticLogger_SampleProtobuf());
+    }
+
+    KineticLogger_SetProtobufSampleRate(4);
+    int sampled = 0;
+    for (int i = 0; i < 40; i++) {
+        if (KineticLogger_SampleProtobuf()) {
+            sampled++;
+        }
+    }
+    TEST_ASSERT_EQUAL(10, sampled);
+}
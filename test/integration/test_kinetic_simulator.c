@@ -0,0 +1,1002 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#include "kinetic_simulator.h"
+#include "kinetic_simulator_store.h"
+#include "kinetic_client.h"
+#include "kinetic_types.h"
+#include "kinetic_types_internal.h"
+#include "kinetic_proto.h"
+#include "kinetic_allocator.h"
+#include "kinetic_message.h"
+#include "kinetic_pdu.h"
+#include "kinetic_decoder.h"
+#include "kinetic_logger.h"
+#include "kinetic_operation.h"
+#include "kinetic_hmac.h"
+#include "kinetic_connection.h"
+#include "kinetic_socket.h"
+#include "kinetic_transport.h"
+#include "kinetic_tls.h"
+#include "kinetic_trace.h"
+#include "kinetic_stats.h"
+#include "kinetic_hooks.h"
+#include "kinetic_nbo.h"
+
+#include "byte_array.h"
+#include "unity.h"
+#include "unity_helper.h"
+#include "protobuf-c/protobuf-c.h"
+#include "socket99/socket99.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+static KineticSimulator* Simulator;
+static KineticSessionHandle Handle;
+static int Socket;
+static int64_t Sequence;
+static uint8_t HmacKeyData[] = "asdfasdf";
+static uint8_t ValueData[PDU_VALUE_MAX_LEN];
+
+static KineticSession SessionConfig(void)
+{
+    KineticSession session = {
+        .host = "localhost",
+        .port = KineticSimulator_GetPort(Simulator),
+        .clusterVersion = 0,
+        .identity = 1,
+        .nonBlocking = false,
+        .hmacKey = ByteArray_Create(HmacKeyData, strlen((char*)HmacKeyData)),
+    };
+    return session;
+}
+
+void setUp(void)
+{
+    KineticClient_Init("NONE");
+    KineticSimulatorConfig config = {.port = 0};
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticSimulator_Start(&config, &Simulator));
+    TEST_ASSERT_TRUE(KineticSimulator_GetPort(Simulator) > 0);
+
+    KineticSession session = SessionConfig();
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_Connect(&session, &Handle));
+    Socket = -1;
+    Sequence = 0;
+}
+
+void tearDown(void)
+{
+    if (Socket >= 0) {
+        KineticSocket_Close(Socket);
+    }
+    KineticClient_Disconnect(&Handle);
+    KineticSimulator_Stop(Simulator);
+    Simulator = NULL;
+}
+
+// Sends a raw request for operations not supported by the client API, signed
+// with the specified key, and returns the unpacked response
+static KineticProto* SendRequest(KineticProto_MessageType type,
+                                 KineticProto_Body* body, ByteArray hmacKey)
+{
+    if (Socket < 0) {
+        Socket = KineticSocket_Connect("localhost",
+                                       KineticSimulator_GetPort(Simulator), false);
+        TEST_ASSERT_TRUE(Socket >= 0);
+    }
+
+    KineticProto_Header header = KINETIC_PROTO_HEADER__INIT;
+    header.clusterVersion = 0;
+    header.has_clusterVersion = true;
+    header.identity = 1;
+    header.has_identity = true;
+    header.sequence = Sequence++;
+    header.has_sequence = true;
+    header.messageType = type;
+    header.has_messageType = true;
+    KineticProto_Command command = KINETIC_PROTO_COMMAND__INIT;
+    command.header = &header;
+    command.body = body;
+    uint8_t hmacData[KINETIC_HMAC_MAX_LEN];
+    KineticProto proto = KINETIC_PROTO__INIT;
+    proto.command = &command;
+    proto.hmac.data = hmacData;
+    KineticHMAC hmac;
+    KineticHMAC_Populate(&hmac, &proto, hmacKey);
+
+    size_t protoLen = KineticProto__get_packed_size(&proto);
+    uint8_t* request = malloc(PDU_HEADER_LEN + protoLen);
+    TEST_ASSERT_NOT_NULL(request);
+    uint32_t protoLenNBO = KineticNBO_FromHostU32(protoLen);
+    uint32_t valueLenNBO = 0;
+    request[0] = 'F';
+    memcpy(&request[1], &protoLenNBO, sizeof(uint32_t));
+    memcpy(&request[5], &valueLenNBO, sizeof(uint32_t));
+    KineticProto__pack(&proto, &request[PDU_HEADER_LEN]);
+    ByteBuffer requestBuffer = ByteBuffer_Create(request, PDU_HEADER_LEN + protoLen);
+    requestBuffer.bytesUsed = PDU_HEADER_LEN + protoLen;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticSocket_Write(Socket, &requestBuffer));
+    free(request);
+
+    uint8_t headerData[PDU_HEADER_LEN];
+    ByteBuffer headerBuffer = ByteBuffer_Create(headerData, sizeof(headerData));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticSocket_Read(Socket, &headerBuffer, sizeof(headerData)));
+    TEST_ASSERT_EQUAL('F', headerData[0]);
+    memcpy(&protoLenNBO, &headerData[1], sizeof(uint32_t));
+    memcpy(&valueLenNBO, &headerData[5], sizeof(uint32_t));
+
+    KineticPDU pdu;
+    memset(&pdu, 0, sizeof(pdu));
+    pdu.header.protobufLength = KineticNBO_ToHostU32(protoLenNBO);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticSocket_ReadProtobuf(Socket, &pdu));
+    uint32_t valueLen = KineticNBO_ToHostU32(valueLenNBO);
+    if (valueLen > 0) {
+        ByteBuffer valueBuffer = ByteBuffer_Create(ValueData, sizeof(ValueData));
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            KineticSocket_Read(Socket, &valueBuffer, valueLen));
+    }
+
+    KineticProto* response = pdu.proto;
+    TEST_ASSERT_NOT_NULL(response->command);
+    TEST_ASSERT_NOT_NULL(response->command->header);
+    TEST_ASSERT_NOT_NULL(response->command->status);
+    TEST_ASSERT_TRUE(KineticHMAC_Validate(response,
+        ByteArray_Create(HmacKeyData, strlen((char*)HmacKeyData))));
+    TEST_ASSERT_EQUAL(type - 1, response->command->header->messageType);
+    TEST_ASSERT_EQUAL(header.sequence, response->command->header->ackSequence);
+    return response;
+}
+
+static KineticProto* SendKeyRequest(KineticProto_MessageType type, const char* key)
+{
+    KineticProto_KeyValue keyValue = KINETIC_PROTO_KEY_VALUE__INIT;
+    keyValue.key = (ProtobufCBinaryData) {.data = (uint8_t*)key, .len = strlen(key)};
+    keyValue.has_key = true;
+    KineticProto_Body body = KINETIC_PROTO_BODY__INIT;
+    body.keyValue = &keyValue;
+    return SendRequest(type, &body,
+        ByteArray_Create(HmacKeyData, strlen((char*)HmacKeyData)));
+}
+
+static void AssertKey(const char* expected, ProtobufCBinaryData actual)
+{
+    TEST_ASSERT_EQUAL(strlen(expected), actual.len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual.data, actual.len);
+}
+
+static KineticStatus Put(const char* key, const char* value,
+                         const char* dbVersion, const char* newVersion)
+{
+    KineticEntry entry = {
+        .key = ByteBuffer_Create((void*)key, strlen(key)),
+        .value = ByteBuffer_Create((void*)value, strlen(value)),
+        .algorithm = KINETIC_ALGORITHM_SHA1,
+    };
+    entry.key.bytesUsed = strlen(key);
+    entry.value.bytesUsed = strlen(value);
+    if (dbVersion != NULL) {
+        entry.dbVersion = ByteBuffer_Create((void*)dbVersion, strlen(dbVersion));
+        entry.dbVersion.bytesUsed = strlen(dbVersion);
+    }
+    if (newVersion != NULL) {
+        entry.newVersion = ByteBuffer_Create((void*)newVersion, strlen(newVersion));
+        entry.newVersion.bytesUsed = strlen(newVersion);
+    }
+    return KineticClient_Put(Handle, &entry);
+}
+
+void test_KineticSimulator_should_respond_to_NoOp(void)
+{
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, KineticClient_NoOp(Handle));
+}
+
+void test_KineticSimulator_should_store_and_retrieve_entries(void)
+{
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        Put("key", "value", NULL, "v1"));
+
+    uint8_t keyData[] = "key";
+    uint8_t value[64], version[16], tag[64];
+    KineticEntry entry = {
+        .key = ByteBuffer_Create(keyData, 3),
+        .value = ByteBuffer_Create(value, sizeof(value)),
+        .dbVersion = ByteBuffer_Create(version, sizeof(version)),
+        .tag = ByteBuffer_Create(tag, sizeof(tag)),
+    };
+    entry.key.bytesUsed = 3;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_Get(Handle, &entry));
+    TEST_ASSERT_EQUAL_MEMORY("value", value, 5);
+    TEST_ASSERT_EQUAL(2, entry.dbVersion.bytesUsed);
+    TEST_ASSERT_EQUAL_MEMORY("v1", version, 2);
+}
+
+void test_KineticSimulator_should_check_versions_of_updates_unless_forced(void)
+{
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        Put("key", "value", NULL, "v1"));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_VERSION_FAILURE,
+        Put("key", "value", "v0", "v2"));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        Put("key", "value", "v1", "v2"));
+
+    KineticEntry entry = {
+        .key = ByteBuffer_Create("key", 3),
+        .dbVersion = ByteBuffer_Create("v1", 2),
+    };
+    entry.key.bytesUsed = 3;
+    entry.dbVersion.bytesUsed = 2;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_VERSION_FAILURE,
+        KineticClient_Delete(Handle, &entry));
+    entry.force = true;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_Delete(Handle, &entry));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_DATA_ERROR,
+        KineticClient_Delete(Handle, &entry));
+}
+
+void test_KineticSimulator_should_reject_requests_with_an_invalid_HMAC(void)
+{
+    KineticProto* response = SendRequest(KINETIC_PROTO_MESSAGE_TYPE_NOOP, NULL,
+        ByteArray_CreateWithCString("wrong"));
+    TEST_ASSERT_EQUAL(KINETIC_PROTO_STATUS_STATUS_CODE_HMAC_FAILURE,
+                      response->command->status->code);
+    KineticProto__free_unpacked(response, NULL);
+}
+
+void test_KineticSimulator_should_get_next_previous_and_version_of_entries(void)
+{
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, Put("a", "1", NULL, "va"));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, Put("c", "3", NULL, "vc"));
+
+    KineticProto* response = SendKeyRequest(KINETIC_PROTO_MESSAGE_TYPE_GETNEXT, "a");
+    TEST_ASSERT_EQUAL(KINETIC_PROTO_STATUS_STATUS_CODE_SUCCESS,
+                      response->command->status->code);
+    AssertKey("c", response->command->body->keyValue->key);
+    TEST_ASSERT_EQUAL_MEMORY("3", ValueData, 1);
+    KineticProto__free_unpacked(response, NULL);
+
+    response = SendKeyRequest(KINETIC_PROTO_MESSAGE_TYPE_GETPREVIOUS, "b");
+    AssertKey("a", response->command->body->keyValue->key);
+    KineticProto__free_unpacked(response, NULL);
+
+    response = SendKeyRequest(KINETIC_PROTO_MESSAGE_TYPE_GETVERSION, "c");
+    AssertKey("vc", response->command->body->keyValue->dbVersion);
+    KineticProto__free_unpacked(response, NULL);
+
+    response = SendKeyRequest(KINETIC_PROTO_MESSAGE_TYPE_GETNEXT, "c");
+    TEST_ASSERT_EQUAL(KINETIC_PROTO_STATUS_STATUS_CODE_NOT_FOUND,
+                      response->command->status->code);
+    KineticProto__free_unpacked(response, NULL);
+}
+
+void test_KineticSimulator_should_return_key_ranges_in_either_direction(void)
+{
+    const char* keys[] = {"k0", "k1", "k2", "k3", "k4"};
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, Put(keys[i], "", NULL, NULL));
+    }
+
+    KineticProto_Range range = KINETIC_PROTO_RANGE__INIT;
+    range.startKey = (ProtobufCBinaryData) {.data = (uint8_t*)"k1", .len = 2};
+    range.has_startKey = true;
+    range.startKeyInclusive = false;
+    range.has_startKeyInclusive = true;
+    range.endKey = (ProtobufCBinaryData) {.data = (uint8_t*)"k4", .len = 2};
+    range.has_endKey = true;
+    range.endKeyInclusive = true;
+    range.has_endKeyInclusive = true;
+    range.maxReturned = 2;
+    range.has_maxReturned = true;
+    KineticProto_Body body = KINETIC_PROTO_BODY__INIT;
+    body.range = &range;
+    ByteArray hmacKey = ByteArray_Create(HmacKeyData, strlen((char*)HmacKeyData));
+
+    KineticProto* response = SendRequest(KINETIC_PROTO_MESSAGE_TYPE_GETKEYRANGE, &body, hmacKey);
+    TEST_ASSERT_EQUAL(KINETIC_PROTO_STATUS_STATUS_CODE_SUCCESS,
+                      response->command->status->code);
+    TEST_ASSERT_EQUAL(2, response->command->body->range->n_key);
+    AssertKey("k2", response->command->body->range->key[0]);
+    AssertKey("k3", response->command->body->range->key[1]);
+    KineticProto__free_unpacked(response, NULL);
+
+    range.maxReturned = 10;
+    range.reverse = true;
+    range.has_reverse = true;
+    response = SendRequest(KINETIC_PROTO_MESSAGE_TYPE_GETKEYRANGE, &body, hmacKey);
+    TEST_ASSERT_EQUAL(3, response->command->body->range->n_key);
+    AssertKey("k4", response->command->body->range->key[0]);
+    AssertKey("k3", response->command->body->range->key[1]);
+    AssertKey("k2", response->command->body->range->key[2]);
+    KineticProto__free_unpacked(response, NULL);
+}
+
+void test_KineticSimulator_should_report_logs_and_flush(void)
+{
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, Put("key", "value", NULL, NULL));
+
+    KineticProto_GetLog_Type types[] = {
+        KINETIC_PROTO_GET_LOG_TYPE_CAPACITIES,
+        KINETIC_PROTO_GET_LOG_TYPE_STATISTICS,
+        KINETIC_PROTO_GET_LOG_TYPE_LIMITS,
+    };
+    KineticProto_GetLog getLog = KINETIC_PROTO_GET_LOG__INIT;
+    getLog.type = types;
+    getLog.n_type = 3;
+    KineticProto_Body body = KINETIC_PROTO_BODY__INIT;
+    body.getLog = &getLog;
+    ByteArray hmacKey = ByteArray_Create(HmacKeyData, strlen((char*)HmacKeyData));
+
+    KineticProto* response = SendRequest(KINETIC_PROTO_MESSAGE_TYPE_GETLOG, &body, hmacKey);
+    TEST_ASSERT_EQUAL(KINETIC_PROTO_STATUS_STATUS_CODE_SUCCESS,
+                      response->command->status->code);
+    KineticProto_GetLog* log = response->command->body->getLog;
+    TEST_ASSERT_EQUAL(3 + 5, log->capacity->nominalCapacityInBytes);
+    TEST_ASSERT_EQUAL(KINETIC_MAX_KEY_LEN, log->limits->maxKeySize);
+    TEST_ASSERT_TRUE(log->n_statistics > 0);
+    KineticProto__free_unpacked(response, NULL);
+
+    response = SendRequest(KINETIC_PROTO_MESSAGE_TYPE_FLUSHALLDATA, NULL, hmacKey);
+    TEST_ASSERT_EQUAL(KINETIC_PROTO_STATUS_STATUS_CODE_SUCCESS,
+                      response->command->status->code);
+    KineticProto__free_unpacked(response, NULL);
+}
+
+void test_KineticSimulator_should_serve_many_connections(void)
+{
+    // Client sessions are limited, so use raw connections
+    int sockets[32];
+    for (int i = 0; i < 32; i++) {
+        sockets[i] = KineticSocket_Connect("localhost",
+                                           KineticSimulator_GetPort(Simulator), false);
+        TEST_ASSERT_TRUE(sockets[i] >= 0);
+    }
+    ByteArray hmacKey = ByteArray_Create(HmacKeyData, strlen((char*)HmacKeyData));
+    for (int i = 31; i >= 0; i--) {
+        Socket = sockets[i];
+        KineticProto* response = SendRequest(KINETIC_PROTO_MESSAGE_TYPE_NOOP, NULL, hmacKey);
+        TEST_ASSERT_EQUAL(KINETIC_PROTO_STATUS_STATUS_CODE_SUCCESS,
+                          response->command->status->code);
+        KineticProto__free_unpacked(response, NULL);
+    }
+    for (int i = 0; i < 32; i++) {
+        KineticSocket_Close(sockets[i]);
+    }
+    Socket = -1;
+}
+
+void test_KineticSimulator_should_serve_sessions_through_its_in_process_transport(void)
+{
+    KineticSession session = SessionConfig();
+    session.transport = KineticSimulator_GetTransport(Simulator);
+    KineticSessionHandle memoryHandle;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_Connect(&session, &memoryHandle));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_NoOp(memoryHandle));
+
+    for (size_t i = 0; i < sizeof(ValueData); i++) {
+        ValueData[i] = (uint8_t)(i * 7);
+    }
+    uint8_t keyData[] = "memory";
+    KineticEntry entry = {
+        .key = ByteBuffer_Create(keyData, 6),
+        .value = ByteBuffer_Create(ValueData, sizeof(ValueData)),
+        .algorithm = KINETIC_ALGORITHM_SHA1,
+        .force = true,
+    };
+    entry.key.bytesUsed = 6;
+    entry.value.bytesUsed = sizeof(ValueData);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_Put(memoryHandle, &entry));
+    KineticClient_Disconnect(&memoryHandle);
+
+    // Entries are shared with sessions connected over the network
+    static uint8_t value[PDU_VALUE_MAX_LEN];
+    uint8_t version[16], tag[64];
+    entry = (KineticEntry) {
+        .key = ByteBuffer_Create(keyData, 6),
+        .value = ByteBuffer_Create(value, sizeof(value)),
+        .dbVersion = ByteBuffer_Create(version, sizeof(version)),
+        .tag = ByteBuffer_Create(tag, sizeof(tag)),
+    };
+    entry.key.bytesUsed = 6;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_Get(Handle, &entry));
+    TEST_ASSERT_EQUAL_MEMORY(ValueData, value, sizeof(value));
+}
+
+// Gets an entry through the specified session, into the specified buffer
+static KineticStatus GetValue(KineticSessionHandle handle, const char* key,
+                              uint8_t* value, size_t len)
+{
+    uint8_t keyData[64], version[16], tag[64];
+    KineticEntry entry = {
+        .key = ByteBuffer_Create(keyData, sizeof(keyData)),
+        .value = ByteBuffer_Create(value, len),
+        .dbVersion = ByteBuffer_Create(version, sizeof(version)),
+        .tag = ByteBuffer_Create(tag, sizeof(tag)),
+    };
+    ByteBuffer_AppendCString(&entry.key, key);
+    KineticStatus status = KineticClient_Get(handle, &entry);
+    if (status == KINETIC_STATUS_SUCCESS) {
+        TEST_ASSERT_EQUAL(5, entry.value.bytesUsed);
+    }
+    return status;
+}
+
+void test_KineticSimulator_should_revalidate_entries_read_through_the_client_cache(void)
+{
+    KineticSession session = SessionConfig();
+    session.readCacheBytes = 1024 * 1024;
+    KineticSessionHandle cachedHandle;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_Connect(&session, &cachedHandle));
+
+    uint8_t value[64];
+    KineticCacheStats stats;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        Put("cached", "one..", NULL, "v1"));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        GetValue(cachedHandle, "cached", value, sizeof(value)));
+    TEST_ASSERT_EQUAL_MEMORY("one..", value, 5);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetCacheStats(cachedHandle, &stats));
+    TEST_ASSERT_EQUAL(0, stats.hits);
+    TEST_ASSERT_EQUAL(1, stats.misses);
+    TEST_ASSERT_EQUAL(1, stats.entries);
+
+    // Served from the cache once GETVERSION shows it is current
+    memset(value, 0, sizeof(value));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        GetValue(cachedHandle, "cached", value, sizeof(value)));
+    TEST_ASSERT_EQUAL_MEMORY("one..", value, 5);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetCacheStats(cachedHandle, &stats));
+    TEST_ASSERT_EQUAL(1, stats.hits);
+
+    // Updates through other sessions make the cached copy stale
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        Put("cached", "two..", "v1", "v2"));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        GetValue(cachedHandle, "cached", value, sizeof(value)));
+    TEST_ASSERT_EQUAL_MEMORY("two..", value, 5);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetCacheStats(cachedHandle, &stats));
+    TEST_ASSERT_EQUAL(1, stats.hits);
+    TEST_ASSERT_EQUAL(1, stats.stale);
+    TEST_ASSERT_EQUAL(1, stats.entries);
+
+    // ...as does deleting them
+    KineticEntry entry = {
+        .key = ByteBuffer_Create((void*)"cached", 6),
+        .force = true,
+    };
+    entry.key.bytesUsed = 6;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_Delete(Handle, &entry));
+    TEST_ASSERT_TRUE(GetValue(cachedHandle, "cached", value, sizeof(value)) !=
+                     KINETIC_STATUS_SUCCESS);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetCacheStats(cachedHandle, &stats));
+    TEST_ASSERT_EQUAL(1, stats.hits);
+    TEST_ASSERT_EQUAL(0, stats.entries);
+
+    KineticClient_Disconnect(&cachedHandle);
+}
+
+#define CACHE_FILE_PATH "build/test_kinetic_simulator_cache_file.dat"
+
+static KineticSessionHandle ConnectCacheFile(void)
+{
+    KineticSession session = SessionConfig();
+    session.readCacheBytes = 1024 * 1024;
+    session.readCacheFile = CACHE_FILE_PATH;
+    session.readCacheFileBytes = 1024 * 1024;
+    KineticSessionHandle handle;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_Connect(&session, &handle));
+    return handle;
+}
+
+void test_KineticSimulator_should_serve_entries_from_the_cache_file_after_reconnecting(void)
+{
+    unlink(CACHE_FILE_PATH);
+    KineticSessionHandle cachedHandle = ConnectCacheFile();
+
+    // Only one session can use the file at a time
+    KineticSession session = SessionConfig();
+    session.readCacheFile = CACHE_FILE_PATH;
+    session.readCacheFileBytes = 1024 * 1024;
+    KineticSessionHandle otherHandle;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SESSION_INVALID,
+        KineticClient_Connect(&session, &otherHandle));
+
+    uint8_t value[64];
+    KineticCacheStats stats;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        Put("file1", "one..", NULL, "v1"));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        Put("file2", "two..", NULL, "v1"));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        GetValue(cachedHandle, "file1", value, sizeof(value)));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        GetValue(cachedHandle, "file2", value, sizeof(value)));
+    KineticClient_Disconnect(&cachedHandle);
+
+    // The memory tier starts empty, but the file still holds both entries
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        Put("file2", "TWO..", "v1", "v2"));
+    cachedHandle = ConnectCacheFile();
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetCacheFileStats(cachedHandle, &stats));
+    TEST_ASSERT_EQUAL(2, stats.entries);
+
+    memset(value, 0, sizeof(value));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        GetValue(cachedHandle, "file1", value, sizeof(value)));
+    TEST_ASSERT_EQUAL_MEMORY("one..", value, 5);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        GetValue(cachedHandle, "file2", value, sizeof(value)));
+    TEST_ASSERT_EQUAL_MEMORY("TWO..", value, 5);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetCacheFileStats(cachedHandle, &stats));
+    TEST_ASSERT_EQUAL(1, stats.hits);
+    TEST_ASSERT_EQUAL(1, stats.stale);
+    TEST_ASSERT_EQUAL(2, stats.entries);
+
+    // Entries served from the file are promoted to the memory tier
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        GetValue(cachedHandle, "file1", value, sizeof(value)));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetCacheStats(cachedHandle, &stats));
+    TEST_ASSERT_EQUAL(1, stats.hits);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetCacheFileStats(cachedHandle, &stats));
+    TEST_ASSERT_EQUAL(1, stats.hits);
+
+    KineticClient_Disconnect(&cachedHandle);
+    unlink(CACHE_FILE_PATH);
+}
+
+// Forces a PUT of a 5 byte value through the specified session
+static KineticStatus ForcePut(KineticSessionHandle handle, const char* key, const char* value)
+{
+    KineticEntry entry = {
+        .key = ByteBuffer_Create((void*)key, strlen(key)),
+        .value = ByteBuffer_Create((void*)value, strlen(value)),
+        .algorithm = KINETIC_ALGORITHM_SHA1,
+        .force = true,
+    };
+    entry.key.bytesUsed = strlen(key);
+    entry.value.bytesUsed = strlen(value);
+    return KineticClient_Put(handle, &entry);
+}
+
+static KineticSessionHandle ConnectWriteBack(size_t bytes, int intervalMs)
+{
+    KineticSession session = SessionConfig();
+    session.writeBackBytes = bytes;
+    session.writeBackIntervalMs = intervalMs;
+    KineticSessionHandle handle;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_Connect(&session, &handle));
+    return handle;
+}
+
+void test_KineticSimulator_should_absorb_repeated_writes_in_the_write_back_buffer(void)
+{
+    KineticSessionHandle writeBackHandle = ConnectWriteBack(1024 * 1024, 60000);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_ResetStats(writeBackHandle));
+
+    char value[8];
+    for (int i = 0; i < 100; i++) {
+        snprintf(value, sizeof(value), "v%04d", i);
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            ForcePut(writeBackHandle, "hot", value));
+    }
+
+    // Buffered entries are visible to the session, but not yet on the device
+    uint8_t buffer[64];
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        GetValue(writeBackHandle, "hot", buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_MEMORY("v0099", buffer, 5);
+    TEST_ASSERT_TRUE(GetValue(Handle, "hot", buffer, sizeof(buffer)) != KINETIC_STATUS_SUCCESS);
+
+    // Operations served from the buffer are not counted as requests
+    KineticStats operationStats;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetStats(writeBackHandle, &operationStats));
+    TEST_ASSERT_EQUAL(0, operationStats.operations);
+
+    KineticWriteBackStats stats;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetWriteBackStats(writeBackHandle, &stats));
+    TEST_ASSERT_EQUAL(100, stats.absorbed);
+    TEST_ASSERT_EQUAL(0, stats.written);
+    TEST_ASSERT_EQUAL(1, stats.dirtyEntries);
+
+    // One write per key for each flush
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_Flush(writeBackHandle));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetWriteBackStats(writeBackHandle, &stats));
+    TEST_ASSERT_EQUAL(1, stats.written);
+    TEST_ASSERT_EQUAL(1, stats.flushes);
+    TEST_ASSERT_EQUAL(0, stats.dirtyEntries);
+    TEST_ASSERT_EQUAL(0, stats.dirtyBytes);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        GetValue(Handle, "hot", buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_MEMORY("v0099", buffer, 5);
+
+    KineticClient_Disconnect(&writeBackHandle);
+}
+
+void test_KineticSimulator_should_drain_the_write_back_buffer_at_its_high_water_mark(void)
+{
+    KineticSessionHandle writeBackHandle = ConnectWriteBack(1024, 60000);
+
+    char key[16];
+    for (int i = 0; i < 200; i++) {
+        snprintf(key, sizeof(key), "drain%03d", i);
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            ForcePut(writeBackHandle, key, "value"));
+    }
+
+    KineticWriteBackStats stats;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetWriteBackStats(writeBackHandle, &stats));
+    TEST_ASSERT_TRUE(stats.dirtyBytes <= 1024);
+    TEST_ASSERT_TRUE(stats.written > 0);
+
+    // Entries still buffered are written before disconnecting
+    KineticClient_Disconnect(&writeBackHandle);
+    uint8_t buffer[64];
+    for (int i = 0; i < 200; i++) {
+        snprintf(key, sizeof(key), "drain%03d", i);
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            GetValue(Handle, key, buffer, sizeof(buffer)));
+    }
+}
+
+void test_KineticSimulator_should_write_buffered_entries_before_other_updates_of_the_key(void)
+{
+    KineticSessionHandle writeBackHandle = ConnectWriteBack(1024 * 1024, 60000);
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        ForcePut(writeBackHandle, "ordered", "one.."));
+    KineticEntry entry = {
+        .key = ByteBuffer_Create((void*)"ordered", 7),
+        .force = true,
+    };
+    entry.key.bytesUsed = 7;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_Delete(writeBackHandle, &entry));
+
+    uint8_t buffer[64];
+    TEST_ASSERT_TRUE(GetValue(writeBackHandle, "ordered", buffer, sizeof(buffer)) !=
+                     KINETIC_STATUS_SUCCESS);
+    KineticClient_Disconnect(&writeBackHandle);
+    TEST_ASSERT_TRUE(GetValue(Handle, "ordered", buffer, sizeof(buffer)) !=
+                     KINETIC_STATUS_SUCCESS);
+}
+
+// Increments a 5 digit counter, starting from 0 if the entry does not exist
+void test_KineticSimulator_should_read_pipelined_write_back_responses_while_they_decode(void)
+{
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, KineticClient_SetDecodeWorkers(2));
+    KineticSessionHandle writeBackHandle = ConnectWriteBack(1024 * 1024, 60000);
+
+    char key[16];
+    for (int i = 0; i < 200; i++) {
+        snprintf(key, sizeof(key), "pipelined%03d", i);
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            ForcePut(writeBackHandle, key, "value"));
+    }
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_Flush(writeBackHandle));
+
+    KineticWriteBackStats stats;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetWriteBackStats(writeBackHandle, &stats));
+    TEST_ASSERT_EQUAL(200, stats.written);
+    TEST_ASSERT_EQUAL(0, stats.failures);
+    uint8_t buffer[64];
+    for (int i = 0; i < 200; i++) {
+        snprintf(key, sizeof(key), "pipelined%03d", i);
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            GetValue(Handle, key, buffer, sizeof(buffer)));
+    }
+
+    KineticClient_Disconnect(&writeBackHandle);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, KineticClient_SetDecodeWorkers(0));
+}
+
+static bool Increment(KineticEntry* entry, void* context)
+{
+    int* updates = (int*)context;
+    char digits[8] = "0";
+    memcpy(digits, entry->value.array.data, entry->value.bytesUsed < 5 ? entry->value.bytesUsed : 5);
+    snprintf((char*)entry->value.array.data, entry->value.array.len, "%05d", atoi(digits) + 1);
+    entry->value.bytesUsed = 5;
+    entry->algorithm = KINETIC_ALGORITHM_SHA1;
+    (*updates)++;
+    return true;
+}
+
+static KineticStatus UpdateCounter(const char* key, int* updates)
+{
+    uint8_t keyData[64], value[64], version[16], tag[64];
+    KineticEntry entry = {
+        .key = ByteBuffer_Create(keyData, sizeof(keyData)),
+        .value = ByteBuffer_Create(value, sizeof(value)),
+        .dbVersion = ByteBuffer_Create(version, sizeof(version)),
+        .tag = ByteBuffer_Create(tag, sizeof(tag)),
+    };
+    ByteBuffer_AppendCString(&entry.key, key);
+    KineticStatus status = KineticClient_Update(Handle, &entry, Increment, updates);
+    if (status == KINETIC_STATUS_SUCCESS) {
+        TEST_ASSERT_EQUAL(16, entry.dbVersion.bytesUsed);
+    }
+    return status;
+}
+
+void test_KineticSimulator_should_update_entries_with_cached_versions(void)
+{
+    KineticStats stats;
+    int updates = 0;
+    uint8_t buffer[64];
+
+    // Entries are created if they do not exist, reading them only once
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_ResetStats(Handle));
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            UpdateCounter("counter", &updates));
+    }
+    TEST_ASSERT_EQUAL(10, updates);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetStats(Handle, &stats));
+    TEST_ASSERT_EQUAL(11, stats.operations);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        GetValue(Handle, "counter", buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_MEMORY("00010", buffer, 5);
+
+    // Concurrent updates fail the PUT, so the entry is read again
+    KineticSessionHandle otherHandle;
+    KineticSession session = SessionConfig();
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_Connect(&session, &otherHandle));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        ForcePut(otherHandle, "counter", "00100"));
+    KineticClient_Disconnect(&otherHandle);
+
+    updates = 0;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_ResetStats(Handle));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        UpdateCounter("counter", &updates));
+    TEST_ASSERT_EQUAL(2, updates);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetStats(Handle, &stats));
+    TEST_ASSERT_EQUAL(3, stats.operations);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        GetValue(Handle, "counter", buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_MEMORY("00101", buffer, 5);
+}
+
+void test_KineticSimulator_should_fail_GETs_of_keys_excluded_by_the_key_filter(void)
+{
+    char key[16];
+    for (int i = 0; i < 500; i++) {
+        snprintf(key, sizeof(key), "present%03d", i);
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, ForcePut(Handle, key, "value"));
+    }
+
+    KineticSession session = SessionConfig();
+    session.keyFilterBytes = 512;
+    KineticSessionHandle filteredHandle;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_Connect(&session, &filteredHandle));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_RebuildKeyFilter(filteredHandle));
+
+    // No false negatives for keys on the device
+    uint8_t buffer[64];
+    for (int i = 0; i < 500; i++) {
+        snprintf(key, sizeof(key), "present%03d", i);
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            GetValue(filteredHandle, key, buffer, sizeof(buffer)));
+    }
+
+    // Most GETs of absent keys fail without a request
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_ResetStats(filteredHandle));
+    for (int i = 0; i < 1000; i++) {
+        snprintf(key, sizeof(key), "absent%03d", i);
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_DATA_ERROR,
+            GetValue(filteredHandle, key, buffer, sizeof(buffer)));
+    }
+    KineticKeyFilterStats filterStats;
+    KineticStats stats;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetKeyFilterStats(filteredHandle, &filterStats));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetStats(filteredHandle, &stats));
+    printf("Key filter of %llu bits, %u hashes: %llu/1000 false positives (expected rate %.4f)\n",
+           (unsigned long long)filterStats.bits, filterStats.hashes,
+           (unsigned long long)filterStats.falsePositives, filterStats.expectedFalsePositiveRate);
+    TEST_ASSERT_EQUAL(512 * 8, filterStats.bits);
+    TEST_ASSERT_EQUAL(500, filterStats.keys);
+    TEST_ASSERT_EQUAL(1500, filterStats.lookups);
+    TEST_ASSERT_EQUAL(1000, filterStats.negatives + filterStats.falsePositives);
+    TEST_ASSERT_EQUAL(filterStats.falsePositives, stats.operations);
+    TEST_ASSERT_TRUE(filterStats.falsePositiveRate < 0.05);
+    TEST_ASSERT_TRUE(filterStats.expectedFalsePositiveRate < 0.05);
+
+    // Keys PUT through the session are added as they are written, but those
+    // PUT through other sessions only once the filter is rebuilt
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        ForcePut(filteredHandle, "added", "value"));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        GetValue(filteredHandle, "added", buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, ForcePut(Handle, "other", "value"));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_DATA_ERROR,
+        GetValue(filteredHandle, "other", buffer, sizeof(buffer)));
+    uint64_t rebuilds = filterStats.rebuilds;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_RebuildKeyFilter(filteredHandle));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        GetValue(filteredHandle, "other", buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetKeyFilterStats(filteredHandle, &filterStats));
+    TEST_ASSERT_EQUAL(rebuilds + 1, filterStats.rebuilds);
+    TEST_ASSERT_EQUAL(502, filterStats.keys);
+
+    KineticClient_Disconnect(&filteredHandle);
+}
+
+static ByteBuffer CStringBuffer(const char* string)
+{
+    ByteBuffer buffer = ByteBuffer_Create((void*)string, strlen(string));
+    buffer.bytesUsed = strlen(string);
+    return buffer;
+}
+
+void test_KineticSimulator_should_push_entries_to_a_peer(void)
+{
+    KineticSimulator* peerSimulator;
+    KineticSimulatorConfig config = {.port = 0};
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticSimulator_Start(&config, &peerSimulator));
+    KineticSession session = SessionConfig();
+    session.port = KineticSimulator_GetPort(peerSimulator);
+    KineticSessionHandle peerHandle;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_Connect(&session, &peerHandle));
+    KineticP2PPeer peer = {.host = "localhost", .port = session.port};
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        Put("key", "value", NULL, "v1"));
+    KineticP2POperation operations[] = {
+        {.key = CStringBuffer("key"), .newKey = CStringBuffer("copy")},
+        {.key = CStringBuffer("absent")},
+    };
+
+    // Each operation reports its own status, and the first failure is returned
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_DATA_ERROR,
+        KineticClient_P2PPush(Handle, &peer, operations, 2));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, operations[0].status);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_DATA_ERROR, operations[1].status);
+    uint8_t buffer[64];
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        GetValue(peerHandle, "copy", buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_MEMORY("value", buffer, 5);
+
+    // Entries on the peer are only replaced at the expected version, or if forced
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_VERSION_FAILURE,
+        KineticClient_P2PPush(Handle, &peer, operations, 1));
+    operations[0].version = CStringBuffer("v1");
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_P2PPush(Handle, &peer, operations, 1));
+    operations[0].version = CStringBuffer("v0");
+    operations[0].force = true;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_P2PPush(Handle, &peer, operations, 1));
+
+    KineticClient_Disconnect(&peerHandle);
+    KineticSimulator_Stop(peerSimulator);
+}
+
+void test_KineticSimulator_should_push_entries_in_batches_within_its_limits(void)
+{
+    KineticSimulator* peerSimulator;
+    KineticSimulatorConfig config = {.port = 0};
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticSimulator_Start(&config, &peerSimulator));
+    KineticP2PPeer peer = {.host = "localhost", .port = KineticSimulator_GetPort(peerSimulator)};
+
+    enum {COUNT = 150};
+    static char keys[COUNT][16];
+    static KineticP2POperation operations[COUNT];
+    for (int i = 0; i < COUNT; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "key%03d", i);
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, ForcePut(Handle, keys[i], "value"));
+        operations[i] = (KineticP2POperation) {.key = CStringBuffer(keys[i])};
+    }
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_ResetStats(Handle));
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_P2PPush(Handle, &peer, operations, COUNT));
+    KineticStats stats;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetStats(Handle, &stats));
+    TEST_ASSERT_EQUAL((COUNT + KINETIC_SIMULATOR_MAX_P2P_OPERATIONS - 1) /
+                      KINETIC_SIMULATOR_MAX_P2P_OPERATIONS,
+                      stats.latency[KINETIC_PROTO_MESSAGE_TYPE_PEER2PEERPUSH].count);
+    for (int i = 0; i < COUNT; i++) {
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, operations[i].status);
+    }
+    TEST_ASSERT_EQUAL(1, stats.latency[KINETIC_PROTO_MESSAGE_TYPE_GETLOG].count);
+
+    // The limits are read once per connection
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_P2PPush(Handle, &peer, operations, 1));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetStats(Handle, &stats));
+    TEST_ASSERT_EQUAL(1, stats.latency[KINETIC_PROTO_MESSAGE_TYPE_GETLOG].count);
+    KineticConnection* connection = KineticConnection_FromHandle(Handle);
+    KineticConnection_Disconnect(connection);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticConnection_Connect(connection));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_P2PPush(Handle, &peer, operations, 1));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetStats(Handle, &stats));
+    TEST_ASSERT_EQUAL(2, stats.latency[KINETIC_PROTO_MESSAGE_TYPE_GETLOG].count);
+
+    KineticSimulator_Stop(peerSimulator);
+}
+
+void test_KineticSimulator_should_fail_pushes_to_unreachable_peers(void)
+{
+    KineticSimulator* peerSimulator;
+    KineticSimulatorConfig config = {.port = 0};
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticSimulator_Start(&config, &peerSimulator));
+    KineticP2PPeer peer = {.host = "localhost", .port = KineticSimulator_GetPort(peerSimulator)};
+    KineticSimulator_Stop(peerSimulator);
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        Put("key", "value", NULL, "v1"));
+    KineticP2POperation operations[] = {{.key = CStringBuffer("key")}};
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_CONNECTION_ERROR,
+        KineticClient_P2PPush(Handle, &peer, operations, 1));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_CONNECTION_ERROR, operations[0].status);
+}
@@ -23,6 +23,7 @@
 #include "kinetic_types_internal.h"
 #include "kinetic_socket.h"
 #include "kinetic_logger.h"
+#include "kinetic_stats.h"
 #include "kinetic_proto.h"
 #include "kinetic_message.h"
 
@@ -124,6 +125,36 @@ void test_KineticSocket_Connect_should_create_a_socket_connection(void)
     TEST_ASSERT_TRUE_MESSAGE(FileDesc >= 0, "File descriptor invalid");
 }
 
+void test_KineticSocket_Read_should_read_only_the_requested_length_of_pipelined_responses(void)
+{
+    LOG_LOCATION;
+    int pair[2];
+    TEST_ASSERT_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, pair));
+
+    // Both responses have arrived by the time the first is read
+    const char* first = "first response";
+    const char* second = "second";
+    TEST_ASSERT_EQUAL(strlen(first), write(pair[1], first, strlen(first)));
+    TEST_ASSERT_EQUAL(strlen(second), write(pair[1], second, strlen(second)));
+
+    // Each is read into a buffer with room for more than the response
+    uint8_t respData[64];
+    ByteBuffer respBuffer = ByteBuffer_Create(respData, sizeof(respData));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticSocket_Read(pair[0], &respBuffer, strlen(first)));
+    TEST_ASSERT_EQUAL(strlen(first), respBuffer.bytesUsed);
+    TEST_ASSERT_EQUAL_MEMORY(first, respData, strlen(first));
+
+    respBuffer = ByteBuffer_Create(respData, sizeof(respData));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticSocket_Read(pair[0], &respBuffer, strlen(second)));
+    TEST_ASSERT_EQUAL(strlen(second), respBuffer.bytesUsed);
+    TEST_ASSERT_EQUAL_MEMORY(second, respData, strlen(second));
+
+    close(pair[0]);
+    close(pair[1]);
+}
+
 // Disabling socket read/write tests in not OSX, since Linux TravisCI builds
 // fail, but system test passes. Most likely an issue with KineticRuby server
 #if defined(__APPLE__)
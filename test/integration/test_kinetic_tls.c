@@ -0,0 +1,277 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#include "unity.h"
+#include "unity_helper.h"
+#include "kinetic_types.h"
+#include "kinetic_types_internal.h"
+#include "kinetic_tls.h"
+#include "kinetic_socket.h"
+#include "kinetic_logger.h"
+#include "kinetic_stats.h"
+#include "kinetic_proto.h"
+#include "kinetic_message.h"
+#include "byte_array.h"
+#include "protobuf-c/protobuf-c.h"
+#include "socket99/socket99.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/select.h>
+
+// Uses `openssl s_server -rev` as a stand-in for a Kinetic Device TLS port.
+// The server reverses each line of text it receives and sends it back.
+#define TLS_TEST_PORT (18443)
+
+static pid_t ServerPID = -1;
+static KineticConnection Connection;
+
+// Certificates are generated in a temporary directory, removed on exit: the
+// server's, and another which did not sign it
+static char CertDir[] = "/tmp/test_kinetic_tls_XXXXXX";
+static char ServerCert[64], ServerKey[64], OtherCert[64], OtherKey[64];
+
+static void RemoveCertificates(void)
+{
+    unlink(ServerCert);
+    unlink(ServerKey);
+    unlink(OtherCert);
+    unlink(OtherKey);
+    rmdir(CertDir);
+}
+
+static void CreateCertificate(const char* cert, const char* key)
+{
+    char command[512];
+    snprintf(command, sizeof(command),
+             "openssl req -x509 -newkey ec -pkeyopt ec_paramgen_curve:prime256v1 -nodes"
+             " -keyout %s -out %s -days 1 -subj /CN=localhost"
+             " -addext subjectAltName=DNS:localhost </dev/null >/dev/null 2>&1",
+             key, cert);
+    TEST_ASSERT_EQUAL_MESSAGE(0, system(command), "Failed generating test certificate");
+}
+
+static void CreateCertificates(void)
+{
+    if (ServerCert[0] != '\0') {
+        return;
+    }
+    TEST_ASSERT_NOT_NULL_MESSAGE(mkdtemp(CertDir), "Failed creating certificate directory");
+    snprintf(ServerCert, sizeof(ServerCert), "%s/server_cert.pem", CertDir);
+    snprintf(ServerKey, sizeof(ServerKey), "%s/server_key.pem", CertDir);
+    snprintf(OtherCert, sizeof(OtherCert), "%s/other_cert.pem", CertDir);
+    snprintf(OtherKey, sizeof(OtherKey), "%s/other_key.pem", CertDir);
+    atexit(RemoveCertificates);
+    CreateCertificate(ServerCert, ServerKey);
+    CreateCertificate(OtherCert, OtherKey);
+}
+
+static void Sleep100ms(void)
+{
+    struct timeval delay = {.tv_sec = 0, .tv_usec = 100000};
+    select(0, NULL, NULL, NULL, &delay);
+}
+
+static void StartServer(void)
+{
+    CreateCertificates();
+
+    ServerPID = fork();
+    TEST_ASSERT_TRUE_MESSAGE(ServerPID >= 0, "Failed to fork TLS test server");
+    if (ServerPID == 0) {
+        char port[16];
+        sprintf(port, "%d", TLS_TEST_PORT);
+        int devNull = open("/dev/null", O_RDWR);
+        dup2(devNull, STDIN_FILENO);
+        dup2(devNull, STDOUT_FILENO);
+        dup2(devNull, STDERR_FILENO);
+        execlp("openssl", "openssl", "s_server", "-accept", port,
+               "-cert", ServerCert, "-key", ServerKey,
+               "-rev", "-quiet", (char*)NULL);
+        _exit(1);
+    }
+
+    // Wait for the server to start accepting connections
+    for (int attempt = 0; attempt < 50; attempt++) {
+        int fd = KineticSocket_Connect("localhost", TLS_TEST_PORT, false);
+        if (fd >= 0) {
+            KineticSocket_Close(fd);
+            return;
+        }
+        Sleep100ms();
+    }
+    TEST_FAIL_MESSAGE("Timed out waiting for TLS test server to start");
+}
+
+static void StopServer(void)
+{
+    if (ServerPID > 0) {
+        kill(ServerPID, SIGTERM);
+        waitpid(ServerPID, NULL, 0);
+        ServerPID = -1;
+    }
+}
+
+static KineticStatus ConnectTLSVerifying(const char* host, const char* caFile)
+{
+    KINETIC_CONNECTION_INIT(&Connection);
+    strcpy(Connection.session.host, host);
+    Connection.session.port = TLS_TEST_PORT;
+    Connection.session.useTls = true;
+    Connection.session.tlsCAFile = caFile;
+    Connection.socket = KineticSocket_Connect(host, TLS_TEST_PORT, false);
+    TEST_ASSERT_TRUE_MESSAGE(Connection.socket >= 0, "File descriptor invalid");
+    return KineticTLS_Connect(&Connection);
+}
+
+static void ConnectTLS(void)
+{
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+                                    ConnectTLSVerifying("localhost", NULL));
+    TEST_ASSERT_NOT_NULL(Connection.tls);
+}
+
+static void DisconnectTLS(void)
+{
+    if (Connection.socket >= 0) {
+        KineticTLS_Close(&Connection);
+        TEST_ASSERT_NULL(Connection.tls);
+        KineticSocket_Close(Connection.socket);
+        Connection.socket = KINETIC_SOCKET_DESCRIPTOR_INVALID;
+    }
+}
+
+static void ExchangeLine(const char* line, const char* expected)
+{
+    uint8_t requestData[64];
+    ByteBuffer request = ByteBuffer_Create(requestData, sizeof(requestData));
+    ByteBuffer_AppendCString(&request, line);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+                                    KineticTLS_Write(&Connection, &request));
+
+    uint8_t responseData[64];
+    ByteBuffer response = ByteBuffer_Create(responseData, sizeof(responseData));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+                                    KineticTLS_Read(&Connection, &response, strlen(expected)));
+    TEST_ASSERT_EQUAL(strlen(expected), response.bytesUsed);
+    TEST_ASSERT_EQUAL_MEMORY(expected, responseData, strlen(expected));
+}
+
+void setUp(void)
+{
+    KineticLogger_Init(NULL);
+    Connection.socket = KINETIC_SOCKET_DESCRIPTOR_INVALID;
+    StartServer();
+}
+
+void tearDown(void)
+{
+    DisconnectTLS();
+    StopServer();
+}
+
+void test_KINETIC_TLS_PORT_should_be_8443(void)
+{
+    LOG_LOCATION;
+    TEST_ASSERT_EQUAL(8443, KINETIC_TLS_PORT);
+}
+
+void test_KineticTLS_should_establish_a_session_and_exchange_data(void)
+{
+    LOG_LOCATION;
+    ConnectTLS();
+
+    ExchangeLine("Some like it hot!\n", "!toh ti ekil emoS\n");
+    ExchangeLine("kinetic\n", "citenik\n");
+}
+
+void test_KineticTLS_Read_should_discard_remainder_and_return_BUFFER_OVERRUN_if_buffer_too_small(void)
+{
+    LOG_LOCATION;
+    ConnectTLS();
+
+    uint8_t requestData[16];
+    ByteBuffer request = ByteBuffer_Create(requestData, sizeof(requestData));
+    ByteBuffer_AppendCString(&request, "abcdef\n");
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+                                    KineticTLS_Write(&Connection, &request));
+
+    uint8_t responseData[3];
+    ByteBuffer response = ByteBuffer_Create(responseData, sizeof(responseData));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_BUFFER_OVERRUN,
+                                    KineticTLS_Read(&Connection, &response, 7));
+    TEST_ASSERT_EQUAL(3, response.bytesUsed);
+    TEST_ASSERT_EQUAL_MEMORY("fed", responseData, 3);
+
+    // Stream should remain in sync after the truncated read
+    ExchangeLine("xyz\n", "zyx\n");
+}
+
+void test_KineticTLS_Connect_should_resume_a_prior_session_with_the_same_device(void)
+{
+    LOG_LOCATION;
+    ConnectTLS();
+    TEST_ASSERT_FALSE(KineticTLS_SessionReused(&Connection));
+    // Session tickets are delivered after the handshake, so exchange some data
+    ExchangeLine("first\n", "tsrif\n");
+    DisconnectTLS();
+
+    ConnectTLS();
+    TEST_ASSERT_TRUE(KineticTLS_SessionReused(&Connection));
+    ExchangeLine("second\n", "dnoces\n");
+}
+
+void test_KineticTLS_Connect_should_verify_the_device_against_a_pinned_certificate(void)
+{
+    LOG_LOCATION;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+                                    ConnectTLSVerifying("localhost", ServerCert));
+    TEST_ASSERT_NOT_NULL(Connection.tls);
+    ExchangeLine("verified\n", "deifirev\n");
+}
+
+void test_KineticTLS_Connect_should_reject_a_device_certificate_not_signed_by_the_CA(void)
+{
+    LOG_LOCATION;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_CONNECTION_ERROR,
+                                    ConnectTLSVerifying("localhost", OtherCert));
+    TEST_ASSERT_NULL(Connection.tls);
+}
+
+void test_KineticTLS_Connect_should_reject_a_device_certificate_for_another_host(void)
+{
+    LOG_LOCATION;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_CONNECTION_ERROR,
+                                    ConnectTLSVerifying("127.0.0.1", ServerCert));
+    TEST_ASSERT_NULL(Connection.tls);
+}
+
+void test_KineticTLS_Connect_should_fail_if_the_CA_file_cannot_be_loaded(void)
+{
+    LOG_LOCATION;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_CONNECTION_ERROR,
+                                    ConnectTLSVerifying("localhost", "/nonexistent/ca.pem"));
+    TEST_ASSERT_NULL(Connection.tls);
+}
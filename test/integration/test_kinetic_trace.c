@@ -0,0 +1,250 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#include "unity_helper.h"
+#include "kinetic_types.h"
+#include "kinetic_types_internal.h"
+#include "kinetic_trace.h"
+#include "kinetic_logger.h"
+#include "kinetic_proto.h"
+#include "byte_array.h"
+#include "protobuf-c/protobuf-c.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#define TEST_TRACE_FILE "./build/artifacts/test/test.trace"
+
+static KineticConnection Connection;
+static KineticPDU PDU;
+
+void setUp(void)
+{
+    DELETE_FILE(TEST_LOG_FILE);
+    DELETE_FILE(TEST_TRACE_FILE);
+    KineticLogger_Init(TEST_LOG_FILE);
+
+    KINETIC_CONNECTION_INIT(&Connection);
+    Connection.connectionID = 1234;
+    KINETIC_PDU_INIT_WITH_MESSAGE(&PDU, &Connection);
+    PDU.protoData.message.header.sequence = 5678;
+    PDU.protoData.message.header.has_sequence = true;
+    PDU.protoData.message.header.messageType = KINETIC_PROTO_MESSAGE_TYPE_GET;
+    PDU.protoData.message.header.has_messageType = true;
+    PDU.header.protobufLength = 42;
+    PDU.header.valueLength = 17;
+}
+
+void tearDown(void)
+{
+    KineticTrace_Close();
+    KineticLogger_Close();
+    DELETE_FILE(TEST_LOG_FILE);
+    DELETE_FILE(TEST_TRACE_FILE);
+}
+
+static KineticTraceFileHeader* MapTraceFile(size_t* size)
+{
+    int fd = open(TEST_TRACE_FILE, O_RDONLY);
+    TEST_ASSERT_TRUE(fd >= 0);
+    *size = (size_t)lseek(fd, 0, SEEK_END);
+    void* map = mmap(NULL, *size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    TEST_ASSERT_TRUE(map != MAP_FAILED);
+    return map;
+}
+
+static const KineticTraceRecord* GetRecord(const KineticTraceFileHeader* header, uint64_t index)
+{
+    const uint8_t* records = (const uint8_t*)header + sizeof(KineticTraceFileHeader);
+    return (const KineticTraceRecord*)&records[index * header->recordSize];
+}
+
+static int CountLogLines(const char* pattern)
+{
+    char line[1024];
+    int count = 0;
+    FILE* log = fopen(TEST_LOG_FILE, "r");
+    TEST_ASSERT_NOT_NULL(log);
+    while (fgets(line, sizeof(line), log) != NULL) {
+        if (strstr(line, pattern) != NULL) {
+            count++;
+        }
+    }
+    fclose(log);
+    return count;
+}
+
+void test_KineticTrace_should_be_disabled_until_opened(void)
+{
+    LOG_LOCATION;
+    TEST_ASSERT_FALSE(KineticTrace_IsEnabled());
+
+    KineticTrace_Record(KINETIC_TRACE_EVENT_REQUEST, &PDU, PDU.proto, KINETIC_STATUS_SUCCESS);
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticTrace_Open(TEST_TRACE_FILE, 16, 0));
+    TEST_ASSERT_TRUE(KineticTrace_IsEnabled());
+
+    KineticTrace_Close();
+    TEST_ASSERT_FALSE(KineticTrace_IsEnabled());
+}
+
+void test_KineticTrace_Record_should_write_fixed_format_records_to_mapped_file(void)
+{
+    LOG_LOCATION;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticTrace_Open(TEST_TRACE_FILE, 16, 0));
+
+    KineticTrace_Record(KINETIC_TRACE_EVENT_REQUEST, &PDU, PDU.proto, KINETIC_STATUS_SUCCESS);
+    KineticTrace_Record(KINETIC_TRACE_EVENT_RESPONSE, &PDU, NULL, KINETIC_STATUS_SOCKET_TIMEOUT);
+    KineticTrace_Close();
+
+    size_t size;
+    KineticTraceFileHeader* header = MapTraceFile(&size);
+    TEST_ASSERT_EQUAL_STRING(KINETIC_TRACE_MAGIC, header->magic);
+    TEST_ASSERT_EQUAL(KINETIC_TRACE_VERSION, header->version);
+    TEST_ASSERT_EQUAL(sizeof(KineticTraceRecord), header->recordSize);
+    TEST_ASSERT_EQUAL(16, header->recordCount);
+    TEST_ASSERT_EQUAL(2, header->position);
+    TEST_ASSERT_EQUAL(sizeof(KineticTraceFileHeader) + 16 * sizeof(KineticTraceRecord), size);
+
+    const KineticTraceRecord* request = GetRecord(header, 0);
+    TEST_ASSERT_EQUAL(1, request->commit);
+    TEST_ASSERT_TRUE(request->timestamp > 0);
+    TEST_ASSERT_EQUAL(KINETIC_TRACE_EVENT_REQUEST, request->event);
+    TEST_ASSERT_EQUAL(1234, request->connectionID);
+    TEST_ASSERT_EQUAL(5678, request->sequence);
+    TEST_ASSERT_EQUAL(-1, request->ackSequence);
+    TEST_ASSERT_EQUAL(KINETIC_PROTO_MESSAGE_TYPE_GET, request->messageType);
+    TEST_ASSERT_EQUAL(KINETIC_STATUS_SUCCESS, request->status);
+    TEST_ASSERT_EQUAL(42, request->protobufLength);
+    TEST_ASSERT_EQUAL(17, request->valueLength);
+    TEST_ASSERT_EQUAL(0, request->capturedLength);
+
+    const KineticTraceRecord* response = GetRecord(header, 1);
+    TEST_ASSERT_EQUAL(2, response->commit);
+    TEST_ASSERT_EQUAL(KINETIC_TRACE_EVENT_RESPONSE, response->event);
+    TEST_ASSERT_EQUAL(-1, response->sequence);
+    TEST_ASSERT_EQUAL(KINETIC_PROTO_MESSAGE_TYPE_INVALID_MESSAGE_TYPE, response->messageType);
+    TEST_ASSERT_EQUAL(KINETIC_STATUS_SOCKET_TIMEOUT, response->status);
+
+    munmap(header, size);
+}
+
+void test_KineticTrace_Record_should_capture_packed_protobuf_if_requested(void)
+{
+    LOG_LOCATION;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticTrace_Open(TEST_TRACE_FILE, 4, 1000));
+
+    // The protobuf is captured as already packed, and only if held by the PDU
+    uint8_t packed[1000];
+    PDU.header.protobufLength = KineticProto__pack(PDU.proto, packed);
+    KineticTrace_Record(KINETIC_TRACE_EVENT_REQUEST, &PDU, PDU.proto, KINETIC_STATUS_SUCCESS);
+    PDU.packedProtobuf = packed;
+    KineticTrace_Record(KINETIC_TRACE_EVENT_REQUEST, &PDU, PDU.proto, KINETIC_STATUS_SUCCESS);
+    PDU.packedProtobuf = NULL;
+    KineticTrace_Close();
+
+    size_t size;
+    KineticTraceFileHeader* header = MapTraceFile(&size);
+    TEST_ASSERT_EQUAL(sizeof(KineticTraceRecord) + 1000, header->recordSize);
+    TEST_ASSERT_EQUAL(0, GetRecord(header, 0)->capturedLength);
+    const KineticTraceRecord* record = GetRecord(header, 1);
+    TEST_ASSERT_EQUAL(PDU.header.protobufLength, record->capturedLength);
+    TEST_ASSERT_EQUAL_MEMORY(packed, record->protobuf, record->capturedLength);
+    munmap(header, size);
+}
+
+static bool RecordersStopping;
+
+static void* RecordPDUs(void* arg)
+{
+    (void)arg;
+    while (!__atomic_load_n(&RecordersStopping, __ATOMIC_SEQ_CST)) {
+        KineticTrace_Record(KINETIC_TRACE_EVENT_REQUEST, &PDU, PDU.proto, KINETIC_STATUS_SUCCESS);
+    }
+    return NULL;
+}
+
+void test_KineticTrace_Close_should_wait_for_records_in_progress_on_other_threads(void)
+{
+    LOG_LOCATION;
+    pthread_t recorders[4];
+    __atomic_store_n(&RecordersStopping, false, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(0, pthread_create(&recorders[i], NULL, RecordPDUs, NULL));
+    }
+
+    // Each close unmaps the file while the other threads keep recording
+    for (int i = 0; i < 100; i++) {
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            KineticTrace_Open(TEST_TRACE_FILE, 16, 0));
+        KineticTrace_Close();
+    }
+    __atomic_store_n(&RecordersStopping, true, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < 4; i++) {
+        pthread_join(recorders[i], NULL);
+    }
+    TEST_ASSERT_FALSE(KineticTrace_IsEnabled());
+}
+
+void test_KineticTrace_Render_should_render_only_the_records_retained_in_the_ring(void)
+{
+    LOG_LOCATION;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticTrace_Open(TEST_TRACE_FILE, 4, 0));
+    for (int i = 0; i < 10; i++) {
+        PDU.protoData.message.header.sequence = i;
+        KineticTrace_Record(KINETIC_TRACE_EVENT_REQUEST, &PDU, PDU.proto, KINETIC_STATUS_SUCCESS);
+    }
+    KineticTrace_Close();
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticTrace_Render(TEST_TRACE_FILE));
+    KineticLogger_Flush();
+
+    TEST_ASSERT_EQUAL(4, CountLogLines("] SEND connectionID=1234"));
+    TEST_ASSERT_EQUAL(0, CountLogLines("sequence=5 "));
+    TEST_ASSERT_EQUAL(1, CountLogLines("sequence=6 "));
+    TEST_ASSERT_EQUAL(1, CountLogLines("sequence=9 "));
+    TEST_ASSERT_EQUAL(4, CountLogLines("PDU Header:"));
+    TEST_ASSERT_EQUAL(4, CountLogLines("  valueLength: 17"));
+}
+
+void test_KineticTrace_Render_should_reject_files_which_are_not_traces(void)
+{
+    LOG_LOCATION;
+    FILE* file = fopen(TEST_TRACE_FILE, "w");
+    TEST_ASSERT_NOT_NULL(file);
+    for (int i = 0; i < 128; i++) {
+        fputs("not a trace file", file);
+    }
+    fclose(file);
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticTrace_Render(TEST_TRACE_FILE));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticTrace_Render("./build/artifacts/test/missing.trace"));
+}
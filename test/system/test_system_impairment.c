@@ -0,0 +1,271 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#include "kinetic_simulator.h"
+#include "kinetic_simulator_store.h"
+#include "kinetic_simulator_socket.h"
+#include "kinetic_impairment_proxy.h"
+#include "kinetic_client.h"
+#include "kinetic_types.h"
+#include "kinetic_types_internal.h"
+#include "kinetic_proto.h"
+#include "kinetic_allocator.h"
+#include "kinetic_message.h"
+#include "kinetic_pdu.h"
+#include "kinetic_decoder.h"
+#include "kinetic_logger.h"
+#include "kinetic_operation.h"
+#include "kinetic_hmac.h"
+#include "kinetic_connection.h"
+#include "kinetic_socket.h"
+#include "kinetic_transport.h"
+#include "kinetic_tls.h"
+#include "kinetic_trace.h"
+#include "kinetic_stats.h"
+#include "kinetic_hooks.h"
+#include "kinetic_nbo.h"
+
+#include "byte_array.h"
+#include "unity.h"
+#include "unity_helper.h"
+#include "protobuf-c/protobuf-c.h"
+#include "socket99/socket99.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+// Runs the client against the C simulator through the impairment proxy, so
+// these tests do not require the Java simulator.
+
+#define NANOS_PER_SECOND (1000000000.0)
+
+static KineticSimulator* Simulator;
+static KineticImpairmentProxy* Proxy;
+static KineticSessionHandle Handle;
+static uint8_t HmacKeyData[] = "asdfasdf";
+static uint8_t ValueData[PDU_VALUE_MAX_LEN];
+
+void setUp(void)
+{
+    KineticClient_Init("NONE");
+    Simulator = NULL;
+    Proxy = NULL;
+    Handle = KINETIC_HANDLE_INVALID;
+}
+
+void tearDown(void)
+{
+    if (Handle != KINETIC_HANDLE_INVALID) {
+        KineticClient_Disconnect(&Handle);
+    }
+    KineticImpairmentProxy_Stop(Proxy);
+    KineticSimulator_Stop(Simulator);
+}
+
+static void StartSimulator(KineticSimulatorConfig config)
+{
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticSimulator_Start(&config, &Simulator));
+}
+
+// Starts a simulator behind a proxy with the specified impairments, and
+// connects a session through the proxy
+static void StartImpaired(KineticImpairmentProxyConfig proxyConfig)
+{
+    KineticSimulatorConfig config = {.port = 0};
+    StartSimulator(config);
+    proxyConfig.targetPort = KineticSimulator_GetPort(Simulator);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticImpairmentProxy_Start(&proxyConfig, &Proxy));
+}
+
+static KineticStatus Connect(int port)
+{
+    KineticSession session = {
+        .host = "localhost",
+        .port = port,
+        .clusterVersion = 0,
+        .identity = 1,
+        .nonBlocking = false,
+        .hmacKey = ByteArray_Create(HmacKeyData, strlen((char*)HmacKeyData)),
+    };
+    return KineticClient_Connect(&session, &Handle);
+}
+
+static void ConnectToProxy(void)
+{
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        Connect(KineticImpairmentProxy_GetPort(Proxy)));
+}
+
+static KineticStatus Put(const char* key, size_t valueLen)
+{
+    KineticEntry entry = {
+        .key = ByteBuffer_Create((void*)key, strlen(key)),
+        .value = ByteBuffer_Create(ValueData, valueLen),
+        .algorithm = KINETIC_ALGORITHM_SHA1,
+        .force = true,
+    };
+    entry.key.bytesUsed = strlen(key);
+    entry.value.bytesUsed = valueLen;
+    return KineticClient_Put(Handle, &entry);
+}
+
+static double Seconds(uint64_t start)
+{
+    return (KineticStats_Now() - start) / NANOS_PER_SECOND;
+}
+
+void test_Impairment_latency_should_bound_request_rate_by_round_trip_time(void)
+{
+    const int latencyMs = 10;
+    KineticImpairmentProxyConfig config = {.latencyMs = latencyMs, .seed = 1};
+    StartImpaired(config);
+    ConnectToProxy();
+
+    int count = 0;
+    uint64_t start = KineticStats_Now();
+    while (Seconds(start) < 1.0) {
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            KineticClient_NoOp(Handle));
+        count++;
+    }
+    double rate = count / Seconds(start);
+
+    // Each request waits for the latency in both directions, and the
+    // loopback round trip itself should not be significant
+    double expected = 1000.0 / (2 * latencyMs);
+    printf("NOOP rate with %dms latency: %.1f ops/s (expected %.1f)\n",
+           latencyMs, rate, expected);
+    TEST_ASSERT_TRUE(rate <= expected * 1.05);
+    TEST_ASSERT_TRUE(rate >= expected * 0.5);
+}
+
+void test_Impairment_bandwidth_should_bound_write_throughput(void)
+{
+    const int64_t bandwidth = 1000000;
+    const size_t valueLen = 64 * 1024;
+    const int count = 8;
+    KineticImpairmentProxyConfig config = {.bandwidth = bandwidth, .seed = 1};
+    StartImpaired(config);
+    ConnectToProxy();
+
+    char key[16];
+    uint64_t start = KineticStats_Now();
+    for (int i = 0; i < count; i++) {
+        snprintf(key, sizeof(key), "bw%d", i);
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, Put(key, valueLen));
+    }
+    double throughput = count * valueLen / Seconds(start);
+
+    printf("PUT throughput with %lld B/s bandwidth: %.0f B/s\n",
+           (long long)bandwidth, throughput);
+    TEST_ASSERT_TRUE(throughput <= bandwidth * 1.05);
+    TEST_ASSERT_TRUE(throughput >= bandwidth * 0.5);
+}
+
+void test_Impairment_partial_writes_and_jitter_should_not_corrupt_entries(void)
+{
+    KineticImpairmentProxyConfig config = {
+        .maxWriteSize = 7,
+        .jitterMs = 2,
+        .stallProbability = 0.01,
+        .stallMs = 5,
+        .seed = 42,
+    };
+    StartImpaired(config);
+    ConnectToProxy();
+
+    for (size_t i = 0; i < sizeof(ValueData); i++) {
+        ValueData[i] = (uint8_t)(i * 31);
+    }
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, Put("partial", 4096));
+
+    uint8_t keyData[] = "partial";
+    uint8_t value[4096];
+    uint8_t tag[64], version[16];
+    KineticEntry entry = {
+        .key = ByteBuffer_Create(keyData, strlen((char*)keyData)),
+        .value = ByteBuffer_Create(value, sizeof(value)),
+        .dbVersion = ByteBuffer_Create(version, sizeof(version)),
+        .tag = ByteBuffer_Create(tag, sizeof(tag)),
+    };
+    entry.key.bytesUsed = strlen((char*)keyData);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_Get(Handle, &entry));
+    TEST_ASSERT_EQUAL_MEMORY(ValueData, value, sizeof(value));
+}
+
+void test_Impairment_reset_should_fail_requests_without_hanging(void)
+{
+    KineticImpairmentProxyConfig config = {.resetProbability = 1.0, .seed = 1};
+    StartImpaired(config);
+    ConnectToProxy();
+
+    uint64_t start = KineticStats_Now();
+    KineticStatus status = KineticClient_NoOp(Handle);
+    TEST_ASSERT_TRUE(status != KINETIC_STATUS_SUCCESS);
+    TEST_ASSERT_TRUE(Seconds(start) < 5.0);
+
+    // The session stays failed, rather than the client being signalled
+    TEST_ASSERT_TRUE(KineticClient_NoOp(Handle) != KINETIC_STATUS_SUCCESS);
+}
+
+// Records whether each of a series of NOOPs was rejected as busy
+static int RecordBusyResponses(uint64_t seed, bool* busy, int count)
+{
+    KineticSimulatorConfig config = {
+        .port = 0,
+        .serviceBusyProbability = 0.05,
+        .serviceBusyStormLength = 4,
+        .seed = seed,
+    };
+    StartSimulator(config);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        Connect(KineticSimulator_GetPort(Simulator)));
+
+    int busyCount = 0;
+    for (int i = 0; i < count; i++) {
+        KineticStatus status = KineticClient_NoOp(Handle);
+        if (status != KINETIC_STATUS_SUCCESS) {
+            TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_DEVICE_BUSY, status);
+        }
+        busy[i] = (status == KINETIC_STATUS_DEVICE_BUSY);
+        busyCount += busy[i] ? 1 : 0;
+    }
+
+    KineticClient_Disconnect(&Handle);
+    Handle = KINETIC_HANDLE_INVALID;
+    KineticSimulator_Stop(Simulator);
+    Simulator = NULL;
+    return busyCount;
+}
+
+void test_Impairment_service_busy_storms_should_be_repeatable_for_a_seed(void)
+{
+    bool first[200], second[200];
+    int busyCount = RecordBusyResponses(7, first, 200);
+    TEST_ASSERT_EQUAL(busyCount, RecordBusyResponses(7, second, 200));
+    TEST_ASSERT_EQUAL_MEMORY(first, second, sizeof(first));
+
+    // Storms of 4 started by 5% of the remaining requests
+    TEST_ASSERT_TRUE(busyCount > 0);
+    TEST_ASSERT_TRUE(busyCount < 100);
+}
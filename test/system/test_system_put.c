@@ -25,11 +25,17 @@
 #include "kinetic_allocator.h"
 #include "kinetic_message.h"
 #include "kinetic_pdu.h"
+#include "kinetic_decoder.h"
 #include "kinetic_logger.h"
 #include "kinetic_operation.h"
 #include "kinetic_hmac.h"
 #include "kinetic_connection.h"
 #include "kinetic_socket.h"
+#include "kinetic_transport.h"
+#include "kinetic_tls.h"
+#include "kinetic_trace.h"
+#include "kinetic_stats.h"
+#include "kinetic_hooks.h"
 #include "kinetic_nbo.h"
 
 #include "byte_array.h"
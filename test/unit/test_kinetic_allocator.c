@@ -261,3 +261,26 @@ void test_KineticAllocator_should_allocate_and_free_multiple_PDU_list_items_in_r
 
     LOG("PASSED!");
 }
+
+void test_KineticAllocator_should_relink_the_list_when_freeing_a_PDU_list_item_from_the_middle(void)
+{
+    LOG_LOCATION;
+    KineticPDU* pdu0 = KineticAllocator_NewPDU(&PDUList);
+    KineticPDU* pdu1 = KineticAllocator_NewPDU(&PDUList);
+    KineticPDU* pdu2 = KineticAllocator_NewPDU(&PDUList);
+    TEST_ASSERT_NOT_NULL(pdu0);
+    TEST_ASSERT_NOT_NULL(pdu1);
+    TEST_ASSERT_NOT_NULL(pdu2);
+
+    KineticAllocator_FreePDU(&PDUList, pdu1);
+    TEST_ASSERT_EQUAL_PTR(PDUList.start, PDUList.last->previous);
+    TEST_ASSERT_EQUAL_PTR(PDUList.last, PDUList.start->next);
+
+    // The last item must not be relinked to the freed item
+    KineticAllocator_FreePDU(&PDUList, pdu2);
+    TEST_ASSERT_EQUAL_PTR(PDUList.start, PDUList.last);
+    TEST_ASSERT_NULL(PDUList.start->next);
+
+    KineticAllocator_FreePDU(&PDUList, pdu0);
+    TEST_ASSERT_TRUE(KineticAllocator_ValidateAllMemoryFreed(&PDUList));
+}
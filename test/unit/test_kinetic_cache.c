@@ -0,0 +1,212 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+
+#include "kinetic_cache.h"
+#include "kinetic_types.h"
+#include "kinetic_types_internal.h"
+#include "kinetic_logger.h"
+#include "kinetic_proto.h"
+#include "protobuf-c/protobuf-c.h"
+#include "unity.h"
+#include "unity_helper.h"
+#include <string.h>
+#include <stdio.h>
+
+static KineticCache* Cache;
+static uint8_t KeyData[32];
+static uint8_t VersionData[16];
+static uint8_t TagData[20];
+static uint8_t ValueData[1024];
+static KineticEntry Entry;
+
+void setUp(void)
+{
+    KineticLogger_Init("stdout");
+    Cache = KineticCache_Create(64 * 1024);
+    TEST_ASSERT_NOT_NULL(Cache);
+}
+
+void tearDown(void)
+{
+    KineticCache_Destroy(Cache);
+}
+
+// Points the entry at the static buffers, holding the specified key, version
+// and value
+static KineticEntry* MakeEntry(const char* key, const char* version, const char* value)
+{
+    Entry = (KineticEntry) {
+        .key = ByteBuffer_Create(KeyData, sizeof(KeyData)),
+        .dbVersion = ByteBuffer_Create(VersionData, sizeof(VersionData)),
+        .tag = ByteBuffer_Create(TagData, sizeof(TagData)),
+        .value = ByteBuffer_Create(ValueData, sizeof(ValueData)),
+        .algorithm = KINETIC_ALGORITHM_SHA1,
+    };
+    ByteBuffer_AppendCString(&Entry.key, key);
+    ByteBuffer_AppendCString(&Entry.dbVersion, version);
+    ByteBuffer_AppendCString(&Entry.tag, "some tag");
+    ByteBuffer_AppendCString(&Entry.value, value);
+    return &Entry;
+}
+
+// Clears all but the key of the entry, as before a GET
+static KineticEntry* Lookup(const char* key)
+{
+    MakeEntry(key, "", "");
+    Entry.algorithm = KINETIC_ALGORITHM_INVALID;
+    return &Entry;
+}
+
+static ByteArray Version(const char* version)
+{
+    return ByteArray_Create((void*)version, strlen(version));
+}
+
+void test_KineticCache_Get_should_return_the_cached_entry_if_its_version_is_current(void)
+{
+    KineticCache_Put(Cache, MakeEntry("key", "v1", "some value"));
+
+    KineticEntry* entry = Lookup("key");
+    TEST_ASSERT_TRUE(KineticCache_Contains(Cache, &entry->key));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCache_Get(Cache, entry, Version("v1")));
+
+    TEST_ASSERT_EQUAL(strlen("some value"), entry->value.bytesUsed);
+    TEST_ASSERT_EQUAL_MEMORY("some value", entry->value.array.data, entry->value.bytesUsed);
+    TEST_ASSERT_EQUAL(2, entry->dbVersion.bytesUsed);
+    TEST_ASSERT_EQUAL_MEMORY("v1", entry->dbVersion.array.data, 2);
+    TEST_ASSERT_EQUAL(strlen("some tag"), entry->tag.bytesUsed);
+    TEST_ASSERT_EQUAL(KINETIC_ALGORITHM_SHA1, entry->algorithm);
+
+    KineticCacheStats stats;
+    KineticCache_GetStats(Cache, &stats);
+    TEST_ASSERT_EQUAL(1, stats.hits);
+    TEST_ASSERT_EQUAL(0, stats.misses);
+    TEST_ASSERT_EQUAL(1, stats.entries);
+}
+
+void test_KineticCache_Get_should_drop_the_cached_entry_if_its_version_is_stale(void)
+{
+    KineticCache_Put(Cache, MakeEntry("key", "v1", "some value"));
+
+    KineticEntry* entry = Lookup("key");
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_NOT_ATTEMPTED,
+        KineticCache_Get(Cache, entry, Version("v2")));
+    TEST_ASSERT_FALSE(KineticCache_Contains(Cache, &entry->key));
+
+    KineticCacheStats stats;
+    KineticCache_GetStats(Cache, &stats);
+    TEST_ASSERT_EQUAL(0, stats.hits);
+    TEST_ASSERT_EQUAL(1, stats.stale);
+    TEST_ASSERT_EQUAL(1, stats.misses);
+    TEST_ASSERT_EQUAL(0, stats.entries);
+    TEST_ASSERT_EQUAL(0, stats.bytes);
+}
+
+void test_KineticCache_Get_should_report_an_overrun_if_the_value_does_not_fit(void)
+{
+    KineticCache_Put(Cache, MakeEntry("key", "v1", "some value"));
+
+    KineticEntry* entry = Lookup("key");
+    entry->value.array.len = 4;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_BUFFER_OVERRUN,
+        KineticCache_Get(Cache, entry, Version("v1")));
+}
+
+void test_KineticCache_Put_should_not_cache_entries_without_a_version(void)
+{
+    KineticCache_Put(Cache, MakeEntry("key", "v1", "some value"));
+    KineticCache_Put(Cache, MakeEntry("key", "", "new value"));
+
+    TEST_ASSERT_FALSE(KineticCache_Contains(Cache, &Entry.key));
+}
+
+void test_KineticCache_Put_should_replace_the_cached_entry(void)
+{
+    KineticCache_Put(Cache, MakeEntry("key", "v1", "some value"));
+    KineticCache_Put(Cache, MakeEntry("key", "v2", "new value"));
+
+    KineticEntry* entry = Lookup("key");
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCache_Get(Cache, entry, Version("v2")));
+    TEST_ASSERT_EQUAL_MEMORY("new value", entry->value.array.data, entry->value.bytesUsed);
+
+    KineticCacheStats stats;
+    KineticCache_GetStats(Cache, &stats);
+    TEST_ASSERT_EQUAL(1, stats.entries);
+}
+
+void test_KineticCache_Invalidate_should_remove_the_cached_entry(void)
+{
+    KineticCache_Put(Cache, MakeEntry("key", "v1", "some value"));
+    KineticCache_Invalidate(Cache, &Entry.key);
+
+    TEST_ASSERT_FALSE(KineticCache_Contains(Cache, &Entry.key));
+    KineticCacheStats stats;
+    KineticCache_GetStats(Cache, &stats);
+    TEST_ASSERT_EQUAL(0, stats.entries);
+}
+
+void test_KineticCache_should_evict_least_recently_used_entries_to_stay_within_its_capacity(void)
+{
+    char key[16];
+    char value[900];
+    memset(value, 'x', sizeof(value) - 1);
+    value[sizeof(value) - 1] = '\0';
+
+    for (int i = 0; i < 1000; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        KineticCache_Put(Cache, MakeEntry(key, "v1", value));
+        if (i == 0 || i % 10 != 0) {
+            continue;
+        }
+        // Keep the first entry in use, so that it is never the oldest
+        KineticEntry* entry = Lookup("key0");
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            KineticCache_Get(Cache, entry, Version("v1")));
+    }
+
+    KineticCacheStats stats;
+    KineticCache_GetStats(Cache, &stats);
+    TEST_ASSERT_TRUE(stats.bytes <= 64 * 1024);
+    TEST_ASSERT_TRUE(stats.evictions > 0);
+    TEST_ASSERT_TRUE(stats.entries < 1000);
+    TEST_ASSERT_EQUAL(1000, stats.entries + stats.evictions);
+
+    TEST_ASSERT_TRUE(KineticCache_Contains(Cache, &Lookup("key0")->key));
+    TEST_ASSERT_FALSE(KineticCache_Contains(Cache, &Lookup("key1")->key));
+    TEST_ASSERT_TRUE(KineticCache_Contains(Cache, &Lookup("key999")->key));
+}
+
+void test_KineticCache_GetLatest_should_return_the_cached_entry_without_checking_its_version(void)
+{
+    KineticCache_Put(Cache, MakeEntry("key", "v1", "some value"));
+
+    KineticEntry* entry = Lookup("key");
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCache_GetLatest(Cache, entry));
+    TEST_ASSERT_EQUAL(2, entry->dbVersion.bytesUsed);
+    TEST_ASSERT_EQUAL_MEMORY("v1", entry->dbVersion.array.data, 2);
+    TEST_ASSERT_EQUAL_MEMORY("some value", entry->value.array.data, entry->value.bytesUsed);
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_NOT_ATTEMPTED,
+        KineticCache_GetLatest(Cache, Lookup("other")));
+}
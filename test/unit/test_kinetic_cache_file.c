@@ -0,0 +1,274 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+
+#include "kinetic_cache_file.h"
+#include "kinetic_types.h"
+#include "kinetic_types_internal.h"
+#include "kinetic_logger.h"
+#include "kinetic_proto.h"
+#include "protobuf-c/protobuf-c.h"
+#include "unity.h"
+#include "unity_helper.h"
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#define CACHE_FILE_PATH "build/test_kinetic_cache_file.dat"
+#define CACHE_FILE_BYTES (64 * 1024)
+
+static KineticCacheFile* CacheFile;
+static uint8_t KeyData[32];
+static uint8_t VersionData[16];
+static uint8_t TagData[20];
+static uint8_t ValueData[4096];
+static KineticEntry Entry;
+
+void setUp(void)
+{
+    KineticLogger_Init("stdout");
+    unlink(CACHE_FILE_PATH);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCacheFile_Open(CACHE_FILE_PATH, CACHE_FILE_BYTES, &CacheFile));
+    TEST_ASSERT_NOT_NULL(CacheFile);
+}
+
+void tearDown(void)
+{
+    KineticCacheFile_Close(CacheFile);
+    unlink(CACHE_FILE_PATH);
+}
+
+// Closes and opens the file again, as when the client restarts
+static void Reopen(void)
+{
+    KineticCacheFile_Close(CacheFile);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCacheFile_Open(CACHE_FILE_PATH, CACHE_FILE_BYTES, &CacheFile));
+    TEST_ASSERT_NOT_NULL(CacheFile);
+}
+
+// Points the entry at the static buffers, holding the specified key, version
+// and value
+static KineticEntry* MakeEntry(const char* key, const char* version, const char* value)
+{
+    Entry = (KineticEntry) {
+        .key = ByteBuffer_Create(KeyData, sizeof(KeyData)),
+        .dbVersion = ByteBuffer_Create(VersionData, sizeof(VersionData)),
+        .tag = ByteBuffer_Create(TagData, sizeof(TagData)),
+        .value = ByteBuffer_Create(ValueData, sizeof(ValueData)),
+        .algorithm = KINETIC_ALGORITHM_SHA1,
+    };
+    ByteBuffer_AppendCString(&Entry.key, key);
+    ByteBuffer_AppendCString(&Entry.dbVersion, version);
+    ByteBuffer_AppendCString(&Entry.tag, "some tag");
+    ByteBuffer_AppendCString(&Entry.value, value);
+    return &Entry;
+}
+
+// Clears all but the key of the entry, as before a GET
+static KineticEntry* Lookup(const char* key)
+{
+    MakeEntry(key, "", "");
+    Entry.algorithm = KINETIC_ALGORITHM_INVALID;
+    return &Entry;
+}
+
+static ByteArray Version(const char* version)
+{
+    return ByteArray_Create((void*)version, strlen(version));
+}
+
+static KineticStatus Get(const char* key, const char* version)
+{
+    return KineticCacheFile_Get(CacheFile, Lookup(key), Version(version));
+}
+
+void test_KineticCacheFile_Get_should_return_the_cached_entry_if_its_version_is_current(void)
+{
+    KineticCacheFile_Put(CacheFile, MakeEntry("key", "v1", "some value"));
+
+    KineticEntry* entry = Lookup("key");
+    TEST_ASSERT_TRUE(KineticCacheFile_Contains(CacheFile, &entry->key));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticCacheFile_Get(CacheFile, entry, Version("v1")));
+
+    TEST_ASSERT_EQUAL(strlen("some value"), entry->value.bytesUsed);
+    TEST_ASSERT_EQUAL_MEMORY("some value", entry->value.array.data, entry->value.bytesUsed);
+    TEST_ASSERT_EQUAL(2, entry->dbVersion.bytesUsed);
+    TEST_ASSERT_EQUAL_MEMORY("v1", entry->dbVersion.array.data, 2);
+    TEST_ASSERT_EQUAL(strlen("some tag"), entry->tag.bytesUsed);
+    TEST_ASSERT_EQUAL(KINETIC_ALGORITHM_SHA1, entry->algorithm);
+
+    KineticCacheStats stats;
+    KineticCacheFile_GetStats(CacheFile, &stats);
+    TEST_ASSERT_EQUAL(1, stats.hits);
+    TEST_ASSERT_EQUAL(0, stats.misses);
+    TEST_ASSERT_EQUAL(1, stats.entries);
+}
+
+void test_KineticCacheFile_Get_should_drop_the_cached_entry_if_its_version_is_stale(void)
+{
+    KineticCacheFile_Put(CacheFile, MakeEntry("key", "v1", "some value"));
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_NOT_ATTEMPTED, Get("key", "v2"));
+    TEST_ASSERT_FALSE(KineticCacheFile_Contains(CacheFile, &Lookup("key")->key));
+
+    KineticCacheStats stats;
+    KineticCacheFile_GetStats(CacheFile, &stats);
+    TEST_ASSERT_EQUAL(1, stats.stale);
+    TEST_ASSERT_EQUAL(1, stats.misses);
+    TEST_ASSERT_EQUAL(0, stats.entries);
+}
+
+void test_KineticCacheFile_Put_should_not_cache_entries_without_a_version(void)
+{
+    KineticCacheFile_Put(CacheFile, MakeEntry("key", "", "some value"));
+    TEST_ASSERT_FALSE(KineticCacheFile_Contains(CacheFile, &Lookup("key")->key));
+}
+
+void test_KineticCacheFile_should_keep_entries_once_reopened(void)
+{
+    KineticCacheFile_Put(CacheFile, MakeEntry("key1", "v1", "first value"));
+    KineticCacheFile_Put(CacheFile, MakeEntry("key2", "v1", "second value"));
+    KineticCacheFile_Put(CacheFile, MakeEntry("key1", "v2", "replaced value"));
+    KineticCacheFile_Put(CacheFile, MakeEntry("key3", "v1", "third value"));
+    KineticCacheFile_Invalidate(CacheFile, &Lookup("key3")->key);
+
+    Reopen();
+
+    KineticCacheStats stats;
+    KineticCacheFile_GetStats(CacheFile, &stats);
+    TEST_ASSERT_EQUAL(2, stats.entries);
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, Get("key1", "v2"));
+    TEST_ASSERT_EQUAL_MEMORY("replaced value", Entry.value.array.data, Entry.value.bytesUsed);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, Get("key2", "v1"));
+    TEST_ASSERT_EQUAL_MEMORY("second value", Entry.value.array.data, Entry.value.bytesUsed);
+    TEST_ASSERT_FALSE(KineticCacheFile_Contains(CacheFile, &Lookup("key3")->key));
+}
+
+void test_KineticCacheFile_should_overwrite_the_oldest_entries_once_full(void)
+{
+    char key[16];
+    char value[2048];
+    memset(value, 'x', sizeof(value) - 1);
+    value[sizeof(value) - 1] = '\0';
+
+    // Several times the capacity, so that the log wraps around
+    const int count = 100;
+    for (int i = 0; i < count; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        KineticCacheFile_Put(CacheFile, MakeEntry(key, "v1", value));
+    }
+
+    KineticCacheStats stats;
+    KineticCacheFile_GetStats(CacheFile, &stats);
+    TEST_ASSERT_TRUE(stats.entries > 0);
+    TEST_ASSERT_TRUE(stats.entries < count);
+    TEST_ASSERT_EQUAL(count - stats.entries, stats.evictions);
+    TEST_ASSERT_TRUE(stats.bytes <= CACHE_FILE_BYTES);
+
+    // The most recent entries are those kept, including once reopened
+    uint64_t entries = stats.entries;
+    Reopen();
+    KineticCacheFile_GetStats(CacheFile, &stats);
+    TEST_ASSERT_EQUAL(entries, stats.entries);
+    for (int i = 0; i < count; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        bool kept = (i >= count - (int)entries);
+        TEST_ASSERT_EQUAL(kept, KineticCacheFile_Contains(CacheFile, &Lookup(key)->key));
+        if (kept) {
+            TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, Get(key, "v1"));
+            TEST_ASSERT_EQUAL(strlen(value), Entry.value.bytesUsed);
+        }
+    }
+}
+
+void test_KineticCacheFile_should_discard_entries_corrupted_while_closed(void)
+{
+    KineticCacheFile_Put(CacheFile, MakeEntry("key1", "v1", "first value"));
+    KineticCacheFile_Put(CacheFile, MakeEntry("key2", "v1", "second value"));
+    KineticCacheFile_Close(CacheFile);
+    CacheFile = NULL;
+
+    // Overwrite the start of the second value, as a torn write would
+    int fd = open(CACHE_FILE_PATH, O_RDWR);
+    TEST_ASSERT_TRUE(fd >= 0);
+    uint8_t data[KINETIC_CACHE_FILE_DATA_OFFSET + CACHE_FILE_BYTES / 16];
+    TEST_ASSERT_EQUAL(sizeof(data), pread(fd, data, sizeof(data), 0));
+    uint8_t* found = NULL;
+    for (size_t i = 0; i + strlen("second") <= sizeof(data); i++) {
+        if (memcmp(&data[i], "second", strlen("second")) == 0) {
+            found = &data[i];
+            break;
+        }
+    }
+    TEST_ASSERT_NOT_NULL(found);
+    TEST_ASSERT_EQUAL(6, pwrite(fd, "SECOND", 6, found - data));
+    close(fd);
+
+    Reopen();
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, Get("key1", "v1"));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_NOT_ATTEMPTED, Get("key2", "v1"));
+    TEST_ASSERT_FALSE(KineticCacheFile_Contains(CacheFile, &Lookup("key2")->key));
+}
+
+void test_KineticCacheFile_Open_should_fail_if_the_file_is_in_use(void)
+{
+    KineticCacheFile* other = NULL;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SESSION_INVALID,
+        KineticCacheFile_Open(CACHE_FILE_PATH, CACHE_FILE_BYTES, &other));
+    TEST_ASSERT_NULL(other);
+}
+
+void test_KineticCacheFile_Open_should_allocate_the_whole_file(void)
+{
+    struct stat st;
+    TEST_ASSERT_EQUAL(0, stat(CACHE_FILE_PATH, &st));
+    TEST_ASSERT_TRUE(st.st_size >= CACHE_FILE_BYTES);
+    TEST_ASSERT_TRUE((uint64_t)st.st_blocks * 512 >= (uint64_t)st.st_size);
+}
+
+void test_KineticCacheFile_Open_should_fail_if_the_file_cannot_be_allocated(void)
+{
+    KineticCacheFile_Close(CacheFile);
+    CacheFile = NULL;
+    unlink(CACHE_FILE_PATH);
+
+    // Limiting the size of files written stands in for a full file system
+    struct rlimit limit, saved;
+    TEST_ASSERT_EQUAL(0, getrlimit(RLIMIT_FSIZE, &saved));
+    limit = saved;
+    limit.rlim_cur = CACHE_FILE_BYTES / 2;
+    void (*handler)(int) = signal(SIGXFSZ, SIG_IGN);
+    TEST_ASSERT_EQUAL(0, setrlimit(RLIMIT_FSIZE, &limit));
+
+    KineticStatus status = KineticCacheFile_Open(CACHE_FILE_PATH, CACHE_FILE_BYTES, &CacheFile);
+
+    setrlimit(RLIMIT_FSIZE, &saved);
+    signal(SIGXFSZ, handler);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_MEMORY_ERROR, status);
+    TEST_ASSERT_NULL(CacheFile);
+}
@@ -29,6 +29,14 @@
 #include "mock_kinetic_connection.h"
 #include "mock_kinetic_message.h"
 #include "mock_kinetic_pdu.h"
+#include "mock_kinetic_decoder.h"
+#include "mock_kinetic_trace.h"
+#include "kinetic_stats.h"
+#include "kinetic_hooks.h"
+#include "kinetic_cache.h"
+#include "kinetic_cache_file.h"
+#include "kinetic_writeback.h"
+#include "kinetic_keyfilter.h"
 #include "mock_kinetic_operation.h"
 #include "protobuf-c/protobuf-c.h"
 #include <stdio.h>
@@ -70,6 +78,79 @@ static void ConnectSession(void)
     TEST_ASSERT_EQUAL(DummyHandle, SessionHandle);
 }
 
+void test_KineticClient_StartTrace_should_open_the_specified_trace_file(void)
+{
+    KineticTrace_Open_ExpectAndReturn("./some_file.trace", 1024, 512, KINETIC_STATUS_SUCCESS);
+
+    KineticStatus status = KineticClient_StartTrace("./some_file.trace", 1024, 512);
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, status);
+}
+
+void test_KineticClient_StartTrace_should_return_KINETIC_STATUS_INVALID_upon_empty_path(void)
+{
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticClient_StartTrace(NULL, 0, 0));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticClient_StartTrace("", 0, 0));
+}
+
+void test_KineticClient_StopTrace_should_close_the_trace_file(void)
+{
+    KineticTrace_Close_Expect();
+
+    KineticClient_StopTrace();
+}
+
+void test_KineticClient_GetStats_should_collect_process_wide_stats_if_no_session_specified(void)
+{
+    KineticStats stats;
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_ResetStats(KINETIC_HANDLE_INVALID));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetStats(KINETIC_HANDLE_INVALID, &stats));
+    TEST_ASSERT_EQUAL(0, stats.operations);
+    TEST_ASSERT_EQUAL(0, KineticClient_GetLatencyPercentile(&stats.latency[2], 99.0));
+}
+
+void test_KineticClient_GetStats_should_collect_stats_for_the_specified_session(void)
+{
+    KineticConnection connection;
+    KINETIC_CONNECTION_INIT(&connection);
+    KineticStats stats;
+
+    KineticConnection_FromHandle_ExpectAndReturn(DummyHandle, &connection);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetStats(DummyHandle, &stats));
+    TEST_ASSERT_EQUAL(0, stats.operations);
+
+    KineticConnection_FromHandle_ExpectAndReturn(DummyHandle, NULL);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SESSION_INVALID,
+        KineticClient_ResetStats(DummyHandle));
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticClient_GetStats(DummyHandle, NULL));
+}
+
+void test_KineticClient_GetLastOperationTiming_should_report_timing_only_once_collected(void)
+{
+    KineticOperationTiming timing;
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticClient_GetLastOperationTiming(NULL));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_NOT_ATTEMPTED,
+        KineticClient_GetLastOperationTiming(&timing));
+
+    KineticClient_SetOperationTiming(true);
+    KineticStats_BeginOperation();
+    KineticStats_EndOperation(NULL, KINETIC_PROTO_MESSAGE_TYPE_NOOP, KINETIC_STATUS_SUCCESS);
+    KineticClient_SetOperationTiming(false);
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticClient_GetLastOperationTiming(&timing));
+}
+
 void test_KineticClient_Connect_should_configure_a_session_and_connect_to_specified_host(void)
 {
     ConnectSession();
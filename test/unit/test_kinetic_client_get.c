@@ -29,6 +29,14 @@
 #include "mock_kinetic_connection.h"
 #include "mock_kinetic_message.h"
 #include "mock_kinetic_pdu.h"
+#include "mock_kinetic_decoder.h"
+#include "mock_kinetic_trace.h"
+#include "kinetic_stats.h"
+#include "kinetic_hooks.h"
+#include "kinetic_cache.h"
+#include "kinetic_cache_file.h"
+#include "kinetic_writeback.h"
+#include "kinetic_keyfilter.h"
 #include <stdio.h>
 #include "protobuf-c/protobuf-c.h"
 #include "byte_array.h"
@@ -24,7 +24,10 @@
 #include "kinetic_proto.h"
 #include "protobuf-c/protobuf-c.h"
 #include "kinetic_logger.h"
+#include "kinetic_transport.h"
+#include "kinetic_stats.h"
 #include "mock_kinetic_socket.h"
+#include "mock_kinetic_tls.h"
 #include <string.h>
 #include <time.h>
 
@@ -209,6 +212,47 @@ void test_KineticConnection_Connect_should_connect_to_specified_host_with_a_non_
     TEST_ASSERT_EQUAL_ByteArray(expected.session.hmacKey, connection.session.hmacKey);
 }
 
+void test_KineticConnection_Connect_should_establish_a_TLS_session_if_requested(void)
+{
+    LOG_LOCATION;
+    KineticConnection connection;
+    KINETIC_CONNECTION_INIT(&connection);
+    strcpy(connection.session.host, "valid-host.com");
+    connection.session.port = KINETIC_TLS_PORT;
+    connection.session.useTls = true;
+
+    KineticSocket_Connect_ExpectAndReturn(connection.session.host,
+                                          KINETIC_TLS_PORT, false, 24);
+    KineticTLS_Connect_ExpectAndReturn(&connection, KINETIC_STATUS_SUCCESS);
+
+    KineticStatus status = KineticConnection_Connect(&connection);
+
+    TEST_ASSERT_EQUAL(KINETIC_STATUS_SUCCESS, status);
+    TEST_ASSERT_TRUE(connection.connected);
+    TEST_ASSERT_EQUAL(24, connection.socket);
+}
+
+void test_KineticConnection_Connect_should_close_the_socket_if_TLS_negotiation_fails(void)
+{
+    LOG_LOCATION;
+    KineticConnection connection;
+    KINETIC_CONNECTION_INIT(&connection);
+    strcpy(connection.session.host, "valid-host.com");
+    connection.session.port = KINETIC_TLS_PORT;
+    connection.session.useTls = true;
+
+    KineticSocket_Connect_ExpectAndReturn(connection.session.host,
+                                          KINETIC_TLS_PORT, false, 24);
+    KineticTLS_Connect_ExpectAndReturn(&connection, KINETIC_STATUS_CONNECTION_ERROR);
+    KineticSocket_Close_Expect(24);
+
+    KineticStatus status = KineticConnection_Connect(&connection);
+
+    TEST_ASSERT_EQUAL(KINETIC_STATUS_CONNECTION_ERROR, status);
+    TEST_ASSERT_FALSE(connection.connected);
+    TEST_ASSERT_EQUAL(KINETIC_SOCKET_DESCRIPTOR_INVALID, connection.socket);
+}
+
 void test_KineticConnection_IncrementSequence_should_increment_the_sequence_count(void)
 {
     LOG_LOCATION;
@@ -0,0 +1,129 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#include "kinetic_decoder.h"
+#include "kinetic_types_internal.h"
+#include "kinetic_logger.h"
+#include "kinetic_proto.h"
+#include "mock_kinetic_pdu.h"
+#include "protobuf-c/protobuf-c.h"
+#include "unity.h"
+#include "unity_helper.h"
+
+static KineticConnection Connection;
+static KineticPDU PDUs[3];
+
+void setUp(void)
+{
+    KineticLogger_Init(NULL);
+    KINETIC_CONNECTION_INIT(&Connection);
+    for (int i = 0; i < 3; i++) {
+        KINETIC_PDU_INIT(&PDUs[i], &Connection);
+    }
+}
+
+void tearDown(void)
+{
+    KineticDecoder_Stop();
+    TEST_ASSERT_FALSE(KineticDecoder_IsEnabled());
+}
+
+void test_KineticDecoder_should_be_disabled_by_default(void)
+{
+    LOG_LOCATION;
+    TEST_ASSERT_FALSE(KineticDecoder_IsEnabled());
+}
+
+void test_KineticDecoder_Start_should_enable_the_decode_stage_until_stopped(void)
+{
+    LOG_LOCATION;
+
+    KineticStatus status = KineticDecoder_Start(2);
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, status);
+    TEST_ASSERT_TRUE(KineticDecoder_IsEnabled());
+
+    KineticDecoder_Stop();
+
+    TEST_ASSERT_FALSE(KineticDecoder_IsEnabled());
+}
+
+void test_KineticDecoder_Start_should_leave_the_decode_stage_disabled_if_no_workers_requested(void)
+{
+    LOG_LOCATION;
+
+    KineticStatus status = KineticDecoder_Start(0);
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, status);
+    TEST_ASSERT_FALSE(KineticDecoder_IsEnabled());
+}
+
+void test_KineticDecoder_Submit_should_decode_inline_if_decode_stage_is_disabled(void)
+{
+    LOG_LOCATION;
+    KineticPDU_Decode_ExpectAndReturn(&PDUs[0], KINETIC_STATUS_VERSION_MISMATCH);
+
+    KineticStatus status = KineticDecoder_Submit(&PDUs[0]);
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, status);
+    TEST_ASSERT_TRUE(PDUs[0].decoded);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_VERSION_MISMATCH,
+                                    KineticDecoder_Wait(&PDUs[0]));
+    TEST_ASSERT_EQUAL(1, Connection.decodeSubmitted);
+    TEST_ASSERT_EQUAL(1, Connection.decodeCompleted);
+}
+
+void test_KineticDecoder_Wait_should_return_the_status_of_a_response_decoded_by_a_worker(void)
+{
+    LOG_LOCATION;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, KineticDecoder_Start(2));
+    KineticPDU_Decode_ExpectAndReturn(&PDUs[0], KINETIC_STATUS_DATA_ERROR);
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+                                    KineticDecoder_Submit(&PDUs[0]));
+    KineticStatus status = KineticDecoder_Wait(&PDUs[0]);
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_DATA_ERROR, status);
+    TEST_ASSERT_TRUE(PDUs[0].decoded);
+    TEST_ASSERT_EQUAL(0, PDUs[0].decodeTicket);
+    TEST_ASSERT_EQUAL(1, Connection.decodeCompleted);
+}
+
+void test_KineticDecoder_should_complete_responses_in_submission_order_for_a_connection(void)
+{
+    LOG_LOCATION;
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS, KineticDecoder_Start(1));
+    KineticPDU_Decode_ExpectAndReturn(&PDUs[0], KINETIC_STATUS_SUCCESS);
+    KineticPDU_Decode_ExpectAndReturn(&PDUs[1], KINETIC_STATUS_SUCCESS);
+    KineticPDU_Decode_ExpectAndReturn(&PDUs[2], KINETIC_STATUS_DEVICE_BUSY);
+
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+                                        KineticDecoder_Submit(&PDUs[i]));
+        TEST_ASSERT_EQUAL(i, PDUs[i].decodeTicket);
+    }
+
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_DEVICE_BUSY,
+                                    KineticDecoder_Wait(&PDUs[2]));
+    TEST_ASSERT_TRUE(PDUs[0].decoded);
+    TEST_ASSERT_TRUE(PDUs[1].decoded);
+    TEST_ASSERT_EQUAL(3, Connection.decodeSubmitted);
+    TEST_ASSERT_EQUAL(3, Connection.decodeCompleted);
+}
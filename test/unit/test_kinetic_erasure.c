@@ -0,0 +1,162 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+
+
+#include "kinetic_erasure.h"
+#include "kinetic_types.h"
+#include "kinetic_types_internal.h"
+#include "kinetic_logger.h"
+#include "kinetic_proto.h"
+#include "protobuf-c/protobuf-c.h"
+#include "unity.h"
+#include "unity_helper.h"
+#include <string.h>
+#include <stdlib.h>
+
+#define CHUNK_LEN_MAX (40000)
+
+static uint8_t Chunks[KINETIC_ERASURE_CHUNKS_MAX][CHUNK_LEN_MAX];
+static uint8_t Original[KINETIC_ERASURE_CHUNKS_MAX][CHUNK_LEN_MAX];
+static uint8_t* ChunkPointers[KINETIC_ERASURE_CHUNKS_MAX];
+static KineticErasureCode Code;
+
+void setUp(void)
+{
+    KineticLogger_Init("stdout");
+    srand(1);
+    for (int i = 0; i < KINETIC_ERASURE_CHUNKS_MAX; i++) {
+        ChunkPointers[i] = Chunks[i];
+    }
+}
+
+void tearDown(void)
+{
+}
+
+// Fills the data chunks with random bytes, and encodes the parity chunks
+static void Encode(int dataChunks, int parityChunks, size_t len)
+{
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticErasure_Init(&Code, dataChunks, parityChunks));
+    for (int i = 0; i < dataChunks; i++) {
+        for (size_t j = 0; j < len; j++) {
+            Chunks[i][j] = (uint8_t)rand();
+        }
+    }
+    KineticErasure_Encode(&Code, ChunkPointers, &ChunkPointers[dataChunks], len);
+    for (int i = 0; i < dataChunks + parityChunks; i++) {
+        memcpy(Original[i], Chunks[i], len);
+    }
+}
+
+// Multiplies a and b one bit at a time, as a reference for the tables
+static uint8_t SlowMultiply(uint8_t a, uint8_t b)
+{
+    int product = 0;
+    int x = a;
+    for (int bit = 0; bit < 8; bit++) {
+        if (b & (1 << bit)) {
+            product ^= x;
+        }
+        x <<= 1;
+        if (x & 0x100) {
+            x ^= 0x11d;
+        }
+    }
+    return (uint8_t)product;
+}
+
+void test_KineticErasure_Multiply_should_multiply_in_GF256(void)
+{
+    for (int a = 0; a < 256; a++) {
+        for (int b = 0; b < 256; b++) {
+            TEST_ASSERT_EQUAL(SlowMultiply(a, b), KineticErasure_Multiply(a, b));
+        }
+    }
+}
+
+void test_KineticErasure_Init_should_reject_invalid_codes(void)
+{
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticErasure_Init(&Code, 0, 2));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticErasure_Init(&Code, 4, -1));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_INVALID,
+        KineticErasure_Init(&Code, KINETIC_ERASURE_CHUNKS_MAX, 1));
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+        KineticErasure_Init(&Code, KINETIC_ERASURE_CHUNKS_MAX - 1, 1));
+}
+
+void test_KineticErasure_Encode_should_compute_parity_with_the_code(void)
+{
+    // Lengths which leave tails for each width of kernel
+    const size_t lens[] = {1, 15, 17, 33, 100, 20000 + 7};
+    printf("Erasure coding kernel: %s\n", KineticErasure_GetKernel());
+    for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+        Encode(5, 3, lens[l]);
+        for (int i = 0; i < 3; i++) {
+            for (size_t j = 0; j < lens[l]; j++) {
+                uint8_t expected = 0;
+                for (int d = 0; d < 5; d++) {
+                    expected ^= SlowMultiply(Code.parity[i][d], Chunks[d][j]);
+                }
+                TEST_ASSERT_EQUAL_HEX8(expected, Chunks[5 + i][j]);
+            }
+        }
+    }
+}
+
+void test_KineticErasure_Decode_should_reconstruct_from_any_data_chunks_of_the_chunks(void)
+{
+    const int dataChunks = 4, parityChunks = 3, total = 7;
+    const size_t len = CHUNK_LEN_MAX - 3;
+    Encode(dataChunks, parityChunks, len);
+
+    // Every combination of up to parityChunks chunks missing
+    for (int lost = 0; lost < (1 << total); lost++) {
+        if (__builtin_popcount(lost) > parityChunks) {
+            continue;
+        }
+        bool present[KINETIC_ERASURE_CHUNKS_MAX];
+        for (int i = 0; i < total; i++) {
+            present[i] = !(lost & (1 << i));
+            if (!present[i]) {
+                memset(Chunks[i], 0xAA, len);
+            }
+        }
+        TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_SUCCESS,
+            KineticErasure_Decode(&Code, ChunkPointers, present, len));
+        for (int i = 0; i < dataChunks; i++) {
+            TEST_ASSERT_EQUAL_MEMORY(Original[i], Chunks[i], len);
+        }
+        for (int i = dataChunks; i < total; i++) {
+            memcpy(Chunks[i], Original[i], len);
+        }
+    }
+}
+
+void test_KineticErasure_Decode_should_fail_without_enough_chunks(void)
+{
+    Encode(3, 2, 64);
+    bool present[KINETIC_ERASURE_CHUNKS_MAX] = {true, false, false, false, true};
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_DATA_ERROR,
+        KineticErasure_Decode(&Code, ChunkPointers, present, 64));
+}
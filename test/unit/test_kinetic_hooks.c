@@ -0,0 +1,169 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#include "kinetic_hooks.h"
+#include "kinetic_types.h"
+#include "kinetic_types_internal.h"
+#include "kinetic_logger.h"
+#include "kinetic_proto.h"
+#include "protobuf-c/protobuf-c.h"
+#include "unity.h"
+#include "unity_helper.h"
+#include <string.h>
+
+#define MAX_EVENTS (8)
+
+static KineticConnection Connection;
+static KineticPDU Request;
+static uint8_t KeyData[] = "some key";
+static uint8_t ValueData[] = "some value";
+static KineticHookInfo Events[MAX_EVENTS];
+static const char* EventNames[MAX_EVENTS];
+static int EventCount;
+static int Context;
+
+static void RecordEvent(const char* name, const KineticHookInfo* info, void* context)
+{
+    TEST_ASSERT_EQUAL_PTR(&Context, context);
+    TEST_ASSERT_TRUE(EventCount < MAX_EVENTS);
+    EventNames[EventCount] = name;
+    Events[EventCount++] = *info;
+}
+
+static void OnStarted(const KineticHookInfo* info, void* context)
+{
+    RecordEvent("started", info, context);
+}
+
+static void OnWritten(const KineticHookInfo* info, void* context)
+{
+    RecordEvent("written", info, context);
+}
+
+static void OnResponse(const KineticHookInfo* info, void* context)
+{
+    RecordEvent("response", info, context);
+}
+
+static void OnCompleted(const KineticHookInfo* info, void* context)
+{
+    RecordEvent("completed", info, context);
+}
+
+static const KineticHooks Hooks = {
+    .operationStarted = OnStarted,
+    .requestWritten = OnWritten,
+    .responseStarted = OnResponse,
+    .operationCompleted = OnCompleted,
+    .context = &Context,
+};
+
+void setUp(void)
+{
+    KineticLogger_Init(NULL);
+    KINETIC_CONNECTION_INIT(&Connection);
+    Connection.connectionID = 12345;
+    Connection.sequence = 7;
+    KINETIC_PDU_INIT_WITH_MESSAGE(&Request, &Connection);
+    Request.protoData.message.header.messageType = KINETIC_PROTO_MESSAGE_TYPE_PUT;
+    Request.protoData.message.header.has_messageType = true;
+    Request.entry.key = ByteBuffer_Create(KeyData, sizeof(KeyData));
+    Request.entry.key.bytesUsed = 8;
+    Request.entry.value = ByteBuffer_Create(ValueData, sizeof(ValueData));
+    Request.entry.value.bytesUsed = 10;
+    EventCount = 0;
+    memset(Events, 0, sizeof(Events));
+}
+
+void tearDown(void)
+{
+    KineticHooks_Set(NULL);
+}
+
+static void ExecuteOperation(void)
+{
+    if (KINETIC_HOOKS_ENABLED()) {
+        KineticHooks_BeginOperation(&Request);
+    }
+    KINETIC_HOOK(KINETIC_HOOK_EVENT_REQUEST_WRITTEN, KINETIC_STATUS_SUCCESS);
+    if (KINETIC_HOOKS_ENABLED()) {
+        KineticHooks_SetResponseValueLength(42);
+        KineticHooks_Invoke(KINETIC_HOOK_EVENT_RESPONSE_STARTED, KINETIC_STATUS_SUCCESS);
+    }
+    KINETIC_HOOK(KINETIC_HOOK_EVENT_OPERATION_COMPLETED, KINETIC_STATUS_VERSION_FAILURE);
+}
+
+void test_KineticHooks_should_not_invoke_anything_if_no_hooks_registered(void)
+{
+    TEST_ASSERT_FALSE(KINETIC_HOOKS_ENABLED());
+
+    ExecuteOperation();
+
+    TEST_ASSERT_EQUAL(0, EventCount);
+}
+
+void test_KineticHooks_should_invoke_each_hook_with_details_of_the_operation(void)
+{
+    KineticHooks_Set(&Hooks);
+    TEST_ASSERT_TRUE(KINETIC_HOOKS_ENABLED());
+
+    ExecuteOperation();
+
+    TEST_ASSERT_EQUAL(4, EventCount);
+    TEST_ASSERT_EQUAL_STRING("started", EventNames[0]);
+    TEST_ASSERT_EQUAL_STRING("written", EventNames[1]);
+    TEST_ASSERT_EQUAL_STRING("response", EventNames[2]);
+    TEST_ASSERT_EQUAL_STRING("completed", EventNames[3]);
+    for (int i = 0; i < EventCount; i++) {
+        TEST_ASSERT_EQUAL(12345, Events[i].connectionID);
+        TEST_ASSERT_EQUAL(7, Events[i].sequence);
+        TEST_ASSERT_EQUAL(KINETIC_PROTO_MESSAGE_TYPE_PUT, Events[i].messageType);
+        TEST_ASSERT_EQUAL(8, Events[i].keyLength);
+        TEST_ASSERT_EQUAL(10, Events[i].valueLength);
+    }
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_NOT_ATTEMPTED, Events[0].status);
+    TEST_ASSERT_EQUAL(0, Events[1].responseValueLength);
+    TEST_ASSERT_EQUAL(42, Events[2].responseValueLength);
+    TEST_ASSERT_EQUAL_KineticStatus(KINETIC_STATUS_VERSION_FAILURE, Events[3].status);
+}
+
+void test_KineticHooks_should_skip_callbacks_which_are_not_specified(void)
+{
+    KineticHooks hooks = {.operationCompleted = OnCompleted, .context = &Context};
+    KineticHooks_Set(&hooks);
+
+    ExecuteOperation();
+
+    TEST_ASSERT_EQUAL(1, EventCount);
+    TEST_ASSERT_EQUAL_STRING("completed", EventNames[0]);
+}
+
+void test_KineticHooks_should_ignore_operations_started_before_hooks_were_registered(void)
+{
+    KineticHooks_BeginOperation(&Request);
+    KineticHooks_Set(&Hooks);
+
+    KINETIC_HOOK(KINETIC_HOOK_EVENT_REQUEST_WRITTEN, KINETIC_STATUS_SUCCESS);
+    KINETIC_HOOK(KINETIC_HOOK_EVENT_OPERATION_COMPLETED, KINETIC_STATUS_SUCCESS);
+    TEST_ASSERT_EQUAL(0, EventCount);
+
+    ExecuteOperation();
+    TEST_ASSERT_EQUAL(4, EventCount);
+}
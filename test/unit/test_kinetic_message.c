@@ -147,3 +147,105 @@ void test_KineticMessage_ConfigureKeyValue_should_configure_Body_KeyValue_and_ad
     TEST_ASSERT_FALSE(message.keyValue.has_force);
     TEST_ASSERT_FALSE(message.keyValue.has_synchronization);
 }
+
+void test_KineticMessage_ConfigureKeyRange_should_configure_Body_Range_and_add_to_message(void)
+{
+    KineticMessage message;
+    KineticKeyRange range = {
+        .startKey = KeyBuffer,
+        .endKey = TagBuffer,
+        .startKeyInclusive = false,
+        .endKeyInclusive = true,
+        .maxReturned = 200,
+    };
+    memset(&message, 0, sizeof(KineticMessage));
+    KineticMessage_Init(&message);
+
+    KineticMessage_ConfigureKeyRange(&message, &range);
+
+    // Validate that message range and body container are enabled in protobuf
+    TEST_ASSERT_EQUAL_PTR(&message.body, message.command.body);
+    TEST_ASSERT_EQUAL_PTR(&message.body, message.proto.command->body);
+    TEST_ASSERT_EQUAL_PTR(&message.range, message.proto.command->body->range);
+    TEST_ASSERT_NULL(message.proto.command->body->keyValue);
+
+    // Validate range fields
+    TEST_ASSERT_TRUE(message.range.has_startKey);
+    TEST_ASSERT_ByteArray_EQUALS_ByteBuffer(message.range.startKey, range.startKey);
+    TEST_ASSERT_TRUE(message.range.has_endKey);
+    TEST_ASSERT_ByteArray_EQUALS_ByteBuffer(message.range.endKey, range.endKey);
+    TEST_ASSERT_TRUE(message.range.has_startKeyInclusive);
+    TEST_ASSERT_FALSE(message.range.startKeyInclusive);
+    TEST_ASSERT_TRUE(message.range.has_endKeyInclusive);
+    TEST_ASSERT_TRUE(message.range.endKeyInclusive);
+    TEST_ASSERT_TRUE(message.range.has_maxReturned);
+    TEST_ASSERT_EQUAL(200, message.range.maxReturned);
+    TEST_ASSERT_FALSE(message.range.has_reverse);
+}
+
+void test_KineticMessage_ConfigureGetLog_should_configure_Body_GetLog_and_add_to_message(void)
+{
+    KineticMessage message;
+    memset(&message, 0, sizeof(KineticMessage));
+    KineticMessage_Init(&message);
+
+    KineticMessage_ConfigureGetLog(&message, KINETIC_PROTO_GET_LOG_TYPE_CAPACITIES);
+
+    // Validate that message getLog and body container are enabled in protobuf
+    TEST_ASSERT_EQUAL_PTR(&message.body, message.command.body);
+    TEST_ASSERT_EQUAL_PTR(&message.body, message.proto.command->body);
+    TEST_ASSERT_EQUAL_PTR(&message.getLog, message.proto.command->body->getLog);
+    TEST_ASSERT_NULL(message.proto.command->body->keyValue);
+
+    // Validate the requested log type
+    TEST_ASSERT_EQUAL(1, message.getLog.n_type);
+    TEST_ASSERT_EQUAL(KINETIC_PROTO_GET_LOG_TYPE_CAPACITIES, message.getLog.type[0]);
+}
+
+void test_KineticMessage_ConfigureP2POperation_should_configure_Body_P2POperation_and_add_to_message(void)
+{
+    KineticMessage message;
+    KineticP2PPeer peer = {.host = "peer.local", .port = 8123, .tls = true};
+    KineticP2POperation operations[2] = {
+        {.key = KeyBuffer, .version = VersionBuffer, .newKey = TagBuffer},
+        {.key = KeyBuffer, .force = true},
+    };
+    KineticProto_P2POperation_Operation protoOperationData[2];
+    KineticProto_P2POperation_Operation* protoOperations[2] = {
+        &protoOperationData[0], &protoOperationData[1],
+    };
+    memset(&message, 0, sizeof(KineticMessage));
+    KineticMessage_Init(&message);
+
+    KineticMessage_ConfigureP2POperation(&message, &peer, operations, protoOperations, 2);
+
+    // Validate that message p2pOperation and body container are enabled in protobuf
+    TEST_ASSERT_EQUAL_PTR(&message.body, message.command.body);
+    TEST_ASSERT_EQUAL_PTR(&message.body, message.proto.command->body);
+    TEST_ASSERT_EQUAL_PTR(&message.p2pOperation, message.proto.command->body->p2pOperation);
+    TEST_ASSERT_NULL(message.proto.command->body->keyValue);
+
+    // Validate the peer
+    TEST_ASSERT_EQUAL_PTR(&message.p2pPeer, message.p2pOperation.peer);
+    TEST_ASSERT_EQUAL_STRING("peer.local", message.p2pPeer.hostname);
+    TEST_ASSERT_TRUE(message.p2pPeer.has_port);
+    TEST_ASSERT_EQUAL(8123, message.p2pPeer.port);
+    TEST_ASSERT_TRUE(message.p2pPeer.has_tls);
+    TEST_ASSERT_TRUE(message.p2pPeer.tls);
+
+    // Validate the operations
+    TEST_ASSERT_EQUAL(2, message.p2pOperation.n_operation);
+    TEST_ASSERT_EQUAL_PTR(protoOperations, message.p2pOperation.operation);
+    TEST_ASSERT_TRUE(protoOperationData[0].has_key);
+    TEST_ASSERT_ByteArray_EQUALS_ByteBuffer(protoOperationData[0].key, KeyBuffer);
+    TEST_ASSERT_TRUE(protoOperationData[0].has_version);
+    TEST_ASSERT_ByteArray_EQUALS_ByteBuffer(protoOperationData[0].version, VersionBuffer);
+    TEST_ASSERT_TRUE(protoOperationData[0].has_newKey);
+    TEST_ASSERT_ByteArray_EQUALS_ByteBuffer(protoOperationData[0].newKey, TagBuffer);
+    TEST_ASSERT_FALSE(protoOperationData[0].force);
+    TEST_ASSERT_TRUE(protoOperationData[1].has_key);
+    TEST_ASSERT_FALSE(protoOperationData[1].has_version);
+    TEST_ASSERT_FALSE(protoOperationData[1].has_newKey);
+    TEST_ASSERT_TRUE(protoOperationData[1].has_force);
+    TEST_ASSERT_TRUE(protoOperationData[1].force);
+}
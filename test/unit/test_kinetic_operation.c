@@ -168,6 +168,36 @@ void test_KineticOperation_BuildNoop_should_build_and_execute_a_NOOP_operation(v
     TEST_ASSERT_ByteBuffer_NULL(Response.entry.value);
 }
 
+void test_KineticOperation_BuildFlush_should_build_a_FLUSHALLDATA_operation(void)
+{
+    LOG_LOCATION;
+
+    KineticConnection_IncrementSequence_Expect(&Connection);
+
+    KineticOperation_BuildFlush(&Operation);
+
+    // FLUSHALLDATA
+    // Persists all entries written with KINETIC_SYNCHRONIZATION_WRITEBACK
+    //
+    // Request Message:
+    //
+    // command {
+    //   header {
+    //     clusterVersion: ...
+    //     identity: ...
+    //     connectionID: ...
+    //     sequence: ...
+    //     messageType: FLUSHALLDATA
+    //   }
+    // }
+    // hmac: "..."
+    //
+    TEST_ASSERT_TRUE(Request.proto->command->header->has_messageType);
+    TEST_ASSERT_EQUAL(KINETIC_PROTO_MESSAGE_TYPE_FLUSHALLDATA, Request.proto->command->header->messageType);
+    TEST_ASSERT_ByteBuffer_NULL(Request.entry.value);
+    TEST_ASSERT_ByteBuffer_NULL(Response.entry.value);
+}
+
 void test_KineticOperation_BuildPut_should_build_and_execute_a_PUT_operation_to_create_a_new_object(void)
 {
     LOG_LOCATION;
@@ -371,6 +401,32 @@ void test_KineticOperation_BuildGet_should_build_a_GET_operation_requesting_meta
 }
 
 
+void test_KineticOperation_BuildGetVersion_should_build_a_GETVERSION_operation_for_the_key_only(void)
+{
+    LOG_LOCATION;
+    const ByteArray key = ByteArray_CreateWithCString("foobar");
+    const ByteArray tag = ByteArray_CreateWithCString("some tag");
+    ByteArray value = {.data = ValueData, .len = sizeof(ValueData)};
+    KineticEntry entry = {
+        .key = ByteBuffer_CreateWithArray(key),
+        .tag = ByteBuffer_CreateWithArray(tag),
+        .value = ByteBuffer_CreateWithArray(value),
+    };
+
+    KineticConnection_IncrementSequence_Expect(&Connection);
+    KineticMessage_ConfigureKeyValue_Ignore();
+
+    KineticOperation_BuildGetVersion(&Operation, &entry);
+
+    TEST_ASSERT_TRUE(Request.proto->command->header->has_messageType);
+    TEST_ASSERT_EQUAL(KINETIC_PROTO_MESSAGE_TYPE_GETVERSION,
+                      Request.proto->command->header->messageType);
+    TEST_ASSERT_EQUAL_ByteBuffer(entry.key, Request.entry.key);
+    TEST_ASSERT_ByteBuffer_NULL(Request.entry.tag);
+    TEST_ASSERT_ByteBuffer_NULL(Request.entry.value);
+    TEST_ASSERT_ByteBuffer_NULL(Operation.response->entry.value);
+}
+
 void test_KineticOperation_BuildDelete_should_build_a_DELETE_operation(void)
 {
     LOG_LOCATION;
@@ -412,3 +468,69 @@ void test_KineticOperation_BuildDelete_should_build_a_DELETE_operation(void)
     TEST_ASSERT_ByteBuffer_NULL(Request.entry.value);
     TEST_ASSERT_ByteBuffer_NULL(Response.entry.value);
 }
+
+void test_KineticOperation_BuildGetKeyRange_should_build_a_GETKEYRANGE_operation(void)
+{
+    LOG_LOCATION;
+    KineticKeyRange range = {
+        .startKey = ByteBuffer_CreateWithArray(ByteArray_CreateWithCString("key0")),
+        .endKey = ByteBuffer_CreateWithArray(ByteArray_CreateWithCString("key9")),
+        .startKeyInclusive = true,
+        .endKeyInclusive = true,
+        .maxReturned = 10,
+    };
+
+    KineticConnection_IncrementSequence_Expect(&Connection);
+    KineticMessage_ConfigureKeyRange_Expect(&Request.protoData.message, &range);
+
+    KineticOperation_BuildGetKeyRange(&Operation, &range);
+
+    TEST_ASSERT_TRUE(Request.proto->command->header->has_messageType);
+    TEST_ASSERT_EQUAL(KINETIC_PROTO_MESSAGE_TYPE_GETKEYRANGE,
+                      Request.proto->command->header->messageType);
+    TEST_ASSERT_ByteBuffer_NULL(Request.entry.key);
+    TEST_ASSERT_ByteBuffer_NULL(Request.entry.value);
+    TEST_ASSERT_ByteBuffer_NULL(Operation.response->entry.value);
+}
+
+void test_KineticOperation_BuildGetLog_should_build_a_GETLOG_operation(void)
+{
+    LOG_LOCATION;
+
+    KineticConnection_IncrementSequence_Expect(&Connection);
+    KineticMessage_ConfigureGetLog_Expect(&Request.protoData.message,
+                                          KINETIC_PROTO_GET_LOG_TYPE_CAPACITIES);
+
+    KineticOperation_BuildGetLog(&Operation, KINETIC_PROTO_GET_LOG_TYPE_CAPACITIES);
+
+    TEST_ASSERT_TRUE(Request.proto->command->header->has_messageType);
+    TEST_ASSERT_EQUAL(KINETIC_PROTO_MESSAGE_TYPE_GETLOG,
+                      Request.proto->command->header->messageType);
+    TEST_ASSERT_ByteBuffer_NULL(Request.entry.key);
+    TEST_ASSERT_ByteBuffer_NULL(Request.entry.value);
+    TEST_ASSERT_ByteBuffer_NULL(Operation.response->entry.value);
+}
+
+void test_KineticOperation_BuildP2POperation_should_build_a_PEER2PEERPUSH_operation(void)
+{
+    LOG_LOCATION;
+    KineticP2PPeer peer = {.host = "localhost", .port = 8123};
+    KineticP2POperation operations[] = {
+        {.key = ByteBuffer_CreateWithArray(ByteArray_CreateWithCString("key0"))},
+    };
+    KineticProto_P2POperation_Operation protoOperation;
+    KineticProto_P2POperation_Operation* protoOperations[] = {&protoOperation};
+
+    KineticConnection_IncrementSequence_Expect(&Connection);
+    KineticMessage_ConfigureP2POperation_Expect(&Request.protoData.message,
+        &peer, operations, protoOperations, 1);
+
+    KineticOperation_BuildP2POperation(&Operation, &peer, operations, protoOperations, 1);
+
+    TEST_ASSERT_TRUE(Request.proto->command->header->has_messageType);
+    TEST_ASSERT_EQUAL(KINETIC_PROTO_MESSAGE_TYPE_PEER2PEERPUSH,
+                      Request.proto->command->header->messageType);
+    TEST_ASSERT_ByteBuffer_NULL(Request.entry.key);
+    TEST_ASSERT_ByteBuffer_NULL(Request.entry.value);
+    TEST_ASSERT_ByteBuffer_NULL(Operation.response->entry.value);
+}
@@ -0,0 +1,59 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#include "kinetic_probes.h"
+#include "unity.h"
+#include "unity_helper.h"
+#include <stdint.h>
+
+static int EvaluationCount;
+
+static int64_t CountEvaluation(int64_t value)
+{
+    EvaluationCount++;
+    return value;
+}
+
+void setUp(void)
+{
+    EvaluationCount = 0;
+}
+
+void tearDown(void)
+{
+}
+
+void test_KINETIC_PROBE_should_only_evaluate_arguments_if_probes_are_compiled_in(void)
+{
+    int64_t sequence = 7;
+    KINETIC_PROBE1(probe_test, CountEvaluation(sequence));
+    KINETIC_PROBE2(probe_test, CountEvaluation(1), sequence);
+    KINETIC_PROBE3(probe_test, CountEvaluation(1), CountEvaluation(2), sequence);
+    KINETIC_PROBE4(probe_test, CountEvaluation(1), CountEvaluation(2),
+                   CountEvaluation(3), sequence);
+    KINETIC_PROBE5(probe_test, CountEvaluation(1), CountEvaluation(2),
+                   CountEvaluation(3), CountEvaluation(4), sequence);
+
+#ifdef KINETIC_USDT
+    TEST_ASSERT_EQUAL(11, EvaluationCount);
+#else
+    TEST_ASSERT_EQUAL(0, EvaluationCount);
+#endif
+}
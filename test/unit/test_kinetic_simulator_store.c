@@ -0,0 +1,189 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#include "kinetic_simulator_store.h"
+#include "kinetic_types.h"
+#include "unity.h"
+#include "unity_helper.h"
+#include <stdio.h>
+#include <string.h>
+
+static KineticSimulatorStore* Store;
+
+static ByteArray Key(const char* key)
+{
+    return (ByteArray) {.data = (uint8_t*)key, .len = strlen(key)};
+}
+
+static KineticSimulatorEntry* Put(const char* key, const char* value)
+{
+    return KineticSimulatorStore_Put(Store, Key(key), Key(value),
+                                     BYTE_ARRAY_NONE, BYTE_ARRAY_NONE, 0);
+}
+
+static void AssertEntryKey(const char* expected, const KineticSimulatorEntry* entry)
+{
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL(strlen(expected), entry->key.len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, entry->key.data, entry->key.len);
+}
+
+void setUp(void)
+{
+    Store = KineticSimulatorStore_Create();
+    TEST_ASSERT_NOT_NULL(Store);
+}
+
+void tearDown(void)
+{
+    KineticSimulatorStore_Destroy(Store);
+    Store = NULL;
+}
+
+void test_KineticSimulatorStore_CompareKeys_should_order_bytewise_with_prefixes_first(void)
+{
+    TEST_ASSERT_EQUAL(0, KineticSimulatorStore_CompareKeys(Key("abc"), Key("abc")));
+    TEST_ASSERT_TRUE(KineticSimulatorStore_CompareKeys(Key("abc"), Key("abd")) < 0);
+    TEST_ASSERT_TRUE(KineticSimulatorStore_CompareKeys(Key("ab"), Key("abc")) < 0);
+    TEST_ASSERT_TRUE(KineticSimulatorStore_CompareKeys(Key("b"), Key("abc")) > 0);
+    TEST_ASSERT_TRUE(KineticSimulatorStore_CompareKeys(BYTE_ARRAY_NONE, Key("a")) < 0);
+
+    uint8_t high[] = {0xFF}, low[] = {0x01};
+    TEST_ASSERT_TRUE(KineticSimulatorStore_CompareKeys(
+        (ByteArray) {.data = high, .len = 1}, (ByteArray) {.data = low, .len = 1}) > 0);
+}
+
+void test_KineticSimulatorStore_Put_should_store_copies_of_entry_fields(void)
+{
+    char key[] = "key", value[] = "value", version[] = "v1", tag[] = "tag";
+    KineticSimulatorEntry* entry = KineticSimulatorStore_Put(Store,
+        Key(key), Key(value), Key(version), Key(tag), 3);
+    memset(value, 'x', strlen(value));
+
+    TEST_ASSERT_EQUAL_PTR(entry, KineticSimulatorStore_Get(Store, Key("key")));
+    TEST_ASSERT_EQUAL_MEMORY("value", entry->value.data, 5);
+    TEST_ASSERT_EQUAL_MEMORY("v1", entry->version.data, 2);
+    TEST_ASSERT_EQUAL_MEMORY("tag", entry->tag.data, 3);
+    TEST_ASSERT_EQUAL(3, entry->algorithm);
+    TEST_ASSERT_EQUAL(1, Store->count);
+    TEST_ASSERT_EQUAL(3 + 5 + 2 + 3, Store->bytes);
+}
+
+void test_KineticSimulatorStore_Put_should_replace_existing_entries(void)
+{
+    Put("a", "1");
+    Put("b", "2");
+    Put("c", "3");
+    KineticSimulatorEntry* entry = Put("b", "replaced");
+
+    TEST_ASSERT_EQUAL(3, Store->count);
+    TEST_ASSERT_EQUAL((1 + 1) + (1 + 8) + (1 + 1), Store->bytes);
+    TEST_ASSERT_EQUAL_PTR(entry, KineticSimulatorStore_Get(Store, Key("b")));
+    TEST_ASSERT_EQUAL_MEMORY("replaced", entry->value.data, 8);
+    AssertEntryKey("a", entry->previous);
+    AssertEntryKey("c", entry->next[0]);
+    TEST_ASSERT_EQUAL_PTR(entry, entry->next[0]->previous);
+}
+
+void test_KineticSimulatorStore_Get_should_return_NULL_for_missing_keys(void)
+{
+    TEST_ASSERT_NULL(KineticSimulatorStore_Get(Store, Key("missing")));
+    Put("key", "value");
+    TEST_ASSERT_NULL(KineticSimulatorStore_Get(Store, Key("ke")));
+    TEST_ASSERT_NULL(KineticSimulatorStore_Get(Store, Key("key0")));
+}
+
+void test_KineticSimulatorStore_Delete_should_unlink_entries(void)
+{
+    Put("a", "1");
+    Put("b", "2");
+    Put("c", "3");
+
+    TEST_ASSERT_TRUE(KineticSimulatorStore_Delete(Store, Key("b")));
+    TEST_ASSERT_FALSE(KineticSimulatorStore_Delete(Store, Key("b")));
+    TEST_ASSERT_NULL(KineticSimulatorStore_Get(Store, Key("b")));
+    TEST_ASSERT_EQUAL(2, Store->count);
+    TEST_ASSERT_EQUAL(4, Store->bytes);
+
+    KineticSimulatorEntry* last = KineticSimulatorStore_Last(Store);
+    AssertEntryKey("c", last);
+    AssertEntryKey("a", last->previous);
+    TEST_ASSERT_NULL(last->previous->previous);
+}
+
+void test_KineticSimulatorStore_Next_and_Previous_should_find_neighbouring_keys(void)
+{
+    Put("b", "");
+    Put("d", "");
+    Put("f", "");
+
+    AssertEntryKey("d", KineticSimulatorStore_Next(Store, Key("b"), false));
+    AssertEntryKey("b", KineticSimulatorStore_Next(Store, Key("b"), true));
+    AssertEntryKey("b", KineticSimulatorStore_Next(Store, Key("a"), false));
+    AssertEntryKey("f", KineticSimulatorStore_Next(Store, Key("e"), true));
+    TEST_ASSERT_NULL(KineticSimulatorStore_Next(Store, Key("f"), false));
+
+    AssertEntryKey("b", KineticSimulatorStore_Previous(Store, Key("d"), false));
+    AssertEntryKey("d", KineticSimulatorStore_Previous(Store, Key("d"), true));
+    AssertEntryKey("f", KineticSimulatorStore_Previous(Store, Key("z"), false));
+    TEST_ASSERT_NULL(KineticSimulatorStore_Previous(Store, Key("b"), false));
+    TEST_ASSERT_NULL(KineticSimulatorStore_Previous(Store, Key("a"), true));
+}
+
+void test_KineticSimulatorStore_should_keep_many_entries_in_key_order(void)
+{
+    char key[16];
+    for (int i = 0; i < 1000; i++) {
+        // Insert in a scattered order
+        snprintf(key, sizeof(key), "key%04d", (i * 7919) % 1000);
+        TEST_ASSERT_NOT_NULL(Put(key, "value"));
+    }
+    TEST_ASSERT_EQUAL(1000, Store->count);
+
+    int count = 0;
+    for (KineticSimulatorEntry* entry = KineticSimulatorStore_First(Store);
+         entry != NULL; entry = entry->next[0]) {
+        snprintf(key, sizeof(key), "key%04d", count++);
+        AssertEntryKey(key, entry);
+    }
+    TEST_ASSERT_EQUAL(1000, count);
+
+    for (KineticSimulatorEntry* entry = KineticSimulatorStore_Last(Store);
+         entry != NULL; entry = entry->previous) {
+        snprintf(key, sizeof(key), "key%04d", --count);
+        AssertEntryKey(key, entry);
+    }
+    TEST_ASSERT_EQUAL(0, count);
+}
+
+void test_KineticSimulatorStore_Clear_should_remove_all_entries(void)
+{
+    Put("a", "1");
+    Put("b", "2");
+
+    KineticSimulatorStore_Clear(Store);
+
+    TEST_ASSERT_EQUAL(0, Store->count);
+    TEST_ASSERT_EQUAL(0, Store->bytes);
+    TEST_ASSERT_NULL(KineticSimulatorStore_First(Store));
+    TEST_ASSERT_NULL(KineticSimulatorStore_Last(Store));
+    TEST_ASSERT_NOT_NULL(Put("c", "3"));
+    AssertEntryKey("c", KineticSimulatorStore_First(Store));
+}
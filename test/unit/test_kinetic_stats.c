@@ -0,0 +1,260 @@
+/*
+* kinetic-c
+* Copyright (C) 2014 Seagate Technology.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*/
+
+#include "kinetic_stats.h"
+#include "kinetic_types_internal.h"
+#include "kinetic_logger.h"
+#include "kinetic_proto.h"
+#include "protobuf-c/protobuf-c.h"
+#include "unity.h"
+#include "unity_helper.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+static KineticConnection Connection;
+static KineticStats Stats;
+
+void setUp(void)
+{
+    KineticLogger_Init(NULL);
+    KINETIC_CONNECTION_INIT(&Connection);
+    KineticStats_Reset(NULL);
+    KineticStats_SetTimingEnabled(false);
+}
+
+void tearDown(void)
+{
+    free(Connection.stats);
+    Connection.stats = NULL;
+}
+
+void test_KineticStats_BucketIndex_should_map_small_values_to_their_own_buckets(void)
+{
+    for (uint64_t value = 0; value < 16; value++) {
+        TEST_ASSERT_EQUAL(value, KineticStats_BucketIndex(value));
+        TEST_ASSERT_EQUAL(value, KineticStats_BucketUpperBound(value));
+    }
+}
+
+void test_KineticStats_BucketIndex_should_bound_relative_error_of_recorded_values(void)
+{
+    uint64_t values[] = {17, 100, 999, 1000, 123456, 1000000, 40000000, 5000000000ull};
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        size_t index = KineticStats_BucketIndex(values[i]);
+        uint64_t upper = KineticStats_BucketUpperBound(index);
+        TEST_ASSERT_TRUE(upper >= values[i]);
+        TEST_ASSERT_TRUE((upper - values[i]) <= values[i] / 8);
+        TEST_ASSERT_TRUE(KineticStats_BucketUpperBound(index - 1) < values[i]);
+    }
+}
+
+void test_KineticStats_BucketIndex_should_clamp_huge_values_into_the_last_bucket(void)
+{
+    TEST_ASSERT_EQUAL(KINETIC_STATS_LATENCY_BUCKETS - 1, KineticStats_BucketIndex(UINT64_MAX));
+    TEST_ASSERT_EQUAL(UINT64_MAX,
+        KineticStats_BucketUpperBound(KINETIC_STATS_LATENCY_BUCKETS - 1));
+}
+
+void test_KineticStats_Percentile_should_return_upper_bound_of_bucket_holding_percentile(void)
+{
+    KineticLatencyHistogram histogram;
+    memset(&histogram, 0, sizeof(histogram));
+    TEST_ASSERT_EQUAL(0, KineticStats_Percentile(&histogram, 50.0));
+
+    for (uint64_t i = 1; i <= 100; i++) {
+        histogram.count++;
+        histogram.buckets[KineticStats_BucketIndex(i * 1000)]++;
+    }
+
+    uint64_t p50 = KineticStats_Percentile(&histogram, 50.0);
+    TEST_ASSERT_TRUE(p50 >= 50000 && p50 <= 50000 + 50000 / 8);
+    uint64_t p99 = KineticStats_Percentile(&histogram, 99.0);
+    TEST_ASSERT_TRUE(p99 >= 99000 && p99 <= 99000 + 99000 / 8);
+    uint64_t p100 = KineticStats_Percentile(&histogram, 100.0);
+    TEST_ASSERT_TRUE(p100 >= 100000);
+}
+
+void test_KineticStats_EndOperation_should_record_operation_process_wide_and_for_the_session(void)
+{
+    KineticStats_BeginOperation();
+    KineticStats_CountSyscall();
+    KineticStats_CountSent(100);
+    KineticStats_CountSyscall();
+    KineticStats_CountReceived(42);
+    KineticStats_EndOperation(&Connection,
+        KINETIC_PROTO_MESSAGE_TYPE_GET, KINETIC_STATUS_SUCCESS);
+
+    KineticStats_BeginOperation();
+    KineticStats_EndOperation(&Connection,
+        KINETIC_PROTO_MESSAGE_TYPE_PUT, KINETIC_STATUS_VERSION_FAILURE);
+
+    KineticStats_Get(&Connection, &Stats);
+    TEST_ASSERT_EQUAL(2, Stats.operations);
+    TEST_ASSERT_EQUAL(100, Stats.bytesSent);
+    TEST_ASSERT_EQUAL(42, Stats.bytesReceived);
+    TEST_ASSERT_EQUAL(2, Stats.syscalls);
+    TEST_ASSERT_EQUAL(1, Stats.statusCounts[KINETIC_STATUS_SUCCESS]);
+    TEST_ASSERT_EQUAL(1, Stats.statusCounts[KINETIC_STATUS_VERSION_FAILURE]);
+    TEST_ASSERT_EQUAL(1, Stats.latency[KINETIC_PROTO_MESSAGE_TYPE_GET].count);
+    TEST_ASSERT_EQUAL(1, Stats.latency[KINETIC_PROTO_MESSAGE_TYPE_PUT].count);
+    TEST_ASSERT_EQUAL(0, Stats.latency[KINETIC_PROTO_MESSAGE_TYPE_DELETE].count);
+
+    KineticStats_Get(NULL, &Stats);
+    TEST_ASSERT_EQUAL(2, Stats.operations);
+    TEST_ASSERT_EQUAL(100, Stats.bytesSent);
+    TEST_ASSERT_EQUAL(1, Stats.latency[KINETIC_PROTO_MESSAGE_TYPE_GET].count);
+}
+
+void test_KineticStats_AbandonOperation_should_end_the_operation_without_recording_it(void)
+{
+    KineticStats_BeginOperation();
+    KineticStats_AbandonOperation();
+    KineticStats_EndOperation(&Connection,
+        KINETIC_PROTO_MESSAGE_TYPE_PUT, KINETIC_STATUS_SUCCESS);
+
+    KineticStats_Get(&Connection, &Stats);
+    TEST_ASSERT_EQUAL(0, Stats.operations);
+    KineticStats_Get(NULL, &Stats);
+    TEST_ASSERT_EQUAL(0, Stats.operations);
+}
+
+void test_KineticStats_EndOperation_should_count_invalid_status_and_unknown_message_types(void)
+{
+    KineticStats_BeginOperation();
+    KineticStats_EndOperation(NULL,
+        KINETIC_PROTO_MESSAGE_TYPE_INVALID_MESSAGE_TYPE, KINETIC_STATUS_INVALID);
+
+    KineticStats_Get(NULL, &Stats);
+    TEST_ASSERT_EQUAL(1, Stats.operations);
+    TEST_ASSERT_EQUAL(1, Stats.invalidStatusCount);
+    TEST_ASSERT_EQUAL(1, Stats.latency[0].count);
+    TEST_ASSERT_NULL(Connection.stats);
+}
+
+void test_KineticStats_Reset_should_clear_session_or_process_wide_stats(void)
+{
+    KineticStats_BeginOperation();
+    KineticStats_EndOperation(&Connection,
+        KINETIC_PROTO_MESSAGE_TYPE_NOOP, KINETIC_STATUS_SUCCESS);
+
+    KineticStats_Reset(&Connection);
+    KineticStats_Get(&Connection, &Stats);
+    TEST_ASSERT_EQUAL(0, Stats.operations);
+    KineticStats_Get(NULL, &Stats);
+    TEST_ASSERT_EQUAL(1, Stats.operations);
+
+    KineticStats_Reset(NULL);
+    KineticStats_Get(NULL, &Stats);
+    TEST_ASSERT_EQUAL(0, Stats.operations);
+    TEST_ASSERT_EQUAL(0, Stats.latency[KINETIC_PROTO_MESSAGE_TYPE_NOOP].count);
+}
+
+void test_KineticStats_should_not_time_stages_while_timing_is_disabled(void)
+{
+    KineticOperationTiming timing;
+
+    KineticStats_BeginOperation();
+    uint64_t start = KINETIC_STATS_STAGE_BEGIN();
+    TEST_ASSERT_EQUAL(0, start);
+    KINETIC_STATS_STAGE_END(KINETIC_OPERATION_STAGE_SEND, start);
+    KineticStats_EndOperation(&Connection,
+        KINETIC_PROTO_MESSAGE_TYPE_GET, KINETIC_STATUS_SUCCESS);
+
+    TEST_ASSERT_FALSE(KineticStats_GetLastOperationTiming(&timing));
+    KineticStats_Get(&Connection, &Stats);
+    TEST_ASSERT_EQUAL(1, Stats.operations);
+    for (int stage = 0; stage < KINETIC_OPERATION_STAGE_COUNT; stage++) {
+        TEST_ASSERT_EQUAL(0, Stats.stages[stage].count);
+    }
+}
+
+void test_KineticStats_should_record_stage_breakdown_while_timing_is_enabled(void)
+{
+    KineticOperationTiming timing;
+    KineticStats_SetTimingEnabled(true);
+
+    KineticStats_BeginOperation();
+    KineticStats_EndBuildStage();
+    uint64_t start = KINETIC_STATS_STAGE_BEGIN();
+    TEST_ASSERT_TRUE(start != 0);
+    KINETIC_STATS_STAGE_END(KINETIC_OPERATION_STAGE_SEND, start);
+    KineticStats_EndStage(KINETIC_OPERATION_STAGE_WAIT, KineticStats_Now() - 5000);
+    KineticStats_EndStage(KINETIC_OPERATION_STAGE_WAIT, KineticStats_Now() - 5000);
+    KineticStats_EndOperation(&Connection,
+        KINETIC_PROTO_MESSAGE_TYPE_PUT, KINETIC_STATUS_SUCCESS);
+
+    TEST_ASSERT_TRUE(KineticStats_GetLastOperationTiming(&timing));
+    TEST_ASSERT_TRUE(timing.stageNanoseconds[KINETIC_OPERATION_STAGE_WAIT] >= 10000);
+    TEST_ASSERT_EQUAL(0, timing.stageNanoseconds[KINETIC_OPERATION_STAGE_DECODE]);
+    TEST_ASSERT_TRUE(timing.totalNanoseconds >= timing.stageNanoseconds[KINETIC_OPERATION_STAGE_BUILD]);
+
+    KineticStats_Get(&Connection, &Stats);
+    TEST_ASSERT_EQUAL(1, Stats.stages[KINETIC_OPERATION_STAGE_BUILD].count);
+    TEST_ASSERT_EQUAL(1, Stats.stages[KINETIC_OPERATION_STAGE_SEND].count);
+    TEST_ASSERT_EQUAL(1, Stats.stages[KINETIC_OPERATION_STAGE_WAIT].count);
+    TEST_ASSERT_TRUE(Stats.stages[KINETIC_OPERATION_STAGE_WAIT].totalNanoseconds >= 10000);
+    KineticStats_Get(NULL, &Stats);
+    TEST_ASSERT_EQUAL(1, Stats.stages[KINETIC_OPERATION_STAGE_WAIT].count);
+}
+
+void test_KineticStats_EndStage_should_be_ignored_outside_of_an_operation(void)
+{
+    KineticStats_SetTimingEnabled(true);
+
+    KineticStats_EndStage(KINETIC_OPERATION_STAGE_SEND, KineticStats_Now());
+    KineticStats_EndOperation(&Connection,
+        KINETIC_PROTO_MESSAGE_TYPE_PUT, KINETIC_STATUS_SUCCESS);
+
+    KineticStats_Get(&Connection, &Stats);
+    TEST_ASSERT_EQUAL(0, Stats.operations);
+    TEST_ASSERT_EQUAL(0, Stats.stages[KINETIC_OPERATION_STAGE_SEND].count);
+}
+
+#define STATS_TEST_THREADS (KINETIC_STATS_SHARDS * 2)
+#define STATS_TEST_OPERATIONS (1000)
+
+static void* RecordOperations(void* arg)
+{
+    (void)arg;
+    for (int i = 0; i < STATS_TEST_OPERATIONS; i++) {
+            KineticStats_BeginOperation();
+        KineticStats_CountSent(1);
+        KineticStats_EndOperation(NULL,
+            KINETIC_PROTO_MESSAGE_TYPE_GET, KINETIC_STATUS_SUCCESS);
+    }
+    return NULL;
+}
+
+void test_KineticStats_should_sum_operations_recorded_by_all_threads(void)
+{
+    pthread_t threads[STATS_TEST_THREADS];
+    for (int i = 0; i < STATS_TEST_THREADS; i++) {
+        TEST_ASSERT_EQUAL(0, pthread_create(&threads[i], NULL, RecordOperations, NULL));
+    }
+    for (int i = 0; i < STATS_TEST_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    KineticStats_Get(NULL, &Stats);
+    TEST_ASSERT_EQUAL(STATS_TEST_THREADS * STATS_TEST_OPERATIONS, Stats.operations);
+    TEST_ASSERT_EQUAL(STATS_TEST_THREADS * STATS_TEST_OPERATIONS, Stats.bytesSent);
+    TEST_ASSERT_EQUAL(STATS_TEST_THREADS * STATS_TEST_OPERATIONS,
+        Stats.latency[KINETIC_PROTO_MESSAGE_TYPE_GET].count);
+}
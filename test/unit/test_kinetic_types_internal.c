@@ -148,3 +148,25 @@ void test_KineticProto_Algorithm_from_KineticAlgorithm_should_map_from_public_to
         KINETIC_PROTO_ALGORITHM_INVALID_ALGORITHM,
         KineticProto_Algorithm_from_KineticAlgorithm((KineticAlgorithm) - 19));
 }
+
+void test_Kinetic_HashKey_should_mix_the_FNV1a_hash_of_the_key(void)
+{
+    // FNV-1a of "a" is 0xaf63dc4c8601ec8c, before the final mix
+    TEST_ASSERT_EQUAL_HEX64(0xed8170de1919a24dull, Kinetic_HashKey((const uint8_t*)"a", 1));
+
+    // The last byte of the key changes the high bits too
+    uint64_t hash1 = Kinetic_HashKey((const uint8_t*)"key1", 4);
+    uint64_t hash2 = Kinetic_HashKey((const uint8_t*)"key2", 4);
+    TEST_ASSERT_TRUE((hash1 >> 32) != (hash2 >> 32));
+}
+
+void test_Kinetic_IsConnectionFailure_should_only_be_true_for_connection_and_socket_errors(void)
+{
+    TEST_ASSERT_TRUE(Kinetic_IsConnectionFailure(KINETIC_STATUS_CONNECTION_ERROR));
+    TEST_ASSERT_TRUE(Kinetic_IsConnectionFailure(KINETIC_STATUS_SOCKET_ERROR));
+    TEST_ASSERT_TRUE(Kinetic_IsConnectionFailure(KINETIC_STATUS_SOCKET_TIMEOUT));
+
+    TEST_ASSERT_FALSE(Kinetic_IsConnectionFailure(KINETIC_STATUS_SUCCESS));
+    TEST_ASSERT_FALSE(Kinetic_IsConnectionFailure(KINETIC_STATUS_DATA_ERROR));
+    TEST_ASSERT_FALSE(Kinetic_IsConnectionFailure(KINETIC_STATUS_VERSION_FAILURE));
+}